@@ -10,10 +10,12 @@
 #include "app_cmd.h"
 #include "app_status.h"
 #include "tag_persistence.h"
+#include "tag_slot_cache.h"
 #include "nrf_pwr_mgmt.h"
 #include "settings.h"
 #include "delayed_reset.h"
 #include "netdata.h"
+#include "crc32.h"
 
 
 #define NRF_LOG_MODULE_NAME app_cmd
@@ -30,6 +32,74 @@ static void change_slot_auto(uint8_t slot_new) {
     apply_slot_change(slot_now, slot_new);
 }
 
+// Also sends the frames a processor hands over before it returns, the next response goes to another frame
+static void auto_response_data(data_frame_tx_t *resp);
+
+// The results of a batch are written in a frame of their own, the sub commands use the other one.
+static data_frame_tx_t *m_batch_frame_tx = NULL;
+static uint16_t m_batch_length = 0;
+static bool m_batch_running = false;
+
+static void batch_append(uint8_t *data, uint16_t length) {
+    while (length > 0) {
+        if (m_batch_length == NETDATA_MAX_DATA_LENGTH) {
+            // frame full, the client collects it as a partial response of the batch
+            auto_response_data(data_frame_make_in_place(m_batch_frame_tx, DATA_CMD_BATCH, STATUS_MORE_DATA, m_batch_length));
+            m_batch_frame_tx = data_frame_tx_acquire();
+            m_batch_length = 0;
+        }
+        uint16_t chunk_length = MIN(length, NETDATA_MAX_DATA_LENGTH - m_batch_length);
+        memcpy(&((netdata_frame_raw_t *)m_batch_frame_tx->buffer)->data[m_batch_length], data, chunk_length);
+        m_batch_length += chunk_length;
+        data += chunk_length;
+        length -= chunk_length;
+    }
+}
+
+static void batch_append_result(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    struct {
+        uint16_t cmd;
+        uint16_t status;
+        uint16_t length;
+    } PACKED header = {
+        .cmd = U16HTONS(cmd),
+        .status = U16HTONS(status),
+        .length = U16HTONS(length),
+    };
+    batch_append((uint8_t *)&header, sizeof(header));
+    batch_append(data, length);
+}
+
+/**
+ * @brief Send a partial response right away, with the STATUS_MORE_DATA status.
+ *        The client collects these frames until the final frame of the same cmd.
+ *        Inside a batch, the partial response is a result of the batch instead.
+ */
+static void response_more_data(uint16_t cmd, uint16_t length, uint8_t *data) {
+    if (m_batch_running) {
+        batch_append_result(cmd, STATUS_MORE_DATA, length, data);
+        return;
+    }
+    auto_response_data(data_frame_make(cmd, STATUS_MORE_DATA, length, data));
+}
+
+/**
+ * @brief Make the response of a payload that may not fit in one frame.
+ *        Larger than a frame, it is streamed and the client checks its crc32 once reassembled.
+ *        Inside a batch, the head is sent with response_more_data() and the returned frame carries the tail.
+ */
+static data_frame_tx_t *data_frame_make_chunked(uint16_t cmd, uint16_t status, uint32_t length, uint8_t *data) {
+    if (!m_batch_running && length > NETDATA_MAX_DATA_LENGTH) {
+        return data_frame_stream(cmd, status, length, data, auto_response_data);
+    }
+    while (length > NETDATA_MAX_DATA_LENGTH) {
+        response_more_data(cmd, NETDATA_MAX_DATA_LENGTH, data);
+        data += NETDATA_MAX_DATA_LENGTH;
+        length -= NETDATA_MAX_DATA_LENGTH;
+    }
+    return data_frame_make(cmd, status, length, data);
+}
+
 static data_frame_tx_t *cmd_processor_get_app_version(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
     struct {
         uint8_t version_major;
@@ -82,6 +152,9 @@ static data_frame_tx_t *cmd_processor_enter_bootloader(uint16_t cmd, uint16_t st
 #define BOOTLOADER_DFU_GPREGRET_MASK            (0xB0)
 #define BOOTLOADER_DFU_START_BIT_MASK           (0x01)
 #define BOOTLOADER_DFU_START    (BOOTLOADER_DFU_GPREGRET_MASK |         BOOTLOADER_DFU_START_BIT_MASK)
+    // the slot changes and the queued flash writes are not lost, as before a sleep
+    tag_emulation_save();
+    fds_queue_flush();
     APP_ERROR_CHECK(sd_power_gpregret_clr(0, 0xffffffff));
     APP_ERROR_CHECK(sd_power_gpregret_set(0, BOOTLOADER_DFU_START));
     nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_GOTO_DFU);
@@ -163,6 +236,85 @@ static data_frame_tx_t *cmd_processor_get_battery_info(uint16_t cmd, uint16_t st
     return data_frame_make(cmd, STATUS_SUCCESS, sizeof(payload), (uint8_t *)&payload);
 }
 
+static data_frame_tx_t *cmd_processor_get_ble_link_status(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    ble_link_status_t link;
+    ble_get_link_status(&link);
+    struct {
+        uint8_t connected;
+        uint8_t bulk_mode;
+        uint8_t tx_phy;
+        uint8_t rx_phy;
+        uint16_t att_mtu;
+        uint16_t data_length;
+        uint16_t conn_interval;
+        uint16_t tx_queue_depth;
+    } PACKED payload;
+    payload.connected = link.connected;
+    payload.bulk_mode = link.bulk_mode;
+    payload.tx_phy = link.tx_phy;
+    payload.rx_phy = link.rx_phy;
+    payload.att_mtu = U16HTONS(link.att_mtu);
+    payload.data_length = U16HTONS(link.data_length);
+    payload.conn_interval = U16HTONS(link.conn_interval);
+    payload.tx_queue_depth = U16HTONS(link.tx_queue_depth);
+    return data_frame_make(cmd, STATUS_SUCCESS, sizeof(payload), (uint8_t *)&payload);
+}
+
+static data_frame_tx_t *cmd_processor_set_frame_compression(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    if (length != 1 || data[0] > 1) {
+        return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
+    }
+    data_frame_set_compression(data[0]);
+    uint8_t enabled = data_frame_get_compression();
+    return data_frame_make(cmd, STATUS_SUCCESS, sizeof(enabled), &enabled);
+}
+
+static data_frame_tx_t *cmd_processor_get_storage_status(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    fds_queue_stats_t queue;
+    fds_queue_get_stats(&queue);
+    fds_stat_t flash;
+    if (fds_stat(&flash) != NRF_SUCCESS) {
+        return data_frame_make(cmd, STATUS_FLASH_READ_FAIL, 0, NULL);
+    }
+    struct {
+        uint16_t queue_depth;
+        uint16_t queue_bytes;
+        uint16_t queue_size;
+        uint16_t queue_depth_max;
+        uint32_t writes;
+        uint32_t coalesced;
+        uint32_t stalls;
+        uint32_t failures;
+        uint32_t gc_idle;
+        uint32_t gc_full;
+        uint16_t pages_available;
+        uint16_t page_words;
+        uint16_t valid_records;
+        uint16_t dirty_records;
+        uint16_t words_used;
+        uint16_t freeable_words;
+        uint16_t largest_contig;
+    } PACKED payload;
+    payload.queue_depth = U16HTONS(queue.depth);
+    payload.queue_bytes = U16HTONS(queue.bytes);
+    payload.queue_size = U16HTONS(FDS_QUEUE_POOL_SIZE);
+    payload.queue_depth_max = U16HTONS(queue.depth_max);
+    payload.writes = U32HTONL(queue.writes);
+    payload.coalesced = U32HTONL(queue.coalesced);
+    payload.stalls = U32HTONL(queue.stalls);
+    payload.failures = U32HTONL(queue.failures);
+    payload.gc_idle = U32HTONL(queue.gc_idle);
+    payload.gc_full = U32HTONL(queue.gc_full);
+    payload.pages_available = U16HTONS(flash.pages_available);
+    payload.page_words = U16HTONS(FDS_VIRTUAL_PAGE_SIZE);
+    payload.valid_records = U16HTONS(flash.valid_records);
+    payload.dirty_records = U16HTONS(flash.dirty_records);
+    payload.words_used = U16HTONS(flash.words_used);
+    payload.freeable_words = U16HTONS(flash.freeable_words);
+    payload.largest_contig = U16HTONS(flash.largest_contig);
+    return data_frame_make(cmd, STATUS_SUCCESS, sizeof(payload), (uint8_t *)&payload);
+}
+
 static data_frame_tx_t *cmd_processor_get_button_press_config(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
     if ((length != 1) || (!is_settings_button_type_valid(data[0]))) {
         return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
@@ -372,8 +524,13 @@ static data_frame_tx_t *cmd_processor_mf1_auth_one_key_block(uint16_t cmd, uint1
     return data_frame_make(cmd, status, 0, NULL);
 }
 
+// the keys found in each sector are sent as they are found, the final frame still has all of them
+static void mf1_check_keys_hits_send(mf1_toolbox_check_keys_hit_t *hits, uint8_t count) {
+    response_more_data(DATA_CMD_MF1_CHECK_KEYS_OF_SECTORS, count * sizeof(mf1_toolbox_check_keys_hit_t), (uint8_t *)hits);
+}
+
 static data_frame_tx_t *cmd_processor_mf1_check_keys_of_sectors(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
-    if (length < 16 || (length - 10) % 6 != 0) {
+    if (length < 16 || (length - 10) % 6 != 0 || (length - 10) / 6 > MF1_TOOLBOX_CHECK_KEYS_MAX) {
         return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
     }
 
@@ -381,7 +538,8 @@ static data_frame_tx_t *cmd_processor_mf1_check_keys_of_sectors(uint16_t cmd, ui
     mf1_toolbox_check_keys_of_sectors_in_t in = {
         .mask = *(mf1_toolbox_check_keys_of_sectors_mask_t *) &data[0],
         .keys_len = (length - 10) / 6,
-        .keys = (mf1_key_t *) &data[10]
+        .keys = (mf1_key_t *) &data[10],
+        .on_hits = mf1_check_keys_hits_send,
     };
     mf1_toolbox_check_keys_of_sectors_out_t out;
     status = mf1_toolbox_check_keys_of_sectors(&in, &out);
@@ -407,6 +565,27 @@ static data_frame_tx_t *cmd_processor_mf1_check_keys_on_block(uint16_t cmd, uint
     return data_frame_make(cmd, status, sizeof(out), (uint8_t *)&out);
 }
 
+static data_frame_tx_t *cmd_processor_mf1_read_sectors(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    if (length < sizeof(mf1_toolbox_read_sectors_mask_t)
+            || (length - sizeof(mf1_toolbox_read_sectors_mask_t)) % sizeof(mf1_toolbox_read_sectors_keys_t) != 0) {
+        return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
+    }
+
+    mf1_toolbox_read_sectors_in_t in = {
+        .mask = *(mf1_toolbox_read_sectors_mask_t *) &data[0],
+        .keys_len = (length - sizeof(mf1_toolbox_read_sectors_mask_t)) / sizeof(mf1_toolbox_read_sectors_keys_t),
+        .keys = (mf1_toolbox_read_sectors_keys_t *) &data[sizeof(mf1_toolbox_read_sectors_mask_t)]
+    };
+    // 256 blocks * 17 bytes, too large for the stack and for one frame
+    static mf1_toolbox_read_sectors_block_t blocks[NFC_TAG_MF1_BLOCK_MAX];
+    uint16_t blocks_len = 0;
+    status = mf1_toolbox_read_sectors(&in, blocks, &blocks_len);
+    if (status != STATUS_HF_TAG_OK) {
+        return data_frame_make(cmd, status, 0, NULL);
+    }
+    return data_frame_make_chunked(cmd, status, blocks_len * sizeof(mf1_toolbox_read_sectors_block_t), (uint8_t *)blocks);
+}
+
 static data_frame_tx_t *cmd_processor_mf1_hardnested_nonces_acquire(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
     typedef struct {
         uint8_t slow;
@@ -824,6 +1003,8 @@ static data_frame_tx_t *cmd_processor_get_slot_info(uint16_t cmd, uint16_t statu
 }
 
 static data_frame_tx_t *cmd_processor_wipe_fds(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    // The images the slot cache holds must not be written back before the reset
+    tag_slot_cache_clear();
     bool success = fds_wipe();
     status = success ? STATUS_SUCCESS : STATUS_FLASH_WRITE_FAIL;
     delayed_reset(50);
@@ -963,30 +1144,81 @@ static data_frame_tx_t *cmd_processor_mf1_get_detection_enable(uint16_t cmd, uin
 }
 
 static data_frame_tx_t *cmd_processor_mf1_get_detection_count(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
-    uint32_t count = nfc_tag_mf1_detection_log_count();
-    if (count == 0xFFFFFFFF) {
-        count = 0;
-    }
-    uint32_t payload = U32HTONL(count);
+    uint32_t payload = U32HTONL(nfc_tag_mf1_detection_log_count());
     return data_frame_make(cmd, STATUS_SUCCESS, sizeof(uint32_t), (uint8_t *)&payload);
 }
 
-static data_frame_tx_t *cmd_processor_mf1_get_detection_log(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
-    uint32_t count;
-    uint32_t index;
-    uint8_t *resp = NULL;
-    nfc_tag_mf1_auth_log_t *logs = mf1_get_auth_log(&count);
-    if (length != 4 || count == 0xFFFFFFFF) {
+static void mf1_detection_log_fill(uint32_t offset, uint8_t *buffer, uint16_t length) {
+    nfc_tag_mf1_log_copy(offset, buffer, length);
+}
+
+/**
+ * @brief The log is stored compact, the records are expanded to nfc_tag_mf1_auth_log_t while the response is made.
+ */
+static data_frame_tx_t *mf1_detection_log_response(uint16_t cmd, uint16_t length, uint8_t *data) {
+    const uint32_t page_count = NETDATA_MAX_DATA_LENGTH / sizeof(nfc_tag_mf1_auth_log_t);
+    uint32_t count = nfc_tag_mf1_log_count();
+    uint32_t index = 0;
+    if (length == 0) {
+        // no index, the whole log at once
+        if (!m_batch_running && count > page_count) {
+            return data_frame_stream_fill(cmd, STATUS_SUCCESS, count * sizeof(nfc_tag_mf1_auth_log_t), mf1_detection_log_fill, auto_response_data);
+        }
+        uint8_t *page = data_frame_tx_payload();
+        for (; count - index > page_count; index += page_count) {
+            nfc_tag_mf1_log_copy(index * sizeof(nfc_tag_mf1_auth_log_t), page, page_count * sizeof(nfc_tag_mf1_auth_log_t));
+            response_more_data(cmd, page_count * sizeof(nfc_tag_mf1_auth_log_t), page);
+        }
+        length = (count - index) * sizeof(nfc_tag_mf1_auth_log_t);
+        nfc_tag_mf1_log_copy(index * sizeof(nfc_tag_mf1_auth_log_t), page, length);
+        return data_frame_make(cmd, STATUS_SUCCESS, length, page);
+    }
+    if (length != 4) {
         return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
     }
     index = U32NTOHL(*(uint32_t *)data);
-    // NRF_LOG_INFO("index = %d", index);
     if (index >= count) {
         return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
     }
-    resp = (uint8_t *)(logs + index);
-    length = MIN(count - index, NETDATA_MAX_DATA_LENGTH / sizeof(nfc_tag_mf1_auth_log_t)) * sizeof(nfc_tag_mf1_auth_log_t);
-    return data_frame_make(cmd, STATUS_SUCCESS, length, resp);
+    uint8_t *page = data_frame_tx_payload();
+    length = MIN(count - index, page_count) * sizeof(nfc_tag_mf1_auth_log_t);
+    nfc_tag_mf1_log_copy(index * sizeof(nfc_tag_mf1_auth_log_t), page, length);
+    return data_frame_make(cmd, STATUS_SUCCESS, length, page);
+}
+
+/**
+ * @brief The stream copies the log twice, for the crc32 and for the frames, and the pages follow one another: held,
+ * the log gives the same records to all the copies while the emulation keeps logging.
+ */
+static data_frame_tx_t *cmd_processor_mf1_get_detection_log(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    nfc_tag_mf1_log_hold(true);
+    data_frame_tx_t *tx = mf1_detection_log_response(cmd, length, data);
+    nfc_tag_mf1_log_hold(false);
+    return tx;
+}
+
+static data_frame_tx_t *cmd_processor_mf1_set_detection_policy(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    if (length != 1 || data[0] > NFC_TAG_MF1_LOG_POLICY_OVERWRITE) {
+        return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
+    }
+    nfc_tag_mf1_log_set_policy(data[0]);
+    return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
+}
+
+static data_frame_tx_t *cmd_processor_mf1_get_detection_policy(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    struct {
+        uint8_t policy;
+        uint32_t capacity;
+        uint32_t duplicates;
+        uint32_t dropped;
+    } PACKED payload;
+    uint32_t duplicates, dropped;
+    nfc_tag_mf1_log_get_stats(&duplicates, &dropped);
+    payload.policy = nfc_tag_mf1_log_get_policy();
+    payload.capacity = U32HTONL(NFC_TAG_MF1_LOG_RECORD_MAX);
+    payload.duplicates = U32HTONL(duplicates);
+    payload.dropped = U32HTONL(dropped);
+    return data_frame_make(cmd, STATUS_SUCCESS, sizeof(payload), (uint8_t *)&payload);
 }
 
 static data_frame_tx_t *cmd_processor_mf1_write_emu_block_data(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
@@ -1004,6 +1236,9 @@ static data_frame_tx_t *cmd_processor_mf1_write_emu_block_data(uint16_t cmd, uin
         uint8_t *p_block = &data[i];
         memcpy(info->memory[j], p_block, NFC_TAG_MF1_DATA_SIZE);
     }
+    tag_emulation_data_changed(info->memory[block_index], block_count * NFC_TAG_MF1_DATA_SIZE);
+    // the blocks may be trailers
+    nfc_tag_mf1_access_cache_invalidate();
     return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
 }
 
@@ -1016,7 +1251,7 @@ static data_frame_tx_t *cmd_processor_mf1_read_emu_block_data(uint16_t cmd, uint
     tag_data_buffer_t *buffer = get_buffer_by_tag_type(TAG_TYPE_MIFARE_4096);
     nfc_tag_mf1_information_t *info = (nfc_tag_mf1_information_t *)buffer->buffer;
     uint16_t result_length = block_count * NFC_TAG_MF1_DATA_SIZE;
-    uint8_t result_buffer[result_length];
+    uint8_t *result_buffer = data_frame_tx_payload();
     for (int i = 0, j = block_index; i < result_length; i += NFC_TAG_MF1_DATA_SIZE, j++) {
         memcpy(&result_buffer[i], info->memory[j], NFC_TAG_MF1_DATA_SIZE);
     }
@@ -1057,6 +1292,9 @@ static data_frame_tx_t *cmd_processor_mf0_ntag_write_emu_page_data(uint16_t cmd,
     nfc_tag_mf0_ntag_information_t *info = (nfc_tag_mf0_ntag_information_t *)buffer->buffer;
 
     memcpy(&info->memory[page_index][0], &data[2], byte_length);
+    tag_emulation_data_changed(&info->memory[page_index][0], byte_length);
+    // the pages may be lock or configuration pages
+    nfc_tag_mf0_ntag_state_invalidate();
 
     return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
 }
@@ -1117,6 +1355,7 @@ static data_frame_tx_t *cmd_processor_mf0_ntag_set_version_data(uint16_t cmd, ui
     uint8_t *version_data = nfc_tag_mf0_ntag_get_version_data();
     if (version_data == NULL) return data_frame_make(cmd, STATUS_INVALID_SLOT_TYPE, 0, NULL);
     memcpy(version_data, data, NFC_TAG_MF0_NTAG_VER_SIZE);
+    tag_emulation_data_changed(version_data, NFC_TAG_MF0_NTAG_VER_SIZE);
 
     return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
 }
@@ -1134,6 +1373,7 @@ static data_frame_tx_t *cmd_processor_mf0_ntag_set_signature_data(uint16_t cmd,
     uint8_t *signature_data = nfc_tag_mf0_ntag_get_signature_data();
     if (signature_data == NULL) return data_frame_make(cmd, STATUS_INVALID_SLOT_TYPE, 0, NULL);
     memcpy(signature_data, data, NFC_TAG_MF0_NTAG_SIG_SIZE);
+    tag_emulation_data_changed(signature_data, NFC_TAG_MF0_NTAG_SIG_SIZE);
 
     return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
 }
@@ -1168,6 +1408,7 @@ static data_frame_tx_t *cmd_processor_mf0_ntag_set_counter_data(uint16_t cmd, ui
 
     // copy the actual counter value
     memcpy(counter_data, &data[1], 3);
+    tag_emulation_data_changed(counter_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
 
     return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
 }
@@ -1179,6 +1420,7 @@ static data_frame_tx_t *cmd_processor_mf0_ntag_reset_auth_cnt(uint16_t cmd, uint
 
     uint8_t old_value = counter_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] & MF0_NTAG_AUTHLIM_MASK_IN_CTR;
     counter_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] &= ~MF0_NTAG_AUTHLIM_MASK_IN_CTR;
+    tag_emulation_data_changed(counter_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
 
     return data_frame_make(cmd, STATUS_SUCCESS, 1, &old_value);
 }
@@ -1207,6 +1449,11 @@ static data_frame_tx_t *cmd_processor_hf14a_set_anti_coll_data(uint16_t cmd, uin
     offset ++;
     memcpy(info->ats->data, &data[offset], info->ats->length);
     offset += info->ats->length;
+    tag_emulation_data_changed(info->size, sizeof(*info->size));
+    tag_emulation_data_changed(info->uid, *(info->size));
+    tag_emulation_data_changed(info->atqa, 2);
+    tag_emulation_data_changed(info->sak, 1);
+    tag_emulation_data_changed(info->ats, sizeof(*info->ats));
     return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
 }
 
@@ -1226,7 +1473,7 @@ static data_frame_tx_t *cmd_processor_set_slot_tag_nick(uint16_t cmd, uint16_t s
     buffer[0] = length - 2;
     memcpy(buffer + 1, data + 2, buffer[0]);
 
-    bool ret = fds_write_sync(map_info.id, map_info.key, sizeof(buffer), buffer);
+    bool ret = fds_write_async(map_info.id, map_info.key, sizeof(buffer), buffer);
     if (!ret) {
         return data_frame_make(cmd, STATUS_FLASH_WRITE_FAIL, 0, NULL);
     }
@@ -1255,7 +1502,8 @@ static data_frame_tx_t *cmd_processor_get_slot_tag_nick(uint16_t cmd, uint16_t s
 }
 
 static data_frame_tx_t *cmd_processor_get_all_slot_nicks(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
-    uint8_t response_buffer[TAG_MAX_SLOT_NUM * 2 * 37]; // Max possible size: 8 slots * 2 sense types * (1 byte length + 36 bytes nick)
+    // Max possible size: 8 slots * 2 sense types * (1 byte length + 36 bytes nick)
+    uint8_t *response_buffer = data_frame_tx_payload();
     uint16_t response_length = 0;
 
     for (uint8_t slot = 0; slot < TAG_MAX_SLOT_NUM; slot++) {
@@ -1456,8 +1704,10 @@ static data_frame_tx_t *after_hf_reader_run(uint16_t cmd, uint16_t status, uint1
 
 #endif
 
-// fct will be defined after m_data_cmd_map because we need to know its size
+// fct will be defined after m_data_cmd_map because it lists its commands
 data_frame_tx_t *cmd_processor_get_device_capabilities(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data);
+// fct will be defined after m_data_cmd_map because it dispatches through it
+static data_frame_tx_t *cmd_processor_batch(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data);
 
 static data_frame_tx_t *cmd_processor_mf0_ntag_get_uid_mode(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
     int rc = nfc_tag_mf0_ntag_get_uid_mode();
@@ -1516,6 +1766,10 @@ static data_frame_tx_t *cmd_processor_mf0_ntag_get_detection_log(uint16_t cmd, u
     uint32_t index;
     uint8_t *resp = NULL;
     nfc_tag_mf0_ntag_auth_log_t *logs = mf0_get_auth_log(&count);
+    if (length == 0 && count != 0xFFFFFFFF) {
+        // no index, the whole log at once
+        return data_frame_make_chunked(cmd, STATUS_SUCCESS, count * sizeof(nfc_tag_mf0_ntag_auth_log_t), (uint8_t *)logs);
+    }
     if (length != 4 || count == 0xFFFFFFFF) {
         return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
     }
@@ -1537,135 +1791,133 @@ static data_frame_tx_t *cmd_processor_mf0_get_emulator_config(uint16_t cmd, uint
 }
 
 /**
- * (cmd -> processor) function map, the map struct is:
- *       cmd code                               before process               cmd processor                                after process
+ * @brief Get the emulator memory of the active hf slot as a flat byte array,
+ *        blocks for MIFARE Classic, pages for MIFARE Ultralight / NTAG.
+ * @param memory output pointer to the first byte
+ * @return memory size in bytes, 0 if the active hf slot has no such memory
  */
-static cmd_data_map_t m_data_cmd_map[] = {
-    {    DATA_CMD_GET_APP_VERSION,              NULL,                        cmd_processor_get_app_version,               NULL                   },
-    {    DATA_CMD_CHANGE_DEVICE_MODE,           NULL,                        cmd_processor_change_device_mode,            NULL                   },
-    {    DATA_CMD_GET_DEVICE_MODE,              NULL,                        cmd_processor_get_device_mode,               NULL                   },
-    {    DATA_CMD_SET_ACTIVE_SLOT,              NULL,                        cmd_processor_set_active_slot,               NULL                   },
-    {    DATA_CMD_SET_SLOT_TAG_TYPE,            NULL,                        cmd_processor_set_slot_tag_type,             NULL                   },
-    {    DATA_CMD_SET_SLOT_DATA_DEFAULT,        NULL,                        cmd_processor_set_slot_data_default,         NULL                   },
-    {    DATA_CMD_SET_SLOT_ENABLE,              NULL,                        cmd_processor_set_slot_enable,               NULL                   },
-    {    DATA_CMD_SET_SLOT_TAG_NICK,            NULL,                        cmd_processor_set_slot_tag_nick,             NULL                   },
-    {    DATA_CMD_GET_SLOT_TAG_NICK,            NULL,                        cmd_processor_get_slot_tag_nick,             NULL                   },
-    {    DATA_CMD_SLOT_DATA_CONFIG_SAVE,        NULL,                        cmd_processor_slot_data_config_save,         NULL                   },
-    {    DATA_CMD_ENTER_BOOTLOADER,             NULL,                        cmd_processor_enter_bootloader,              NULL                   },
-    {    DATA_CMD_GET_DEVICE_CHIP_ID,           NULL,                        cmd_processor_get_device_chip_id,            NULL                   },
-    {    DATA_CMD_GET_DEVICE_ADDRESS,           NULL,                        cmd_processor_get_device_address,            NULL                   },
-    {    DATA_CMD_SAVE_SETTINGS,                NULL,                        cmd_processor_save_settings,                 NULL                   },
-    {    DATA_CMD_RESET_SETTINGS,               NULL,                        cmd_processor_reset_settings,                NULL                   },
-    {    DATA_CMD_SET_ANIMATION_MODE,           NULL,                        cmd_processor_set_animation_mode,            NULL                   },
-    {    DATA_CMD_GET_ANIMATION_MODE,           NULL,                        cmd_processor_get_animation_mode,            NULL                   },
-    {    DATA_CMD_GET_GIT_VERSION,              NULL,                        cmd_processor_get_git_version,               NULL                   },
-    {    DATA_CMD_GET_ACTIVE_SLOT,              NULL,                        cmd_processor_get_active_slot,               NULL                   },
-    {    DATA_CMD_GET_SLOT_INFO,                NULL,                        cmd_processor_get_slot_info,                 NULL                   },
-    {    DATA_CMD_WIPE_FDS,                     NULL,                        cmd_processor_wipe_fds,                      NULL                   },
-    {    DATA_CMD_DELETE_SLOT_TAG_NICK,         NULL,                        cmd_processor_delete_slot_tag_nick,          NULL                   },
-    {    DATA_CMD_GET_ENABLED_SLOTS,            NULL,                        cmd_processor_get_enabled_slots,             NULL                   },
-    {    DATA_CMD_DELETE_SLOT_SENSE_TYPE,       NULL,                        cmd_processor_delete_slot_sense_type,        NULL                   },
-    {    DATA_CMD_GET_BATTERY_INFO,             NULL,                        cmd_processor_get_battery_info,              NULL                   },
-    {    DATA_CMD_GET_BUTTON_PRESS_CONFIG,      NULL,                        cmd_processor_get_button_press_config,       NULL                   },
-    {    DATA_CMD_SET_BUTTON_PRESS_CONFIG,      NULL,                        cmd_processor_set_button_press_config,       NULL                   },
-    {    DATA_CMD_GET_LONG_BUTTON_PRESS_CONFIG, NULL,                        cmd_processor_get_long_button_press_config,  NULL                   },
-    {    DATA_CMD_SET_LONG_BUTTON_PRESS_CONFIG, NULL,                        cmd_processor_set_long_button_press_config,  NULL                   },
-    {    DATA_CMD_GET_BLE_PAIRING_KEY,          NULL,                        cmd_processor_get_ble_connect_key,           NULL                   },
-    {    DATA_CMD_SET_BLE_PAIRING_KEY,          NULL,                        cmd_processor_set_ble_connect_key,           NULL                   },
-    {    DATA_CMD_DELETE_ALL_BLE_BONDS,         NULL,                        cmd_processor_delete_all_ble_bonds,          NULL                   },
-    {    DATA_CMD_GET_DEVICE_MODEL,             NULL,                        cmd_processor_get_device_model,              NULL                   },
-    {    DATA_CMD_GET_DEVICE_SETTINGS,          NULL,                        cmd_processor_get_device_settings,           NULL                   },
-    {    DATA_CMD_GET_DEVICE_CAPABILITIES,      NULL,                        cmd_processor_get_device_capabilities,       NULL                   },
-    {    DATA_CMD_GET_BLE_PAIRING_ENABLE,       NULL,                        cmd_processor_get_ble_pairing_enable,        NULL                   },
-    {    DATA_CMD_SET_BLE_PAIRING_ENABLE,       NULL,                        cmd_processor_set_ble_pairing_enable,        NULL                   },
-    {    DATA_CMD_GET_ALL_SLOT_NICKS,           NULL,                        cmd_processor_get_all_slot_nicks,            NULL                   },
+static uint16_t get_active_hf_emu_memory(uint8_t **memory) {
+    tag_slot_specific_type_t active_slot_tag_types;
+    tag_emulation_get_specific_types_by_slot(tag_emulation_get_slot(), &active_slot_tag_types);
 
-#if defined(PROJECT_CHAMELEON_ULTRA)
+    int nr_blocks = nfc_tag_mf1_get_nr_blocks_by_tag_type(active_slot_tag_types.tag_hf);
+    if (nr_blocks > 0) {
+        tag_data_buffer_t *buffer = get_buffer_by_tag_type(active_slot_tag_types.tag_hf);
+        *memory = ((nfc_tag_mf1_information_t *)buffer->buffer)->memory[0];
+        return nr_blocks * NFC_TAG_MF1_DATA_SIZE;
+    }
+    int nr_pages = nfc_tag_mf0_ntag_get_nr_pages_by_tag_type(active_slot_tag_types.tag_hf);
+    if (nr_pages > 0) {
+        tag_data_buffer_t *buffer = get_buffer_by_tag_type(active_slot_tag_types.tag_hf);
+        *memory = ((nfc_tag_mf0_ntag_information_t *)buffer->buffer)->memory[0];
+        return nr_pages * NFC_TAG_MF0_NTAG_DATA_SIZE;
+    }
+    return 0;
+}
 
-    {    DATA_CMD_HF14A_SCAN,                   before_hf_reader_run,        cmd_processor_hf14a_scan,                    after_hf_reader_run    },
-    {    DATA_CMD_MF1_DETECT_SUPPORT,           before_hf_reader_run,        cmd_processor_mf1_detect_support,            after_hf_reader_run    },
-    {    DATA_CMD_MF1_DETECT_PRNG,              before_hf_reader_run,        cmd_processor_mf1_detect_prng,               after_hf_reader_run    },
-    {    DATA_CMD_MF1_STATIC_NESTED_ACQUIRE,    before_hf_reader_run,        cmd_processor_mf1_static_nested_acquire,     after_hf_reader_run    },
-    {    DATA_CMD_MF1_DARKSIDE_ACQUIRE,         before_hf_reader_run,        cmd_processor_mf1_darkside_acquire,          after_hf_reader_run    },
-    {    DATA_CMD_MF1_DETECT_NT_DIST,           before_hf_reader_run,        cmd_processor_mf1_detect_nt_dist,            after_hf_reader_run    },
-    {    DATA_CMD_MF1_NESTED_ACQUIRE,           before_hf_reader_run,        cmd_processor_mf1_nested_acquire,            after_hf_reader_run    },
-    {    DATA_CMD_MF1_ENC_NESTED_ACQUIRE,       before_hf_reader_run,        cmd_processor_mf1_enc_nested_acquire,        after_hf_reader_run    },
-
-    {    DATA_CMD_MF1_AUTH_ONE_KEY_BLOCK,       before_hf_reader_run,        cmd_processor_mf1_auth_one_key_block,        after_hf_reader_run    },
-    {    DATA_CMD_MF1_READ_ONE_BLOCK,           before_hf_reader_run,        cmd_processor_mf1_read_one_block,            after_hf_reader_run    },
-    {    DATA_CMD_MF1_WRITE_ONE_BLOCK,          before_hf_reader_run,        cmd_processor_mf1_write_one_block,           after_hf_reader_run    },
-    {    DATA_CMD_HF14A_RAW,                    before_reader_run,           cmd_processor_hf14a_raw,                     NULL                   },
-    {    DATA_CMD_MF1_MANIPULATE_VALUE_BLOCK,   before_hf_reader_run,        cmd_processor_mf1_manipulate_value_block,    after_hf_reader_run    },
-    {    DATA_CMD_MF1_CHECK_KEYS_OF_SECTORS,    before_hf_reader_run,        cmd_processor_mf1_check_keys_of_sectors,     after_hf_reader_run    },
-    {    DATA_CMD_MF1_HARDNESTED_ACQUIRE,       before_hf_reader_run,        cmd_processor_mf1_hardnested_nonces_acquire, after_hf_reader_run    },
-    {    DATA_CMD_MF1_CHECK_KEYS_ON_BLOCK,      before_hf_reader_run,        cmd_processor_mf1_check_keys_on_block,       after_hf_reader_run    },
-
-    {    DATA_CMD_EM410X_SCAN,                  before_reader_run,           cmd_processor_em410x_scan,                   NULL                   },
-    {    DATA_CMD_EM410X_WRITE_TO_T55XX,        before_reader_run,           cmd_processor_em410x_write_to_t55xx,         NULL                   },
-    {    DATA_CMD_HIDPROX_SCAN,                 before_reader_run,           cmd_processor_hidprox_scan,                  NULL                   },
-    {    DATA_CMD_HIDPROX_WRITE_TO_T55XX,       before_reader_run,           cmd_processor_hidprox_write_to_t55xx,        NULL                   },
-    {    DATA_CMD_VIKING_SCAN,                  before_reader_run,           cmd_processor_viking_scan,                   NULL                   },
-    {    DATA_CMD_VIKING_WRITE_TO_T55XX,        before_reader_run,           cmd_processor_viking_write_to_t55xx,         NULL                   },
-
-    {    DATA_CMD_HF14A_SET_FIELD_ON,           before_reader_run,           cmd_processor_hf14a_set_field_on,            NULL                   },
-    {    DATA_CMD_HF14A_SET_FIELD_OFF,          before_reader_run,           cmd_processor_hf14a_set_field_off,           NULL                   },
+typedef struct {
+    uint16_t offset;
+    uint16_t length;
+} PACKED emu_memory_range_payload_t;
 
-#endif
+/**
+ * @brief Check the requested range against the emulator memory, length 0 means up to the end.
+ * @return the status to answer with
+ */
+static uint16_t get_emu_memory_range(uint16_t length, uint8_t *data, uint8_t **memory, uint16_t *offset, uint16_t *range_length) {
+    if (length != sizeof(emu_memory_range_payload_t)) {
+        return STATUS_PAR_ERR;
+    }
+    uint16_t memory_size = get_active_hf_emu_memory(memory);
+    if (memory_size == 0) {
+        return STATUS_INVALID_SLOT_TYPE;
+    }
+    emu_memory_range_payload_t *payload = (emu_memory_range_payload_t *)data;
+    *offset = U16NTOHS(payload->offset);
+    *range_length = U16NTOHS(payload->length);
+    if (*offset > memory_size) {
+        return STATUS_PAR_ERR;
+    }
+    if (*range_length == 0) {
+        *range_length = memory_size - *offset;
+    }
+    if (*range_length > memory_size - *offset) {
+        return STATUS_PAR_ERR;
+    }
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Read a range of the emulator memory in one request, streamed when larger than a frame,
+ *        the client checks the crc32 of the stream once instead of asking block by block.
+ */
+static data_frame_tx_t *cmd_processor_emu_memory_bulk_read(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    uint8_t *memory;
+    uint16_t offset, range_length;
+    status = get_emu_memory_range(length, data, &memory, &offset, &range_length);
+    if (status != STATUS_SUCCESS) {
+        return data_frame_make(cmd, status, 0, NULL);
+    }
+    return data_frame_make_chunked(cmd, STATUS_SUCCESS, range_length, &memory[offset]);
+}
+
+/**
+ * @brief Write a chunk of the emulator memory, the payload is the offset followed by the raw data.
+ */
+static data_frame_tx_t *cmd_processor_emu_memory_bulk_write(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    typedef struct {
+        uint16_t offset;
+        uint8_t data[];
+    } PACKED payload_t;
+    if (length < sizeof(payload_t)) {
+        return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
+    }
+    uint8_t *memory;
+    uint16_t memory_size = get_active_hf_emu_memory(&memory);
+    if (memory_size == 0) {
+        return data_frame_make(cmd, STATUS_INVALID_SLOT_TYPE, 0, NULL);
+    }
+    payload_t *payload = (payload_t *)data;
+    uint16_t offset = U16NTOHS(payload->offset);
+    uint16_t data_length = length - sizeof(payload_t);
+    if (offset > memory_size || data_length > memory_size - offset) {
+        return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
+    }
+    memcpy(&memory[offset], payload->data, data_length);
+    tag_emulation_data_changed(&memory[offset], data_length);
+    // the range may cover MIFARE Classic trailers or MF0/NTAG lock and configuration pages
+    nfc_tag_mf1_access_cache_invalidate();
+    nfc_tag_mf0_ntag_state_invalidate();
+    return data_frame_make(cmd, STATUS_SUCCESS, 0, NULL);
+}
+
+static data_frame_tx_t *cmd_processor_emu_memory_get_crc32(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    uint8_t *memory;
+    uint16_t offset, range_length;
+    status = get_emu_memory_range(length, data, &memory, &offset, &range_length);
+    if (status != STATUS_SUCCESS) {
+        return data_frame_make(cmd, status, 0, NULL);
+    }
+    uint32_t crc = U32HTONL(crc32_compute(&memory[offset], range_length, NULL));
+    return data_frame_make(cmd, STATUS_SUCCESS, sizeof(crc), (uint8_t *)&crc);
+}
 
-    {    DATA_CMD_HF14A_GET_ANTI_COLL_DATA,     NULL,                        cmd_processor_hf14a_get_anti_coll_data,      NULL                   },
-    {    DATA_CMD_HF14A_SET_ANTI_COLL_DATA,     NULL,                        cmd_processor_hf14a_set_anti_coll_data,      NULL                   },
-
-    {    DATA_CMD_MF1_WRITE_EMU_BLOCK_DATA,     NULL,                        cmd_processor_mf1_write_emu_block_data,      NULL                   },
-    {    DATA_CMD_MF1_SET_DETECTION_ENABLE,     NULL,                        cmd_processor_mf1_set_detection_enable,      NULL                   },
-    {    DATA_CMD_MF1_GET_DETECTION_COUNT,      NULL,                        cmd_processor_mf1_get_detection_count,       NULL                   },
-    {    DATA_CMD_MF1_GET_DETECTION_LOG,        NULL,                        cmd_processor_mf1_get_detection_log,         NULL                   },
-    {    DATA_CMD_MF1_GET_DETECTION_ENABLE,     NULL,                        cmd_processor_mf1_get_detection_enable,      NULL                   },
-    {    DATA_CMD_MF1_READ_EMU_BLOCK_DATA,      NULL,                        cmd_processor_mf1_read_emu_block_data,       NULL                   },
-    {    DATA_CMD_MF1_GET_EMULATOR_CONFIG,      NULL,                        cmd_processor_mf1_get_emulator_config,       NULL                   },
-    {    DATA_CMD_MF1_GET_GEN1A_MODE,           NULL,                        cmd_processor_mf1_get_gen1a_mode,            NULL                   },
-    {    DATA_CMD_MF1_SET_GEN1A_MODE,           NULL,                        cmd_processor_mf1_set_gen1a_mode,            NULL                   },
-    {    DATA_CMD_MF1_GET_GEN2_MODE,            NULL,                        cmd_processor_mf1_get_gen2_mode,             NULL                   },
-    {    DATA_CMD_MF1_SET_GEN2_MODE,            NULL,                        cmd_processor_mf1_set_gen2_mode,             NULL                   },
-    {    DATA_CMD_MF1_GET_BLOCK_ANTI_COLL_MODE, NULL,                        cmd_processor_mf1_get_block_anti_coll_mode,  NULL                   },
-    {    DATA_CMD_MF1_SET_BLOCK_ANTI_COLL_MODE, NULL,                        cmd_processor_mf1_set_block_anti_coll_mode,  NULL                   },
-    {    DATA_CMD_MF1_GET_WRITE_MODE,           NULL,                        cmd_processor_mf1_get_write_mode,            NULL                   },
-    {    DATA_CMD_MF1_SET_WRITE_MODE,           NULL,                        cmd_processor_mf1_set_write_mode,            NULL                   },
-
-    {    DATA_CMD_MF0_NTAG_GET_UID_MAGIC_MODE,    NULL,                      cmd_processor_mf0_ntag_get_uid_mode,         NULL                   },
-    {    DATA_CMD_MF0_NTAG_SET_UID_MAGIC_MODE,    NULL,                      cmd_processor_mf0_ntag_set_uid_mode,         NULL                   },
-    {    DATA_CMD_MF0_NTAG_READ_EMU_PAGE_DATA,    NULL,                      cmd_processor_mf0_ntag_read_emu_page_data,   NULL                   },
-    {    DATA_CMD_MF0_NTAG_WRITE_EMU_PAGE_DATA,   NULL,                      cmd_processor_mf0_ntag_write_emu_page_data,  NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_VERSION_DATA,      NULL,                      cmd_processor_mf0_ntag_get_version_data,     NULL                   },
-    {    DATA_CMD_MF0_NTAG_SET_VERSION_DATA,      NULL,                      cmd_processor_mf0_ntag_set_version_data,     NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_SIGNATURE_DATA,    NULL,                      cmd_processor_mf0_ntag_get_signature_data,   NULL                   },
-    {    DATA_CMD_MF0_NTAG_SET_SIGNATURE_DATA,    NULL,                      cmd_processor_mf0_ntag_set_signature_data,   NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_COUNTER_DATA,      NULL,                      cmd_processor_mf0_ntag_get_counter_data,     NULL                   },
-    {    DATA_CMD_MF0_NTAG_SET_COUNTER_DATA,      NULL,                      cmd_processor_mf0_ntag_set_counter_data,     NULL                   },
-    {    DATA_CMD_MF0_NTAG_RESET_AUTH_CNT,        NULL,                      cmd_processor_mf0_ntag_reset_auth_cnt,       NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_PAGE_COUNT,        NULL,                      cmd_processor_mf0_ntag_get_emu_page_count,   NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_WRITE_MODE,        NULL,                      cmd_processor_mf0_ntag_get_write_mode,       NULL                   },
-    {    DATA_CMD_MF0_NTAG_SET_WRITE_MODE,        NULL,                      cmd_processor_mf0_ntag_set_write_mode,       NULL                   },
-    {    DATA_CMD_MF0_NTAG_SET_DETECTION_ENABLE,  NULL,                      cmd_processor_mf0_ntag_set_detection_enable, NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_DETECTION_COUNT,   NULL,                      cmd_processor_mf0_ntag_get_detection_count,  NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_DETECTION_LOG,     NULL,                      cmd_processor_mf0_ntag_get_detection_log,    NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_DETECTION_ENABLE,  NULL,                      cmd_processor_mf0_ntag_get_detection_enable, NULL                   },
-    {    DATA_CMD_MF0_NTAG_GET_EMULATOR_CONFIG,   NULL,                      cmd_processor_mf0_get_emulator_config,       NULL                   },
-
-    {    DATA_CMD_EM410X_SET_EMU_ID,              NULL,                      cmd_processor_em410x_set_emu_id,             NULL                   },
-    {    DATA_CMD_EM410X_GET_EMU_ID,              NULL,                      cmd_processor_em410x_get_emu_id,             NULL                   },
-    {    DATA_CMD_HIDPROX_SET_EMU_ID,             NULL,                      cmd_processor_hidprox_set_emu_id,            NULL                   },
-    {    DATA_CMD_HIDPROX_GET_EMU_ID,             NULL,                      cmd_processor_hidprox_get_emu_id,            NULL                   },
-    {    DATA_CMD_VIKING_SET_EMU_ID,              NULL,                      cmd_processor_viking_set_emu_id,             NULL                   },
-    {    DATA_CMD_VIKING_GET_EMU_ID,              NULL,                      cmd_processor_viking_get_emu_id,             NULL                   },
+// Two commands on the same slot of the table are an error, not just an overridden initializer.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Woverride-init"
+static const cmd_data_map_t m_data_cmd_map[CMD_MAP_SIZE] = {
+#include "app_cmd_map.h"
 };
+#pragma GCC diagnostic pop
 
 data_frame_tx_t *cmd_processor_get_device_capabilities(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
-    size_t count = ARRAYLEN(m_data_cmd_map);
-    uint16_t commands[count];
-    memset(commands, 0, count * sizeof(uint16_t));
+    uint16_t commands[CMD_MAP_SIZE];
+    size_t count = 0;
 
-    for (size_t i = 0; i < count; i++) {
-        commands[i] = U16HTONS(m_data_cmd_map[i].cmd);
+    for (size_t i = 0; i < CMD_MAP_SIZE; i++) {
+        if (m_data_cmd_map[i].cmd != 0) {
+            commands[count++] = U16HTONS(m_data_cmd_map[i].cmd);
+        }
     }
 
     return data_frame_make(cmd, STATUS_SUCCESS, count * sizeof(uint16_t), (uint8_t *)commands);
@@ -1679,44 +1931,110 @@ data_frame_tx_t *cmd_processor_get_device_capabilities(uint16_t cmd, uint16_t st
 static void auto_response_data(data_frame_tx_t *resp) {
     // TODO Please select the reply source automatically according to the message source,
     //  and do not reply by checking the validity of the link layer by layer
+    data_frame_compress(resp);
     if (is_usb_working()) {
-        usb_cdc_write(resp->buffer, resp->length);
+        // sent from the frame, released on TX done
+        data_frame_tx_commit(resp);
+        usb_cdc_tx_start();
     } else if (is_nus_working()) {
-        nus_data_response(resp->buffer, resp->length);
+        // queued, the tx buffer can be reused as soon as this returns
+        if (!nus_data_response(resp->buffer, resp->length)) {
+            NRF_LOG_ERROR("BLE link lost, response dropped.");
+        }
+        data_frame_tx_discard(resp);
     } else {
         NRF_LOG_ERROR("No connection valid found at response client.");
+        data_frame_tx_discard(resp);
     }
 }
 
 
-/**@brief Function to process data frame(cmd)
+/**
+ * @brief Find cmd in m_data_cmd_map and run its before, processor and after functions.
+ * @param is_cmd_support set to false if cmd is not in the map
+ * @return the response, NULL if the handlers gave none
  */
-void on_data_frame_received(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+static data_frame_tx_t *cmd_dispatch(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data, bool *is_cmd_support) {
     data_frame_tx_t *response = NULL;
-    bool is_cmd_support = false;
-    for (int i = 0; i < ARRAY_SIZE(m_data_cmd_map); i++) {
-        if (m_data_cmd_map[i].cmd == cmd) {
-            is_cmd_support = true;
-            if (m_data_cmd_map[i].cmd_before != NULL) {
-                data_frame_tx_t *before_resp = m_data_cmd_map[i].cmd_before(cmd, status, length, data);
-                if (before_resp != NULL) {
-                    // some problem found before run cmd.
-                    response = before_resp;
-                    break;
-                }
-            }
-            if (m_data_cmd_map[i].cmd_processor != NULL) response = m_data_cmd_map[i].cmd_processor(cmd, status, length, data);
-            if (m_data_cmd_map[i].cmd_after != NULL) {
-                data_frame_tx_t *after_resp = m_data_cmd_map[i].cmd_after(cmd, status, length, data);
-                if (after_resp != NULL) {
-                    // some problem found after run cmd.
-                    response = after_resp;
-                    break;
-                }
-            }
+    const cmd_data_map_t *entry = cmd_map_find(m_data_cmd_map, cmd);
+    *is_cmd_support = entry != NULL;
+    if (entry == NULL) {
+        return NULL;
+    }
+    if (entry->cmd_before != NULL) {
+        response = entry->cmd_before(cmd, status, length, data);
+        if (response != NULL) {
+            // some problem found before run cmd.
+            return response;
+        }
+    }
+    if (entry->cmd_processor != NULL) response = entry->cmd_processor(cmd, status, length, data);
+    if (entry->cmd_after != NULL) {
+        data_frame_tx_t *after_resp = entry->cmd_after(cmd, status, length, data);
+        if (after_resp != NULL) {
+            // some problem found after run cmd.
+            response = after_resp;
+        }
+    }
+    return response;
+}
+
+/**
+ * @brief Run a sequence of commands from one frame and answer all their results at once.
+ *        Request: repeated { cmd (u16), length (u16), data (length bytes) }
+ *        Response: repeated { cmd (u16), status (u16), length (u16), data (length bytes) }, in request order.
+ *        A sub command answering with several frames gives one STATUS_MORE_DATA result per partial frame.
+ *        Results larger than a frame are sent in STATUS_MORE_DATA frames of the batch cmd.
+ */
+static data_frame_tx_t *cmd_processor_batch(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    typedef struct {
+        uint16_t cmd;
+        uint16_t length;
+        uint8_t data[];
+    } PACKED request_t;
+
+    if (m_batch_running) {
+        // batches do not nest
+        return data_frame_make(cmd, STATUS_PAR_ERR, 0, NULL);
+    }
+    m_batch_running = true;
+    m_batch_frame_tx = data_frame_tx_acquire();
+    m_batch_length = 0;
+    status = STATUS_SUCCESS;
+    uint16_t offset = 0;
+    while (offset < length) {
+        request_t *request = (request_t *)&data[offset];
+        if (length - offset < sizeof(request_t) || U16NTOHS(request->length) > length - offset - sizeof(request_t)) {
+            // truncated request, the results of the previous ones are still sent
+            status = STATUS_PAR_ERR;
             break;
         }
+        uint16_t request_cmd = U16NTOHS(request->cmd);
+        uint16_t request_length = U16NTOHS(request->length);
+        offset += sizeof(request_t) + request_length;
+
+        bool is_cmd_support = false;
+        data_frame_tx_t *response = cmd_dispatch(request_cmd, 0, request_length, request_length > 0 ? request->data : NULL, &is_cmd_support);
+        if (!is_cmd_support) {
+            batch_append_result(request_cmd, STATUS_INVALID_CMD, 0, NULL);
+        } else if (response != NULL) {
+            netdata_frame_raw_t *frame = (netdata_frame_raw_t *)response->buffer;
+            batch_append_result(request_cmd, U16NTOHS(frame->pre.status), U16NTOHS(frame->pre.len), frame->data);
+            // copied, free for the next sub command
+            data_frame_tx_discard(response);
+        } else {
+            batch_append_result(request_cmd, STATUS_SUCCESS, 0, NULL);
+        }
     }
+    m_batch_running = false;
+    return data_frame_make_in_place(m_batch_frame_tx, cmd, status, m_batch_length);
+}
+
+/**@brief Function to process data frame(cmd)
+ */
+void on_data_frame_received(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    bool is_cmd_support = false;
+    data_frame_tx_t *response = cmd_dispatch(cmd, status, length, data, &is_cmd_support);
     if (is_cmd_support) {
         // check and response
         if (response != NULL) {
@@ -1728,4 +2046,6 @@ void on_data_frame_received(uint16_t cmd, uint16_t status, uint16_t length, uint
         auto_response_data(response);
         NRF_LOG_INFO("Data frame cmd invalid: %d,", cmd);
     }
+    // frames made by the handlers but replaced by another response
+    data_frame_tx_discard_unsent();
 }
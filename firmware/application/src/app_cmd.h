@@ -14,6 +14,34 @@ typedef struct {
     cmd_processor cmd_after;
 } cmd_data_map_t;
 
+/**
+ * m_data_cmd_map is indexed by command: each range of data_cmd.h owns a fixed number of slots.
+ * CMD_MAP_INDEX is a constant expression for the table initializer and the lookup,
+ * it gives -1 for a command outside of the slots, which does not compile in the table.
+ */
+#define CMD_MAP_IN_RANGE(cmd, base, slots)  ((cmd) >= (base) && (cmd) < (base) + (slots))
+#define CMD_MAP_INDEX(cmd) (                                \
+    CMD_MAP_IN_RANGE(cmd, 1000, 64) ? (cmd) - 1000 :        \
+    CMD_MAP_IN_RANGE(cmd, 2000, 32) ? (cmd) - 2000 + 64 :   \
+    CMD_MAP_IN_RANGE(cmd, 2100, 8)  ? (cmd) - 2100 + 96 :   \
+    CMD_MAP_IN_RANGE(cmd, 3000, 16) ? (cmd) - 3000 + 104 :  \
+    CMD_MAP_IN_RANGE(cmd, 4000, 64) ? (cmd) - 4000 + 120 :  \
+    CMD_MAP_IN_RANGE(cmd, 5000, 16) ? (cmd) - 5000 + 184 :  \
+    -1)
+#define CMD_MAP_SIZE (200)
+
+// m_data_cmd_map entry, unused slots are zeroed (cmd 0)
+#define CMD_MAP(cmd, before, processor, after) \
+    [CMD_MAP_INDEX(cmd)] = { cmd, before, processor, after },
+
+static inline const cmd_data_map_t *cmd_map_find(const cmd_data_map_t *map, uint16_t cmd) {
+    int index = CMD_MAP_INDEX(cmd);
+    if (index < 0 || map[index].cmd != cmd) {
+        return NULL;
+    }
+    return &map[index];
+}
+
 void on_data_frame_received(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data);
 
 #endif
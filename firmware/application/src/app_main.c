@@ -284,6 +284,8 @@ static void system_off_enter(void) {
     m_system_off_processing = true;
     // Save tag data
     tag_emulation_save();
+    // and write what is still queued
+    fds_queue_flush();
 
     if (g_is_low_battery_shutdown) {
         // Don't create too complex animations, just blink LED1 three times.
@@ -668,7 +670,7 @@ static void btn_fn_copy_lf(uint8_t slot, tag_specific_type_t type) {
 
         fds_slot_record_map_t map_info;
         get_fds_map_by_slot_sense_type_for_nick(slot, TAG_SENSE_LF, &map_info);
-        fds_write_sync(map_info.id, map_info.key, sizeof(nick_buffer), nick_buffer);
+        fds_write_async(map_info.id, map_info.key, sizeof(nick_buffer), nick_buffer);
         offline_status_ok();
     } else {
         NRF_LOG_INFO("No lf tag found");
@@ -736,6 +738,7 @@ static void btn_fn_copy_hf(uint8_t slot, tag_specific_type_t type) {
         // copy ats
         antres->ats.length = tag.ats_len;
         memcpy(antres->ats.data, tag.ats, tag.ats_len);
+        tag_emulation_data_changed(antres, sizeof(*antres));
         NRF_LOG_INFO("Offline HF uid copied")
 
         char *nick = "cloned";
@@ -745,7 +748,7 @@ static void btn_fn_copy_hf(uint8_t slot, tag_specific_type_t type) {
 
         fds_slot_record_map_t map_info;
         get_fds_map_by_slot_sense_type_for_nick(slot, TAG_SENSE_HF, &map_info);
-        fds_write_sync(map_info.id, map_info.key, sizeof(nick_buffer), nick_buffer);
+        fds_write_async(map_info.id, map_info.key, sizeof(nick_buffer), nick_buffer);
         offline_status_ok();
     } else {
         NRF_LOG_INFO("No HF tag found");
@@ -924,6 +927,29 @@ static void blink_usb_led_status(void) {
     }
 }
 
+/**
+ * Write the queued FDS records, and collect the garbage of the flash when its free space runs low. Not while a card
+ * is emulated, the CPU stalls while the flash is written.
+ */
+static void fds_process(void) {
+    if (g_is_tag_emulating) {
+        return;
+    }
+    fds_queue_process();
+}
+
+/**
+ * Write the slot images left changed in the slot cache to flash, a slot at a time, and read those of the slots
+ * next to the active one. Not while a card is emulated, the CPU stalls while the flash is written, nor while the
+ * buttons are in use, the slots may be cycled through.
+ */
+static void slot_cache_process(void) {
+    if (g_is_tag_emulating || app_timer_cnt_diff_compute(app_timer_cnt_get(), m_last_btn_press) < APP_TIMER_TICKS(2000)) {
+        return;
+    }
+    tag_emulation_slot_cache_process();
+}
+
 static void lesc_event_process(void) {
     if (settings_get_ble_pairing_enable_first_load()) {
         ret_code_t err_code;
@@ -994,6 +1020,10 @@ int main(void) {
         
         // Data pack process
         data_frame_process();
+        // Slot cache upkeep
+        slot_cache_process();
+        // Queued flash writes
+        fds_process();
         // Log print process
         while (NRF_LOG_PROCESS());
         // USB event process
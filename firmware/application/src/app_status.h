@@ -31,5 +31,9 @@
 #define     STATUS_FLASH_WRITE_FAIL                 (0x70)  // Flash writing failed
 #define     STATUS_FLASH_READ_FAIL                  (0x71)  // Flash read failed
 #define     STATUS_INVALID_SLOT_TYPE                (0x72)  // Invalid slot type
+#define     STATUS_MORE_DATA                        (0x73)  // Partial response, more frames of the same cmd will follow
+#define     STATUS_STREAM_BEGIN                     (0x74)  // Start of a streamed response: stream id, total length, crc32 and final status
+#define     STATUS_STREAM_DATA                      (0x75)  // Part of a streamed response: stream id, offset and data
+#define     STATUS_STREAM_CRC_ERR                   (0x76)  // Set by the client when a streamed response fails its crc32 check, never sent by the device
 
 #endif
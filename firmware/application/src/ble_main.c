@@ -21,6 +21,7 @@
 #include "syssleep.h"
 #include "ble_main.h"
 #include "dataframe.h"
+#include "tx_ring.h"
 #include "hw_connect.h"
 #include "settings.h"
 
@@ -62,6 +63,13 @@ NRF_LOG_MODULE_REGISTER();
 #define NEXT_CONN_PARAMS_UPDATE_DELAY   APP_TIMER_TICKS(30000)                      /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT    3                                           /**< Number of attempts before giving up the connection parameter negotiation. */
 
+#define NUS_TX_RING_SIZE                (2 * (sizeof(netdata_frame_preamble_t) + NETDATA_MAX_DATA_LENGTH + sizeof(netdata_frame_postamble_t)))  /**< Room for two full frames waiting for their notifications. */
+
+#define BULK_MIN_CONN_INTERVAL          MSEC_TO_UNITS(7.5, UNIT_1_25_MS)            /**< Minimum connection interval of the bulk transfer profile (7.5 ms). */
+#define BULK_MAX_CONN_INTERVAL          MSEC_TO_UNITS(15, UNIT_1_25_MS)             /**< Maximum connection interval of the bulk transfer profile (15 ms), the shortest accepted by some centrals. */
+#define BULK_IDLE_TIMEOUT               APP_TIMER_TICKS(2000)                       /**< Time without bulk traffic before going back to the default profile. */
+#define BULK_DATA_LENGTH_DEFAULT        27                                          /**< LL data channel PDU payload before the data length update. */
+
 #define BATTERY_LEVEL_MEAS_INTERVAL     APP_TIMER_TICKS(5000)                       /**< Battery level measurement interval (ticks). This value corresponds to N seconds. */
 
 #define ADC_REF_VOLTAGE_IN_MILLIVOLTS  600  //!< Reference voltage (in milli volts) used by ADC while doing conversion.
@@ -82,6 +90,7 @@ NRF_LOG_MODULE_REGISTER();
         ((((ADC_VALUE) * ADC_REF_VOLTAGE_IN_MILLIVOLTS) / ADC_RES_12BIT) * ADC_PRE_SCALING_COMPENSATION)
 
 APP_TIMER_DEF(m_battery_timer_id);                                                  /**< Battery measurement timer. */
+APP_TIMER_DEF(m_bulk_idle_timer_id);                                                /**< Bulk transfer profile idle timer. */
 BLE_BAS_DEF(m_bas);                                                                 /**< Battery service instance. */
 BLE_NUS_DEF(m_nus, NRF_SDH_BLE_TOTAL_LINK_COUNT);                                   /**< BLE NUS service instance. */
 NRF_BLE_GATT_DEF(m_gatt);                                                           /**< GATT module instance. */
@@ -94,6 +103,11 @@ static nrf_saadc_value_t adc_buf[ADC_BUF_SIZE][ADC_BUF_COUNT];
 static uint16_t   m_conn_handle          = BLE_CONN_HANDLE_INVALID;                 /**< Handle of the current connection. */
 static uint16_t   m_ble_nus_max_data_len = BLE_GATT_ATT_MTU_DEFAULT - 3;            /**< Maximum length of data (in bytes) that can be transmitted to the peer by the Nordic UART service module. */
 lf_adc_callback_t m_lf_adc_callback      = NULL;
+static uint8_t    m_nus_tx_buffer[NUS_TX_RING_SIZE];
+static uint8_t    m_nus_tx_chunk[NRF_SDH_BLE_GATT_MAX_MTU_SIZE];
+static tx_ring_t  m_nus_tx_ring;                                                    /**< Frames waiting to be notified, fed on BLE_GATTS_EVT_HVN_TX_COMPLETE. */
+static bool       m_nus_tx_rejected      = false;                                   /**< The peer can't receive notifications, the queue is dropped. */
+static ble_link_status_t m_link_status;                                             /**< Negotiated parameters of the current connection. */
 
 static ble_uuid_t m_adv_uuids[]          =                                          /**< Universally unique service identifier. */
 {
@@ -149,6 +163,13 @@ static void gap_params_init(void) {
 
     err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
     APP_ERROR_CHECK(err_code);
+
+    // Let connection events go on while there is data to send, up to the connection interval.
+    ble_opt_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.common_opt.conn_evt_ext.enable = 1;
+    err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    APP_ERROR_CHECK(err_code);
 }
 
 /**@brief Function for handling the Battery Service events.
@@ -173,6 +194,88 @@ static void on_bas_evt(ble_bas_t *p_bas, ble_bas_evt_t *p_evt) {
     }
 }
 
+/**@brief Connection parameters of the bulk transfer profile or of the default one. */
+static void bulk_conn_params_get(bool bulk, ble_gap_conn_params_t *p_params) {
+    p_params->min_conn_interval = bulk ? BULK_MIN_CONN_INTERVAL : MIN_CONN_INTERVAL;
+    p_params->max_conn_interval = bulk ? BULK_MAX_CONN_INTERVAL : MAX_CONN_INTERVAL;
+    p_params->slave_latency     = SLAVE_LATENCY;
+    p_params->conn_sup_timeout  = CONN_SUP_TIMEOUT;
+}
+
+/**@brief Switch the link to the bulk transfer profile, or extend it while the traffic goes on:
+ *        2M PHY, largest data length and ATT MTU, shortest connection interval.
+ *        The central may refuse any of them, the requests are best effort.
+ */
+static void bulk_profile_request(void) {
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+    app_timer_stop(m_bulk_idle_timer_id);
+    APP_ERROR_CHECK(app_timer_start(m_bulk_idle_timer_id, BULK_IDLE_TIMEOUT, NULL));
+    if (m_link_status.bulk_mode) {
+        return;
+    }
+    m_link_status.bulk_mode = true;
+    NRF_LOG_INFO("BLE bulk transfer profile on");
+
+    ret_code_t err_code;
+    ble_gap_phys_t const phys = {
+        .rx_phys = BLE_GAP_PHY_2MBPS,
+        .tx_phys = BLE_GAP_PHY_2MBPS,
+    };
+    err_code = sd_ble_gap_phy_update(m_conn_handle, &phys);
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_INFO("PHY update request failed: %d", err_code);
+    }
+    if (m_link_status.att_mtu < NRF_SDH_BLE_GATT_MAX_MTU_SIZE) {
+        // only once per connection, nrf_ble_gatt may have asked already
+        err_code = sd_ble_gattc_exchange_mtu_request(m_conn_handle, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+        if (err_code != NRF_SUCCESS) {
+            NRF_LOG_INFO("ATT MTU request failed: %d", err_code);
+        }
+    }
+    if (m_link_status.data_length < NRF_SDH_BLE_GAP_DATA_LENGTH) {
+        err_code = nrf_ble_gatt_data_length_set(&m_gatt, m_conn_handle, NRF_SDH_BLE_GAP_DATA_LENGTH);
+        if (err_code != NRF_SUCCESS) {
+            NRF_LOG_INFO("Data length request failed: %d", err_code);
+        }
+    }
+    ble_gap_conn_params_t conn_params;
+    bulk_conn_params_get(true, &conn_params);
+    err_code = ble_conn_params_change_conn_params(m_conn_handle, &conn_params);
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_INFO("Connection interval request failed: %d", err_code);
+    }
+}
+
+/**@brief Back to the default connection interval once the bulk traffic is over, for power.
+ *        PHY, data length and MTU stay, they cost nothing when idle.
+ */
+static void bulk_idle_timeout_handler(void *p_context) {
+    UNUSED_PARAMETER(p_context);
+    if (nus_tx_queue_depth() > 0) {
+        APP_ERROR_CHECK(app_timer_start(m_bulk_idle_timer_id, BULK_IDLE_TIMEOUT, NULL));
+        return;
+    }
+    m_link_status.bulk_mode = false;
+    NRF_LOG_INFO("BLE bulk transfer profile off");
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+        ble_gap_conn_params_t conn_params;
+        bulk_conn_params_get(false, &conn_params);
+        ret_code_t err_code = ble_conn_params_change_conn_params(m_conn_handle, &conn_params);
+        if (err_code != NRF_SUCCESS) {
+            NRF_LOG_INFO("Connection interval request failed: %d", err_code);
+        }
+    }
+}
+
+/**@brief Negotiated parameters of the current connection. */
+void ble_get_link_status(ble_link_status_t *p_status) {
+    *p_status = m_link_status;
+    p_status->connected = g_is_ble_connected;
+    p_status->tx_queue_depth = nus_tx_queue_depth();
+}
+
 /**@brief Function for handling the data from the Nordic UART Service.
  *
  * @details This function will process the data received from the Nordic UART BLE Service
@@ -184,37 +287,76 @@ static void nus_data_handler(ble_nus_evt_t *p_evt) {
     if (p_evt->type == BLE_NUS_EVT_RX_DATA) {
         NRF_LOG_DEBUG("Received data from BLE NUS.");
         NRF_LOG_HEXDUMP_DEBUG(p_evt->params.rx_data.p_data, p_evt->params.rx_data.length);
+        if (p_evt->params.rx_data.length >= m_ble_nus_max_data_len) {
+            // full packets, the central is sending a large frame.
+            bulk_profile_request();
+        }
         data_frame_receive((uint8_t *)(p_evt->params.rx_data.p_data), p_evt->params.rx_data.length);
     }
 }
 /**@snippet [Handling the data received over BLE] */
 
-void nus_data_response(uint8_t *p_data, uint16_t length) {
+static bool nus_tx_send_chunk(uint8_t *data, uint16_t length) {
+    ret_code_t err_code = ble_nus_data_send(&m_nus, data, &length, m_conn_handle);
+    if (err_code == NRF_SUCCESS) {
+        return true;
+    }
+    if ((err_code == NRF_ERROR_INVALID_STATE) || (err_code == NRF_ERROR_NOT_FOUND)) {
+        // notifications are not enabled or the link is gone, nobody will read the queue.
+        m_nus_tx_rejected = true;
+    } else if ((err_code != NRF_ERROR_RESOURCES) && (err_code != NRF_ERROR_BUSY)) {
+        APP_ERROR_CHECK(err_code);
+    }
+    // NRF_ERROR_RESOURCES: the softdevice queue is full, resume on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+    return false;
+}
+
+/**@brief Hand the queued bytes to the softdevice until its notification queue is full.
+ *        Called from the main context and from the BLE event handler.
+ */
+static void nus_tx_pump(void) {
+    CRITICAL_REGION_ENTER();
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+        tx_ring_drain(&m_nus_tx_ring, m_nus_tx_chunk, m_ble_nus_max_data_len, nus_tx_send_chunk);
+    }
+    if (m_nus_tx_rejected || m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        tx_ring_reset(&m_nus_tx_ring);
+        m_nus_tx_rejected = false;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+/**@brief Queue a frame for the peer and return without waiting for its notifications.
+ *        Only waits when the queue has no room for the frame (back-pressure).
+ *
+ * @return false if the frame was dropped because the link is gone.
+ */
+bool nus_data_response(uint8_t *p_data, uint16_t length) {
     NRF_LOG_INFO("BLE nus service response data length: %d", length);
     NRF_LOG_HEXDUMP_DEBUG(p_data, length);
 
-    ret_code_t err_code;
-    uint16_t remain = length;
-    uint16_t count = 0;
-    do {
-        remain = MIN(m_ble_nus_max_data_len, remain);
-        err_code = ble_nus_data_send(&m_nus, p_data + count, &remain, m_conn_handle);
-        // NRF_LOG_INFO("Data send length(amount): %d", remain);
-        if (err_code == NRF_SUCCESS) {
-            count += remain;
-            remain = length - count;
-        }
-        // NRF_LOG_INFO("Data send length(count): %d", count);
-        if (err_code == NRF_ERROR_BUSY) {
-            continue;
-        }
-        if ((err_code != NRF_ERROR_INVALID_STATE) &&
-                (err_code != NRF_ERROR_RESOURCES) &&
-                (err_code != NRF_ERROR_NOT_FOUND)) {
-            APP_ERROR_CHECK(err_code);
+    if (length > m_ble_nus_max_data_len || nus_tx_queue_depth() > 0) {
+        // several notifications for this frame, worth a faster link.
+        bulk_profile_request();
+    }
+    bool queued = false;
+    while (g_is_ble_connected) {
+        CRITICAL_REGION_ENTER();
+        queued = tx_ring_push(&m_nus_tx_ring, p_data, length);
+        CRITICAL_REGION_EXIT();
+        nus_tx_pump();
+        if (queued) {
+            break;
         }
+        // queue full, sleep until the softdevice reports sent notifications.
+        sd_app_evt_wait();
+    }
+    return queued;
+}
 
-    } while (count != length && g_is_ble_connected);
+/**@brief Bytes of the queued frames not handed to the softdevice yet. */
+uint16_t nus_tx_queue_depth(void) {
+    return tx_ring_used(&m_nus_tx_ring);
 }
 
 bool is_nus_working(void) {
@@ -343,6 +485,11 @@ static void services_init(void) {
 static void on_conn_params_evt(ble_conn_params_evt_t *p_evt) {
     uint32_t err_code;
 
+    if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED && m_link_status.bulk_mode) {
+        // the central keeps its own interval, not worth losing the link over the bulk profile.
+        NRF_LOG_INFO("Bulk transfer connection interval refused");
+        return;
+    }
     if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED) {
         err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
         APP_ERROR_CHECK(err_code);
@@ -414,6 +561,14 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
             err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
             APP_ERROR_CHECK(err_code);
             g_is_ble_connected = true;
+            memset(&m_link_status, 0, sizeof(m_link_status));
+            m_link_status.tx_phy = BLE_GAP_PHY_1MBPS;
+            m_link_status.rx_phy = BLE_GAP_PHY_1MBPS;
+            m_link_status.att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+            m_link_status.data_length = BULK_DATA_LENGTH_DEFAULT;
+            m_link_status.conn_interval = p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval;
+            // a new client negotiates its own frame format
+            data_frame_set_compression(false);
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
@@ -421,6 +576,9 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
             // LED indication will be changed when advertising starts.
             m_conn_handle = BLE_CONN_HANDLE_INVALID;
             g_is_ble_connected = false;
+            nus_tx_pump();
+            app_timer_stop(m_bulk_idle_timer_id);
+            m_link_status.bulk_mode = false;
             // call sleep_timer_start *after* unsetting g_is_ble_connected
             sleep_timer_start(SLEEP_DELAY_MS_BLE_DISCONNECTED);
             break;
@@ -436,6 +594,18 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
         }
         break;
 
+        case BLE_GAP_EVT_PHY_UPDATE:
+            if (p_ble_evt->evt.gap_evt.params.phy_update.status == BLE_HCI_STATUS_CODE_SUCCESS) {
+                m_link_status.tx_phy = p_ble_evt->evt.gap_evt.params.phy_update.tx_phy;
+                m_link_status.rx_phy = p_ble_evt->evt.gap_evt.params.phy_update.rx_phy;
+            }
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            m_link_status.conn_interval = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval;
+            NRF_LOG_INFO("Connection interval %d (1.25 ms)", m_link_status.conn_interval);
+            break;
+
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
             // Pairing not supported? No, is supported now, hahahaha...
             // But... the pairing is enable?
@@ -455,6 +625,11 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context) {
         }
         break;
 
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            // notifications sent, room for more.
+            nus_tx_pump();
+            break;
+
         case BLE_GATTS_EVT_SYS_ATTR_MISSING:
             // No system attributes have been stored.
             err_code = sd_ble_gatts_sys_attr_set(m_conn_handle, NULL, 0, 0);
@@ -511,8 +686,13 @@ static void ble_stack_init(void) {
 void gatt_evt_handler(nrf_ble_gatt_t *p_gatt, nrf_ble_gatt_evt_t const *p_evt) {
     if ((m_conn_handle == p_evt->conn_handle) && (p_evt->evt_id == NRF_BLE_GATT_EVT_ATT_MTU_UPDATED)) {
         m_ble_nus_max_data_len = p_evt->params.att_mtu_effective - OPCODE_LENGTH - HANDLE_LENGTH;
+        m_link_status.att_mtu = p_evt->params.att_mtu_effective;
         NRF_LOG_INFO("Data len is set to 0x%X(%d)", m_ble_nus_max_data_len, m_ble_nus_max_data_len);
     }
+    if ((m_conn_handle == p_evt->conn_handle) && (p_evt->evt_id == NRF_BLE_GATT_EVT_DATA_LENGTH_UPDATED)) {
+        m_link_status.data_length = p_evt->params.data_length;
+        NRF_LOG_INFO("LL data length is set to %d", m_link_status.data_length);
+    }
     NRF_LOG_DEBUG("ATT MTU exchange completed. central 0x%x peripheral 0x%x",
                   p_gatt->att_mtu_desired_central,
                   p_gatt->att_mtu_desired_periph);
@@ -762,6 +942,9 @@ void create_battery_timer(void) {
     // Start battery timer
     err_code = app_timer_start(m_battery_timer_id, BATTERY_LEVEL_MEAS_INTERVAL, NULL);
     APP_ERROR_CHECK(err_code);
+    // Bulk transfer profile timer, started on demand.
+    err_code = app_timer_create(&m_bulk_idle_timer_id, APP_TIMER_MODE_SINGLE_SHOT, bulk_idle_timeout_handler);
+    APP_ERROR_CHECK(err_code);
 }
 
 /**
@@ -774,6 +957,7 @@ void ble_slave_init(void) {
     gap_params_init();                  // GAP parameter initialization
     gatt_init();                        // Gatt protocol initialization
     services_init();                    // Initialization of service characteristics
+    tx_ring_init(&m_nus_tx_ring, m_nus_tx_buffer, sizeof(m_nus_tx_buffer)); // NUS transmit queue
     advertising_init();                 // Broadcast parameter initialization
     conn_params_init();                 // Connection parameter initialization
     peer_manager_init();                // Peer manager Initialization
@@ -11,11 +11,24 @@ extern uint8_t percentage_batt_lvl;
 
 typedef void (*lf_adc_callback_t)(nrf_saadc_value_t *, size_t);
 
+typedef struct {
+    bool connected;
+    bool bulk_mode;             // bulk transfer profile requested
+    uint8_t tx_phy;             // BLE_GAP_PHY_*
+    uint8_t rx_phy;
+    uint16_t att_mtu;
+    uint16_t data_length;       // LL data channel PDU payload, octets
+    uint16_t conn_interval;     // 1.25 ms units
+    uint16_t tx_queue_depth;    // bytes not handed to the softdevice yet
+} ble_link_status_t;
+
 void ble_slave_init(void);
 void advertising_start(bool erase_bonds);
 void advertising_stop(void);
 void delete_bonds_all(void);
-void nus_data_response(uint8_t *p_data, uint16_t length);
+bool nus_data_response(uint8_t *p_data, uint16_t length);
+uint16_t nus_tx_queue_depth(void);
+void ble_get_link_status(ble_link_status_t *p_status);
 bool is_nus_working(void);
 void set_ble_connect_key(uint8_t *key);
 
@@ -2,7 +2,7 @@
 #include "app_timer.h"
 
 
-#define TICK_PERIOD APP_TIMER_TICKS(10) // Timing
+#define TICK_PERIOD APP_TIMER_TICKS(BSP_TIMER_TICK_MS) // Timing
 
 // Define a soft timer
 APP_TIMER_DEF(m_app_timer);
@@ -63,7 +63,7 @@ void timer_app_callback(void *arg) {
     UNUSED_PARAMETER(arg);
     for (g_timer_fori = 0; g_timer_fori < TIMER_BSP_COUNT; g_timer_fori++) {
         if (bsptimers[g_timer_fori].busy == 1) {
-            bsptimers[g_timer_fori].time += 10;
+            bsptimers[g_timer_fori].time += BSP_TIMER_TICK_MS;
         }
     }
 }
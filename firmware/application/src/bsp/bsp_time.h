@@ -8,6 +8,8 @@
 #endif
 //Define the maximum number of timer that can be used at the same time
 #define TIMER_BSP_COUNT 10
+// Period of the timers, the time of a timer counts in steps of it
+#define BSP_TIMER_TICK_MS 10
 
 // Define a structure
 // This structure stores basic clock information
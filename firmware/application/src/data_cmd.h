@@ -46,6 +46,10 @@
 #define DATA_CMD_GET_BLE_PAIRING_ENABLE         (1036)
 #define DATA_CMD_SET_BLE_PAIRING_ENABLE         (1037)
 #define DATA_CMD_GET_ALL_SLOT_NICKS             (1038)
+#define DATA_CMD_BATCH                          (1039)
+#define DATA_CMD_GET_BLE_LINK_STATUS            (1040)
+#define DATA_CMD_SET_FRAME_COMPRESSION          (1041)
+#define DATA_CMD_GET_STORAGE_STATUS             (1042)
 
 //
 // ******************************************************************
@@ -72,6 +76,7 @@
 #define DATA_CMD_MF1_HARDNESTED_ACQUIRE         (2013)
 #define DATA_CMD_MF1_ENC_NESTED_ACQUIRE         (2014)
 #define DATA_CMD_MF1_CHECK_KEYS_ON_BLOCK        (2015)
+#define DATA_CMD_MF1_READ_SECTORS               (2016)
 
 #define DATA_CMD_HF14A_SET_FIELD_ON             (2100)
 #define DATA_CMD_HF14A_SET_FIELD_OFF            (2101)
@@ -130,8 +135,6 @@
 #define DATA_CMD_MF0_NTAG_SET_COUNTER_DATA      (4028)
 #define DATA_CMD_MF0_NTAG_RESET_AUTH_CNT        (4029)
 #define DATA_CMD_MF0_NTAG_GET_PAGE_COUNT        (4030)
-#define DATA_CMD_MF0_NTAG_RESET_AUTH_CNT        (4029)
-#define DATA_CMD_MF0_NTAG_GET_PAGE_COUNT        (4030)
 #define DATA_CMD_MF0_NTAG_GET_WRITE_MODE        (4031)
 #define DATA_CMD_MF0_NTAG_SET_WRITE_MODE        (4032)
 #define DATA_CMD_MF0_NTAG_SET_DETECTION_ENABLE  (4033)
@@ -139,6 +142,11 @@
 #define DATA_CMD_MF0_NTAG_GET_DETECTION_LOG     (4035)
 #define DATA_CMD_MF0_NTAG_GET_DETECTION_ENABLE  (4036)
 #define DATA_CMD_MF0_NTAG_GET_EMULATOR_CONFIG   (4037)
+#define DATA_CMD_EMU_MEMORY_BULK_READ           (4038)
+#define DATA_CMD_EMU_MEMORY_BULK_WRITE          (4039)
+#define DATA_CMD_EMU_MEMORY_GET_CRC32           (4040)
+#define DATA_CMD_MF1_SET_DETECTION_POLICY       (4041)
+#define DATA_CMD_MF1_GET_DETECTION_POLICY       (4042)
 //
 // ******************************************************************
 
@@ -1,17 +1,152 @@
 #include "crypto1_helper.h"
 
+/*
+ * The Crypto1 of the emulation, on the state layout of crapto1 (odd and even halves of the LFSR, the bits
+ * above the 24th are not masked) so that it can be checked against it bit for bit. The filter is read
+ * from byte tables, the feedback parity is folded instead of __builtin_parity(), a libgcc call on the
+ * Cortex-M4, and two bits are clocked per step so that the halves are never swapped.
+ */
+
+// Index bits 4 and 3 of the filter output table, from the LFSR bits 0..7 of a half
+static const uint8_t m_filter_lo[256] = {
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x00, 0x00, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+    0x08, 0x08, 0x18, 0x18, 0x08, 0x18, 0x08, 0x08, 0x08, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x18,
+};
+
+// Index bits 2 and 1, from the bits 8..15
+static const uint8_t m_filter_mid[256] = {
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+    0x02, 0x02, 0x06, 0x06, 0x02, 0x06, 0x02, 0x02, 0x02, 0x06, 0x02, 0x02, 0x06, 0x06, 0x06, 0x06,
+};
+
+// Index bit 0, from the bits 16..19
+static const uint8_t m_filter_hi[16] = {
+    0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x01,
+};
+
+static inline uint32_t crypto1_filter(uint32_t x) {
+    uint32_t f = m_filter_lo[x & 0xff] | m_filter_mid[(x >> 8) & 0xff] | m_filter_hi[(x >> 16) & 0xf];
+    return (0xEC57E80A >> f) & 1;
+}
+
+static inline uint32_t crypto1_parity(uint32_t x) {
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    return (0x6996 >> (x & 0xf)) & 1;
+}
+
+/**
+ * @brief Clock the LFSR for the bits of 'in', LSB first, two at a time: the first bit shifts into the even
+ * half with the odd half filtered, the second into the odd half with the even half filtered, which is where
+ * crypto1_bit() and its swap leave them after two calls.
+ * @param count an even number of bits, 32 at most
+ * @return the keystream bits, LSB first
+ */
+static inline uint32_t crypto1_clock(struct Crypto1State *pcs, uint32_t in, uint8_t count, int is_encrypted) {
+    uint32_t odd = pcs->odd;
+    uint32_t even = pcs->even;
+    uint32_t enc = is_encrypted ? 1 : 0;
+    uint32_t ks = 0;
+    for (uint8_t i = 0; i < count; i += 2) {
+        uint32_t bit = crypto1_filter(odd);
+        ks |= bit << i;
+        even = even << 1 | crypto1_parity((odd & LF_POLY_ODD) ^ (even & LF_POLY_EVEN) ^ ((in >> i) & 1) ^ (bit & enc));
+        bit = crypto1_filter(even);
+        ks |= bit << (i + 1);
+        odd = odd << 1 | crypto1_parity((even & LF_POLY_ODD) ^ (odd & LF_POLY_EVEN) ^ ((in >> (i + 1)) & 1) ^ (bit & enc));
+    }
+    pcs->odd = odd;
+    pcs->even = even;
+    return ks;
+}
+
+uint8_t mf_crypto1_byte(struct Crypto1State *pcs, uint8_t in, int is_encrypted) {
+    return crypto1_clock(pcs, in, 8, is_encrypted);
+}
+
+uint32_t mf_crypto1_word(struct Crypto1State *pcs, uint32_t in, int is_encrypted) {
+    // the bytes go MSB first and each byte LSB first, as crypto1_word() does
+    uint32_t ks = crypto1_clock(pcs, in >> 24, 8, is_encrypted) << 24;
+    ks |= crypto1_clock(pcs, (in >> 16) & 0xff, 8, is_encrypted) << 16;
+    ks |= crypto1_clock(pcs, (in >> 8) & 0xff, 8, is_encrypted) << 8;
+    ks |= crypto1_clock(pcs, in & 0xff, 8, is_encrypted);
+    return ks;
+}
+
+/**
+ * @brief Load the key, crypto1_init() on the 6 key bytes: the even bits of each byte go into the even half
+ * and the odd bits into the odd half, the first byte and the low bits first.
+ */
+static void crypto1_load_key(struct Crypto1State *pcs, const uint8_t *key) {
+    uint32_t odd = 0;
+    uint32_t even = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+        for (uint8_t bit = 0; bit < 8; bit += 2) {
+            even = even << 1 | ((key[i] >> bit) & 1);
+            odd = odd << 1 | ((key[i] >> (bit + 1)) & 1);
+        }
+    }
+    pcs->odd = odd;
+    pcs->even = even;
+}
+
+void mf_crypto1_setup(struct Crypto1State *pcs, const uint8_t *key, const uint8_t *uid, const uint8_t *nt) {
+    crypto1_load_key(pcs, key);
+    for (uint8_t i = 0; i < 4; i++) {
+        crypto1_clock(pcs, uid[i] ^ nt[i], 8, 0);
+    }
+}
+
+/**
+ * @brief The nested authentication setup: the key is loaded, uid ^ nt shifted in while the nonce is
+ * encrypted with the keystream it produces, and the encrypted nonce framed with its encrypted parity.
+ * @return the bit count of the frame
+ */
+uint16_t mf_crypto1_setup_nested(struct Crypto1State *pcs, const uint8_t *key, const uint8_t *uid, const uint8_t *nt, uint8_t *frame) {
+    uint8_t keystream[4];
+    crypto1_load_key(pcs, key);
+    for (uint8_t i = 0; i < 4; i++) {
+        keystream[i] = uid[i] ^ nt[i];
+    }
+    return mf_crypto1_encrypt_frame(pcs, nt, keystream, 4, frame);
+}
+
 // crypto1 helpers
 void mf_crypto1_decryptEx(struct Crypto1State *pcs, uint8_t *data_in, int len, uint8_t *data_out) {
     if (len != 1) {
         for (int i = 0; i < len; i++)
-            data_out[i] = crypto1_byte(pcs, 0x00, 0) ^ data_in[i];
+            data_out[i] = crypto1_clock(pcs, 0, 8, 0) ^ data_in[i];
     } else {
-        uint8_t bt = 0;
-        bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data_in[0], 0)) << 0;
-        bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data_in[0], 1)) << 1;
-        bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data_in[0], 2)) << 2;
-        bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data_in[0], 3)) << 3;
-        data_out[0] = bt;
+        data_out[0] = (crypto1_clock(pcs, 0, 4, 0) ^ data_in[0]) & 0x0f;
     }
     return;
 }
@@ -25,9 +160,9 @@ void mf_crypto1_encryptEx(struct Crypto1State *pcs, uint8_t *data_in, uint8_t *k
     for (i = 0; i < len; i++) {
         uint8_t bt = data_in[i];
         // Encrypted bytes
-        data_out[i] = crypto1_byte(pcs, keystream ? keystream[i] : 0x00, 0) ^ data_in[i];
+        data_out[i] = crypto1_clock(pcs, keystream ? keystream[i] : 0x00, 8, 0) ^ data_in[i];
         // Generate strange school inspection
-        par[i] = filter(pcs->odd) ^ oddparity8(bt);
+        par[i] = crypto1_filter(pcs->odd) ^ oddparity8(bt);
     }
 }
 
@@ -35,11 +170,34 @@ void mf_crypto1_encrypt(struct Crypto1State *pcs, uint8_t *data, uint16_t len, u
     mf_crypto1_encryptEx(pcs, data, NULL, data, len, par);
 }
 
+/**
+ * @brief Encrypt and frame in one pass, what mf_crypto1_encryptEx() then nfc_tag_14a_wrap_frame() give:
+ * each encrypted byte and its encrypted parity are the next 9 bits of the frame, LSB first.
+ * @return the bit count of the frame
+ */
+uint16_t mf_crypto1_encrypt_frame(struct Crypto1State *pcs, const uint8_t *data_in, const uint8_t *keystream, uint16_t len, uint8_t *frame) {
+    uint32_t bits = 0;
+    uint8_t pending = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t bt = data_in[i];
+        uint32_t enc = (crypto1_clock(pcs, keystream ? keystream[i] : 0x00, 8, 0) ^ bt) & 0xff;
+        enc |= (crypto1_filter(pcs->odd) ^ oddparity8(bt)) << 8;
+        bits |= enc << pending;
+        *frame++ = (uint8_t)bits;
+        bits >>= 8;
+        pending++;
+        if (pending == 8) {
+            *frame++ = (uint8_t)bits;
+            bits = 0;
+            pending = 0;
+        }
+    }
+    if (pending != 0) {
+        *frame = (uint8_t)bits;
+    }
+    return len * 9;
+}
+
 uint8_t mf_crypto1_encrypt4bit(struct Crypto1State *pcs, uint8_t data) {
-    uint8_t bt = 0;
-    bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data, 0)) << 0;
-    bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data, 1)) << 1;
-    bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data, 2)) << 2;
-    bt |= (crypto1_bit(pcs, 0, 0) ^ BIT(data, 3)) << 3;
-    return bt;
+    return (crypto1_clock(pcs, 0, 4, 0) ^ data) & 0x0f;
 }
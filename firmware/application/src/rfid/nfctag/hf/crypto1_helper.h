@@ -4,10 +4,15 @@
 #include "mf1_crapto1.h"
 #include "parity.h"
 
+uint8_t mf_crypto1_byte(struct Crypto1State *pcs, uint8_t in, int is_encrypted);
+uint32_t mf_crypto1_word(struct Crypto1State *pcs, uint32_t in, int is_encrypted);
+void mf_crypto1_setup(struct Crypto1State *pcs, const uint8_t *key, const uint8_t *uid, const uint8_t *nt);
+uint16_t mf_crypto1_setup_nested(struct Crypto1State *pcs, const uint8_t *key, const uint8_t *uid, const uint8_t *nt, uint8_t *frame);
 void mf_crypto1_decryptEx(struct Crypto1State *pcs, uint8_t *data_in, int len, uint8_t *data_out);
 void mf_crypto1_decrypt(struct Crypto1State *pcs, uint8_t *data, int len);
 void mf_crypto1_encryptEx(struct Crypto1State *pcs, uint8_t *data_in, uint8_t *keystream, uint8_t *data_out, uint16_t len, uint8_t *par);
 void mf_crypto1_encrypt(struct Crypto1State *pcs, uint8_t *data, uint16_t len, uint8_t *par);
+uint16_t mf_crypto1_encrypt_frame(struct Crypto1State *pcs, const uint8_t *data_in, const uint8_t *keystream, uint16_t len, uint8_t *frame);
 uint8_t mf_crypto1_encrypt4bit(struct Crypto1State *pcs, uint8_t data);
 
 #endif
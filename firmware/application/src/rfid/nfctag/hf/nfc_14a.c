@@ -11,7 +11,6 @@ NRF_LOG_MODULE_REGISTER();
 #include "hex_utils.h"
 #include "crc_utils.h"
 #include "nfc_mf1.h"
-#include "byte_mirror.h"
 
 #include "rfid_main.h"
 #include "syssleep.h"
@@ -118,56 +117,35 @@ bool nfc_tag_14a_checks_crc(uint8_t *pbtData, size_t szLen) {
 * @retval :The length of the bitstream assembly results buffer. Note that it is the length of the bit.
 */
 uint8_t nfc_tag_14a_wrap_frame(const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtFrame) {
-    uint8_t btData;
-    uint32_t uiBitPos;
-    uint32_t uiDataPos = 0;
-    size_t szBitsLeft = szTxBits;
-    size_t szFrameBits = 0;
-
     // Make sure we should frame at least something
-    if (szBitsLeft == 0)
+    if (szTxBits == 0)
         return 0;
 
     // Handle a short response (1byte) as a special case
-    if (szBitsLeft < 9) {
+    if (szTxBits < 9) {
         *pbtFrame = *pbtTx;
-        szFrameBits = szTxBits;
-        return szFrameBits;
+        return szTxBits;
     }
-    // We start by calculating the frame length in bits
-    szFrameBits = szTxBits + (szTxBits / 8);
-
-    // Parse the data bytes and add the parity bits
-    // This is really a sensitive process, mirror the frame bytes and append parity bits
-    // buffer = mirror(frame-byte) + parity + mirror(frame-byte) + parity + ...
-    // split "buffer" up in segments of 8 bits again and mirror them
-    // air-bytes = mirror(buffer-byte) + mirror(buffer-byte) + mirror(buffer-byte) + ..
-    while (1) {
-        // Reset the temporary frame byte;
-        uint8_t btFrame = 0;
-
-        for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
-            // Copy as much data that fits in the frame byte
-            btData = byte_mirror[pbtTx[uiDataPos]];
-            btFrame |= (btData >> uiBitPos);
-            // Save this frame byte
-            *pbtFrame = byte_mirror[btFrame];
-            // Set the remaining bits of the date in the new frame byte and append the parity bit
-            btFrame = (btData << (8 - uiBitPos));
-            btFrame |= ((pbtTxPar[uiDataPos] & 0x01) << (7 - uiBitPos));
-            // Backup the frame bits we have so far
-            pbtFrame++;
-            *pbtFrame = byte_mirror[btFrame];
-            // Increase the data (without parity bit) position
-            uiDataPos++;
-            // Test if we are done
-            if (szBitsLeft < 9)
-                return szFrameBits;
-            szBitsLeft -= 8;
+
+    // The air bits go out LSB first: each data byte and its parity are 9 bits appended above the
+    // bits still pending, a frame byte is stored as soon as 8 bits are pending
+    uint32_t uiBits = 0;
+    uint8_t uiPending = 0;
+    size_t szBytes = (szTxBits + 7) / 8;
+    for (size_t i = 0; i < szBytes; i++) {
+        uiBits |= (uint32_t)(pbtTx[i] | ((pbtTxPar[i] & 0x01) << 8)) << uiPending;
+        *pbtFrame++ = (uint8_t)uiBits;
+        uiBits >>= 8;
+        uiPending++;
+        if (uiPending == 8) {
+            *pbtFrame++ = (uint8_t)uiBits;
+            uiBits = 0;
+            uiPending = 0;
         }
-        // Every 8 data bytes we lose one frame byte to the parities
-        pbtFrame++;
     }
+    if (uiPending != 0)
+        *pbtFrame = (uint8_t)uiBits;
+    return szTxBits + (szTxBits / 8);
 }
 
 /**
@@ -180,49 +158,38 @@ uint8_t nfc_tag_14a_wrap_frame(const uint8_t *pbtTx, const size_t szTxBits, cons
 * @retval :The data length of the bitstream packaging, note that the length of the data area is the length of the data area.retval / 8
 */
 uint8_t nfc_tag_14a_unwrap_frame(const uint8_t *pbtFrame, const size_t szFrameBits, uint8_t *pbtRx, uint8_t *pbtRxPar) {
-    uint8_t btFrame;
-    uint8_t btData;
-    uint8_t uiBitPos;
-    uint32_t uiDataPos = 0;
-    uint8_t *pbtFramePos = (uint8_t *)pbtFrame;
-    size_t szBitsLeft = szFrameBits;
-    size_t szRxBits = 0;
-
     // Make sure we should frame at least something
-    if (szBitsLeft == 0)
+    if (szFrameBits == 0)
         return 0;
 
     // Handle a short response (1byte) as a special case
-    if (szBitsLeft < 9) {
+    if (szFrameBits < 9) {
         *pbtRx = *pbtFrame;
-        szRxBits = szFrameBits;
-        return szRxBits;
+        return szFrameBits;
     }
 
-    // Calculate the data length in bits
-    szRxBits = szFrameBits - (szFrameBits / 9);
-
-    // Parse the frame bytes, remove the parity bits and store them in the parity array
-    // This process is the reverse of WrapFrame(), look there for more info
-    while (1) {
-        for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
-            btFrame = byte_mirror[pbtFramePos[uiDataPos]];
-            btData = (btFrame << uiBitPos);
-            btFrame = byte_mirror[pbtFramePos[uiDataPos + 1]];
-            btData |= (btFrame >> (8 - uiBitPos));
-            pbtRx[uiDataPos] = byte_mirror[btData];
-            if (pbtRxPar != NULL)
-                pbtRxPar[uiDataPos] = ((btFrame >> (7 - uiBitPos)) & 0x01);
-            // Increase the data (without parity bit) position
-            uiDataPos++;
-            // Test if we are done
-            if (szBitsLeft < 9)
-                return szRxBits;
-            szBitsLeft -= 9;
+    // The reverse of nfc_tag_14a_wrap_frame(): data byte i is the 9 bits from bit 9 * i of the frame, the
+    // last of them its parity. Like the frame is read, the byte after the last full 9 bits is unwrapped too.
+    // pbtRx may be pbtFrame, a frame byte is always read before the data byte at its position is written.
+    uint32_t uiBits = 0;
+    uint8_t uiPending = 0;
+    size_t szBytes = szFrameBits / 9 + 1;
+    for (size_t i = 0; i < szBytes; i++) {
+        if (uiPending < 9) {
+            uiBits |= (uint32_t)(*pbtFrame++) << uiPending;
+            uiPending += 8;
+        }
+        if (uiPending < 9) {
+            uiBits |= (uint32_t)(*pbtFrame++) << uiPending;
+            uiPending += 8;
         }
-        // Every 8 data bytes we lose one frame byte to the parities
-        pbtFramePos++;
+        pbtRx[i] = (uint8_t)uiBits;
+        if (pbtRxPar != NULL)
+            pbtRxPar[i] = (uiBits >> 8) & 0x01;
+        uiBits >>= 9;
+        uiPending -= 9;
     }
+    return szFrameBits - (szFrameBits / 9);
 }
 
 /**
@@ -259,7 +226,11 @@ uint8_t nfc_tag_14a_unwrap_frame(const uint8_t *pbtFrame, const size_t szFrameBi
  * @param[in]   appendCrc  Whether to send the byte flow, automatically send the CRC16 verification automatically
  */
 void nfc_tag_14a_tx_bytes(uint8_t *data, uint32_t bytes, bool appendCrc) {
-    ASSERT(bytes <= MAX_NFC_TX_BUFFER_SIZE);
+    // The length may come from the reader, the check stays in the release builds
+    if (bytes > MAX_NFC_TX_BUFFER_SIZE) {
+        NRF_LOG_ERROR("TX of %d bytes over the buffer.", bytes);
+        return;
+    }
     NFC_14A_TX_BYTE_CORE(data, bytes, appendCrc, NRF_NFCT_FRAME_DELAY_MODE_WINDOWGRID);
 }
 
@@ -134,6 +134,9 @@ static nfc_tag_mf0_ntag_tx_buffer_t m_tag_tx_buffer;
 static tag_specific_type_t m_tag_type;
 static bool m_tag_authenticated = false;
 static bool m_did_first_read = false;
+// Decoded lock and configuration pages of the slot, rebuilt on first use after one of them is written or a load
+static nfc_tag_mf0_ntag_state_t m_state;
+static bool m_state_valid = false;
 
 #define MF0_NTAG_AUTH_LOG_MAX 32
 static __attribute__((section(".noinit_mf0"))) struct nfc_tag_mf0_auth_log_buffer {
@@ -258,21 +261,6 @@ static int get_first_cfg_page_by_tag_type(tag_specific_type_t tag_type) {
     return page;
 }
 
-static int get_block_max_by_tag_type(tag_specific_type_t tag_type, bool read) {
-    int max_pages = get_nr_pages_by_tag_type(tag_type);
-    int first_cfg_page = get_first_cfg_page_by_tag_type(tag_type);
-
-    if (first_cfg_page == 0 || m_tag_authenticated || m_tag_information->config.mode_uid_magic) return max_pages;
-
-    uint8_t auth0 = m_tag_information->memory[first_cfg_page][CONF_AUTH0_BYTE];
-    uint8_t access = m_tag_information->memory[first_cfg_page + 1][0];
-
-    NRF_LOG_INFO("auth0 %02x access %02x max_pages %02x first_cfg_page %02x authenticated %i", auth0, access, max_pages, first_cfg_page, m_tag_authenticated);
-
-    if (!read || ((access & CONF_ACCESS_PROT) != 0)) return (max_pages > auth0) ? auth0 : max_pages;
-    else return max_pages;
-}
-
 static bool is_ntag() {
     switch (m_tag_type) {
         case TAG_TYPE_NTAG_210:
@@ -447,6 +435,11 @@ static int get_user_data_end_by_tag_type(tag_specific_type_t type) {
     return nr_pages;
 }
 
+// The emulator settings were changed, they are saved with the data
+static void config_changed(void) {
+    tag_emulation_data_changed(&m_tag_information->config, sizeof(m_tag_information->config));
+}
+
 static uint8_t *get_counter_data_by_index(uint8_t index, bool external) {
     uint8_t ctr_page_off;
     uint8_t ctr_page_end;
@@ -515,28 +508,152 @@ static void bytes2hex(const uint8_t *bytes, char *hex, size_t len) {
     }
 }
 
-static void handle_any_read(uint8_t block_num, uint8_t block_cnt, uint8_t block_max) {
-    ASSERT(block_cnt <= block_max);
-    ASSERT((block_max - block_cnt) >= block_num);
+// Whether the lock bits or CFGLCK make the page read-only, decoded once per page into the lock bitmap of the state
+static bool decode_ro_lock_on_page(int block_num) {
+    if (block_num < 3) return true;
+    else if (block_num == 3) return (m_tag_information->memory[2][2] & 9) != 0; // bits 0 and 3
+    else if (block_num <= MF0ICU1_PAGES) {
+        bool locked = false;
 
-    uint8_t first_cfg_page = get_first_cfg_page_by_tag_type(m_tag_type);
+        // check block locking bits
+        if (block_num <= 9) locked |= (m_tag_information->memory[2][2] & 2) == 2;
+        else locked |= (m_tag_information->memory[2][2] & 4) == 4;
+
+        locked |= (((*(uint16_t *)&m_tag_information->memory[2][2]) >> block_num) & 1) == 1;
+
+        return locked;
+    } else {
+        uint8_t *p_lock_bytes = NULL;
+        int user_memory_end = 0;
+        int dyn_lock_bit_page_cnt = 0;
+        int index = block_num - MF0ICU1_PAGES;
+
+        switch (m_tag_type) {
+            case TAG_TYPE_MF0ICU1:
+                return true;
+            case TAG_TYPE_MF0ICU2: {
+                p_lock_bytes = m_tag_information->memory[MF0ICU2_USER_MEMORY_END];
+
+                if (block_num < MF0ICU2_USER_MEMORY_END) {
+                    uint8_t byte2 = p_lock_bytes[0];
+
+                    // Account for block locking bits first.
+                    bool locked = (byte2 & (0x10 * (block_num >= 28))) != 0;
+                    locked |= (byte2 >> (1 + (index / 4) + (block_num >= 28)));
+                    return locked;
+                } else if (block_num == MF0ICU2_USER_MEMORY_END) {
+                    return false;
+                } else if (block_num < MF0ICU2_FIRST_KEY_PAGE) {
+                    uint8_t byte3 = p_lock_bytes[1];
+                    return ((byte3 >> (block_num - MF0ICU2_CNT_PAGE)) & 1) != 0;
+                } else {
+                    uint8_t byte3 = p_lock_bytes[1];
+                    return (byte3 & 0x80) != 0;
+                }
+            }
+            // for the next two we reuse the check for CFGLCK bit used for NTAG
+            case TAG_TYPE_MF0UL11:
+                ASSERT(block_num >= MF0UL11_USER_MEMORY_END);
+                user_memory_end = MF0UL11_USER_MEMORY_END;
+                break;
+            case TAG_TYPE_MF0UL21: {
+                user_memory_end = MF0UL11_USER_MEMORY_END;
+                if (block_num < user_memory_end) {
+                    p_lock_bytes = m_tag_information->memory[MF0UL21_USER_MEMORY_END];
+                    uint16_t lock_word = (((uint16_t)p_lock_bytes[1]) << 8) | (uint16_t)p_lock_bytes[0];
+                    bool locked = ((lock_word >> (index / 2)) & 1) != 0;
+                    locked |= ((p_lock_bytes[2] >> (index / 4)) & 1) != 0;
+                    return locked;
+                }
+                break;
+            }
+            case TAG_TYPE_NTAG_210:
+                user_memory_end = NTAG210_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 0; // NTAG 210 doesn't have dynamic lock bits
+                break;
+            case TAG_TYPE_NTAG_212:
+                user_memory_end = NTAG212_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 2;
+                break;
+            case TAG_TYPE_NTAG_213:
+                user_memory_end = NTAG213_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 2;
+                break;
+            case TAG_TYPE_NTAG_215:
+                user_memory_end = NTAG215_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 16;
+                break;
+            case TAG_TYPE_NTAG_216:
+                user_memory_end = NTAG216_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 16;
+                break;
+            default:
+                ASSERT(false);
+                break;
+        }
+
+        if (block_num < user_memory_end) {
+            ASSERT(dyn_lock_bit_page_cnt > 0);
+
+            p_lock_bytes = m_tag_information->memory[user_memory_end];
+            uint16_t lock_word = (((uint16_t)p_lock_bytes[1]) << 8) | (uint16_t)p_lock_bytes[0];
+
+            bool locked_small_range = ((lock_word >> (index / dyn_lock_bit_page_cnt)) & 1) != 0;
+            bool locked_large_range = ((p_lock_bytes[2] >> (index / dyn_lock_bit_page_cnt / 2)) & 1) != 0;
+
+            return locked_small_range | locked_large_range;
+        } else {
+            // check CFGLCK bit
+            int first_cfg_page = get_first_cfg_page_by_tag_type(m_tag_type);
+            uint8_t access = m_tag_information->memory[first_cfg_page + CONF_ACCESS_PAGE_OFFSET][CONF_ACCESS_BYTE];
+            if ((access & CONF_ACCESS_CFGLCK) != 0)
+                return (block_num >= first_cfg_page) && ((block_num - first_cfg_page) <= 1);
+            else
+                return false;
+        }
+    }
+}
+
+/**
+ * @brief Decode the lock and configuration pages of the slot, what READ, FAST_READ, WRITE and PWD_AUTH look up.
+ */
+static void rebuild_state(void) {
+    nfc_tag_mf0_ntag_state_t *state = &m_state;
+    memset(state, 0, sizeof(*state));
+
+    state->nr_pages = get_nr_pages_by_tag_type(m_tag_type);
+    state->user_data_end = get_user_data_end_by_tag_type(m_tag_type);
+    state->first_cfg_page = get_first_cfg_page_by_tag_type(m_tag_type);
+    state->read_max = state->nr_pages;
+    state->write_max = state->nr_pages;
+
+    for (int page = 0; page < state->nr_pages; page++) {
+        if (decode_ro_lock_on_page(page)) state->lock_bitmap[page / 8] |= 1 << (page % 8);
+    }
+
+    uint8_t first_cfg_page = state->first_cfg_page;
+    if (first_cfg_page == 0) {
+        m_state_valid = true;
+        return;
+    }
 
     // password pages are present on all tags that have config pages
-    uint8_t pwd_page = 0;
-    if (first_cfg_page != 0) pwd_page = first_cfg_page + CONF_PWD_PAGE_OFFSET;
+    state->pwd_page = first_cfg_page + CONF_PWD_PAGE_OFFSET;
+    state->pack_page = first_cfg_page + CONF_PACK_PAGE_OFFSET;
+
+    uint8_t auth0 = m_tag_information->memory[first_cfg_page][CONF_AUTH0_BYTE];
+    uint8_t access = m_tag_information->memory[first_cfg_page + 1][0];
+    if (state->nr_pages > auth0) {
+        state->write_max = auth0;
+        if ((access & CONF_ACCESS_PROT) != 0) state->read_max = auth0;
+    }
 
     // extract mirroring config
-    int mirror_page_off = 0;
-    int mirror_page_end = 0;
-    int mirror_byte_off = 0;
-    int mirror_mode = 0;
-    int mirror_size = 0;
-    uint8_t mirror_buf[MIRROR_UID_CNT_SIZE];
     if (is_ntag()) {
         uint8_t mirror = m_tag_information->memory[first_cfg_page][CONF_MIRROR_BYTE];
-        mirror_page_off = m_tag_information->memory[first_cfg_page][CONF_MIRROR_PAGE_BYTE];
-        mirror_mode = (mirror & MIRROR_BYTE_CONF_MASK) >> MIRROR_BYTE_CONF_SHIFT;
-        mirror_byte_off = (mirror & MIRROR_BYTE_BYTE_MASK) >> MIRROR_BYTE_BYTE_SHIFT;
+        int mirror_page_off = m_tag_information->memory[first_cfg_page][CONF_MIRROR_PAGE_BYTE];
+        int mirror_mode = (mirror & MIRROR_BYTE_CONF_MASK) >> MIRROR_BYTE_CONF_SHIFT;
+        int mirror_byte_off = (mirror & MIRROR_BYTE_BYTE_MASK) >> MIRROR_BYTE_BYTE_SHIFT;
 
         // NTAG 210/212 don't have a counter thus no mirror mode
         switch (m_tag_type) {
@@ -549,69 +666,138 @@ static void handle_any_read(uint8_t block_num, uint8_t block_cnt, uint8_t block_
         }
 
         if ((mirror_page_off > 3) && (mirror_mode != MIRROR_CONF_DISABLED)) {
-            mirror_size = mirror_size_for_mode(mirror_mode);
-            int user_data_end = get_user_data_end_by_tag_type(m_tag_type);
+            int mirror_size = mirror_size_for_mode(mirror_mode);
+            int user_data_end = state->user_data_end;
             int pages_needed =
                 (mirror_byte_off + mirror_size + (NFC_TAG_MF0_NTAG_DATA_SIZE - 1)) / NFC_TAG_MF0_NTAG_DATA_SIZE;
 
             if ((pages_needed >= user_data_end) || ((user_data_end - pages_needed) < mirror_page_off)) {
                 NRF_LOG_ERROR("invalid mirror config %02x %02x %02x", mirror_page_off, mirror_byte_off, mirror_mode);
-                mirror_page_off = 0;
             } else {
-                mirror_page_end = mirror_page_off + pages_needed;
-
-                switch (mirror_mode) {
-                    case MIRROR_CONF_UID:
-                        bytes2hex(m_tag_information->res_coll.uid, (char *)mirror_buf, 7);
-                        break;
-                    case MIRROR_CONF_CNT:
-                        bytes2hex(get_counter_data_by_index(0, false), (char *)mirror_buf, 3);
-                        break;
-                    case MIRROR_CONF_UID_CNT:
-                        bytes2hex(m_tag_information->res_coll.uid, (char *)mirror_buf, 7);
-                        mirror_buf[7] = 'x';
-                        bytes2hex(get_counter_data_by_index(0, false), (char *)&mirror_buf[8], 3);
-                        break;
-                }
+                state->mirror_mode = mirror_mode;
+                state->mirror_page = mirror_page_off;
+                state->mirror_page_end = mirror_page_off + pages_needed;
+                state->mirror_byte = mirror_byte_off;
+                state->mirror_size = mirror_size;
             }
         }
     }
 
-    for (uint8_t block = 0; block < block_cnt; block++) {
-        uint8_t block_to_read = (block_num + block) % block_max;
-        uint8_t *tx_buf_ptr = m_tag_tx_buffer.tx_buffer + block * NFC_TAG_MF0_NTAG_DATA_SIZE;
+    m_state_valid = true;
+}
 
-        // In case PWD or PACK pages are read we need to write zero to the output buffer. In UID magic mode we don't care.
-        if (m_tag_information->config.mode_uid_magic || (pwd_page == 0) || (block_to_read < pwd_page) || (block_to_read > (pwd_page + 1))) {
-            memcpy(tx_buf_ptr, m_tag_information->memory[block_to_read], NFC_TAG_MF0_NTAG_DATA_SIZE);
-        } else {
-            memset(tx_buf_ptr, 0, NFC_TAG_MF0_NTAG_DATA_SIZE);
-        }
+static const nfc_tag_mf0_ntag_state_t *get_state(void) {
+    if (!m_state_valid) rebuild_state();
+    return &m_state;
+}
 
-        // apply mirroring if needed
-        if ((mirror_page_off > 0) && (mirror_size > 0) && (block_to_read >= mirror_page_off) && (block_to_read < mirror_page_end)) {
-            // When accessing the first page that includes mirrored data the offset into the mirror buffer is
-            // definitely zero. Later pages need to account for the offset in the first page. Offset in the
-            // destination page chunk will be zero however.
-            int mirror_buf_off = (block_to_read - mirror_page_off) * NFC_TAG_MF0_NTAG_DATA_SIZE;
-            int offset_in_cur_block = mirror_byte_off;
-            if (mirror_buf_off != 0) {
-                mirror_buf_off -= mirror_byte_off;
-                offset_in_cur_block = 0;
-            }
+const nfc_tag_mf0_ntag_state_t *nfc_tag_mf0_ntag_get_state(void) {
+    if (m_tag_type == TAG_TYPE_UNDEFINED || m_tag_information == NULL) return NULL;
+    return get_state();
+}
+
+void nfc_tag_mf0_ntag_state_invalidate(void) {
+    m_state_valid = false;
+}
+
+// The lock bytes are on page 2 and after the user memory, the configuration pages after it too
+static bool page_holds_state(int block_num) {
+    return (block_num == 2) || (block_num >= get_state()->user_data_end);
+}
 
-            int mirror_copy_size = mirror_size - mirror_buf_off;
-            if (mirror_copy_size > NFC_TAG_MF0_NTAG_DATA_SIZE) mirror_copy_size = NFC_TAG_MF0_NTAG_DATA_SIZE;
+static bool check_ro_lock_on_page(int block_num) {
+    return (get_state()->lock_bitmap[block_num / 8] >> (block_num % 8)) & 1;
+}
 
-            // Ensure we don't corrupt memory here.
-            ASSERT(offset_in_cur_block < NFC_TAG_MF0_NTAG_DATA_SIZE);
-            ASSERT(mirror_buf_off <= sizeof(mirror_buf));
-            ASSERT(mirror_copy_size <= (sizeof(mirror_buf) - mirror_buf_off));
+static int get_block_max(bool read) {
+    const nfc_tag_mf0_ntag_state_t *state = get_state();
 
-            memcpy(&tx_buf_ptr[offset_in_cur_block], &mirror_buf[mirror_buf_off], mirror_copy_size);
+    if (m_tag_authenticated || m_tag_information->config.mode_uid_magic) return state->nr_pages;
+    else return read ? state->read_max : state->write_max;
+}
+
+// The UID and counter mirror as ASCII hex, the bytes a READ shows from its first byte
+static void render_mirror(uint8_t mirror_mode, uint8_t *mirror_buf) {
+    switch (mirror_mode) {
+        case MIRROR_CONF_UID:
+            bytes2hex(m_tag_information->res_coll.uid, (char *)mirror_buf, 7);
+            break;
+        case MIRROR_CONF_CNT:
+            bytes2hex(get_counter_data_by_index(0, false), (char *)mirror_buf, 3);
+            break;
+        case MIRROR_CONF_UID_CNT:
+            bytes2hex(m_tag_information->res_coll.uid, (char *)mirror_buf, 7);
+            mirror_buf[7] = 'x';
+            bytes2hex(get_counter_data_by_index(0, false), (char *)&mirror_buf[8], 3);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Build the answer to READ or FAST_READ: block_cnt pages from block_num, wrapping at block_max. Each run of
+ * pages up to the wrap is copied without a check per page, the PWD and PACK pages it covers are zeroed over it and
+ * the mirror, rendered only when the answer shows it, is patched in. The NFCT appends the CRC.
+ * @return the length of the answer
+ */
+uint16_t nfc_tag_mf0_ntag_build_read(uint8_t *buffer, uint8_t block_num, uint8_t block_cnt, uint8_t block_max) {
+    const nfc_tag_mf0_ntag_state_t *state = get_state();
+    // In case PWD or PACK pages are read we need to write zero to the output buffer. In UID magic mode we don't care.
+    bool mask_pwd = !m_tag_information->config.mode_uid_magic && (state->pwd_page != 0);
+    int pwd_end = state->pwd_page + 2;
+    // byte addresses of the mirror in the memory of the tag
+    int mirror_start = state->mirror_page * NFC_TAG_MF0_NTAG_DATA_SIZE + state->mirror_byte;
+    int mirror_end = mirror_start + state->mirror_size;
+    uint8_t mirror_buf[MIRROR_UID_CNT_SIZE];
+    bool mirror_rendered = false;
+
+    uint8_t *out = buffer;
+    int page = block_num;
+    int remaining = block_cnt;
+    while (remaining > 0) {
+        int run_end = page + remaining;
+        if (run_end > block_max) run_end = block_max;
+        // a page is one unaligned word load and store, the memcpy() of newlib nano copies a byte at a time
+        for (int i = page; i < run_end; i++) {
+            memcpy(out + (i - page) * NFC_TAG_MF0_NTAG_DATA_SIZE, m_tag_information->memory[i], NFC_TAG_MF0_NTAG_DATA_SIZE);
+        }
+
+        if (mask_pwd && (state->pwd_page < run_end) && (pwd_end > page)) {
+            int first = (state->pwd_page > page) ? state->pwd_page : page;
+            int last = (pwd_end < run_end) ? pwd_end : run_end;
+            memset(out + (first - page) * NFC_TAG_MF0_NTAG_DATA_SIZE, 0, (last - first) * NFC_TAG_MF0_NTAG_DATA_SIZE);
         }
+
+        // the mirror size is 0 when disabled
+        int run_start_byte = page * NFC_TAG_MF0_NTAG_DATA_SIZE;
+        int run_end_byte = run_end * NFC_TAG_MF0_NTAG_DATA_SIZE;
+        if ((mirror_start < run_end_byte) && (mirror_end > run_start_byte) && (state->mirror_size != 0)) {
+            if (!mirror_rendered) {
+                render_mirror(state->mirror_mode, mirror_buf);
+                mirror_rendered = true;
+            }
+            int first = (mirror_start > run_start_byte) ? mirror_start : run_start_byte;
+            int last = (mirror_end < run_end_byte) ? mirror_end : run_end_byte;
+            for (int i = first; i < last; i++) {
+                out[i - run_start_byte] = mirror_buf[i - mirror_start];
+            }
+        }
+
+        out += run_end_byte - run_start_byte;
+        remaining -= run_end - page;
+        page = 0;
     }
 
+    return block_cnt * NFC_TAG_MF0_NTAG_DATA_SIZE;
+}
+
+static void handle_any_read(uint8_t block_num, uint8_t block_cnt, uint8_t block_max) {
+    ASSERT(block_cnt <= block_max);
+    ASSERT((block_max - block_cnt) >= block_num);
+
+    uint16_t length = nfc_tag_mf0_ntag_build_read(m_tag_tx_buffer.tx_buffer, block_num, block_cnt, block_max);
+
     NRF_LOG_DEBUG("READ handled %02x %02x %02x", block_num, block_cnt, block_max);
 
     // update counter for NTAG cards if needed
@@ -622,8 +808,7 @@ static void handle_any_read(uint8_t block_num, uint8_t block_cnt, uint8_t block_
             if (!m_did_first_read) {
                 m_did_first_read = true;
 
-                int first_cfg_page = get_first_cfg_page_by_tag_type(m_tag_type);
-                int access = m_tag_information->memory[first_cfg_page + CONF_ACCESS_PAGE_OFFSET][CONF_ACCESS_BYTE];
+                int access = m_tag_information->memory[get_state()->first_cfg_page + CONF_ACCESS_PAGE_OFFSET][CONF_ACCESS_BYTE];
 
                 if ((access & CONF_ACCESS_NFC_CNT_EN) != 0) {
                     uint8_t *ctr = get_counter_data_by_index(0, false);
@@ -632,6 +817,7 @@ static void handle_any_read(uint8_t block_num, uint8_t block_cnt, uint8_t block_
                     ctr[0] = (uint8_t)(counter >> 16);
                     ctr[1] = (uint8_t)(counter >> 8);
                     ctr[2] = (uint8_t)(counter);
+                    tag_emulation_data_changed(ctr, NFC_TAG_MF0_NTAG_DATA_SIZE);
                 }
                 break;
             }
@@ -639,11 +825,11 @@ static void handle_any_read(uint8_t block_num, uint8_t block_cnt, uint8_t block_
             break;
     }
 
-    nfc_tag_14a_tx_bytes(m_tag_tx_buffer.tx_buffer, ((int)block_cnt) * NFC_TAG_MF0_NTAG_DATA_SIZE, true);
+    nfc_tag_14a_tx_bytes(m_tag_tx_buffer.tx_buffer, length, true);
 }
 
 static void handle_read_command(uint8_t block_num) {
-    int block_max = get_block_max_by_tag_type(m_tag_type, true);
+    int block_max = get_block_max(true);
 
     NRF_LOG_DEBUG("handling READ %02x %02x", block_num, block_max);
 
@@ -673,125 +859,27 @@ static void handle_fast_read_command(uint8_t block_num, uint8_t end_block_num) {
             return;
     }
 
-    int block_max = get_block_max_by_tag_type(m_tag_type, true);
+    int block_max = get_block_max(true);
 
     if (block_num >= end_block_num || end_block_num >= block_max) {
         nfc_tag_14a_tx_nbit(NAK_INVALID_OPERATION_TBV, 4);
         return;
     }
 
+    // The answer is sent from the TX buffer of nfc_14a.c, a reader asking for more pages than it holds gets a NAK
+    if ((end_block_num - block_num) * NFC_TAG_MF0_NTAG_DATA_SIZE > MAX_NFC_TX_BUFFER_SIZE) {
+        NRF_LOG_WARNING("FAST READ %02x %02x too long for the TX buffer", block_num, end_block_num);
+        nfc_tag_14a_tx_nbit(NAK_INVALID_OPERATION_TBV, 4);
+        return;
+    }
+
     NRF_LOG_INFO("HANDLING FAST READ %02x %02x", block_num, end_block_num);
 
     handle_any_read(block_num, end_block_num - block_num, block_max);
 }
 
-static bool check_ro_lock_on_page(int block_num) {
-    if (block_num < 3) return true;
-    else if (block_num == 3) return (m_tag_information->memory[2][2] & 9) != 0; // bits 0 and 3
-    else if (block_num <= MF0ICU1_PAGES) {
-        bool locked = false;
-
-        // check block locking bits
-        if (block_num <= 9) locked |= (m_tag_information->memory[2][2] & 2) == 2;
-        else locked |= (m_tag_information->memory[2][2] & 4) == 4;
-
-        locked |= (((*(uint16_t *)&m_tag_information->memory[2][2]) >> block_num) & 1) == 1;
-
-        return locked;
-    } else {
-        uint8_t *p_lock_bytes = NULL;
-        int user_memory_end = 0;
-        int dyn_lock_bit_page_cnt = 0;
-        int index = block_num - MF0ICU1_PAGES;
-
-        switch (m_tag_type) {
-            case TAG_TYPE_MF0ICU1:
-                return true;
-            case TAG_TYPE_MF0ICU2: {
-                p_lock_bytes = m_tag_information->memory[MF0ICU2_USER_MEMORY_END];
-
-                if (block_num < MF0ICU2_USER_MEMORY_END) {
-                    uint8_t byte2 = p_lock_bytes[0];
-
-                    // Account for block locking bits first.
-                    bool locked = (byte2 & (0x10 * (block_num >= 28))) != 0;
-                    locked |= (byte2 >> (1 + (index / 4) + (block_num >= 28)));
-                    return locked;
-                } else if (block_num == MF0ICU2_USER_MEMORY_END) {
-                    return false;
-                } else if (block_num < MF0ICU2_FIRST_KEY_PAGE) {
-                    uint8_t byte3 = p_lock_bytes[1];
-                    return ((byte3 >> (block_num - MF0ICU2_CNT_PAGE)) & 1) != 0;
-                } else {
-                    uint8_t byte3 = p_lock_bytes[1];
-                    return (byte3 & 0x80) != 0;
-                }
-            }
-            // for the next two we reuse the check for CFGLCK bit used for NTAG
-            case TAG_TYPE_MF0UL11:
-                ASSERT(block_num >= MF0UL11_USER_MEMORY_END);
-                user_memory_end = MF0UL11_USER_MEMORY_END;
-                break;
-            case TAG_TYPE_MF0UL21: {
-                user_memory_end = MF0UL11_USER_MEMORY_END;
-                if (block_num < user_memory_end) {
-                    p_lock_bytes = m_tag_information->memory[MF0UL21_USER_MEMORY_END];
-                    uint16_t lock_word = (((uint16_t)p_lock_bytes[1]) << 8) | (uint16_t)p_lock_bytes[0];
-                    bool locked = ((lock_word >> (index / 2)) & 1) != 0;
-                    locked |= ((p_lock_bytes[2] >> (index / 4)) & 1) != 0;
-                    return locked;
-                }
-                break;
-            }
-            case TAG_TYPE_NTAG_210:
-                user_memory_end = NTAG210_USER_MEMORY_END;
-                dyn_lock_bit_page_cnt = 0; // NTAG 210 doesn't have dynamic lock bits
-                break;
-            case TAG_TYPE_NTAG_212:
-                user_memory_end = NTAG212_USER_MEMORY_END;
-                dyn_lock_bit_page_cnt = 2;
-                break;
-            case TAG_TYPE_NTAG_213:
-                user_memory_end = NTAG213_USER_MEMORY_END;
-                dyn_lock_bit_page_cnt = 2;
-                break;
-            case TAG_TYPE_NTAG_215:
-                user_memory_end = NTAG215_USER_MEMORY_END;
-                dyn_lock_bit_page_cnt = 16;
-                break;
-            case TAG_TYPE_NTAG_216:
-                user_memory_end = NTAG216_USER_MEMORY_END;
-                dyn_lock_bit_page_cnt = 16;
-                break;
-            default:
-                ASSERT(false);
-                break;
-        }
-
-        if (block_num < user_memory_end) {
-            ASSERT(dyn_lock_bit_page_cnt > 0);
-
-            p_lock_bytes = m_tag_information->memory[user_memory_end];
-            uint16_t lock_word = (((uint16_t)p_lock_bytes[1]) << 8) | (uint16_t)p_lock_bytes[0];
-
-            bool locked_small_range = ((lock_word >> (index / dyn_lock_bit_page_cnt)) & 1) != 0;
-            bool locked_large_range = ((p_lock_bytes[2] >> (index / dyn_lock_bit_page_cnt / 2)) & 1) != 0;
-
-            return locked_small_range | locked_large_range;
-        } else {
-            // check CFGLCK bit
-            int first_cfg_page = get_first_cfg_page_by_tag_type(m_tag_type);
-            uint8_t access = m_tag_information->memory[first_cfg_page + CONF_ACCESS_PAGE_OFFSET][CONF_ACCESS_BYTE];
-            if ((access & CONF_ACCESS_CFGLCK) != 0)
-                return (block_num >= first_cfg_page) && ((block_num - first_cfg_page) <= 1);
-            else
-                return false;
-        }
-    }
-}
-
 static int handle_write_command(uint8_t block_num, uint8_t *p_data) {
-    int block_max = get_block_max_by_tag_type(m_tag_type, false);
+    int block_max = get_block_max(false);
 
     if (block_num >= block_max) {
         NRF_LOG_ERROR("Write failed: block_num %08x >= block_max %08x", block_num, block_max);
@@ -813,6 +901,8 @@ static int handle_write_command(uint8_t block_num, uint8_t *p_data) {
     if (m_tag_information->config.mode_uid_magic) {
         // anything can be written in this mode
         memcpy(m_tag_information->memory[block_num], p_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
+        tag_emulation_data_changed(m_tag_information->memory[block_num], NFC_TAG_MF0_NTAG_DATA_SIZE);
+        if (page_holds_state(block_num)) nfc_tag_mf0_ntag_state_invalidate();
         return ACK_VALUE;
     }
 
@@ -843,6 +933,8 @@ static int handle_write_command(uint8_t block_num, uint8_t *p_data) {
             break;
     }
 
+    tag_emulation_data_changed(m_tag_information->memory[block_num], NFC_TAG_MF0_NTAG_DATA_SIZE);
+    if (page_holds_state(block_num)) nfc_tag_mf0_ntag_state_invalidate();
     return ACK_VALUE;
 }
 
@@ -899,6 +991,7 @@ static void handle_incr_cnt_command(uint8_t block_num, uint8_t *p_data) {
     if ((0xFFFFFF - cnt) < incr_value) {
         // set tearing event flag
         cnt_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] |= MF0_NTAG_TEARING_MASK_IN_AUTHLIM;
+        tag_emulation_data_changed(cnt_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
 
         nfc_tag_14a_tx_nbit(NAK_INVALID_OPERATION_TBIV, 4);
     } else {
@@ -907,13 +1000,15 @@ static void handle_incr_cnt_command(uint8_t block_num, uint8_t *p_data) {
         cnt_data[0] = (uint8_t)(cnt >> 16);
         cnt_data[1] = (uint8_t)(cnt >> 8);
         cnt_data[2] = (uint8_t)(cnt & 0xff);
+        tag_emulation_data_changed(cnt_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
 
         nfc_tag_14a_tx_nbit(ACK_VALUE, 4);
     }
 }
 
 static void handle_pwd_auth_command(uint8_t *p_data) {
-    int first_cfg_page = get_first_cfg_page_by_tag_type(m_tag_type);
+    const nfc_tag_mf0_ntag_state_t *state = get_state();
+    int first_cfg_page = state->first_cfg_page;
     uint8_t *cnt_data = get_counter_data_by_index(0, false);
     if (first_cfg_page == 0 || cnt_data == NULL) {
         if (is_ntag()) nfc_tag_14a_tx_nbit(NAK_INVALID_OPERATION_TBV, 4);
@@ -928,7 +1023,7 @@ static void handle_pwd_auth_command(uint8_t *p_data) {
         return;
     }
 
-    uint32_t pwd = *(uint32_t *)m_tag_information->memory[first_cfg_page + CONF_PWD_PAGE_OFFSET];
+    uint32_t pwd = *(uint32_t *)m_tag_information->memory[state->pwd_page];
     uint32_t supplied_pwd = *(uint32_t *)&p_data[1];
 
     if (m_tag_information->config.detection_enable && m_auth_log.count < MF0_NTAG_AUTH_LOG_MAX) {
@@ -942,17 +1037,21 @@ static void handle_pwd_auth_command(uint8_t *p_data) {
         if (auth_lim) {
             cnt_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] &= ~MF0_NTAG_AUTHLIM_MASK_IN_CTR;
             cnt_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] |= (auth_cnt + 1) & MF0_NTAG_AUTHLIM_MASK_IN_CTR;
+            tag_emulation_data_changed(cnt_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
         }
         nfc_tag_14a_tx_nbit(NAK_INVALID_OPERATION_TBIV, 4);
         return;
     }
 
     // reset authentication attempts counter and authenticate user
-    cnt_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] &= ~MF0_NTAG_AUTHLIM_MASK_IN_CTR;
+    if (auth_cnt != 0) {
+        cnt_data[MF0_NTAG_AUTHLIM_OFF_IN_CTR] &= ~MF0_NTAG_AUTHLIM_MASK_IN_CTR;
+        tag_emulation_data_changed(cnt_data, NFC_TAG_MF0_NTAG_DATA_SIZE);
+    }
     m_tag_authenticated = true; // TODO: this should be possible to reset somehow
 
     // Send the PACK value back
-    nfc_tag_14a_tx_bytes(m_tag_information->memory[first_cfg_page + CONF_PACK_PAGE_OFFSET], 2, true);
+    nfc_tag_14a_tx_bytes(m_tag_information->memory[state->pack_page], 2, true);
 }
 
 static void handle_check_tearing_event(int index) {
@@ -1086,6 +1185,7 @@ int nfc_tag_mf0_ntag_data_savecb(tag_specific_type_t type, tag_data_buffer_t *bu
         if (m_tag_information->config.mode_block_write == NFC_TAG_MF0_NTAG_WRITE_SHADOW_REQ) {
             NRF_LOG_INFO("The mf0/ntag will be set to shadow write mode.");
             m_tag_information->config.mode_block_write = NFC_TAG_MF0_NTAG_WRITE_SHADOW;
+            config_changed();
         }
         // Save the corresponding size data according to the current label type
         return get_information_size_by_tag_type(type);
@@ -1102,6 +1202,8 @@ int nfc_tag_mf0_ntag_data_loadcb(tag_specific_type_t type, tag_data_buffer_t *bu
         m_tag_information = (nfc_tag_mf0_ntag_information_t *)buffer->buffer;
         // The specific type of MF0/NTAG tag that is emulated by the cache
         m_tag_type = type;
+        // Its lock and configuration pages are decoded on first use
+        nfc_tag_mf0_ntag_state_invalidate();
         // Register 14A communication management interface
         nfc_tag_14a_handler_t handler_for_14a = {
             .get_coll_res = nfc_tag_mf0_ntag_get_coll_res,
@@ -1256,11 +1358,9 @@ bool nfc_tag_mf0_ntag_data_factory(uint8_t slot, tag_specific_type_t tag_type) {
 
     // save data to flash
     tag_sense_type_t sense_type = get_sense_type_from_tag_type(tag_type);
-    fds_slot_record_map_t map_info;
-    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
     int info_size = get_information_size_by_tag_type(tag_type);
     NRF_LOG_INFO("MF0/NTAG info size: %d", info_size);
-    bool ret = fds_write_sync(map_info.id, map_info.key, info_size, p_ntag_information);
+    bool ret = tag_persistence_write(slot, sense_type, (uint8_t *)p_ntag_information, info_size, TAG_PERSISTENCE_CHUNKS_ALL);
     if (ret) {
         NRF_LOG_INFO("Factory slot data success.");
     } else {
@@ -1279,6 +1379,7 @@ bool nfc_tag_mf0_ntag_set_uid_mode(bool enabled) {
     if (m_tag_type == TAG_TYPE_UNDEFINED || m_tag_information == NULL) return false;
 
     m_tag_information->config.mode_uid_magic = enabled;
+    config_changed();
     return true;
 }
 
@@ -1289,6 +1390,7 @@ void nfc_tag_mf0_ntag_set_write_mode(nfc_tag_mf0_ntag_write_mode_t write_mode) {
         write_mode = NFC_TAG_MF0_NTAG_WRITE_SHADOW_REQ;
     }
     m_tag_information->config.mode_block_write = write_mode;
+    config_changed();
 }
 
 nfc_tag_mf0_ntag_write_mode_t nfc_tag_mf0_ntag_get_write_mode(void) {
@@ -1306,6 +1408,7 @@ nfc_tag_mf0_ntag_auth_log_t *mf0_get_auth_log(uint32_t *count) {
 void nfc_tag_mf0_ntag_set_detection_enable(bool enable) {
     if (m_tag_type == TAG_TYPE_UNDEFINED || m_tag_information == NULL) return;
     m_tag_information->config.detection_enable = enable;
+    config_changed();
 }
 
 bool nfc_tag_mf0_ntag_is_detection_enable(void) {
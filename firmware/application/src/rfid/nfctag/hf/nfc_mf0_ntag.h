@@ -80,6 +80,23 @@ typedef struct __attribute__((aligned(4))) {
 }
 nfc_tag_mf0_ntag_information_t;
 
+// What the lock and configuration pages of the slot decode to, rebuilt when one of them changes or the slot loads
+typedef struct {
+    uint8_t lock_bitmap[(NFC_TAG_NTAG_BLOCK_MAX + 7) / 8];  // bit set: the page is read-only for a reader
+    uint8_t nr_pages;
+    uint8_t user_data_end;
+    uint8_t first_cfg_page;     // 0 for the tags without configuration pages
+    uint8_t pwd_page;           // 0 without password
+    uint8_t pack_page;
+    uint8_t read_max;           // pages readable before PWD_AUTH, AUTH0 when PROT is set
+    uint8_t write_max;          // pages writable before PWD_AUTH, AUTH0
+    uint8_t mirror_mode;        // MIRROR_CONF_DISABLED for no or an invalid mirror configuration
+    uint8_t mirror_page;
+    uint8_t mirror_page_end;
+    uint8_t mirror_byte;
+    uint8_t mirror_size;
+} nfc_tag_mf0_ntag_state_t;
+
 typedef struct {
     // TX buffer must fit the largest possible frame size.
     // TODO: This size should be decreased as the maximum allowed frame size is 257 (see 6.14.13.36 in datasheet).
@@ -94,6 +111,9 @@ uint8_t *nfc_tag_mf0_ntag_get_counter_data_by_index(uint8_t index);
 uint8_t *nfc_tag_mf0_ntag_get_version_data(void);
 uint8_t *nfc_tag_mf0_ntag_get_signature_data(void);
 nfc_tag_14a_coll_res_reference_t *nfc_tag_mf0_ntag_get_coll_res(void);
+const nfc_tag_mf0_ntag_state_t *nfc_tag_mf0_ntag_get_state(void);
+void nfc_tag_mf0_ntag_state_invalidate(void);
+uint16_t nfc_tag_mf0_ntag_build_read(uint8_t *buffer, uint8_t block_num, uint8_t block_cnt, uint8_t block_max);
 
 int nfc_tag_mf0_ntag_get_uid_mode(void);
 bool nfc_tag_mf0_ntag_set_uid_mode(bool enabled);
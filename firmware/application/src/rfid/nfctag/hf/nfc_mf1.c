@@ -1,16 +1,13 @@
 #include <stdlib.h>
 
 #include "nfc_mf1.h"
+#include "nfc_mf1_log.h"
 #include "nfc_14a.h"
 #include "hex_utils.h"
 #include "fds_util.h"
 #include "tag_persistence.h"
 
-#ifdef NFC_MF1_FAST_SIM
-#include "mf1_crypto1.h"
-#else
 #include "crypto1_helper.h"
-#endif
 
 #define NRF_LOG_MODULE_NAME tag_mf1
 #include "nrf_log.h"
@@ -191,20 +188,12 @@ static nfc_tag_mf1_tx_buffer_t m_tag_tx_buffer;
 //Save the specific type of MF1 currently being emulated
 static tag_specific_type_t m_tag_type;
 
-// Fast simulate is enable, we use internal crypto1 instance from 'mf1_crypto1.c'
-#ifndef NFC_MF1_FAST_SIM
 // mifare classic crypto1
 static struct Crypto1State mpcs = {0, 0};
 static struct Crypto1State *pcs = &mpcs;
-#endif
 
-// Define the buffer of the data that stored the detected data
-// Place this data in a dormant RAM to save time and space to write into Flash
-#define MF1_AUTH_LOG_MAX_SIZE   1000
-static __attribute__((section(".noinit_mf1"))) struct nfc_tag_mf1_auth_log_buffer {
-    uint32_t count;
-    nfc_tag_mf1_auth_log_t logs[MF1_AUTH_LOG_MAX_SIZE];
-} m_auth_log;
+// The detection record of the authentication in progress, stored in the log by its last step
+static nfc_tag_mf1_auth_log_t m_auth_log_pending;
 
 static uint8_t CardResponse[4];
 static uint8_t ReaderResponse[4];
@@ -219,14 +208,30 @@ static uint8_t m_data_block_buffer[MEM_BYTES_PER_BLOCK];
 #define NO_ACCESS 0x07
 
 
-/* decode Access conditions for a block */
-uint8_t GetAccessCondition(uint8_t Block) {
+// Decoded access conditions of each sector, 3 bits C1 C2 C3 per block group, bit 15 set once decoded.
+// The trailer only changes on a write of it or a new slot, then the sector or the whole cache is invalidated.
+#define MF1_SECTOR_MAX          40
+#define ACCESS_CACHE_VALID      0x8000
+static uint16_t m_access_cache[MF1_SECTOR_MAX];
+// The sector of the trailer m_tag_trailer_info points to
+static uint8_t m_auth_sector;
+
+static uint8_t block_to_sector(uint8_t Block) {
+    return Block < 128 ? Block / 4 : 32 + (Block - 128) / 16;
+}
+
+static bool block_is_trailer(uint8_t Block) {
+    return Block < 128 ? (Block & 3) == 3 : (Block & 15) == 15;
+}
+
+/* decode Access conditions of the 4 block groups of a trailer */
+static uint16_t DecodeAccessConditions(const uint8_t *acs) {
     uint8_t  InvSAcc0;
     uint8_t  InvSAcc1;
-    uint8_t  Acc0 = m_tag_trailer_info->acs[0];
-    uint8_t  Acc1 = m_tag_trailer_info->acs[1];
-    uint8_t  Acc2 = m_tag_trailer_info->acs[2];
-    uint8_t  ResultForBlock = 0;
+    uint8_t  Acc0 = acs[0];
+    uint8_t  Acc1 = acs[1];
+    uint8_t  Acc2 = acs[2];
+    uint16_t Result = 0;
 
     InvSAcc0 = ~BYTE_SWAP(Acc0);
     InvSAcc1 = ~BYTE_SWAP(Acc1);
@@ -235,37 +240,57 @@ uint8_t GetAccessCondition(uint8_t Block) {
     if (((InvSAcc0 ^ Acc1) & 0xf0) ||    /* C1x */
             ((InvSAcc0 ^ Acc2) & 0x0f) ||   /* C2x */
             ((InvSAcc1 ^ Acc2) & 0xf0)) {   /* C3x */
-        return (NO_ACCESS);
-    }
-    /* Fix for MFClassic 4K cards */
-    if (Block < 128)
-        Block &= 3;
-    else {
-        Block &= 15;
-        if (Block & 15)
-            Block = 3;
-        else if (Block <= 4)
-            Block = 0;
-        else if (Block <= 9)
-            Block = 1;
-        else
-            Block = 2;
+        return (NO_ACCESS << 9) | (NO_ACCESS << 6) | (NO_ACCESS << 3) | NO_ACCESS;
     }
 
     Acc0 = ~Acc0;       /* C1x Bits to bit 0..3 */
     Acc1 =  Acc2;       /* C2x Bits to bit 0..3 */
     Acc2 =  Acc2 >> 4;  /* C3x Bits to bit 0..3 */
 
-    if (Block) {
-        Acc0 >>= Block;
-        Acc1 >>= Block;
-        Acc2 >>= Block;
+    /* combine the bits of each block group */
+    for (uint8_t Group = 0; Group < 4; Group++) {
+        Result |= (((Acc2 >> Group) & 1) << 2 | ((Acc1 >> Group) & 1) << 1 | ((Acc0 >> Group) & 1)) << (Group * 3);
     }
-    /* combine the bits */
-    ResultForBlock = ((Acc2 & 1) << 2) |
-                     ((Acc1 & 1) << 1) |
-                     (Acc0 & 1);
-    return (ResultForBlock);
+    return Result;
+}
+
+/**
+ * @brief Access conditions of a block under the trailer of a sector, decoded once per trailer
+ */
+uint8_t nfc_tag_mf1_access_condition(uint8_t sector, uint8_t Block) {
+    uint16_t *cached = &m_access_cache[sector];
+    if (!(*cached & ACCESS_CACHE_VALID)) {
+        uint8_t trailer = sector < 32 ? sector * 4 + 3 : 128 + (sector - 32) * 16 + 15;
+        *cached = DecodeAccessConditions(((nfc_tag_mf1_trailer_info_t *)m_tag_information->memory[trailer])->acs) | ACCESS_CACHE_VALID;
+    }
+    /* Fix for MFClassic 4K cards */
+    if (Block < 128)
+        Block &= 3;
+    else
+        Block = (Block & 15) ? 3 : 0;
+    return (*cached >> (Block * 3)) & NO_ACCESS;
+}
+
+void nfc_tag_mf1_access_cache_invalidate(void) {
+    memset(m_access_cache, 0, sizeof(m_access_cache));
+}
+
+// A block of the emulated card was written: it is saved, and a new trailer changes the access conditions of its sector
+static void access_cache_block_written(uint8_t Block) {
+    tag_emulation_data_changed(m_tag_information->memory[Block], NFC_TAG_MF1_DATA_SIZE);
+    if (block_is_trailer(Block)) {
+        m_access_cache[block_to_sector(Block)] = 0;
+    }
+}
+
+// The emulator settings were changed, they are saved with the data
+static void config_changed(void) {
+    tag_emulation_data_changed(&m_tag_information->config, sizeof(m_tag_information->config));
+}
+
+/* decode Access conditions for a block, under the trailer of the authenticated sector */
+uint8_t GetAccessCondition(uint8_t Block) {
+    return nfc_tag_mf1_access_condition(m_auth_sector, Block);
 }
 
 bool CheckValueIntegrity(uint8_t *Block) {
@@ -331,25 +356,13 @@ void nfc_tag_mf1_random_nonce(uint8_t nonce[4], bool isNested) {
  * @param nonce: Brightly random number
  */
 void append_mf1_auth_log_step1(bool isKeyB, bool isNested, uint8_t block, uint8_t *nonce) {
-    // Power up for the first time, reset the buffer information
-    if (m_auth_log.count == 0xFFFFFFFF) {
-        m_auth_log.count = 0;
-        NRF_LOG_INFO("Mifare Classic auth log buffer ready");
-    }
-    // Non -first -time call, see if you record whether the detection log is over the upper limit of the size
-    if (m_auth_log.count > MF1_AUTH_LOG_MAX_SIZE) {
-        // Skill this operation directly over the upper limit.
-        NRF_LOG_INFO("Mifare Classic auth log buffer overflow");
-        return;
-    }
     // Determine whether this card slot enables the detection log record
     if (m_tag_information->config.detection_enable) {
-        m_auth_log.logs[m_auth_log.count].is_key_b = isKeyB;
-        m_auth_log.logs[m_auth_log.count].block = block;
-        m_auth_log.logs[m_auth_log.count].is_nested = isNested;
-        memcpy(m_auth_log.logs[m_auth_log.count].uid, UID_BY_CASCADE_LEVEL, 4);
-//        m_auth_log.logs[m_auth_log.count].nt = U32HTONL(*(uint32_t *)nonce);
-        memcpy(m_auth_log.logs[m_auth_log.count].nt, nonce, 4);
+        m_auth_log_pending.is_key_b = isKeyB;
+        m_auth_log_pending.block = block;
+        m_auth_log_pending.is_nested = isNested;
+        memcpy(m_auth_log_pending.uid, UID_BY_CASCADE_LEVEL, 4);
+        memcpy(m_auth_log_pending.nt, nonce, 4);
     }
 }
 
@@ -358,46 +371,23 @@ void append_mf1_auth_log_step1(bool isKeyB, bool isNested, uint8_t block, uint8_
  * @param ar: The random number of the label, the random number of the read -headed head is encrypted
  */
 void append_mf1_auth_log_step2(uint8_t *nr, uint8_t *ar) {
-    // Determine to the upper limit and skip this operation directly to avoid covering the previous records
-    if (m_auth_log.count > MF1_AUTH_LOG_MAX_SIZE) {
-        return;
-    }
     if (m_tag_information->config.detection_enable) {
         // Cache encryption information
-//        m_auth_log.logs[m_auth_log.count].nr = U32HTONL(*(uint32_t *)nr);
-//        m_auth_log.logs[m_auth_log.count].ar = U32HTONL(*(uint32_t *)ar);
-        memcpy(m_auth_log.logs[m_auth_log.count].nr, nr, 4);
-        memcpy(m_auth_log.logs[m_auth_log.count].ar, ar, 4);
+        memcpy(m_auth_log_pending.nr, nr, 4);
+        memcpy(m_auth_log_pending.ar, ar, 4);
     }
 }
 
 /** @brief MF1 additional verification log, step 3, store the last verification or failure log
- * This step has completed the final statistics increase
+ * This step has completed the final statistics increase, the log drops a record it already has
  * @param is_auth_success: Whether to verify success
  */
 void append_mf1_auth_log_step3(bool is_auth_success) {
-    // Determine to the upper limit and skip this operation directly to avoid covering the previous records
-    if (m_auth_log.count > MF1_AUTH_LOG_MAX_SIZE) {
-        return;
-    }
     if (m_tag_information->config.detection_enable) {
-        // Then you can end this record, the number of statistics increases
-        m_auth_log.count += 1;
-        // Print the number of logs in the current record
-        NRF_LOG_INFO("Auth log count: %d", m_auth_log.count);
+        nfc_tag_mf1_log_append(&m_auth_log_pending);
     }
 }
 
-/** @brief MF1 obtain verification log
- * @param count: The statistics of the verification log
- */
-nfc_tag_mf1_auth_log_t *mf1_get_auth_log(uint32_t *count) {
-    // First pass the total number of logs verified by verified
-    *count = m_auth_log.count;
-    // Just return to the head pointer of the log number array
-    return m_auth_log.logs;
-}
-
 static int get_block_max_by_tag_type(tag_specific_type_t tag_type) {
     int block_max;
     switch (tag_type) {
@@ -418,25 +408,31 @@ static int get_block_max_by_tag_type(tag_specific_type_t tag_type) {
     return block_max;
 }
 
+int nfc_tag_mf1_get_nr_blocks_by_tag_type(tag_specific_type_t tag_type) {
+    switch (tag_type) {
+        case TAG_TYPE_MIFARE_Mini:
+        case TAG_TYPE_MIFARE_1024:
+        case TAG_TYPE_MIFARE_2048:
+        case TAG_TYPE_MIFARE_4096:
+            return get_block_max_by_tag_type(tag_type);
+        default:
+            return -1;
+    }
+}
+
 static bool check_block_max_overflow(uint8_t block) {
     uint8_t block_max = get_block_max_by_tag_type(m_tag_type) - 1;
     return block > block_max;
 }
 
-#ifndef NFC_MF1_FAST_SIM
 void mf1_prng_by_bytes(uint8_t *nonces, uint32_t n) {
     uint32_t nonces_u32 = bytes_to_num(nonces, 4);
     nonces_u32 = prng_successor(nonces_u32, n);
     num_to_bytes(nonces_u32, 4, nonces);
 }
-#endif
 
 void mf1_response_4bit_auto_encrypt(uint8_t value) {
-#ifdef NFC_MF1_FAST_SIM
-    nfc_tag_14a_tx_nbit(value ^ Crypto1Nibble(), 4);
-#else
     nfc_tag_14a_tx_nbit(mf_crypto1_encrypt4bit(pcs, value), 4);
-#endif
 }
 
 /** @brief MF1 status machine
@@ -462,9 +458,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                     m_gen1a_state = GEN1A_STATE_UNLOCKED_RW_WAIT;       // Update the Gen1A status machine
                     m_mf1_state = MF1_STATE_UNAUTHENTICATED;                     // Update MF1 status machine
                     nfc_tag_14a_tx_nbit(ACK_VALUE, 4);     //Reply to the card reader Gen1a label unlock the back door success
-#ifndef NFC_MF1_FAST_SIM
                     crypto1_deinit(pcs);                                // Reset crypto1 handler
-#endif
                 } else {
                     m_gen1a_state = GEN1A_STATE_DISABLE;                // If you find that you have not taken the first step, directly reset the Gen1a status machine
                 }
@@ -510,6 +504,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
 
                             // Obtain the specified sector access control bytes. Here we directly take the coincidence, convert the memory into a structure, and let the compiler help us maintain the pointing of the pointer
                             m_tag_trailer_info = (nfc_tag_mf1_trailer_info_t *)m_tag_information->memory[BlockEnd];
+                            m_auth_sector = block_to_sector(BlockEnd);
 
                             // Generate random number
                             nfc_tag_mf1_random_nonce(CardNonce, false);
@@ -518,21 +513,13 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             for (uint8_t i = 0; i < sizeof(ReaderResponse); i++) {
                                 ReaderResponse[i] = CardNonce[i];
                             }
-#ifdef NFC_MF1_FAST_SIM
-                            Crypto1PRNG(ReaderResponse, 64);
-#else
                             mf1_prng_by_bytes(ReaderResponse, 64);
-#endif
 
                             // Calculate our response based on the response from the card reader
                             for (uint8_t i = 0; i < sizeof(CardResponse); i++) {
                                 CardResponse[i] = ReaderResponse[i];
                             }
-#ifdef NFC_MF1_FAST_SIM
-                            Crypto1PRNG(CardResponse, 32);
-#else
                             mf1_prng_by_bytes(CardResponse, 32);
-#endif
 
                             // Record verification log
                             append_mf1_auth_log_step1(KeyInUse, false, BlockAuth, CardNonce);
@@ -546,26 +533,8 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             m_tag_tx_buffer.tx_raw_buffer[2] = CardNonce[2];
                             m_tag_tx_buffer.tx_raw_buffer[3] = CardNonce[3];
 
-#ifdef NFC_MF1_FAST_SIM
-                            Crypto1Setup(
-                                // Select A or B secrets based on the current instruction type
-                                KeyInUse ? m_tag_trailer_info->key_b : m_tag_trailer_info->key_a,
-                                // Passing the current anti -collision UID
-                                UID_BY_CASCADE_LEVEL,
-                                // Passing into a clear random number, this random number will be used to decrypt subsequent communication
-                                CardNonce
-                            );
-#else
-                            // Set the Crypto1 key flow and discard the previous encryption state
-                            crypto1_deinit(pcs);
-                            // Load key flow
-                            crypto1_init(pcs,
-                                         // Select A or B secrets based on the current instruction type
-                                         bytes_to_num(KeyInUse ? m_tag_trailer_info->key_b : m_tag_trailer_info->key_a, 6)
-                                        );
-                            // Set key flow
-                            crypto1_word(pcs, bytes_to_num(UID_BY_CASCADE_LEVEL, 4) ^ bytes_to_num(CardNonce, 4), 0);
-#endif
+                            // Load the A or B key of the current instruction, discarding the previous encryption state, and shift in uid ^ nt
+                            mf_crypto1_setup(pcs, KeyInUse ? m_tag_trailer_info->key_b : m_tag_trailer_info->key_a, UID_BY_CASCADE_LEVEL, CardNonce);
                             // Responsible for clear -scale random number to read the card reader
                             nfc_tag_14a_tx_bytes(m_tag_tx_buffer.tx_raw_buffer, 4, false);
                             break;
@@ -616,6 +585,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                     if (nfc_tag_14a_checks_crc(p_data, NFC_TAG_MF1_FRAME_SIZE)) {
                         // The data verification passes, we need to put the data sent in RAM
                         memcpy(m_tag_information->memory[CurrentAddress], p_data, NFC_TAG_MF1_DATA_SIZE);
+                        access_cache_block_written(CurrentAddress);
                         // Restore the Gen1A special state machine for waiting operation status
                         m_gen1a_state = GEN1A_STATE_UNLOCKED_RW_WAIT;
                         // Reply to read head ACK, complete the writing operation
@@ -638,19 +608,13 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
             if (szDataBits == 64) {
                 //NR + AR responded to the card reader
                 append_mf1_auth_log_step2(p_data, &p_data[4]);
-#ifdef NFC_MF1_FAST_SIM
-                // Reader delivers an encrypted nonce. We use it to setup the crypto1 LFSR in nonlinear feedback mode. Furthermore it delivers an encrypted answer. Decrypt and check it
-                Crypto1Auth(&p_data[0]);
-                Crypto1ByteArray(&p_data[4], 4);
-#else
                 // NR, a random number generated by a card reader
                 uint32_t nr = bytes_to_num(p_data, 4);
                 // AR, is the encrypted data that we responded in the first step of the card encryption
                 uint32_t ar = bytes_to_num(&p_data[4], 4);
                 // --- crypto
-                crypto1_word(pcs, nr, 1);
-                num_to_bytes(ar ^ crypto1_word(pcs, 0, 0), 4, &p_data[4]);
-#endif
+                mf_crypto1_word(pcs, nr, 1);
+                num_to_bytes(ar ^ mf_crypto1_word(pcs, 0, 0), 4, &p_data[4]);
                 // Was the random number of the return of the card reader was sent by us
                 if ((p_data[4] == ReaderResponse[0]) && (p_data[5] == ReaderResponse[1]) && (p_data[6] == ReaderResponse[2]) && (p_data[7] == ReaderResponse[3])) {
                     // The reader has passed the authentication.The estimated calculation card response data and generating the puppet test position.
@@ -659,16 +623,11 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                     m_tag_tx_buffer.tx_raw_buffer[2] = CardResponse[2];
                     m_tag_tx_buffer.tx_raw_buffer[3] = CardResponse[3];
                     //Encryption and calculation of the puppet school inspection
-#ifdef NFC_MF1_FAST_SIM
-                    Crypto1ByteArrayWithParity(m_tag_tx_buffer.tx_raw_buffer, m_tag_tx_buffer.tx_bit_parity, 4);
-#else
-                    mf_crypto1_encrypt(pcs, m_tag_tx_buffer.tx_raw_buffer, 4, m_tag_tx_buffer.tx_bit_parity);
-#endif
+                    // Encrypted, parity and frame in one pass
+                    m_tag_tx_buffer.tx_frame_bit_size = mf_crypto1_encrypt_frame(pcs, m_tag_tx_buffer.tx_raw_buffer, NULL, 4, m_tag_tx_buffer.tx_warp_frame);
                     // The verification is successful, and you need to enter the state that has been successfully verified
                     m_mf1_state = MF1_STATE_AUTHENTICATED;
                     nfc_tag_14a_set_state(NFC_TAG_STATE_14A_PROPRIETARY);
-                    // Package, stitch the Qiqi school inspection, return
-                    m_tag_tx_buffer.tx_frame_bit_size = nfc_tag_14a_wrap_frame(m_tag_tx_buffer.tx_raw_buffer, 32, m_tag_tx_buffer.tx_bit_parity, m_tag_tx_buffer.tx_warp_frame);
                     nfc_tag_14a_tx_bits(m_tag_tx_buffer.tx_warp_frame, m_tag_tx_buffer.tx_frame_bit_size);
                 } else {
                     // Temporary only stored verification failed logs
@@ -687,11 +646,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
         case MF1_STATE_AUTHENTICATED: {
             if (szDataBits == 32) {
                 // In this state, all communication is encrypted.Therefore, we must first decrypt the data sent by the read head.
-#ifdef NFC_MF1_FAST_SIM
-                Crypto1ByteArray(p_data, 4);
-#else
                 mf_crypto1_decryptEx(pcs, p_data, 4, p_data);
-#endif
                 // After the decryption is completed, check whether the CRC is correct, and we must ensure that the data coming over is correct!
                 if (nfc_tag_14a_checks_crc(p_data, 4)) {
                     switch (p_data[0]) {
@@ -728,13 +683,8 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             // In any case, the data of the reply must be calculated CRC
                             nfc_tag_14a_append_crc(m_tag_tx_buffer.tx_raw_buffer, NFC_TAG_MF1_DATA_SIZE);
                             // Reply and calculate the coupling school inspection to reply to the card reader
-#ifdef NFC_MF1_FAST_SIM
-                            Crypto1ByteArrayWithParity(m_tag_tx_buffer.tx_raw_buffer, m_tag_tx_buffer.tx_bit_parity, NFC_TAG_MF1_FRAME_SIZE);
-#else
-                            mf_crypto1_encrypt(pcs, m_tag_tx_buffer.tx_raw_buffer, NFC_TAG_MF1_FRAME_SIZE, m_tag_tx_buffer.tx_bit_parity);
-#endif
-                            // Combined Qiqi School Check Data Frame
-                            m_tag_tx_buffer.tx_frame_bit_size = nfc_tag_14a_wrap_frame(m_tag_tx_buffer.tx_raw_buffer, 144, m_tag_tx_buffer.tx_bit_parity, m_tag_tx_buffer.tx_warp_frame);
+                            // Encrypted, parity and frame in one pass
+                            m_tag_tx_buffer.tx_frame_bit_size = mf_crypto1_encrypt_frame(pcs, m_tag_tx_buffer.tx_raw_buffer, NULL, NFC_TAG_MF1_FRAME_SIZE, m_tag_tx_buffer.tx_warp_frame);
                             // Start sending
                             nfc_tag_14a_tx_bits(m_tag_tx_buffer.tx_warp_frame, m_tag_tx_buffer.tx_frame_bit_size);
                             return;
@@ -785,6 +735,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             } else {
                                 // Write the block address specified by the global buffer back in the instruction parameter
                                 memcpy(m_tag_information->memory[p_data[1]], m_data_block_buffer, MEM_BYTES_PER_BLOCK);
+                                access_cache_block_written(p_data[1]);
                                 status = ACK_VALUE;
                             }
                             mf1_response_4bit_auto_encrypt(status);
@@ -823,6 +774,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
 
                             // Obtain the specified sector access control bytes. Here we directly take the coincidence, convert the memory into a structure, and let the compiler help us maintain the pointing of the pointer
                             m_tag_trailer_info = (nfc_tag_mf1_trailer_info_t *)m_tag_information->memory[BlockEnd];
+                            m_auth_sector = block_to_sector(BlockEnd);
 
                             // Generate random number
                             nfc_tag_mf1_random_nonce(CardNonce, true);
@@ -831,21 +783,13 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             for (uint8_t i = 0; i < sizeof(ReaderResponse); i++) {
                                 ReaderResponse[i] = CardNonce[i];
                             }
-#ifdef NFC_MF1_FAST_SIM
-                            Crypto1PRNG(ReaderResponse, 64);
-#else
                             mf1_prng_by_bytes(ReaderResponse, 64);
-#endif
 
                             // Calculate our response based on the response from the card reader
                             for (uint8_t i = 0; i < sizeof(CardResponse); i++) {
                                 CardResponse[i] = ReaderResponse[i];
                             }
-#ifdef NFC_MF1_FAST_SIM
-                            Crypto1PRNG(CardResponse, 32);
-#else
                             mf1_prng_by_bytes(CardResponse, 32);
-#endif
 
                             // Record nested verification information
                             append_mf1_auth_log_step1(KeyInUse, true, BlockAuth, CardNonce);
@@ -859,36 +803,10 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             m_tag_tx_buffer.tx_raw_buffer[2] = CardNonce[2];
                             m_tag_tx_buffer.tx_raw_buffer[3] = CardNonce[3];
 
-#ifdef NFC_MF1_FAST_SIM
-                            /* Setup crypto1 cipher. Discard in-place encrypted CardNonce. */
-                            Crypto1SetupNested(
-                                // Select A or B secrets based on the current instruction type
-                                KeyInUse ? m_tag_trailer_info->key_b : m_tag_trailer_info->key_a,
-                                // Passing the current anti -collision UID
-                                UID_BY_CASCADE_LEVEL,
-                                // Passing into a clear random number, this random number will be encrypted and passed through this buffer area
-                                m_tag_tx_buffer.tx_raw_buffer,
-                                // A buffer that passed into a strange school inspection of random numbers
-                                m_tag_tx_buffer.tx_bit_parity,
-                                // Explain the user: Decrypt = false for the tag, decrypt = true for the reader
-                                // We are currently a label character, so we are introduced into false
-                                false
-                            );
-#else
-                            // Set the Crypto1 key flow and discard the previous encryption state
-                            crypto1_deinit(pcs);
-                            //Load key flow
-                            crypto1_init(pcs,
-                                         // Select A or B secrets based on the current instruction type
-                                         bytes_to_num(KeyInUse ? m_tag_trailer_info->key_b : m_tag_trailer_info->key_a, 6)
-                                        );
-                            // Random number encryption
-                            uint8_t m_auth_nt_keystream[4];
-                            num_to_bytes(bytes_to_num(UID_BY_CASCADE_LEVEL, 4) ^ bytes_to_num(CardNonce, 4), 4, m_auth_nt_keystream);
-                            mf_crypto1_encryptEx(pcs, CardNonce, m_auth_nt_keystream, m_tag_tx_buffer.tx_raw_buffer, 4, m_tag_tx_buffer.tx_bit_parity);
-#endif
-                            // In the case of nested verification, after the frame is set up, a encrypted random number is replied, and the puppet school inspection does not bring CRC
-                            m_tag_tx_buffer.tx_frame_bit_size = nfc_tag_14a_wrap_frame(m_tag_tx_buffer.tx_raw_buffer, 32, m_tag_tx_buffer.tx_bit_parity, m_tag_tx_buffer.tx_warp_frame);
+                            // Load the A or B key of the current instruction, discarding the previous encryption state, and encrypt
+                            // the random number while uid ^ nt is shifted in, the frame carries its encrypted parity and no CRC
+                            m_tag_tx_buffer.tx_frame_bit_size = mf_crypto1_setup_nested(pcs, KeyInUse ? m_tag_trailer_info->key_b : m_tag_trailer_info->key_a,
+                                                                                        UID_BY_CASCADE_LEVEL, CardNonce, m_tag_tx_buffer.tx_warp_frame);
                             nfc_tag_14a_tx_bits(m_tag_tx_buffer.tx_warp_frame, m_tag_tx_buffer.tx_frame_bit_size);
                             break;
                         }
@@ -896,11 +814,13 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                             // Let the label sleep.According to the ISO14443 agreement, the second byte should be 0.
                             if (p_data[1] == 0x00) {
                                 // If everything is normal, then we should make the card directly to sleep, and cannot respond to any message to the read head
+                                // The reset leaves the 14a state IDLE, so it comes first, or the halted card would answer REQA
+                                nfc_tag_mf1_reset_handler();
                                 nfc_tag_14a_set_state(NFC_TAG_STATE_14A_HALTED);
                             } else {
                                 mf1_response_4bit_auto_encrypt(NAK_INVALID_OPERATION_TBIV);
+                                nfc_tag_mf1_reset_handler();
                             }
-                            nfc_tag_mf1_reset_handler();
                             break;
                         }
                         default: {
@@ -930,11 +850,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
             //It is currently in a state machine, we need to ensure that the received data is sufficient length
             if (szDataBits == 144) {
                 // Decrypted the 16 -byte to be written in data and 2 -byte CRCA
-#ifdef NFC_MF1_FAST_SIM
-                Crypto1ByteArray(p_data, NFC_TAG_MF1_FRAME_SIZE);
-#else
                 mf_crypto1_decryptEx(pcs, p_data, NFC_TAG_MF1_FRAME_SIZE, p_data);
-#endif
                 //The CRC that checks the data, ensure that the data received again is correct
                 if (nfc_tag_14a_checks_crc(p_data, NFC_TAG_MF1_FRAME_SIZE)) {
                     // Do not judge the current writing mode here to control the writing mode
@@ -947,6 +863,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                     } else {
                         // Other remaining modes can be updated to the labeled RAM
                         memcpy(m_tag_information->memory[CurrentAddress], p_data, NFC_TAG_MF1_DATA_SIZE);
+                        access_cache_block_written(CurrentAddress);
                         status = ACK_VALUE;
                     }
                 } else {
@@ -972,11 +889,7 @@ void nfc_tag_mf1_state_handler(uint8_t *p_data, uint16_t szDataBits) {
                 //When we arrived here, we have issued a decrease, increasing or recovery command, and the reader is now sending data.
                 // First, decrypt the data and check the CRC.Read the data in the requested block address into the global block buffer and check the integrity.
                 // Then, if necessary, add or decrease according to the command issued, and store the block back to the global block buffer.
-#ifdef NFC_MF1_FAST_SIM
-                Crypto1ByteArray(p_data, MEM_VALUE_SIZE + NFC_TAG_14A_CRC_LENGTH);
-#else
                 mf_crypto1_decryptEx(pcs, p_data, MEM_VALUE_SIZE + NFC_TAG_14A_CRC_LENGTH, p_data);
-#endif
                 // After decomposition, CRC must be verified to avoid using error data
                 if (nfc_tag_14a_checks_crc(p_data, MEM_VALUE_SIZE + NFC_TAG_14A_CRC_LENGTH)) {
                     // Copy a piece of data first to the global buffer zone
@@ -1069,10 +982,8 @@ void nfc_tag_mf1_reset_handler() {
     m_gen1a_state = GEN1A_STATE_DISABLE;
     nfc_tag_14a_set_state(NFC_TAG_STATE_14A_IDLE);
 
-#ifndef NFC_MF1_FAST_SIM
     // Must to reset pcs handler
     crypto1_deinit(pcs);
-#endif
 }
 
 /** @brief Obtain the length of effective information for the information structure
@@ -1098,6 +1009,7 @@ int nfc_tag_mf1_data_savecb(tag_specific_type_t type, tag_data_buffer_t *buffer)
         if (m_tag_information->config.mode_block_write == NFC_TAG_MF1_WRITE_SHADOW_REQ) {
             NRF_LOG_INFO("The mf1 will be set to shadow write mode.");
             m_tag_information->config.mode_block_write = NFC_TAG_MF1_WRITE_SHADOW;
+            config_changed();
         }
         // Save the corresponding size data according to the current label type
         return get_information_size_by_tag_type(type);
@@ -1118,6 +1030,8 @@ int nfc_tag_mf1_data_loadcb(tag_specific_type_t type, tag_data_buffer_t *buffer)
         m_tag_information = (nfc_tag_mf1_information_t *)buffer->buffer;
         // The specific type of MF1 that is emulated by the cache
         m_tag_type = type;
+        // The trailers of the new data are decoded again on use
+        nfc_tag_mf1_access_cache_invalidate();
         // Register 14A communication management interface
         nfc_tag_14a_handler_t handler_for_14a = {
             .get_coll_res = get_mifare_coll_res,
@@ -1201,11 +1115,9 @@ bool nfc_tag_mf1_data_factory(uint8_t slot, tag_specific_type_t tag_type) {
 
     // save data to flash
     tag_sense_type_t sense_type = get_sense_type_from_tag_type(tag_type);
-    fds_slot_record_map_t map_info;
-    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
     int info_size = get_information_size_by_tag_type(tag_type);
     NRF_LOG_INFO("MF1 info size: %d", info_size);
-    bool ret = fds_write_sync(map_info.id, map_info.key, info_size, p_mf1_information);
+    bool ret = tag_persistence_write(slot, sense_type, (uint8_t *)p_mf1_information, info_size, TAG_PERSISTENCE_CHUNKS_ALL);
     if (ret) {
         NRF_LOG_INFO("Factory slot data success.");
     } else {
@@ -1217,6 +1129,7 @@ bool nfc_tag_mf1_data_factory(uint8_t slot, tag_specific_type_t tag_type) {
 // Settling whether it enables detection
 void nfc_tag_mf1_set_detection_enable(bool enable) {
     m_tag_information->config.detection_enable = enable;
+    config_changed();
 }
 
 // Whether it can be detected at present
@@ -1226,17 +1139,18 @@ bool nfc_tag_mf1_is_detection_enable(void) {
 
 // Clear detection record
 void nfc_tag_mf1_detection_log_clear(void) {
-    m_auth_log.count = 0;
+    nfc_tag_mf1_log_clear();
 }
 
 // The number of statistics of detection records
 uint32_t nfc_tag_mf1_detection_log_count(void) {
-    return m_auth_log.count;
+    return nfc_tag_mf1_log_count();
 }
 
 // Set gen1a magic mode
 void nfc_tag_mf1_set_gen1a_magic_mode(bool enable) {
     m_tag_information->config.mode_gen1a_magic = enable;
+    config_changed();
 }
 
 // Is in gen1a magic mode?
@@ -1247,6 +1161,7 @@ bool nfc_tag_mf1_is_gen1a_magic_mode(void) {
 // Set gen2 magic mode
 void nfc_tag_mf1_set_gen2_magic_mode(bool enable) {
     m_tag_information->config.mode_gen2_magic = enable;
+    config_changed();
 }
 
 // Is in gen2 magic mode?
@@ -1257,6 +1172,7 @@ bool nfc_tag_mf1_is_gen2_magic_mode(void) {
 // Set anti collision data from block 0
 void nfc_tag_mf1_set_use_mf1_coll_res(bool enable) {
     m_tag_information->config.use_mf1_coll_res = enable;
+    config_changed();
 }
 
 // Get is anti collision data from block 0
@@ -1270,6 +1186,7 @@ void nfc_tag_mf1_set_write_mode(nfc_tag_mf1_write_mode_t write_mode) {
         write_mode = NFC_TAG_MF1_WRITE_SHADOW_REQ;
     }
     m_tag_information->config.mode_block_write = write_mode;
+    config_changed();
 }
 
 // Get write mode
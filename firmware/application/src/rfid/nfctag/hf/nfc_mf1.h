@@ -4,10 +4,6 @@
 #include "nfc_14a.h"
 #include "netdata.h"
 
-// Exchange space for time.
-// Fast simulate enable(Implement By ChameleonMini Repo)
-// #define NFC_MF1_FAST_SIM
-
 #define NFC_TAG_MF1_DATA_SIZE   16
 #define NFC_TAG_MF1_FRAME_SIZE  (NFC_TAG_MF1_DATA_SIZE + NFC_TAG_14A_CRC_LENGTH)
 #define NFC_TAG_MF1_BLOCK_MAX   256
@@ -139,11 +135,11 @@ typedef struct {
 } PACKED nfc_tag_mf1_auth_log_t;
 
 
-nfc_tag_mf1_auth_log_t *mf1_get_auth_log(uint32_t *count);
 void nfc_tag_mf1_reset_handler();
 int nfc_tag_mf1_data_loadcb(tag_specific_type_t type, tag_data_buffer_t *buffer);
 int nfc_tag_mf1_data_savecb(tag_specific_type_t type, tag_data_buffer_t *buffer);
 bool nfc_tag_mf1_data_factory(uint8_t slot, tag_specific_type_t tag_type);
+int nfc_tag_mf1_get_nr_blocks_by_tag_type(tag_specific_type_t tag_type);
 void nfc_tag_mf1_set_detection_enable(bool enable);
 bool nfc_tag_mf1_is_detection_enable(void);
 void nfc_tag_mf1_detection_log_clear(void);
@@ -158,6 +154,8 @@ void nfc_tag_mf1_set_use_mf1_coll_res(bool enable);
 bool nfc_tag_mf1_is_use_mf1_coll_res(void);
 void nfc_tag_mf1_set_write_mode(nfc_tag_mf1_write_mode_t write_mode);
 nfc_tag_mf1_write_mode_t nfc_tag_mf1_get_write_mode(void);
+uint8_t nfc_tag_mf1_access_condition(uint8_t sector, uint8_t block);
+void nfc_tag_mf1_access_cache_invalidate(void);
 
 
 #endif
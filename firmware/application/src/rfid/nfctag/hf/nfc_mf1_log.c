@@ -0,0 +1,223 @@
+#include <string.h>
+
+#include "nfc_mf1_log.h"
+#include "app_util_platform.h"
+
+#define NRF_LOG_MODULE_NAME tag_mf1_log
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_log_default_backends.h"
+NRF_LOG_MODULE_REGISTER();
+
+
+#define MF1_LOG_MAGIC   0x4D46314C  // "MF1L"
+
+/*
+ * The MF1 detection log, a ring of 14 bytes records in the dormant RAM of the flat log of 18 bytes records
+ * it replaced: the UID of a slot is stored once in a small table and each record keeps its index, a record
+ * equal to one in the log, a reader retrying the same authentication, is counted and not stored again. A hash
+ * byte per record lets memchr() find the candidates, the whole log is searched and only those are compared.
+ * The records are read back in the nfc_tag_mf1_auth_log_t form of the detection log command, oldest first.
+ */
+static __attribute__((section(".noinit_mf1"))) struct {
+    nfc_tag_mf1_log_header_t header;
+    nfc_tag_mf1_log_record_t records[NFC_TAG_MF1_LOG_RECORD_MAX];
+    uint8_t hashes[NFC_TAG_MF1_LOG_RECORD_MAX];
+} m_log;
+
+/*
+ * A reader of the log, the detection log command, reads the records of head and count as they were when it held the
+ * log, while the NFCT interrupt keeps appending: after them, until the log is full, then the records are dropped
+ * rather than overwritten.
+ */
+static struct {
+    bool held;
+    uint16_t head;
+    uint16_t count;
+} m_hold;
+
+
+static void log_reset(uint8_t policy) {
+    memset(&m_log.header, 0, sizeof(m_log.header));
+    m_log.header.policy = policy;
+    m_log.header.magic = MF1_LOG_MAGIC;
+}
+
+/**
+ * @brief The dormant RAM holds a log since the last reset or anything after a power up, start a new one then.
+ */
+static void log_ready(void) {
+    nfc_tag_mf1_log_header_t *header = &m_log.header;
+    if (header->magic != MF1_LOG_MAGIC || header->head >= NFC_TAG_MF1_LOG_RECORD_MAX || header->count > NFC_TAG_MF1_LOG_RECORD_MAX
+            || header->uid_count > NFC_TAG_MF1_LOG_UID_MAX || header->policy > NFC_TAG_MF1_LOG_POLICY_OVERWRITE) {
+        log_reset(NFC_TAG_MF1_LOG_POLICY_STOP);
+        NRF_LOG_INFO("Mifare Classic auth log buffer ready");
+    }
+}
+
+/**
+ * @brief Index of the UID in the table, added if new. Once the table is full, an entry no record refers to
+ * anymore is reused.
+ * @return the index, -1 if the table is full
+ */
+static int uid_index(const uint8_t *uid) {
+    nfc_tag_mf1_log_header_t *header = &m_log.header;
+    for (int i = 0; i < header->uid_count; i++) {
+        if (memcmp(header->uids[i], uid, 4) == 0) {
+            return i;
+        }
+    }
+    if (header->uid_count < NFC_TAG_MF1_LOG_UID_MAX) {
+        memcpy(header->uids[header->uid_count], uid, 4);
+        return header->uid_count++;
+    }
+    uint16_t used = 0;
+    for (uint16_t i = 0; i < header->count; i++) {
+        used |= 1 << (m_log.records[(header->head + i) % NFC_TAG_MF1_LOG_RECORD_MAX].flags >> NFC_TAG_MF1_LOG_UID_SHIFT);
+    }
+    for (int i = 0; i < NFC_TAG_MF1_LOG_UID_MAX; i++) {
+        if (!(used & (1 << i))) {
+            memcpy(header->uids[i], uid, 4);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint8_t record_hash(const nfc_tag_mf1_log_record_t *record) {
+    uint32_t nt, nr, ar;
+    memcpy(&nt, record->nt, 4);
+    memcpy(&nr, record->nr, 4);
+    memcpy(&ar, record->ar, 4);
+    uint32_t x = nt ^ ((nr << 11) | (nr >> 21)) ^ ((ar << 22) | (ar >> 10)) ^ ((uint32_t)record->block << 8) ^ record->flags;
+    return (x * 2654435761u) >> 24;
+}
+
+/**
+ * @brief Store a complete record, the one of the authentication that just ended.
+ * @return true if stored, false for a duplicate or a full log
+ */
+bool nfc_tag_mf1_log_append(const nfc_tag_mf1_auth_log_t *log) {
+    log_ready();
+    nfc_tag_mf1_log_header_t *header = &m_log.header;
+    int uid = uid_index(log->uid);
+    if (uid < 0) {
+        header->dropped++;
+        return false;
+    }
+    nfc_tag_mf1_log_record_t record;
+    record.block = log->block;
+    record.flags = (log->is_key_b ? NFC_TAG_MF1_LOG_FLAG_KEY_B : 0) | (log->is_nested ? NFC_TAG_MF1_LOG_FLAG_NESTED : 0)
+                   | (uid << NFC_TAG_MF1_LOG_UID_SHIFT);
+    memcpy(record.nt, log->nt, 4);
+    memcpy(record.nr, log->nr, 4);
+    memcpy(record.ar, log->ar, 4);
+
+    // the records in use are the first count ones of the ring, the log only turns once full
+    uint8_t hash = record_hash(&record);
+    const uint8_t *found = m_log.hashes;
+    const uint8_t *end = m_log.hashes + header->count;
+    while ((found = memchr(found, hash, end - found)) != NULL) {
+        if (memcmp(&m_log.records[found - m_log.hashes], &record, sizeof(record)) == 0) {
+            header->duplicates++;
+            return false;
+        }
+        found++;
+    }
+
+    uint16_t slot;
+    if (header->count < NFC_TAG_MF1_LOG_RECORD_MAX) {
+        slot = (header->head + header->count) % NFC_TAG_MF1_LOG_RECORD_MAX;
+        header->count++;
+    } else if (header->policy == NFC_TAG_MF1_LOG_POLICY_OVERWRITE && !m_hold.held) {
+        slot = header->head;
+        header->head = (header->head + 1) % NFC_TAG_MF1_LOG_RECORD_MAX;
+    } else {
+        header->dropped++;
+        NRF_LOG_INFO("Mifare Classic auth log buffer overflow");
+        return false;
+    }
+    m_log.records[slot] = record;
+    m_log.hashes[slot] = hash;
+    NRF_LOG_INFO("Auth log count: %d", header->count);
+    return true;
+}
+
+/**
+ * @brief Empty the log. From the main loop, out of reach of the NFCT interrupt while the log is reset.
+ */
+void nfc_tag_mf1_log_clear(void) {
+    log_ready();
+    CRITICAL_REGION_ENTER();
+    log_reset(m_log.header.policy);
+    CRITICAL_REGION_EXIT();
+}
+
+uint32_t nfc_tag_mf1_log_count(void) {
+    log_ready();
+    return m_hold.held ? m_hold.count : m_log.header.count;
+}
+
+/**
+ * @brief Copy the records as the detection log command sends them, an array of nfc_tag_mf1_auth_log_t from the
+ * oldest record, from any byte offset of it. Those of the hold while the log is held.
+ */
+void nfc_tag_mf1_log_copy(uint32_t offset, uint8_t *buffer, uint32_t length) {
+    log_ready();
+    nfc_tag_mf1_log_header_t *header = &m_log.header;
+    uint16_t head = m_hold.held ? m_hold.head : header->head;
+    uint16_t count = m_hold.held ? m_hold.count : header->count;
+    uint32_t index = offset / sizeof(nfc_tag_mf1_auth_log_t);
+    uint32_t skip = offset % sizeof(nfc_tag_mf1_auth_log_t);
+    while (length > 0 && index < count) {
+        const nfc_tag_mf1_log_record_t *record = &m_log.records[(head + index) % NFC_TAG_MF1_LOG_RECORD_MAX];
+        nfc_tag_mf1_auth_log_t log;
+        memset(&log, 0, sizeof(log));
+        log.block = record->block;
+        log.is_key_b = (record->flags & NFC_TAG_MF1_LOG_FLAG_KEY_B) != 0;
+        log.is_nested = (record->flags & NFC_TAG_MF1_LOG_FLAG_NESTED) != 0;
+        memcpy(log.uid, header->uids[record->flags >> NFC_TAG_MF1_LOG_UID_SHIFT], 4);
+        memcpy(log.nt, record->nt, 4);
+        memcpy(log.nr, record->nr, 4);
+        memcpy(log.ar, record->ar, 4);
+
+        uint32_t chunk = sizeof(log) - skip;
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(buffer, (uint8_t *)&log + skip, chunk);
+        buffer += chunk;
+        length -= chunk;
+        skip = 0;
+        index++;
+    }
+}
+
+void nfc_tag_mf1_log_set_policy(nfc_tag_mf1_log_policy_t policy) {
+    log_ready();
+    m_log.header.policy = policy;
+}
+
+nfc_tag_mf1_log_policy_t nfc_tag_mf1_log_get_policy(void) {
+    log_ready();
+    return (nfc_tag_mf1_log_policy_t)m_log.header.policy;
+}
+
+void nfc_tag_mf1_log_get_stats(uint32_t *duplicates, uint32_t *dropped) {
+    log_ready();
+    *duplicates = m_log.header.duplicates;
+    *dropped = m_log.header.dropped;
+}
+
+/**
+ * @brief Hold the log for a reader that copies it more than once, the copies give the same records until it is
+ * released. From the main loop, out of reach of the NFCT interrupt while head and count are taken.
+ */
+void nfc_tag_mf1_log_hold(bool hold) {
+    log_ready();
+    CRITICAL_REGION_ENTER();
+    m_hold.held = hold;
+    m_hold.head = m_log.header.head;
+    m_hold.count = m_log.header.count;
+    CRITICAL_REGION_EXIT();
+}
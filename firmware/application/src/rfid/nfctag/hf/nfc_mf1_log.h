@@ -0,0 +1,52 @@
+#ifndef NFC_MF1_LOG_H
+#define NFC_MF1_LOG_H
+
+#include "nfc_mf1.h"
+
+// What the log does with a new record once it is full
+typedef enum {
+    NFC_TAG_MF1_LOG_POLICY_STOP,        // keep the first records, drop the new ones
+    NFC_TAG_MF1_LOG_POLICY_OVERWRITE,   // overwrite the oldest record
+} nfc_tag_mf1_log_policy_t;
+
+// Stored form of a detection record, its UID is an index in the UID table of the log
+typedef struct {
+    uint8_t block;
+    uint8_t flags;  // bit 0: key B, bit 1: nested, bits 4..7: UID index
+    uint8_t nt[4];
+    uint8_t nr[4];
+    uint8_t ar[4];
+} PACKED nfc_tag_mf1_log_record_t;
+
+#define NFC_TAG_MF1_LOG_FLAG_KEY_B      0x01
+#define NFC_TAG_MF1_LOG_FLAG_NESTED     0x02
+#define NFC_TAG_MF1_LOG_UID_SHIFT       4
+#define NFC_TAG_MF1_LOG_UID_MAX         16
+
+// The RAM of the flat log of 1000 nfc_tag_mf1_auth_log_t it replaced, count included
+#define NFC_TAG_MF1_LOG_RAM_SIZE        (sizeof(uint32_t) + 1000 * sizeof(nfc_tag_mf1_auth_log_t))
+
+typedef struct {
+    uint32_t magic;
+    uint16_t head;          // ring index of the oldest record
+    uint16_t count;
+    uint32_t duplicates;    // records not stored, equal to one in the log
+    uint32_t dropped;       // records not stored, the log was full or the UID table
+    uint8_t policy;
+    uint8_t uid_count;
+    uint8_t uids[NFC_TAG_MF1_LOG_UID_MAX][4];
+} nfc_tag_mf1_log_header_t;
+
+// A record and its hash byte, to look for duplicates
+#define NFC_TAG_MF1_LOG_RECORD_MAX      ((NFC_TAG_MF1_LOG_RAM_SIZE - sizeof(nfc_tag_mf1_log_header_t)) / (sizeof(nfc_tag_mf1_log_record_t) + 1))
+
+bool nfc_tag_mf1_log_append(const nfc_tag_mf1_auth_log_t *log);
+void nfc_tag_mf1_log_clear(void);
+uint32_t nfc_tag_mf1_log_count(void);
+void nfc_tag_mf1_log_copy(uint32_t offset, uint8_t *buffer, uint32_t length);
+void nfc_tag_mf1_log_set_policy(nfc_tag_mf1_log_policy_t policy);
+nfc_tag_mf1_log_policy_t nfc_tag_mf1_log_get_policy(void);
+void nfc_tag_mf1_log_get_stats(uint32_t *duplicates, uint32_t *dropped);
+void nfc_tag_mf1_log_hold(bool hold);
+
+#endif
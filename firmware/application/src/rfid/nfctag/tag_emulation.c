@@ -9,6 +9,7 @@
 #include "nfc_mf1.h"
 #include "rgb_marquee.h"
 #include "tag_persistence.h"
+#include "tag_slot_cache.h"
 
 #define NRF_LOG_MODULE_NAME tag_emu
 #include "nrf_log.h"
@@ -47,15 +48,19 @@ bool is_tag_specific_type_valid(tag_specific_type_t tag_type) {
 // **********************  Specific parameters start **********************
 
 /**
- * Tag data stored in flash. Total length must be aligned by 4 bytes (whole words).
+ * Tag data stored in flash. Total length must be aligned by 4 bytes (whole words), and so must the buffers be.
  */
-static uint8_t m_tag_data_buffer_lf[20];  // LF card data buffer
-static uint16_t m_tag_data_lf_crc;
-static tag_data_buffer_t m_tag_data_lf = {sizeof(m_tag_data_buffer_lf), m_tag_data_buffer_lf, &m_tag_data_lf_crc};
+static uint8_t m_tag_data_buffer_lf[20] ALIGN_U32;  // LF card data buffer
+static tag_data_buffer_t m_tag_data_lf = {sizeof(m_tag_data_buffer_lf), m_tag_data_buffer_lf, 0, 0};
 
-static uint8_t m_tag_data_buffer_hf[4500];  // HF card data buffer
-static uint16_t m_tag_data_hf_crc;
-static tag_data_buffer_t m_tag_data_hf = {sizeof(m_tag_data_buffer_hf), m_tag_data_buffer_hf, &m_tag_data_hf_crc};
+static uint8_t m_tag_data_buffer_hf[4500] ALIGN_U32;  // HF card data buffer
+static tag_data_buffer_t m_tag_data_hf = {sizeof(m_tag_data_buffer_hf), m_tag_data_buffer_hf, 0, 0};
+STATIC_ASSERT(sizeof(m_tag_data_buffer_hf) <= TAG_SLOT_CACHE_IMAGE_MAX);
+STATIC_ASSERT(sizeof(m_tag_data_buffer_hf) <= TAG_PERSISTENCE_CHUNK_MAX * TAG_PERSISTENCE_CHUNK_SIZE);
+STATIC_ASSERT(TAG_PERSISTENCE_CHUNK_MAX <= 32);
+
+// The slots around the active one are to be read into the slot cache
+static bool m_prefetch_pending = false;
 
 /**
  * Eight card slots, each card slot has its own unique configuration
@@ -179,8 +184,9 @@ tag_data_buffer_t *get_buffer_by_tag_type(tag_specific_type_t type) {
 
 /**
  * Load data from memory to the emulated card data.
+ * @param loaded: the buffer holds the data just read from flash, else it was set from outside and is all saved
  */
-bool tag_emulation_load_by_buffer(tag_specific_type_t tag_type, bool update_crc) {
+bool tag_emulation_load_by_buffer(tag_specific_type_t tag_type, bool loaded) {
     // data has been read to buffer,
     // here we load buffer to the emulator to config pwm seq for the activated card slot.
     tag_datas_loadcb_t loader = get_data_loadcb_from_tag_type(tag_type);
@@ -195,14 +201,33 @@ bool tag_emulation_load_by_buffer(tag_specific_type_t tag_type, bool update_crc)
     }
 
     int length = loader(tag_type, buffer);
-    if (length > 0 && update_crc) {
-        // afterReadingIsCompleted,WeCanSaveACrcOfTheCurrentDataWhenItIsStoredLater,ItCanBeUsedAsAReferenceForChangesComparison
-        calc_14a_crc_lut(buffer->buffer, length, (uint8_t *)buffer->crc);
+    if (!loaded) {
+        buffer->dirty |= tag_persistence_chunk_mask(0, buffer->length);
+    }
+    if (length > 0 && loaded) {
+        // After reading, nothing is to be saved until the emulator memory changes, see tag_emulation_data_changed()
+        buffer->dirty = 0;
         return true;
     }
     return false;
 }
 
+/**
+ * Note a change of the emulator memory, by a reader or the client: the chunks of the slot data it falls in are
+ * written at the next save. Cheap, for the write handlers of the emulated cards.
+ */
+void tag_emulation_data_changed(const void *data, uint16_t length) {
+    tag_data_buffer_t *buffers[] = {&m_tag_data_hf, &m_tag_data_lf};
+    for (uint8_t i = 0; i < ARRAYLEN(buffers); i++) {
+        const uint8_t *start = buffers[i]->buffer;
+        if ((const uint8_t *)data >= start && (const uint8_t *)data + length <= start + buffers[i]->length) {
+            buffers[i]->dirty |= tag_persistence_chunk_mask((const uint8_t *)data - start, length);
+            return;
+        }
+    }
+    NRF_LOG_ERROR("Changed data not in a tag data buffer.");
+}
+
 /**
  * Load card data based on tag type.
  */
@@ -219,15 +244,16 @@ static void load_data_by_tag_type(uint8_t slot, tag_specific_type_t tag_type) {
 
     tag_sense_type_t sense_type = get_sense_type_from_tag_type(tag_type);
 
-    // get fds record for the card slot
-    fds_slot_record_map_t map_info;
-    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
-
     // load data to the buffer according to the card slot currently activated.
     // If the length of data does not match the length of the buffer,
     // it may be caused by the firmware update at this time, the data must be deleted and rebuilt.
+    // The slot cache holds the images of the slots used last, and those changed that are not in flash yet.
     uint16_t length = buffer->length;
-    bool ret = fds_read_sync(map_info.id, map_info.key, &length, buffer->buffer);
+    bool ret = tag_slot_cache_load(slot, sense_type, buffer->buffer, &length) ||
+               tag_persistence_read(slot, sense_type, buffer->buffer, &length);
+    // Nothing of what the buffer holds is the data of the slot, or all of it is
+    buffer->stored = length;
+    buffer->dirty = 0;
     if (false == ret) {
         NRF_LOG_INFO("tag slot data no exists.");
         return;
@@ -240,8 +266,9 @@ static void load_data_by_tag_type(uint8_t slot, tag_specific_type_t tag_type) {
 
 /**
  * Save data according to the type
+ * @param lazy: the slot cache may keep the data and write it to flash later
  */
-static void save_data_by_tag_type(uint8_t slot, tag_specific_type_t tag_type) {
+static void save_data_by_tag_type(uint8_t slot, tag_specific_type_t tag_type, bool lazy) {
     // Maybe the card slot is not enabled to use the emulation of this type of label, and skip it directly to save this data
     if (tag_type == TAG_TYPE_UNDEFINED) {
         return;
@@ -261,7 +288,7 @@ static void save_data_by_tag_type(uint8_t slot, tag_specific_type_t tag_type) {
     }
 
     data_byte_length = fn_savecb(tag_type, buffer);
-    // Make sure to save data, we can judge whether the data has changed through CRC
+    // Make sure to save data, what changed was noted in the dirty chunks
     if (data_byte_length <= 0) {
         NRF_LOG_INFO("Tag type %d data no save.", tag_type);
         return;
@@ -271,26 +298,31 @@ static void save_data_by_tag_type(uint8_t slot, tag_specific_type_t tag_type) {
         NRF_LOG_ERROR("Tag data save length overflow.", tag_type);
         return;
     }
-    uint16_t crc;
-    calc_14a_crc_lut(buffer->buffer, data_byte_length, (uint8_t *)&crc);
     // Determine whether the data has changed
-    if (crc == *buffer->crc) {
+    if (buffer->dirty == 0) {
         NRF_LOG_INFO("Tag slot data no change, length = %d", data_byte_length);
         return;
     }
+    // Only the chunks changed are written, unless the data in flash is not as long, or not there at all.
+    // It is stored in whole words, and read back as such.
+    uint16_t stored_length = (data_byte_length + 3) & ~3;
+    uint32_t chunks = stored_length == buffer->stored ? buffer->dirty : TAG_PERSISTENCE_CHUNKS_ALL;
+    buffer->stored = stored_length;
+    buffer->dirty = 0;
     tag_sense_type_t sense_type = get_sense_type_from_tag_type(tag_type);
-    // Get the special card slot FDS record information
-    fds_slot_record_map_t map_info;
-    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
+    // And those the slot cache has not written yet, the copy it holds is older than the one saved now
+    chunks |= tag_slot_cache_drop(slot, sense_type);
+    if (lazy && tag_slot_cache_store(slot, sense_type, buffer->buffer, data_byte_length, chunks)) {
+        NRF_LOG_INFO("Tag slot data cached, length = %d", data_byte_length);
+        return;
+    }
     // Call the blocked FDS to write the function, and write the data of the specified field type of the card slot into the Flash
-    bool ret = fds_write_sync(map_info.id, map_info.key, data_byte_length, buffer->buffer);
+    bool ret = tag_persistence_write(slot, sense_type, buffer->buffer, data_byte_length, chunks);
     if (ret) {
         NRF_LOG_INFO("Save tag slot data success.");
     } else {
         NRF_LOG_ERROR("Save tag slot data error.");
     }
-    // After the preservation is completed, the CRC of the BUFFER in the corresponding memory
-    *buffer->crc = crc;
 }
 
 /**
@@ -300,9 +332,8 @@ static void delete_data_by_tag_type(uint8_t slot, tag_sense_type_t sense_type) {
     if (sense_type == TAG_SENSE_NO) {
         return;
     }
-    fds_slot_record_map_t map_info;
-    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
-    int count = fds_delete_sync(map_info.id, map_info.key);
+    tag_slot_cache_drop(slot, sense_type);
+    int count = tag_persistence_delete(slot, sense_type);
     NRF_LOG_INFO("Slot %d delete sense type %d data, record count: %d", slot, sense_type, count);
 }
 
@@ -318,11 +349,12 @@ void tag_emulation_load_data(void) {
 
 /**
  *Save the emulated card configuration data. At the right time, this function should be called for data preservation of data
+ * @param lazy: the slot cache may keep the data and write it to flash later, see tag_emulation_slot_cache_process()
  */
-void tag_emulation_save_data(void) {
+void tag_emulation_save_data(bool lazy) {
     uint8_t slot = tag_emulation_get_slot();
-    save_data_by_tag_type(slot, slotConfig.slots[slot].tag_hf);
-    save_data_by_tag_type(slot, slotConfig.slots[slot].tag_lf);
+    save_data_by_tag_type(slot, slotConfig.slots[slot].tag_hf, lazy);
+    save_data_by_tag_type(slot, slotConfig.slots[slot].tag_lf, lazy);
 }
 
 /**
@@ -366,6 +398,8 @@ void tag_emulation_delete_data(uint8_t slot, tag_sense_type_t sense_type) {
  */
 bool tag_emulation_factory_data(uint8_t slot, tag_specific_type_t tag_type) {
     tag_datas_factory_t factory = get_data_factory_from_tag_type(tag_type);
+    // The factory writes to flash, the image the slot cache holds is not that of the slot anymore
+    tag_slot_cache_drop(slot, get_sense_type_from_tag_type(tag_type));
     // The process of implementing the data formatting data!
     if (factory != NULL && factory(slot, tag_type)) {
         // If the current data card slot number currently set is the current activated card slot, then we need to update to the memory
@@ -514,7 +548,7 @@ static void tag_emulation_save_config(void) {
     calc_14a_crc_lut((uint8_t *)&slotConfig, sizeof(slotConfig), (uint8_t *)&new_calc_crc);
     if (new_calc_crc != m_slot_config_crc) {  // Before saving, make sure that the card slot configuration has changed
         NRF_LOG_INFO("Save tag slot config start.");
-        bool ret = fds_write_sync(FDS_EMULATION_CONFIG_FILE_ID, FDS_EMULATION_CONFIG_RECORD_KEY, sizeof(slotConfig), (uint8_t *)&slotConfig);
+        bool ret = fds_write_async(FDS_EMULATION_CONFIG_FILE_ID, FDS_EMULATION_CONFIG_RECORD_KEY, sizeof(slotConfig), (uint8_t *)&slotConfig);
         if (ret) {
             NRF_LOG_INFO("Save tag slot config success.");
             m_slot_config_crc = new_calc_crc;
@@ -542,10 +576,35 @@ void tag_emulation_sense_end(void) {
     tag_emulation_sense_switch_all(false);
 }
 
+/**
+ * A chunk of slot data the flash write queue dropped, the flash full: it is written again at the next save, from the
+ * emulator memory if the slot is active, else from the slot cache. Else the older chunk stays in flash.
+ */
+static void tag_emulation_write_failed(uint16_t id, uint16_t key) {
+    uint8_t slot;
+    uint8_t chunk;
+    tag_sense_type_t sense_type;
+    if (!tag_persistence_chunk_of(id, key, &slot, &sense_type, &chunk)) {
+        return;
+    }
+    if (slot == tag_emulation_get_slot()) {
+        tag_specific_type_t tag_type = sense_type == TAG_SENSE_HF ? slotConfig.slots[slot].tag_hf : slotConfig.slots[slot].tag_lf;
+        tag_data_buffer_t *buffer = tag_type == TAG_TYPE_UNDEFINED ? NULL : get_buffer_by_tag_type(tag_type);
+        if (buffer != NULL) {
+            buffer->dirty |= 1UL << chunk;
+            return;
+        }
+    }
+    if (!tag_slot_cache_write_failed(slot, sense_type, 1UL << chunk)) {
+        NRF_LOG_ERROR("Slot %d sense %d chunk %d lost, the flash is full.", slot, sense_type, chunk);
+    }
+}
+
 /**
  * Initialized tag emulation
  */
 void tag_emulation_init(void) {
+    on_fds_write_failed(tag_emulation_write_failed);
     tag_emulation_load_config();  // Configuration of loading the card slot of the emulation card
     tag_emulation_load_data();    // Load the data of the emulated card
 }
@@ -554,8 +613,36 @@ void tag_emulation_init(void) {
  * Save the tag data (written from RAM to Flash)
  */
 void tag_emulation_save(void) {
-    tag_emulation_save_config();  // Save the card slot configuration
-    tag_emulation_save_data();    // Save card slot data
+    tag_emulation_save_config();    // Save the card slot configuration
+    tag_emulation_save_data(false); // Save card slot data
+    tag_slot_cache_flush();         // And that of the slots left before, the slot cache still holds
+}
+
+/**
+ * One step of the slot cache upkeep, for when the device is idle and no card is emulated: write a slot image
+ * left changed to flash, else read that of a slot next to the active one.
+ * @return false if there was nothing left to do
+ */
+bool tag_emulation_slot_cache_process(void) {
+    if (tag_slot_cache_write_back()) {
+        return true;
+    }
+    if (!m_prefetch_pending) {
+        return false;
+    }
+    uint8_t slot_now = tag_emulation_get_slot();
+    uint8_t slots[2] = {tag_emulation_slot_find_next(slot_now), tag_emulation_slot_find_prev(slot_now)};
+    for (uint8_t i = 0; i < ARRAYLEN(slots); i++) {
+        if (slots[i] == slot_now) {
+            continue;
+        }
+        if ((slotConfig.slots[slots[i]].tag_hf != TAG_TYPE_UNDEFINED && tag_slot_cache_prefetch(slots[i], TAG_SENSE_HF)) ||
+            (slotConfig.slots[slots[i]].tag_lf != TAG_TYPE_UNDEFINED && tag_slot_cache_prefetch(slots[i], TAG_SENSE_LF))) {
+            return true;
+        }
+    }
+    m_prefetch_pending = false;
+    return false;
 }
 
 /**
@@ -581,10 +668,11 @@ void tag_emulation_change_slot(uint8_t index, bool sense_disable) {
         // Turn off the analog card to avoid triggering the emulation when switching the card slot
         tag_emulation_sense_end();
     }
-    tag_emulation_save_data();      // Save the data of the current card, in case of there is a change
+    tag_emulation_save_data(true);  // Save the data of the current card, in case of there is a change
     g_is_tag_emulating = false;     // Reset the emulating flag
     tag_emulation_set_slot(index);  // Update the index of the activated card slot
     tag_emulation_load_data();      // Then reload the data of the card slot
+    m_prefetch_pending = true;      // And the slots next to it, when the device is idle
     if (sense_disable) {
         // According to the configuration of the new card slot, the monitoring status of our update
         tag_emulation_sense_run();
@@ -681,37 +769,31 @@ void tag_emulation_change_type(uint8_t slot, tag_specific_type_t tag_type) {
  * Defaults to a dual-frequency card in slot 1, a hf M1 card in slot 2, and a lf em410x card in slot 3.
  */
 void tag_emulation_factory_init(void) {
-    fds_slot_record_map_t map_info;
-
     // Initialized a dual -frequency card in the card slot, if there is no historical record, it is a new state of factory.
     if (slotConfig.slots[0].enabled_hf && slotConfig.slots[0].tag_hf == TAG_TYPE_MIFARE_1024) {
         // Initialize a high -frequency M1 card in the card slot 1, if it does not exist.
-        get_fds_map_by_slot_sense_type_for_dump(0, TAG_SENSE_HF, &map_info);
-        if (!fds_is_exists(map_info.id, map_info.key)) {
+        if (!tag_persistence_exists(0, TAG_SENSE_HF)) {
             tag_emulation_factory_data(0, slotConfig.slots[0].tag_hf);
         }
     }
 
     if (slotConfig.slots[0].enabled_lf && slotConfig.slots[0].tag_lf == TAG_TYPE_EM410X) {
         // Initialize a low -frequency EM410X card in slot 1, if it does not exist.
-        get_fds_map_by_slot_sense_type_for_dump(0, TAG_SENSE_LF, &map_info);
-        if (!fds_is_exists(map_info.id, map_info.key)) {
+        if (!tag_persistence_exists(0, TAG_SENSE_LF)) {
             tag_emulation_factory_data(0, slotConfig.slots[0].tag_lf);
         }
     }
 
     if (slotConfig.slots[1].enabled_hf && slotConfig.slots[1].tag_hf == TAG_TYPE_MF0ICU1) {
         // Initialize a high -frequency M1 card in the card slot 2, if it does not exist.
-        get_fds_map_by_slot_sense_type_for_dump(1, TAG_SENSE_HF, &map_info);
-        if (!fds_is_exists(map_info.id, map_info.key)) {
+        if (!tag_persistence_exists(1, TAG_SENSE_HF)) {
             tag_emulation_factory_data(1, slotConfig.slots[1].tag_hf);
         }
     }
 
     if (slotConfig.slots[2].enabled_lf && slotConfig.slots[2].tag_lf == TAG_TYPE_EM410X) {
         // Initialize a low -frequency EM410X card in slot 3, if it does not exist.
-        get_fds_map_by_slot_sense_type_for_dump(2, TAG_SENSE_LF, &map_info);
-        if (!fds_is_exists(map_info.id, map_info.key)) {
+        if (!tag_persistence_exists(2, TAG_SENSE_LF)) {
             tag_emulation_factory_data(2, slotConfig.slots[2].tag_lf);
         }
     }
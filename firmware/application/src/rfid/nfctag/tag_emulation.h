@@ -18,7 +18,8 @@ extern bool g_is_tag_emulating;
 typedef struct {
     uint16_t length;
     uint8_t *buffer;
-    uint16_t *crc;
+    uint16_t stored;    // length of the data in flash, the buffer was loaded from or last saved, 0 if none
+    uint32_t dirty;     // the chunks changed since then (tag_persistence.h), only they are written
 } tag_data_buffer_t;
 
 // Farming impact enable and closed energy switching function
@@ -78,6 +79,8 @@ STATIC_ASSERT(sizeof(tag_slot_config_t) == TAG_SLOT_CONFIG_CURRENT_SIZE);
 void tag_emulation_init(void);
 // Some of the data stored in RAM can be saved to Flash through this interface
 void tag_emulation_save(void);
+// The slot cache writes back and prefetches slot images a step at a time, when the device is idle
+bool tag_emulation_slot_cache_process(void);
 
 // Starting and ending of the emulation card
 void tag_emulation_sense_run(void);
@@ -92,7 +95,9 @@ bool tag_emulation_factory_data(uint8_t slot, tag_specific_type_t tag_type);
 // Change the type of the card that is being emulated
 void tag_emulation_change_type(uint8_t slot, tag_specific_type_t tag_type);
 // Load the data from the memory to the emulation card buffer
-bool tag_emulation_load_by_buffer(tag_specific_type_t tag_type, bool update_crc);
+bool tag_emulation_load_by_buffer(tag_specific_type_t tag_type, bool loaded);
+// Note a change of the emulator memory, what is not noted is not saved
+void tag_emulation_data_changed(const void *data, uint16_t length);
 
 tag_sense_type_t get_sense_type_from_tag_type(tag_specific_type_t type);
 tag_data_buffer_t *get_buffer_by_tag_type(tag_specific_type_t type);
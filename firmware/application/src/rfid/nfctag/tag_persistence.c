@@ -1,6 +1,7 @@
 #include "tag_persistence.h"
 
 #include "fds_ids.h"
+#include "fds_util.h"
 
 #define NRF_LOG_MODULE_NAME tag_persistence
 #include "nrf_log.h"
@@ -29,3 +30,139 @@ void get_fds_map_by_slot_sense_type_for_dump(uint8_t slot, tag_sense_type_t sens
 void get_fds_map_by_slot_sense_type_for_nick(uint8_t slot, tag_sense_type_t sense_type, fds_slot_record_map_t *map) {
     get_fds_map_by_slot_auto_inc_id(FDS_SLOT_TAG_NICK_NAME_FILE_ID_BASE, slot, sense_type, map);
 }
+
+// The record key of a chunk, the sense type in the high byte
+static uint16_t chunk_key(tag_sense_type_t sense_type, uint8_t chunk) {
+    return FDS_SLOT_TAG_DUMP_CHUNK_KEY(sense_type, chunk);
+}
+
+/**
+ * The chunks a change of length bytes at offset in the data falls in
+ */
+uint32_t tag_persistence_chunk_mask(uint16_t offset, uint16_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    uint8_t first = offset / TAG_PERSISTENCE_CHUNK_SIZE;
+    uint8_t last = (offset + length - 1) / TAG_PERSISTENCE_CHUNK_SIZE;
+    return (2UL << last) - (1UL << first);
+}
+
+/**
+ * The slot, sense type and chunk of a chunk record, from the id and key fds_write_failed_t reports
+ * @return false if the record is not a chunk of the data of a slot
+ */
+bool tag_persistence_chunk_of(uint16_t id, uint16_t key, uint8_t *slot, tag_sense_type_t *sense_type, uint8_t *chunk) {
+    if (id < FDS_SLOT_TAG_DUMP_FILE_ID_BASE || id > FDS_SLOT_TAG_DUMP_FILE_ID_BASE + 7) {
+        return false;
+    }
+    *slot = id - FDS_SLOT_TAG_DUMP_FILE_ID_BASE;
+    *sense_type = key >> 8;
+    *chunk = key & 0xFF;
+    return (*sense_type == TAG_SENSE_HF || *sense_type == TAG_SENSE_LF) && *chunk < TAG_PERSISTENCE_CHUNK_MAX;
+}
+
+/**
+ * Read the data of a slot, as fds_read_sync() reads a record: the chunks one after the other, up to the first that
+ * is not a whole one. Data stored before the chunks, as a single record, is read and stored again in chunks.
+ * @param length: size of the buffer, set to the length of the data
+ */
+bool tag_persistence_read(uint8_t slot, tag_sense_type_t sense_type, uint8_t *buffer, uint16_t *length) {
+    fds_slot_record_map_t map_info;
+    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
+    uint16_t total = 0;
+    for (uint8_t chunk = 0; chunk < TAG_PERSISTENCE_CHUNK_MAX; chunk++) {
+        uint16_t chunk_length = *length - total;
+        if (!fds_read_sync(map_info.id, chunk_key(sense_type, chunk), &chunk_length, &buffer[total])) {
+            break;
+        }
+        total += chunk_length;
+        if (chunk_length < TAG_PERSISTENCE_CHUNK_SIZE) {
+            break;
+        }
+    }
+    if (total == 0) {
+        total = *length;
+        if (!fds_read_sync(map_info.id, map_info.key, &total, buffer)) {
+            *length = 0;
+            return false;
+        }
+        NRF_LOG_INFO("Slot %d sense %d data stored again in chunks.", slot, sense_type);
+        tag_persistence_write(slot, sense_type, buffer, total, TAG_PERSISTENCE_CHUNKS_ALL);
+    }
+    *length = total;
+    return true;
+}
+
+// The chunks of longer data, or the single record of before the chunks, that data of count chunks replaces
+static bool tag_persistence_stale_exists(const fds_slot_record_map_t *map_info, tag_sense_type_t sense_type, uint8_t count) {
+    for (uint8_t chunk = count; chunk < TAG_PERSISTENCE_CHUNK_MAX; chunk++) {
+        if (fds_is_exists(map_info->id, chunk_key(sense_type, chunk))) {
+            return true;
+        }
+    }
+    return fds_is_exists(map_info->id, map_info->key);
+}
+
+/**
+ * Write the chunks of the data of a slot. Data not in flash yet is written whole, and written whole it replaces the
+ * chunks of longer data and the single record of the data stored before the chunks. The chunks are queued for the
+ * flash, unless they replace records: then they are written before the records are deleted.
+ * @param data: word aligned, readable up to the next whole word
+ * @param chunks: mask of the chunks to write, TAG_PERSISTENCE_CHUNKS_ALL for all of them
+ */
+bool tag_persistence_write(uint8_t slot, tag_sense_type_t sense_type, const uint8_t *data, uint16_t length, uint32_t chunks) {
+    fds_slot_record_map_t map_info;
+    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
+    if (chunks != TAG_PERSISTENCE_CHUNKS_ALL && !fds_is_exists(map_info.id, chunk_key(sense_type, 0))) {
+        chunks = TAG_PERSISTENCE_CHUNKS_ALL;
+    }
+    uint8_t count = (length + TAG_PERSISTENCE_CHUNK_SIZE - 1) / TAG_PERSISTENCE_CHUNK_SIZE;
+    if (count > TAG_PERSISTENCE_CHUNK_MAX) {
+        NRF_LOG_ERROR("Slot %d sense %d data too long, %d bytes.", slot, sense_type, length);
+        return false;
+    }
+    bool ret = true;
+    for (uint8_t chunk = 0; chunk < count; chunk++) {
+        if (chunks & (1UL << chunk)) {
+            uint16_t offset = chunk * TAG_PERSISTENCE_CHUNK_SIZE;
+            uint16_t chunk_length = MIN(TAG_PERSISTENCE_CHUNK_SIZE, length - offset);
+            ret &= fds_write_async(map_info.id, chunk_key(sense_type, chunk), chunk_length, &data[offset]);
+        }
+    }
+    if (chunks == TAG_PERSISTENCE_CHUNKS_ALL && ret && tag_persistence_stale_exists(&map_info, sense_type, count)) {
+        // The chunks reach the flash before the records they replace are deleted, a reset in between keeps a copy
+        fds_queue_flush();
+        for (uint8_t chunk = 0; chunk < count; chunk++) {
+            if (!fds_is_exists(map_info.id, chunk_key(sense_type, chunk))) {
+                NRF_LOG_ERROR("Slot %d sense %d chunk %d not written, older data kept.", slot, sense_type, chunk);
+                return false;
+            }
+        }
+        for (uint8_t chunk = count; chunk < TAG_PERSISTENCE_CHUNK_MAX; chunk++) {
+            fds_delete_sync(map_info.id, chunk_key(sense_type, chunk));
+        }
+        fds_delete_sync(map_info.id, map_info.key);
+    }
+    return ret;
+}
+
+/**
+ * Delete the data of a slot, the chunks and the single record of before them
+ * @return the number of records deleted
+ */
+int tag_persistence_delete(uint8_t slot, tag_sense_type_t sense_type) {
+    fds_slot_record_map_t map_info;
+    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
+    int count = fds_delete_sync(map_info.id, map_info.key);
+    for (uint8_t chunk = 0; chunk < TAG_PERSISTENCE_CHUNK_MAX; chunk++) {
+        count += fds_delete_sync(map_info.id, chunk_key(sense_type, chunk));
+    }
+    return count;
+}
+
+bool tag_persistence_exists(uint8_t slot, tag_sense_type_t sense_type) {
+    fds_slot_record_map_t map_info;
+    get_fds_map_by_slot_sense_type_for_dump(slot, sense_type, &map_info);
+    return fds_is_exists(map_info.id, chunk_key(sense_type, 0)) || fds_is_exists(map_info.id, map_info.key);
+}
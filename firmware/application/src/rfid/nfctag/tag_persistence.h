@@ -1,10 +1,19 @@
 #ifndef TAG_PERSISTENCE_H
 #define TAG_PERSISTENCE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "tag_base_type.h"
 
+/*
+ * The data of a slot is stored in chunks, one FDS record each: a change of the emulator memory rewrites only the
+ * chunks it falls in, a bit each in a chunk mask.
+ */
+#define TAG_PERSISTENCE_CHUNK_SIZE  256
+#define TAG_PERSISTENCE_CHUNK_MAX   18          // of the largest data, the 4500 bytes of the HF buffer
+#define TAG_PERSISTENCE_CHUNKS_ALL  UINT32_MAX  // the data written whole, it may not be in flash yet
+
 typedef struct {
     uint16_t key;
     uint16_t id;
@@ -19,4 +28,11 @@ void get_fds_map_by_slot_sense_type_for_dump(uint8_t slot, tag_sense_type_t sens
  */
 void get_fds_map_by_slot_sense_type_for_nick(uint8_t slot, tag_sense_type_t sense_type, fds_slot_record_map_t *map);
 
+uint32_t tag_persistence_chunk_mask(uint16_t offset, uint16_t length);
+bool tag_persistence_chunk_of(uint16_t id, uint16_t key, uint8_t *slot, tag_sense_type_t *sense_type, uint8_t *chunk);
+bool tag_persistence_read(uint8_t slot, tag_sense_type_t sense_type, uint8_t *buffer, uint16_t *length);
+bool tag_persistence_write(uint8_t slot, tag_sense_type_t sense_type, const uint8_t *data, uint16_t length, uint32_t chunks);
+int tag_persistence_delete(uint8_t slot, tag_sense_type_t sense_type);
+bool tag_persistence_exists(uint8_t slot, tag_sense_type_t sense_type);
+
 #endif
@@ -0,0 +1,310 @@
+#include <string.h>
+
+#include "tag_slot_cache.h"
+
+#include "lz4_block.h"
+#include "tag_persistence.h"
+
+#define NRF_LOG_MODULE_NAME tag_slot_cache
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_log_default_backends.h"
+NRF_LOG_MODULE_REGISTER();
+
+
+static tag_slot_cache_stats_t m_stats;
+
+#if TAG_SLOT_CACHE_SIZE > 0
+
+STATIC_ASSERT(TAG_SLOT_CACHE_SIZE <= UINT16_MAX);
+
+/*
+ * The slot images of the most recently used slots, as stored in flash, LZ4 compressed when that makes them
+ * smaller. A slot left with changes keeps them here, marked dirty, until they are written back when the device is
+ * idle, or before it sleeps: a slot change costs no flash write and a switch back costs no flash read. The images
+ * are packed in the pool in the order of the entries, the least recently used clean image makes room for a new one,
+ * a dirty image is never dropped.
+ */
+typedef struct {
+    uint16_t offset;        // in the pool
+    uint16_t size;          // bytes in the pool
+    uint16_t length;        // bytes of the image
+    uint8_t slot;
+    uint8_t sense_type;
+    uint32_t dirty;         // the chunks not in flash yet (tag_persistence.h)
+    bool failed;            // some of them found the flash full, they wait for tag_slot_cache_flush()
+    bool compressed;
+    uint32_t used;          // the use clock when it was last loaded or stored
+} entry_t;
+
+static uint8_t m_pool[TAG_SLOT_CACHE_SIZE];
+static entry_t m_entries[TAG_SLOT_CACHE_ENTRY_MAX];
+static uint8_t m_count;
+static uint32_t m_clock;
+
+// The image written back or prefetched, word aligned
+static uint8_t m_image[TAG_SLOT_CACHE_IMAGE_MAX] ALIGN_U32;
+static uint16_t m_table[LZ4_BLOCK_HASH_SIZE];
+
+
+static entry_t *entry_find(uint8_t slot, tag_sense_type_t sense_type) {
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (m_entries[i].slot == slot && m_entries[i].sense_type == sense_type) {
+            return &m_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static uint16_t pool_used(void) {
+    return m_count == 0 ? 0 : m_entries[m_count - 1].offset + m_entries[m_count - 1].size;
+}
+
+// The images after it move down, the pool stays packed
+static void entry_remove(entry_t *entry) {
+    uint16_t size = entry->size;
+    uint16_t end = pool_used();
+    uint16_t next = entry->offset + size;
+    memmove(&m_pool[entry->offset], &m_pool[next], end - next);
+    for (uint8_t i = entry - m_entries + 1; i < m_count; i++) {
+        m_entries[i].offset -= size;
+        m_entries[i - 1] = m_entries[i];
+    }
+    m_count--;
+}
+
+// Drops the least recently used clean image, false if there is none
+static bool entry_evict(void) {
+    entry_t *victim = NULL;
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (m_entries[i].dirty == 0 && (victim == NULL || m_entries[i].used < victim->used)) {
+            victim = &m_entries[i];
+        }
+    }
+    if (victim == NULL) {
+        return false;
+    }
+    entry_remove(victim);
+    m_stats.evictions++;
+    return true;
+}
+
+static bool entry_unpack(const entry_t *entry, uint8_t *buffer, uint16_t buffer_length) {
+    if (entry->length > buffer_length) {
+        return false;
+    }
+    if (!entry->compressed) {
+        memcpy(buffer, &m_pool[entry->offset], entry->length);
+        return true;
+    }
+    return lz4_block_decompress(&m_pool[entry->offset], entry->size, buffer, entry->length) == entry->length;
+}
+
+/**
+ * @brief Copy the image of a slot to the buffer, as fds_read_sync() does
+ * @param length: size of the buffer, set to the length of the image
+ * @return false if the cache does not hold it
+ */
+bool tag_slot_cache_load(uint8_t slot, tag_sense_type_t sense_type, uint8_t *buffer, uint16_t *length) {
+    entry_t *entry = entry_find(slot, sense_type);
+    if (entry == NULL || !entry_unpack(entry, buffer, *length)) {
+        m_stats.misses++;
+        return false;
+    }
+    entry->used = ++m_clock;
+    *length = entry->length;
+    m_stats.hits++;
+    return true;
+}
+
+/**
+ * @brief Keep the image of a slot, in place of the one held. Its dirty chunks are written to flash later.
+ * @param data: readable up to the next whole word
+ * @param dirty: the chunks changed, those of the image held stay dirty
+ * @return false if there is no room for it, the image held is dropped all the same: drop it first to write them
+ */
+bool tag_slot_cache_store(uint8_t slot, tag_sense_type_t sense_type, const uint8_t *data, uint16_t length, uint32_t dirty) {
+    dirty |= tag_slot_cache_drop(slot, sense_type);
+    // In whole words, as the FDS stores it and fds_read_sync() loads it
+    length = (length + 3) & ~3;
+    if (length > TAG_SLOT_CACHE_IMAGE_MAX || length > sizeof(m_pool)) {
+        m_stats.rejects += dirty != 0;
+        return false;
+    }
+    // compressed straight into the free end of the pool, the used images make room until it fits
+    uint16_t size;
+    bool compressed;
+    while (true) {
+        uint16_t free = sizeof(m_pool) - pool_used();
+        if (m_count < TAG_SLOT_CACHE_ENTRY_MAX) {
+            size = lz4_block_compress(data, length, &m_pool[pool_used()], free < length ? free : length - 1, m_table);
+            compressed = size != 0;
+            if (compressed) {
+                break;
+            }
+            if (free >= length) {
+                // no smaller compressed, kept as it is
+                memcpy(&m_pool[pool_used()], data, length);
+                size = length;
+                break;
+            }
+        }
+        if (!entry_evict()) {
+            m_stats.rejects += dirty != 0;
+            return false;
+        }
+    }
+
+    entry_t *entry = &m_entries[m_count];
+    entry->offset = pool_used();
+    entry->size = size;
+    entry->length = length;
+    entry->slot = slot;
+    entry->sense_type = sense_type;
+    entry->dirty = dirty;
+    entry->failed = false;
+    entry->compressed = compressed;
+    entry->used = ++m_clock;
+    m_count++;
+    NRF_LOG_INFO("Slot %d sense %d image cached, %d -> %d bytes", slot, sense_type, length, size);
+    return true;
+}
+
+/**
+ * @brief Read the image of a slot from flash, ahead of a switch to it
+ * @return true if it was read, false if the cache holds it already, if there is none or no room for it
+ */
+bool tag_slot_cache_prefetch(uint8_t slot, tag_sense_type_t sense_type) {
+    if (entry_find(slot, sense_type) != NULL) {
+        return false;
+    }
+    uint16_t length = sizeof(m_image);
+    if (!tag_persistence_read(slot, sense_type, m_image, &length)) {
+        return false;
+    }
+    if (!tag_slot_cache_store(slot, sense_type, m_image, length, 0)) {
+        return false;
+    }
+    m_stats.prefetches++;
+    return true;
+}
+
+// Writes the dirty chunks of the image, false if it was dropped
+static bool entry_write_back(entry_t *entry) {
+    // Like a save at the slot change, an image that cannot be written is not tried again, unless the flash write
+    // queue reports chunks of it lost, see tag_slot_cache_write_failed()
+    uint32_t chunks = entry->dirty;
+    entry->dirty = 0;
+    entry->failed = false;
+    if (!entry_unpack(entry, m_image, sizeof(m_image))) {
+        NRF_LOG_ERROR("Slot %d sense %d cached image corrupted.", entry->slot, entry->sense_type);
+        entry_remove(entry);
+        return false;
+    }
+    if (tag_persistence_write(entry->slot, entry->sense_type, m_image, entry->length, chunks)) {
+        NRF_LOG_INFO("Slot %d sense %d image written back.", entry->slot, entry->sense_type);
+        m_stats.write_backs++;
+    } else {
+        NRF_LOG_ERROR("Slot %d sense %d image write back error.", entry->slot, entry->sense_type);
+    }
+    return true;
+}
+
+/**
+ * @brief Write the dirty chunks of the least recently used dirty image to flash, but those that found the flash full
+ * @return false if there was none
+ */
+bool tag_slot_cache_write_back(void) {
+    entry_t *entry = NULL;
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (m_entries[i].dirty != 0 && !m_entries[i].failed && (entry == NULL || m_entries[i].used < entry->used)) {
+            entry = &m_entries[i];
+        }
+    }
+    if (entry == NULL) {
+        return false;
+    }
+    entry_write_back(entry);
+    return true;
+}
+
+/**
+ * @brief Write the dirty chunks of all the images to flash, once: those that find the flash full stay dirty
+ */
+void tag_slot_cache_flush(void) {
+    for (uint8_t i = 0; i < m_count;) {
+        if (m_entries[i].dirty == 0 || entry_write_back(&m_entries[i])) {
+            i++;
+        }
+    }
+}
+
+/**
+ * @brief Mark chunks of the image of a slot dirty again, their queued write found the flash full
+ * @return false if the cache does not hold it
+ */
+bool tag_slot_cache_write_failed(uint8_t slot, tag_sense_type_t sense_type, uint32_t chunks) {
+    entry_t *entry = entry_find(slot, sense_type);
+    if (entry == NULL) {
+        return false;
+    }
+    entry->dirty |= chunks;
+    entry->failed = true;
+    return true;
+}
+
+/**
+ * @brief Forget the image of a slot
+ * @return its chunks not written to flash yet, for the caller to write
+ */
+uint32_t tag_slot_cache_drop(uint8_t slot, tag_sense_type_t sense_type) {
+    entry_t *entry = entry_find(slot, sense_type);
+    if (entry == NULL) {
+        return 0;
+    }
+    uint32_t dirty = entry->dirty;
+    entry_remove(entry);
+    return dirty;
+}
+
+void tag_slot_cache_clear(void) {
+    m_count = 0;
+}
+
+#else
+
+bool tag_slot_cache_load(uint8_t slot, tag_sense_type_t sense_type, uint8_t *buffer, uint16_t *length) {
+    return false;
+}
+
+bool tag_slot_cache_store(uint8_t slot, tag_sense_type_t sense_type, const uint8_t *data, uint16_t length, uint32_t dirty) {
+    return false;
+}
+
+bool tag_slot_cache_prefetch(uint8_t slot, tag_sense_type_t sense_type) {
+    return false;
+}
+
+bool tag_slot_cache_write_back(void) {
+    return false;
+}
+
+void tag_slot_cache_flush(void) {
+}
+
+bool tag_slot_cache_write_failed(uint8_t slot, tag_sense_type_t sense_type, uint32_t chunks) {
+    return false;
+}
+
+uint32_t tag_slot_cache_drop(uint8_t slot, tag_sense_type_t sense_type) {
+    return 0;
+}
+
+void tag_slot_cache_clear(void) {
+}
+
+#endif
+
+const tag_slot_cache_stats_t *tag_slot_cache_get_stats(void) {
+    return &m_stats;
+}
@@ -0,0 +1,40 @@
+#ifndef TAG_SLOT_CACHE_H
+#define TAG_SLOT_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tag_emulation.h"
+
+/*
+ * RAM given to the slot images the cache keeps, LZ4 compressed. 0 leaves the cache out: a slot change then reads
+ * the images of the new slot from flash and writes those of the old slot that changed at once.
+ */
+#ifndef TAG_SLOT_CACHE_SIZE
+#define TAG_SLOT_CACHE_SIZE         (16 * 1024)
+#endif
+// The largest image, the size of the HF data buffer
+#define TAG_SLOT_CACHE_IMAGE_MAX    4500
+// An LF and an HF image per slot
+#define TAG_SLOT_CACHE_ENTRY_MAX    (2 * TAG_MAX_SLOT_NUM)
+
+typedef struct {
+    uint32_t hits;          // loads served from the cache
+    uint32_t misses;        // loads left to the flash
+    uint32_t prefetches;    // images read from flash ahead of a load
+    uint32_t write_backs;   // changed images written to flash later
+    uint32_t evictions;     // images dropped to make room
+    uint32_t rejects;       // changed images without room, the caller writes them at once
+} tag_slot_cache_stats_t;
+
+bool tag_slot_cache_load(uint8_t slot, tag_sense_type_t sense_type, uint8_t *buffer, uint16_t *length);
+bool tag_slot_cache_store(uint8_t slot, tag_sense_type_t sense_type, const uint8_t *data, uint16_t length, uint32_t dirty);
+bool tag_slot_cache_prefetch(uint8_t slot, tag_sense_type_t sense_type);
+bool tag_slot_cache_write_back(void);
+void tag_slot_cache_flush(void);
+bool tag_slot_cache_write_failed(uint8_t slot, tag_sense_type_t sense_type, uint32_t chunks);
+uint32_t tag_slot_cache_drop(uint8_t slot, tag_sense_type_t sense_type);
+void tag_slot_cache_clear(void);
+const tag_slot_cache_stats_t *tag_slot_cache_get_stats(void);
+
+#endif
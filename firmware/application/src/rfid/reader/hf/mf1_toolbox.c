@@ -13,6 +13,7 @@
 #include "hw_connect.h"
 #include "nrf_gpio.h"
 #include "rgb_marquee.h"
+#include "app_util.h"
 
 // The default delay of the antenna reset
 static uint32_t g_ant_reset_delay = 100;
@@ -1025,74 +1026,248 @@ inline void mf1_toolbox_report_healthy() {
     while (NRF_LOG_PROCESS());
 }
 
-uint16_t mf1_toolbox_check_keys_of_sectors(
+// open addressing table of the key dedup, kept at most two thirds full
+#define CHECK_KEYS_HASH_BITS 10
+#define CHECK_KEYS_HASH_SLOTS (1 << CHECK_KEYS_HASH_BITS)
+STATIC_ASSERT(CHECK_KEYS_HASH_SLOTS * 2 >= MF1_TOOLBOX_CHECK_KEYS_MAX * 3);
+// a wrong key gets no answer, give up after the second tick of the 10 ms timer instead of the third
+#define CHECK_KEYS_AUTH_TIMEOUT_MS 10
+
+/**
+* @brief : Remove the duplicated keys in one pass, the first occurrence of each key is kept in place.
+* @param :keys : keys, compacted in place
+* @param :keys_len : number of keys
+* @retval : number of unique keys
+*
+*/
+static uint16_t check_keys_unique(mf1_key_t *keys, uint16_t keys_len) {
+    static uint16_t slots[CHECK_KEYS_HASH_SLOTS]; // index + 1 of a unique key, 0 when free
+    uint16_t unique = 0;
+
+    memset(slots, 0, sizeof(slots));
+    for (uint16_t i = 0; i < keys_len; i++) {
+        uint64_t key = bytes_to_num(keys[i].key, 6);
+        uint16_t slot = (key * 0x9E3779B97F4A7C15ULL) >> (64 - CHECK_KEYS_HASH_BITS);
+        while (slots[slot] && memcmp(&keys[slots[slot] - 1], &keys[i], sizeof(mf1_key_t)) != 0) {
+            slot = (slot + 1) & (CHECK_KEYS_HASH_SLOTS - 1);
+        }
+        if (slots[slot]) continue;
+        keys[unique] = keys[i];
+        slots[slot] = ++unique;
+    }
+    return unique;
+}
+
+/**
+* @brief : Move a key which just hit in front of the keys which did not hit yet,
+*          the keys of a card are often shared between its sectors.
+* @param :keys : keys, hits first
+* @param :hits : number of keys in front which already hit
+* @param :index : index of the key which hit
+* @retval : number of keys in front which already hit
+*
+*/
+static uint16_t check_keys_promote(mf1_key_t *keys, uint16_t hits, uint16_t index) {
+    if (index < hits) return hits;
+    mf1_key_t key = keys[index];
+    memmove(&keys[hits + 1], &keys[hits], (index - hits) * sizeof(mf1_key_t));
+    keys[hits] = key;
+    return hits + 1;
+}
+
+/**
+* @brief : Authenticate with a key of the check or of the sectors read, the tag is selected again the cheapest way:
+*          scanned once, then fast selected with its known uid. It is idle after a failed authentication or a
+*          refused read and halted after a successful one, all answer the WUPA. The field is restarted only when it does not.
+* @param :block : block of the sector
+* @param :type : PICC_AUTHENT1A or PICC_AUTHENT1B
+* @param :key : key to try
+* @param :scanned : whether the tag was scanned already
+* @retval : STATUS_HF_TAG_OK, STATUS_MF_ERR_AUTH or STATUS_HF_TAG_NO
+*
+*/
+static uint16_t check_keys_auth(uint8_t block, uint8_t type, uint8_t *key, bool *scanned) {
+    mf1_toolbox_report_healthy();
+    if (*scanned && pcd_14a_reader_fast_select(p_tag_info) != STATUS_HF_TAG_OK) {
+        mf1_toolbox_antenna_restart();
+        *scanned = false;
+    }
+    if (!*scanned) {
+        if (pcd_14a_reader_scan_auto(p_tag_info) != STATUS_HF_TAG_OK) return STATUS_HF_TAG_NO;
+        *scanned = true;
+    }
+    return pcd_14a_reader_mf1_auth(p_tag_info, type, block, key);
+}
+
+// leave a successful authentication, the tag wakes up again on the next fast select
+static void check_keys_leave(void) {
+    pcd_14a_reader_halt_tag();
+    pcd_14a_reader_mf1_unauth();
+}
+
+static uint16_t check_keys_of_sectors_run(
     mf1_toolbox_check_keys_of_sectors_in_t *in,
     mf1_toolbox_check_keys_of_sectors_out_t *out
 ) {
-    memset(out, 0, sizeof(mf1_toolbox_check_keys_of_sectors_out_t));
     uint8_t trailer[18] = {}; // trailer 16 bytes + padding 2 bytes
+    mf1_toolbox_check_keys_hit_t hits[2];
+    uint8_t hits_count, maskSector, maskShift, trailerNo;
+    uint16_t i, j, promoted = 0;
+    uint16_t status;
+    bool scanned = false;
 
-    // keys unique
-    uint8_t i, j, maskSector, maskShift, trailerNo;
-    for (i = 0; i < in->keys_len; i++) {
-        for (j = i + 1; j < in->keys_len; j++) {
-            if (memcmp(&in->keys[i], &in->keys[j], sizeof(mf1_key_t)) != 0) continue;
-
-            // key duplicated, replace with last key
-            if (j != in->keys_len - 1) in->keys[j] = in->keys[in->keys_len - 1];
-            in->keys_len--;
-            j--;
-        }
-    }
-
-    uint16_t status = STATUS_HF_TAG_OK;
-    bool skipKeyB;
     for (i = 0; i < 40; i++) {
         maskShift = 6 - i % 4 * 2;
         maskSector = (in->mask.b[i / 4] >> maskShift) & 0b11;
         trailerNo = i < 32 ? i * 4 + 3 : i * 16 - 369; // trailerNo of sector
-        skipKeyB = (maskSector & 0b1) > 0;
+        hits_count = 0;
+
         if ((maskSector & 0b10) == 0) {
             for (j = 0; j < in->keys_len; j++) {
-                mf1_toolbox_report_healthy();
-                if (status != STATUS_HF_TAG_OK) mf1_toolbox_antenna_restart();
-
-                status = auth_key_use_522_hw(trailerNo, PICC_AUTHENT1A, in->keys[j].key);
-                if (status != STATUS_HF_TAG_OK) { // auth failed
-                    if (status == STATUS_HF_TAG_NO) return STATUS_HF_TAG_NO;
-                    continue;
-                }
+                status = check_keys_auth(trailerNo, PICC_AUTHENT1A, in->keys[j].key, &scanned);
+                if (status == STATUS_HF_TAG_NO) return STATUS_HF_TAG_NO;
+                if (status != STATUS_HF_TAG_OK) continue;
                 // key A found
                 out->found.b[i / 4] |= 0b10 << maskShift;
                 out->keys[i][0] = in->keys[j];
+                hits[hits_count++] = (mf1_toolbox_check_keys_hit_t) { i, PICC_AUTHENT1A, in->keys[j] };
+                promoted = check_keys_promote(in->keys, promoted, j);
                 // try to read keyB from trailer of sector
                 status = pcd_14a_reader_mf1_read(trailerNo, trailer);
+                check_keys_leave();
                 // key B not in trailer
                 if (status != STATUS_HF_TAG_OK || 0 == *(uint64_t *) &trailer[10]) break;
                 // key B found
-                skipKeyB = true;
+                maskSector |= 0b1;
                 out->found.b[i / 4] |= 0b1 << maskShift;
-                out->keys[i][1] = *(mf1_key_t*)&trailer[10];
+                out->keys[i][1] = *(mf1_key_t *) &trailer[10];
+                hits[hits_count++] = (mf1_toolbox_check_keys_hit_t) { i, PICC_AUTHENT1B, out->keys[i][1] };
                 break;
             }
         }
-        if (skipKeyB) continue;
 
-        for (j = 0; j < in->keys_len; j++) {
-            mf1_toolbox_report_healthy();
-            if (status != STATUS_HF_TAG_OK) mf1_toolbox_antenna_restart();
+        if ((maskSector & 0b1) == 0) {
+            for (j = 0; j < in->keys_len; j++) {
+                status = check_keys_auth(trailerNo, PICC_AUTHENT1B, in->keys[j].key, &scanned);
+                if (status == STATUS_HF_TAG_NO) return STATUS_HF_TAG_NO;
+                if (status != STATUS_HF_TAG_OK) continue;
+                // key B found
+                check_keys_leave();
+                out->found.b[i / 4] |= 0b1 << maskShift;
+                out->keys[i][1] = in->keys[j];
+                hits[hits_count++] = (mf1_toolbox_check_keys_hit_t) { i, PICC_AUTHENT1B, in->keys[j] };
+                promoted = check_keys_promote(in->keys, promoted, j);
+                break;
+            }
+        }
+
+        if (hits_count && in->on_hits) in->on_hits(hits, hits_count);
+    }
+    return STATUS_HF_TAG_OK;
+}
+
+/**
+* @brief : Check keys on the trailers of several sectors.
+*          The keys are deduplicated, those which hit are tried first on the next sectors,
+*          key B is read from the trailer when key A allows it.
+* @param :in : sectors mask, the keys and the optional callback of the hits of each sector
+* @param :out : keys found
+* @retval : STATUS_HF_TAG_OK, or STATUS_HF_TAG_NO if the tag is lost
+*
+*/
+uint16_t mf1_toolbox_check_keys_of_sectors(
+    mf1_toolbox_check_keys_of_sectors_in_t *in,
+    mf1_toolbox_check_keys_of_sectors_out_t *out
+) {
+    uint16_t timeout_ms = pcd_14a_reader_timeout_get();
+    uint16_t status;
+
+    memset(out, 0, sizeof(mf1_toolbox_check_keys_of_sectors_out_t));
+    in->keys_len = check_keys_unique(in->keys, in->keys_len);
+    pcd_14a_reader_timeout_set(timeout_ms < CHECK_KEYS_AUTH_TIMEOUT_MS ? timeout_ms : CHECK_KEYS_AUTH_TIMEOUT_MS);
+    status = check_keys_of_sectors_run(in, out);
+    pcd_14a_reader_timeout_set(timeout_ms);
+    return status;
+}
+
+/**
+* @brief : Read all the blocks of several sectors with known keys.
+*          The tag is authenticated once per sector and key instead of once per block,
+*          key A is used first and the blocks it can not read are tried again with key B.
+* @param :in : sectors mask and the keys of the selected sectors
+* @param :out : one record per block of the selected sectors, in sector order, 256 records at most
+* @param :out_len : number of records written
+* @retval : STATUS_HF_TAG_OK, or STATUS_HF_TAG_NO if the tag is lost. The status of each block is in its record.
+*
+*/
+uint16_t mf1_toolbox_read_sectors(
+    mf1_toolbox_read_sectors_in_t *in,
+    mf1_toolbox_read_sectors_block_t *out,
+    uint16_t *out_len
+) {
+    uint8_t block[18] = {}; // block 16 bytes + crc 2 bytes
+    uint8_t i, j, k, maskSector, maskShift, firstBlock, blockCount, keysIdx = 0;
+    mf1_toolbox_read_sectors_block_t *records;
+    uint16_t status = STATUS_HF_TAG_OK;
+    bool authenticated = false;
+    bool scanned = false;
 
-            status = auth_key_use_522_hw(trailerNo, PICC_AUTHENT1B, in->keys[j].key);
-            if (status != STATUS_HF_TAG_OK) { // auth failed
+    *out_len = 0;
+    for (i = 0; i < 40; i++) {
+        maskShift = 6 - i % 4 * 2;
+        maskSector = (in->mask.b[i / 4] >> maskShift) & 0b11;
+        if (maskSector == 0) continue;
+        if (keysIdx >= in->keys_len) return STATUS_PAR_ERR;
+
+        firstBlock = i < 32 ? i * 4 : i * 16 - 384;
+        blockCount = i < 32 ? 4 : 16;
+        records = &out[*out_len];
+        *out_len += blockCount;
+        for (j = 0; j < blockCount; j++) {
+            records[j].status = STATUS_MF_ERR_AUTH;
+            memset(records[j].data, 0, sizeof(records[j].data));
+        }
+
+        for (k = 0; k < 2; k++) {
+            if ((maskSector & (0b10 >> k)) == 0) continue;
+            uint8_t keyType = k == 0 ? PICC_AUTHENT1A : PICC_AUTHENT1B;
+            uint8_t *key = k == 0 ? in->keys[keysIdx].key_a.key : in->keys[keysIdx].key_b.key;
+
+            j = 0;
+            while (j < blockCount) {
+                if (records[j].status == STATUS_HF_TAG_OK) {
+                    j++;
+                    continue;
+                }
+                if (authenticated) {
+                    check_keys_leave();
+                }
+                authenticated = false;
+
+                // fast selected again as the check keys do it, the field is restarted only when the tag does not answer
+                status = check_keys_auth(firstBlock + j, keyType, key, &scanned);
                 if (status == STATUS_HF_TAG_NO) return STATUS_HF_TAG_NO;
-                continue;
+                if (status != STATUS_HF_TAG_OK) break;
+                authenticated = true;
+
+                for (; j < blockCount; j++) {
+                    if (records[j].status == STATUS_HF_TAG_OK) continue;
+                    status = pcd_14a_reader_mf1_read(firstBlock + j, block);
+                    records[j].status = status;
+                    if (status != STATUS_HF_TAG_OK) {
+                        // the tag is idle after a refused read, no halt needed before it is selected again
+                        pcd_14a_reader_mf1_unauth();
+                        authenticated = false;
+                        j++;
+                        break;
+                    }
+                    memcpy(records[j].data, block, sizeof(records[j].data));
+                }
             }
-            // key B found
-            out->found.b[i / 4] |= 0b1 << maskShift;
-            out->keys[i][1] = in->keys[j];
-            break;
         }
+        keysIdx++;
     }
+    if (keysIdx != in->keys_len) return STATUS_PAR_ERR;
 
     return STATUS_HF_TAG_OK;
 }
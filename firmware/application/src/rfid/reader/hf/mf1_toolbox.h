@@ -65,10 +65,23 @@ typedef struct {
     uint8_t b[10]; // 80 bits: 40 sectors * 2 keys
 } PACKED mf1_toolbox_check_keys_of_sectors_mask_t;
 
+// as many keys as one frame can carry after the mask
+#define MF1_TOOLBOX_CHECK_KEYS_MAX ((NETDATA_MAX_DATA_LENGTH - sizeof(mf1_toolbox_check_keys_of_sectors_mask_t)) / sizeof(mf1_key_t))
+
+typedef struct {
+    uint8_t sector;
+    uint8_t key_type; // PICC_AUTHENT1A or PICC_AUTHENT1B
+    mf1_key_t key;
+} PACKED mf1_toolbox_check_keys_hit_t;
+
+// keys found in a sector, reported as soon as the sector is done
+typedef void (*mf1_toolbox_check_keys_on_hits_t)(mf1_toolbox_check_keys_hit_t *hits, uint8_t count);
+
 typedef struct {
     mf1_toolbox_check_keys_of_sectors_mask_t mask;
-    uint8_t keys_len;
-    mf1_key_t *keys;
+    uint16_t keys_len;
+    mf1_key_t *keys; // deduplicated and reordered in place
+    mf1_toolbox_check_keys_on_hits_t on_hits; // optional
 } mf1_toolbox_check_keys_of_sectors_in_t;
 
 typedef struct {
@@ -88,6 +101,26 @@ typedef struct {
     mf1_key_t key;
 } PACKED mf1_toolbox_check_keys_on_block_out_t;
 
+typedef struct {
+    uint8_t b[10]; // 80 bits: 40 sectors * 2 bits, 0b10 key A known, 0b01 key B known, 0b00 sector skipped
+} PACKED mf1_toolbox_read_sectors_mask_t;
+
+typedef struct {
+    mf1_key_t key_a;
+    mf1_key_t key_b;
+} PACKED mf1_toolbox_read_sectors_keys_t;
+
+typedef struct {
+    mf1_toolbox_read_sectors_mask_t mask;
+    uint16_t keys_len;
+    mf1_toolbox_read_sectors_keys_t *keys; // one entry per sector selected in mask
+} mf1_toolbox_read_sectors_in_t;
+
+typedef struct {
+    uint8_t status;
+    uint8_t data[16];
+} PACKED mf1_toolbox_read_sectors_block_t;
+
 typedef struct {
     uint8_t nt_first_half[2];
     uint8_t nt_par_err;
@@ -146,6 +179,12 @@ uint16_t mf1_toolbox_check_keys_on_block(
     mf1_toolbox_check_keys_on_block_out_t *out
 );
 
+uint16_t mf1_toolbox_read_sectors(
+    mf1_toolbox_read_sectors_in_t *in,
+    mf1_toolbox_read_sectors_block_t *out,
+    uint16_t *out_len
+);
+
 uint8_t mf1_hardnested_nonces_acquire(bool slow, uint8_t blkKnown, uint8_t typKnown, uint64_t keyKnown,
                                       uint8_t targetBlk, uint8_t targetTyp, uint8_t *nonces, uint16_t noncesMax, uint8_t *num_nonces);
 
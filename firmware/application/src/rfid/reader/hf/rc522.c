@@ -2,12 +2,16 @@
 #include <stdbool.h>
 #include <nrf_gpio.h>
 
-#include "nrf_drv_spi.h"
+#include "nrf_spim.h"
 #include "nrf_gpio.h"
+#include "nrfx_gpiote.h"
+#include "nrf_soc.h"
 #include "app_error.h"
 
 #include "rfid_main.h"
 #include "rc522.h"
+#include "rc522_spi.h"
+#include "rc522_wait.h"
 #include "bsp_delay.h"
 #include "bsp_time.h"
 #include "app_status.h"
@@ -35,57 +39,104 @@ static bool m_reader_is_init = false;
 static uint16_t g_com_timeout_ms = DEF_COM_TIMEOUT;
 static autotimer *g_timeout_auto_timer;
 
-// RC522 SPI
-#define SPI_INSTANCE  0 /**< SPI instance index. */
-static const nrf_drv_spi_t s_spiHandle = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);    // SPI instance
+// RC522 SPI, the SPIM0 EasyDMA sends a whole register session from RAM
+#define RC522_SPIM NRF_SPIM0
+
+// Register program of the running command
+static rc522_program_t m_program;
+
+// End of the running command, signalled by the IRQ pin of the RC522 when the board routes it
+static rc522_wait_t m_wait;
+static bool m_irq_mode = false;
+// Interrupt enables last written to ComIEnReg and DivlEnReg, 0 when unknown
+static uint8_t m_com_irq_enable;
+static uint8_t m_div_irq_enable;
+
+// CalcCRC of a full FIFO takes about 40us, the timeout only guards against a lost RC522. The timer counts whole ticks
+// of BSP_TIMER_TICK_MS and the first may come at once: the wait gives up between one and two ticks after the start.
+#define RC522_CRC_TIMEOUT_TICKS 1
 
 #define ONCE_OPT __attribute__((optimize("O3")))
 
 /**
-* @brief  :Read register
-* @param  :Address:Register address
-* @retval :Value in the register
+* @brief  : One SPI session with the RC522, chip select held low for the whole transfer
+* @param  : tx: bytes to send, in RAM
+*           rx: received bytes, as many as sent
 */
-uint8_t read_register_single(uint8_t Address) {
+static void ONCE_OPT rc522_spim_xfer(const uint8_t *tx, uint8_t *rx, uint16_t length) {
     RC522_DOSEL;
-
-    Address = (uint8_t)(((Address << 1) & 0x7E) | 0x80);
-
-    NRF_SPI0->TXD = Address;
-    while (NRF_SPI0->EVENTS_READY == 0);
-    NRF_SPI0->EVENTS_READY = 0;
-    (void)NRF_SPI0->RXD;
-
-    NRF_SPI0->TXD = Address;
-    while (NRF_SPI0->EVENTS_READY == 0);
-    NRF_SPI0->EVENTS_READY = 0;
-    Address = NRF_SPI0->RXD;
-
+    nrf_spim_tx_buffer_set(RC522_SPIM, tx, length);
+    nrf_spim_rx_buffer_set(RC522_SPIM, rx, length);
+    nrf_spim_event_clear(RC522_SPIM, NRF_SPIM_EVENT_END);
+    nrf_spim_task_trigger(RC522_SPIM, NRF_SPIM_TASK_START);
+    while (!nrf_spim_event_check(RC522_SPIM, NRF_SPIM_EVENT_END));
     RC522_UNSEL;
-
-    return Address;
 }
 
-void read_register_buffer(uint8_t Address, uint8_t *pInBuffer, uint8_t len) {
-    RC522_DOSEL;
+#if HW_HF_RC522_IRQ_ROUTED
+/**
+* @brief  : Falling edge of the RC522 IRQ pin: an enabled interrupt request of the RC522 is set
+*/
+static void rc522_irq_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
+    rc522_wait_irq(&m_wait);
+}
+#endif
 
-    Address = (((Address << 1) & 0x7E) | 0x80);
+/**
+* @brief  : Queue the interrupt enables of the next command, only the requests it waits for drive the IRQ pin,
+*           otherwise a request left set by the previous command holds the pin low and the edge never comes.
+*           Skipped when polling, or when the enables are already written.
+*/
+static void rc522_program_irq_enable(rc522_program_t *program, uint8_t com_irq, uint8_t div_irq) {
+    if (!m_irq_mode) {
+        return;
+    }
+    // IRqInv: the pin is low while a request is set, IRQPushPull: no pull-up needed on the board
+    if (m_com_irq_enable != (0x80 | com_irq)) {
+        m_com_irq_enable = 0x80 | com_irq;
+        rc522_program_write(program, ComIEnReg, m_com_irq_enable);
+    }
+    if (m_div_irq_enable != (0x80 | div_irq)) {
+        m_div_irq_enable = 0x80 | div_irq;
+        rc522_program_write(program, DivlEnReg, m_div_irq_enable);
+    }
+}
 
-    NRF_SPI0->TXD = Address;
-    while (NRF_SPI0->EVENTS_READY == 0);    // Waiting for transmission ends
-    NRF_SPI0->EVENTS_READY = 0;
-    (void)NRF_SPI0->RXD;    //Read once and give a level
+/**
+* @brief  : Wait for the end of the command armed with rc522_wait_start(),
+*           the CPU sleeps until the IRQ pin or the next tick of the timeout timer when the pin is routed
+* @retval : RC522_WAIT_DONE or RC522_WAIT_TIMEOUT, the last value read is in m_wait.flags
+*/
+static rc522_wait_state_t rc522_wait(void) {
+    rc522_wait_state_t state;
+    while ((state = rc522_wait_step(&m_wait, g_timeout_auto_timer->time, read_register_single)) == RC522_WAIT_BUSY) {
+#if HW_HF_RC522_IRQ_ROUTED
+        if (m_irq_mode) {
+            // An edge between the step and here sets the event register, the wait then returns at once
+            sd_app_evt_wait();
+        }
+#endif
+    }
+    return state;
+}
 
-    uint8_t i = 0;
-    do {
-        //Then start receiving data
-        NRF_SPI0->TXD = Address;
-        while (NRF_SPI0->EVENTS_READY == 0);    //Waiting for transmission
-        NRF_SPI0->EVENTS_READY = 0;
-        pInBuffer[i] = NRF_SPI0->RXD;    // Read once and give a level
-    } while (++i < len);
+/**
+* @brief  :Read register
+* @param  :Address:Register address
+* @retval :Value in the register
+*/
+uint8_t read_register_single(uint8_t Address) {
+    uint8_t tx[2] = { (((Address << 1) & 0x7E) | 0x80), 0x00 };
+    uint8_t rx[2];
+    rc522_spim_xfer(tx, rx, sizeof(tx));
+    return rx[1];
+}
 
-    RC522_UNSEL;
+void read_register_buffer(uint8_t Address, uint8_t *pInBuffer, uint8_t len) {
+    rc522_program_init(&m_program);
+    uint16_t index = rc522_program_read_buffer(&m_program, Address, len);
+    rc522_program_run(&m_program, rc522_spim_xfer);
+    memcpy(pInBuffer, &m_program.rx[index], len);
 }
 
 /**
@@ -94,45 +145,16 @@ void read_register_buffer(uint8_t Address, uint8_t *pInBuffer, uint8_t len) {
 *           value: The value to be written
 */
 void ONCE_OPT write_register_single(uint8_t Address, uint8_t value) {
-    RC522_DOSEL;
-
-    Address = ((Address << 1) & 0x7E);
-
-    // First pass the address first pass the address
-    NRF_SPI0->TXD = Address;
-    while (NRF_SPI0->EVENTS_READY == 0);
-    NRF_SPI0->EVENTS_READY = 0;
-    (void)NRF_SPI0->RXD;
-
-    //  Passing address
-    NRF_SPI0->TXD = value;
-    while (NRF_SPI0->EVENTS_READY == 0);
-    NRF_SPI0->EVENTS_READY = 0;
-    (void)NRF_SPI0->RXD;
-
-    RC522_UNSEL;
+    uint8_t tx[2] = { ((Address << 1) & 0x7E), value };
+    uint8_t rx[2];
+    rc522_spim_xfer(tx, rx, sizeof(tx));
 }
 
 void write_register_buffer(uint8_t Address, uint8_t *values, uint8_t len) {
-    RC522_DOSEL;
-
-    Address = ((Address << 1) & 0x7E);
-
-    NRF_SPI0->TXD = Address;
-    while (NRF_SPI0->EVENTS_READY == 0);
-    NRF_SPI0->EVENTS_READY = 0;
-    (void)NRF_SPI0->RXD;
-
-    uint8_t i = 0;
-    do {
-        // Passing address
-        NRF_SPI0->TXD = values[i];
-        while (NRF_SPI0->EVENTS_READY == 0);
-        NRF_SPI0->EVENTS_READY = 0;
-        (void)NRF_SPI0->RXD;
-    } while (++i < len);
-
-    RC522_UNSEL;
+    // copied to the program, EasyDMA cannot read a buffer in flash
+    rc522_program_init(&m_program);
+    rc522_program_write_buffer(&m_program, Address, values, len);
+    rc522_program_run(&m_program, rc522_spim_xfer);
 }
 
 /**
@@ -166,19 +188,30 @@ void pcd_14a_reader_init(void) {
         // Initialize NSS foot GPIO
         nrf_gpio_cfg_output(HF_SPI_SELECT);
 
-        // Initialize SPI
-        ret_code_t errCode;
-
-        nrf_drv_spi_config_t spiConfig = NRF_DRV_SPI_DEFAULT_CONFIG;                // Use SPI default configuration
-        // Configure the SPI port, pay attention not to set the CSN here, and use the GPIO port control
-        spiConfig.miso_pin = HF_SPI_MISO;
-        spiConfig.mosi_pin = HF_SPI_MOSI;
-        spiConfig.sck_pin = HF_SPI_SCK;
-        spiConfig.mode = NRF_DRV_SPI_MODE_0;
-        spiConfig.frequency = NRF_DRV_SPI_FREQ_8M;
-        // Configure to block operation
-        errCode = nrf_drv_spi_init(&s_spiHandle, &spiConfig, NULL, NULL);
-        APP_ERROR_CHECK(errCode);
+        // Initialize SPIM, mode 0 at 8 Mbps, the CSN is controlled by GPIO
+        nrf_gpio_pin_clear(HF_SPI_SCK);
+        nrf_gpio_cfg_output(HF_SPI_SCK);
+        nrf_gpio_pin_clear(HF_SPI_MOSI);
+        nrf_gpio_cfg_output(HF_SPI_MOSI);
+        nrf_gpio_cfg_input(HF_SPI_MISO, NRF_GPIO_PIN_NOPULL);
+        nrf_spim_pins_set(RC522_SPIM, HF_SPI_SCK, HF_SPI_MOSI, HF_SPI_MISO);
+        nrf_spim_frequency_set(RC522_SPIM, NRF_SPIM_FREQ_8M);
+        nrf_spim_configure(RC522_SPIM, NRF_SPIM_MODE_0, NRF_SPIM_BIT_ORDER_MSB_FIRST);
+        nrf_spim_orc_set(RC522_SPIM, 0x00);
+        nrf_spim_enable(RC522_SPIM);
+
+        // IRQ pin, if routed: the end of the commands is signalled instead of polled
+        m_irq_mode = false;
+#if HW_HF_RC522_IRQ_ROUTED
+        if (HF_RC522_IRQ != HW_PIN_NOT_CONNECTED) {
+            nrfx_gpiote_in_config_t cfg = NRFX_GPIOTE_CONFIG_IN_SENSE_HITOLO(false);
+            cfg.pull = NRF_GPIO_PIN_PULLUP;
+            ret_code_t err_code = nrfx_gpiote_in_init(HF_RC522_IRQ, &cfg, rc522_irq_handler);
+            APP_ERROR_CHECK(err_code);
+            nrfx_gpiote_in_event_enable(HF_RC522_IRQ, true);
+            m_irq_mode = true;
+        }
+#endif
 
         // Initialized timer
         // This timer is not released after the initialization of the timer, and it always needs to take up
@@ -203,6 +236,10 @@ void pcd_14a_reader_reset(void) {
         // Please don't continue to make high -frequency antennas
         pcd_14a_reader_antenna_off();
 
+        // The soft reset restored the interrupt enables, written again by the next command
+        m_com_irq_enable = 0;
+        m_div_irq_enable = 0;
+
         // Disable the timer of 522, use the MCU timer timeout time
         write_register_single(TModeReg, 0x00);
 
@@ -224,7 +261,13 @@ void pcd_14a_reader_uninit(void) {
     if (m_reader_is_init) {
         m_reader_is_init = false;
         bsp_return_timer(g_timeout_auto_timer);
-        nrf_drv_spi_uninit(&s_spiHandle);
+        nrf_spim_disable(RC522_SPIM);
+#if HW_HF_RC522_IRQ_ROUTED
+        if (m_irq_mode) {
+            nrfx_gpiote_in_uninit(HF_RC522_IRQ);
+            m_irq_mode = false;
+        }
+#endif
     }
 }
 
@@ -254,15 +297,18 @@ uint16_t pcd_14a_reader_timeout_get() {
 *          Inlenbyte: The byte length of sending the data
 *          POUT: The receiving card returns the data
 *          POUTLENBIT: Bit the length of the data
+*          FLAGS:
+*            - PCD_TRANSMIT_FLAG_NO_RESET_MF_CRYPTO1_ON: Do not reset MFCrypto1On
+*          TXLASTBITS: Bits of the last byte to send, 0 for the whole byte
 * @retval : Status value mi_ok, successful
 */
-uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InLenByte, uint8_t *pOut, uint16_t *pOutLenBit, uint16_t maxOutLenBit) {
+static uint8_t pcd_14a_reader_transfer(uint8_t Command, uint8_t *pIn, uint8_t InLenByte, uint8_t *pOut, uint16_t *pOutLenBit, uint16_t maxOutLenBit, uint32_t flags, uint8_t txLastBits) {
     uint8_t status      = STATUS_HF_ERR_STAT;
     uint8_t waitFor     = 0x00;
     uint8_t lastBits    = 0;
     uint8_t n           = 0;
     uint8_t pcd_err_val = 0;
-    uint8_t not_timeout = 0;
+    bool not_timeout    = false;
 
     switch (Command) {
         case PCD_AUTHENT:                       //  MiFare certification
@@ -274,16 +320,14 @@ uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InL
             break;
     }
 
-    write_register_single(CommandReg,       PCD_IDLE);      //  Flushbuffer clearing the internal FIFO read and writing pointer and ErRreg's Bufferovfl logo position is cleared
-    clear_register_mask(ComIrqReg,      0x80);          //  When Set1 is cleared, the shielding position of commonricqreg is clear zero
-    set_register_mask(FIFOLevelReg,     0x80);          //  Write an empty order
-
-    write_register_buffer(FIFODataReg, pIn, InLenByte); // Write data into FIFODATA
-    write_register_single(CommandReg, Command);             // Write command
-
-    if (Command == PCD_TRANSCEIVE) {
-        set_register_mask(BitFramingReg, 0x80);     // StartSend places to start the data to send this bit and send and receive commands when it is valid
-    }
+    // Stop the previous command, clear the interrupts, flush and fill the FIFO, start the command (StartSend): one program
+    rc522_program_init(&m_program);
+    rc522_program_irq_enable(&m_program, waitFor, 0x00);
+    rc522_program_command_start(&m_program, Command, pIn, InLenByte, txLastBits);
+    // Armed before the start, the end of a short command may come before the program returns
+    rc522_wait_start(&m_wait, ComIrqReg, waitFor, g_com_timeout_ms, m_irq_mode && pOut != NULL);
+    bsp_set_timer(g_timeout_auto_timer, 0);         // Before starting the operation, return to zero over time counting
+    rc522_program_run(&m_program, rc522_spim_xfer);
 
     if (pOut == NULL) {
         // If the developer does not need to receive data, then return directly after the sending!
@@ -293,17 +337,15 @@ uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InL
     // Reset the length of the received data
     *pOutLenBit         = 0;
 
-    bsp_set_timer(g_timeout_auto_timer, 0);         // Before starting the operation, return to zero over time counting
-
-    do {
-        n = read_register_single(ComIrqReg);                // Read the communication interrupt register to determine whether the current IO task is completed!
-        not_timeout = NO_TIMEOUT_1MS(g_timeout_auto_timer, g_com_timeout_ms);
-    } while (not_timeout && (!(n & waitFor)));  // Exit conditions: timeout interruption, interrupt with empty command commands
+    // Exit conditions: timeout interruption, interrupt with empty command commands
+    not_timeout = rc522_wait() == RC522_WAIT_DONE;
+    n = m_wait.flags;                               // The communication interrupt register, read when the IO task completed
     // NRF_LOG_INFO("N = %02x\n", n);
 
-    if (Command == PCD_TRANSCEIVE) {
-        clear_register_mask(BitFramingReg, 0x80);       // Clean up allows the startsend bit and the bit length position
-    }
+    // Clean up the startsend bit and the bit length position, read ErrorReg, FIFOLevelReg and Control522Reg at once
+    rc522_program_init(&m_program);
+    uint16_t result = rc522_program_command_end(&m_program, Command);
+    rc522_program_run(&m_program, rc522_spim_xfer);
 
     // Whether to receive timeout
     if (not_timeout) {
@@ -311,7 +353,7 @@ uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InL
         if (n & 0x02) {
             // Error occur
             // Read an error logo register BufferOfI CollErr ParityErr ProtocolErr
-            pcd_err_val = read_register_single(ErrorReg);
+            pcd_err_val = m_program.rx[result];
             // Detect whether there are abnormalities
             if (pcd_err_val & 0x01) {               // ProtocolErr Error only appears in the following two cases:
                 if (Command == PCD_AUTHENT) {       // During the execution of the MFAUTHENT command, if the number of bytes received by a data stream, the position of the place
@@ -339,10 +381,10 @@ uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InL
             // Occasionally occur
             // NRF_LOG_INFO("COM OK\n");
             if (Command == PCD_TRANSCEIVE) {
-                n = read_register_single(FIFOLevelReg);                             // Read the number of bytes saved in FIFO
+                n = m_program.rx[result + 1];                                       // The number of bytes saved in FIFO
                 if (n == 0) { n = 1; }
 
-                lastBits = read_register_single(Control522Reg) & 0x07;          // Finally receive the validity of the byte
+                lastBits = m_program.rx[result + 2] & 0x07;                     // Finally receive the validity of the byte
 
                 if (lastBits) { *pOutLenBit = (n - 1) * 8 + lastBits; } // N -byte number minus 1 (last byte)+ the number of bits of the last bit The total number of data readings read
                 else { *pOutLenBit = n * 8; }                           // Finally received the entire bytes received by the byte valid
@@ -369,7 +411,7 @@ uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InL
         // NRF_LOG_INFO("Tag lost(timeout).\n");
     }
 
-    if (status != STATUS_HF_TAG_OK) {
+    if ((flags & PCD_TRANSMIT_FLAG_NO_RESET_MF_CRYPTO1_ON) == 0 && status != STATUS_HF_TAG_OK) {
         // If there are certain operations,
         // We may need to remove MFCrypto1On This register logo,
         // Because it may be because of the error encryption communication caused by verification
@@ -380,6 +422,34 @@ uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InL
     return status;
 }
 
+/**
+* @brief  : Through RC522 and ISO14443 cartoon communication
+* @param  : Command: RC522 command word
+*          PIN: Data sent to the card through RC522
+*          Inlenbyte: The byte length of sending the data
+*          POUT: The receiving card returns the data
+*          POUTLENBIT: Bit the length of the data
+* @retval : Status value mi_ok, successful
+*/
+uint8_t pcd_14a_reader_bytes_transfer(uint8_t Command, uint8_t *pIn, uint8_t InLenByte, uint8_t *pOut, uint16_t *pOutLenBit, uint16_t maxOutLenBit) {
+    return pcd_14a_reader_transfer(Command, pIn, InLenByte, pOut, pOutLenBit, maxOutLenBit, 0, 0);
+}
+
+/**
+* @brief  : Through RC522 and ISO14443 cartoon communication
+* @param  : Command: RC522 command word
+*          PIN: Data sent to the card through RC522
+*          Inlenbyte: The byte length of sending the data
+*          POUT: The receiving card returns the data
+*          POUTLENBIT: Bit the length of the data
+*          FLAGS:
+*            - PCD_TRANSMIT_FLAG_NO_RESET_MF_CRYPTO1_ON: Do not reset MFCrypto1On
+* @retval : Status value mi_ok, successful
+*/
+uint8_t pcd_14a_reader_bytes_transfer_flags(uint8_t Command, uint8_t *pIn, uint8_t InLenByte, uint8_t *pOut, uint16_t *pOutLenBit, uint16_t maxOutLenBit, uint32_t flags) {
+    return pcd_14a_reader_transfer(Command, pIn, InLenByte, pOut, pOutLenBit, maxOutLenBit, flags, 0);
+}
+
 /**
 * @brief  : Through RC522 and ISO14443 cartoon communication
 * @param
@@ -429,19 +499,19 @@ uint8_t pcd_14a_reader_bits_transfer(uint8_t *pTx, uint16_t  szTxBits, uint8_t *
         modulus = szTxBits;
     }
 
-    set_register_mask(BitFramingReg, modulus);  // Set the last byte transmission n bit
     set_register_mask(MfRxReg, 0x10);  // Need to close the puppet school test to enable
 
-    status = pcd_14a_reader_bytes_transfer(
+    status = pcd_14a_reader_transfer(
                  PCD_TRANSCEIVE,
                  buffer,
                  dataLen,                // Data byte count
                  buffer,                 // Receiving buffer
                  pRxLenBit,              // The length of the received data, note that it is the length of the special stream
-                 U8ARR_BIT_LEN(buffer)   // The upper limit of the data that can be collected
+                 U8ARR_BIT_LEN(buffer),  // The upper limit of the data that can be collected
+                 0,
+                 modulus                 // The last byte transmission n bit, cleared with StartSend
              );
 
-    clear_register_mask(BitFramingReg, modulus);
     clear_register_mask(MfRxReg, 0x10);  // Enable Qiqi school inspection
 
     // Simply judge the length of data transmission
@@ -482,141 +552,6 @@ uint8_t pcd_14a_reader_bits_transfer(uint8_t *pTx, uint16_t  szTxBits, uint8_t *
     return STATUS_HF_TAG_OK;
 }
 
-/**
-* @brief  : Through RC522 and ISO14443 cartoon communication
-* @param  : Command: RC522 command word
-*          PIN: Data sent to the card through RC522
-*          Inlenbyte: The byte length of sending the data
-*          POUT: The receiving card returns the data
-*          POUTLENBIT: Bit the length of the data
-*          FLAGS:
-*            - PCD_TRANSMIT_FLAG_NO_RESET_MF_CRYPTO1_ON: Do not reset MFCrypto1On
-* @retval : Status value mi_ok, successful
-*/
-uint8_t pcd_14a_reader_bytes_transfer_flags(uint8_t Command, uint8_t *pIn, uint8_t InLenByte, uint8_t *pOut, uint16_t *pOutLenBit, uint16_t maxOutLenBit, uint32_t flags) {
-    uint8_t status      = STATUS_HF_ERR_STAT;
-    uint8_t waitFor     = 0x00;
-    uint8_t lastBits    = 0;
-    uint8_t n           = 0;
-    uint8_t pcd_err_val = 0;
-    uint8_t not_timeout = 0;
-
-    switch (Command) {
-        case PCD_AUTHENT:                       //  MiFare certification
-            waitFor = 0x10;                     //  Query the free interrupt logo when the certification card is waiting
-            break;
-
-        case PCD_TRANSCEIVE:
-            waitFor = 0x30;                     //  Inquiry the receiving interrupt logo position and Leisure interrupt logo
-            break;
-    }
-
-    write_register_single(CommandReg,       PCD_IDLE);      //  Flushbuffer clearing the internal FIFO read and writing pointer and ErRreg's Bufferovfl logo position is cleared
-    clear_register_mask(ComIrqReg,      0x80);          //  When Set1 is cleared, the shielding position of commonricqreg is clear zero
-    set_register_mask(FIFOLevelReg,     0x80);          //  Write an empty order
-
-    write_register_buffer(FIFODataReg, pIn, InLenByte); // Write data into FIFODATA
-    write_register_single(CommandReg, Command);             // Write command
-
-    if (Command == PCD_TRANSCEIVE) {
-        set_register_mask(BitFramingReg, 0x80);     // StartSend places to start the data to send this bit and send and receive commands when it is valid
-    }
-
-    if (pOut == NULL) {
-        // If the developer does not need to receive data, then return directly after the sending!
-        while ((read_register_single(Status2Reg) & 0x07) == 0x03);
-        return STATUS_HF_TAG_OK;
-    }
-    // Reset the length of the received data
-    *pOutLenBit         = 0;
-
-    bsp_set_timer(g_timeout_auto_timer, 0);         // Before starting the operation, return to zero over time counting
-
-    do {
-        n = read_register_single(ComIrqReg);                // Read the communication interrupt register to determine whether the current IO task is completed!
-        not_timeout = NO_TIMEOUT_1MS(g_timeout_auto_timer, g_com_timeout_ms);
-    } while (not_timeout && (!(n & waitFor)));  // Exit conditions: timeout interruption, interrupt with empty command commands
-    // NRF_LOG_INFO("N = %02x\n", n);
-
-    if (Command == PCD_TRANSCEIVE) {
-        clear_register_mask(BitFramingReg, 0x80);       // Clean up allows the startsend bit and the bit length position
-    }
-
-    // Whether to receive timeout
-    if (not_timeout) {
-        // First determine whether there is a place where there is an error register
-        if (n & 0x02) {
-            // Error occur
-            // Read an error logo register BufferOfI CollErr ParityErr ProtocolErr
-            pcd_err_val = read_register_single(ErrorReg);
-            // Detect whether there are abnormalities
-            if (pcd_err_val & 0x01) {               // ProtocolErr Error only appears in the following two cases:
-                if (Command == PCD_AUTHENT) {       // During the execution of the MFAUTHENT command, if the number of bytes received by a data stream, the position of the place
-                    // Therefore, we need to deal with it well, assuming that there are problems during the verification process, then we need to think that this is normal
-                    status = STATUS_MF_ERR_AUTH;
-                } else {                            // If the SOF is wrong, the position is set up and the receiver is automatically cleared during the start -up stage, which is effective at the rate of 106kbd
-                    NRF_LOG_INFO("Protocol error\n");
-                    status = STATUS_HF_ERR_STAT;
-                }
-            } else if (pcd_err_val & 0x02) {
-                // Detecting whether there are even strange errors
-                NRF_LOG_INFO("Parity error\n");
-                status = STATUS_HF_ERR_PARITY;
-            } else if (pcd_err_val & 0x04) {        // Detect whether there are CRC errors
-                NRF_LOG_INFO("CRC error\n");
-                status = STATUS_HF_ERR_CRC;
-            } else if (pcd_err_val & 0x08) {        // There is a conflict to detect the label
-                NRF_LOG_INFO("Collision tag\n");
-                status = STATUS_HF_COLLISION;
-            } else {                                // There are other unrepaired abnormalities
-                NRF_LOG_INFO("HF error: 0x%0x2\n", pcd_err_val);
-                status = STATUS_HF_ERR_STAT;
-            }
-        } else {
-            // Occasionally occur
-            // NRF_LOG_INFO("COM OK\n");
-            if (Command == PCD_TRANSCEIVE) {
-                n = read_register_single(FIFOLevelReg);                             // Read the number of bytes saved in FIFO
-                if (n == 0) { n = 1; }
-
-                lastBits = read_register_single(Control522Reg) & 0x07;          // Finally receive the validity of the byte
-
-                if (lastBits) { *pOutLenBit = (n - 1) * 8 + lastBits; } // N -byte number minus 1 (last byte)+ the number of bits of the last bit The total number of data readings read
-                else { *pOutLenBit = n * 8; }                           // Finally received the entire bytes received by the byte valid
-
-                if (*pOutLenBit <= maxOutLenBit) {
-                    // Read all the data in FIFO
-                    read_register_buffer(FIFODataReg, pOut, n);
-                    // Transmission instructions can be considered success when reading normal data!
-                    status = STATUS_HF_TAG_OK;
-                } else {
-                    NRF_LOG_INFO("pcd_14a_reader_bytes_transfer receive response overflow: %d, max = %d\n", *pOutLenBit, maxOutLenBit);
-                    // We can't pass the problem with problems, which is meaningless for the time being
-                    *pOutLenBit = 0;
-                    // Since there is a problem with the data, let's notify the upper layer and inform me
-                    status = STATUS_HF_ERR_STAT;
-                }
-            } else {
-                // Non -transmitted instructions, the execution is completed without errors and considered success!
-                status = STATUS_HF_TAG_OK;
-            }
-        }
-    } else {
-        status = STATUS_HF_TAG_NO;
-        // NRF_LOG_INFO("Tag lost(timeout).\n");
-    }
-
-    if ((flags & PCD_TRANSMIT_FLAG_NO_RESET_MF_CRYPTO1_ON) == 0 && status != STATUS_HF_TAG_OK) {
-        // If there are certain operations,
-        // We may need to remove MFCrypto1On This register logo,
-        // Because it may be because of the error encryption communication caused by verification
-        clear_register_mask(Status2Reg, 0x08);
-    }
-
-    // NRF_LOG_INFO("Com status: %d\n", status);
-    return status;
-}
-
 /**
 * @brief  : ISO14443-A Fast Select
 * @param  :tag: tag info buffer
@@ -1219,27 +1154,33 @@ void pcd_14a_reader_fast_halt_tag(void) {
 * @retval : Status value hf_tag_ok, success
 */
 void pcd_14a_reader_calc_crc(uint8_t *pbtData, size_t szLen, uint8_t *pbtCrc) {
-    uint8_t i, n;
-
-    // Reset state machine
-    clear_register_mask(Status1Reg, 0x20);
-    write_register_single(CommandReg, PCD_IDLE);
-    set_register_mask(FIFOLevelReg, 0x80);
-
-    // Calculate the data of CRC to write to FIFO
-    write_register_buffer(FIFODataReg, pbtData, szLen);
-    write_register_single(CommandReg, PCD_CALCCRC);
-
-    // Waiting for calculation to complete
-    i = szLen * 2;
-    do {
-        n = read_register_single(Status1Reg);
-        i--;
-    } while ((i != 0) && !(n & 0x20));
+    // Reset state machine, clear CRCIRq, flush and fill the FIFO with the data of CRC, start: one program
+    rc522_program_init(&m_program);
+    rc522_program_irq_enable(&m_program, 0x00, 0x04);
+    rc522_program_write(&m_program, CommandReg, PCD_IDLE);
+    rc522_program_write(&m_program, DivIrqReg, 0x04);
+    rc522_program_write(&m_program, FIFOLevelReg, 0x80);
+    rc522_program_write_buffer(&m_program, FIFODataReg, pbtData, szLen);
+    rc522_program_write(&m_program, CommandReg, PCD_CALCCRC);
+    rc522_wait_start(&m_wait, DivIrqReg, 0x04, RC522_CRC_TIMEOUT_TICKS * BSP_TIMER_TICK_MS, m_irq_mode);
+    bsp_set_timer(g_timeout_auto_timer, 0);
+    rc522_program_run(&m_program, rc522_spim_xfer);
+
+    // Waiting for calculation to complete (CRCIRq), CRCResultReg holds no result without it
+    if (rc522_wait() != RC522_WAIT_DONE) {
+        NRF_LOG_WARNING("RC522 CRC timeout, computed by the MCU.");
+        write_register_single(CommandReg, PCD_IDLE);
+        calc_14a_crc_lut(pbtData, szLen, pbtCrc);
+        return;
+    }
 
-    // Get the final calculated CRC data
-    pbtCrc[0] = read_register_single(CRCResultRegL);
-    pbtCrc[1] = read_register_single(CRCResultRegM);
+    // Get the final calculated CRC data, both bytes in one session
+    rc522_program_init(&m_program);
+    uint16_t crc = rc522_program_read(&m_program, CRCResultRegL);
+    rc522_program_read(&m_program, CRCResultRegM);
+    rc522_program_run(&m_program, rc522_spim_xfer);
+    pbtCrc[0] = m_program.rx[crc];
+    pbtCrc[1] = m_program.rx[crc + 1];
 }
 
 /**
@@ -0,0 +1,127 @@
+#include <string.h>
+
+#include "rc522_spi.h"
+
+#include "app_error.h"
+
+#define RC522_SPI_READ(reg)     ((((reg) << 1) & 0x7E) | 0x80)
+#define RC522_SPI_WRITE(reg)    (((reg) << 1) & 0x7E)
+
+
+/**
+ * @brief Start a new program, empty.
+ */
+void rc522_program_init(rc522_program_t *program) {
+    program->length = 0;
+    program->sessions = 0;
+    program->reading = false;
+    program->overflow = false;
+}
+
+/**
+ * @brief Open a session of length bytes, false if the program is full: the access is dropped and the program
+ *        marked, it does not run.
+ */
+static bool program_session(rc522_program_t *program, uint16_t length) {
+    if (program->sessions == RC522_PROGRAM_SESSIONS || program->length + length > RC522_PROGRAM_SIZE) {
+        program->overflow = true;
+        return false;
+    }
+    program->session_end[program->sessions++] = program->length + length;
+    return true;
+}
+
+/**
+ * @brief Queue the write of a register, in a session of its own.
+ */
+void rc522_program_write(rc522_program_t *program, uint8_t reg, uint8_t value) {
+    rc522_program_write_buffer(program, reg, &value, 1);
+}
+
+/**
+ * @brief Queue the write of bytes to one register, the FIFO in one burst.
+ */
+void rc522_program_write_buffer(rc522_program_t *program, uint8_t reg, const uint8_t *values, uint8_t length) {
+    if (!program_session(program, 1 + length)) {
+        return;
+    }
+    program->tx[program->length++] = RC522_SPI_WRITE(reg);
+    memcpy(&program->tx[program->length], values, length);
+    program->length += length;
+    program->reading = false;
+}
+
+/**
+ * @brief Queue length reads of a register, joined to the reads queued just before.
+ * @return index of the first value in program->rx once the program has run
+ */
+uint16_t rc522_program_read_buffer(rc522_program_t *program, uint8_t reg, uint8_t length) {
+    if (program->reading && program->length + length <= RC522_PROGRAM_SIZE) {
+        // the trailing dummy byte of the session becomes the first address
+        program->length--;
+        program->session_end[program->sessions - 1] += length;
+    } else if (!program_session(program, length + 1)) {
+        return 0;
+    }
+    uint16_t index = program->length + 1;
+    memset(&program->tx[program->length], RC522_SPI_READ(reg), length);
+    program->length += length;
+    program->tx[program->length++] = 0x00;
+    program->reading = true;
+    return index;
+}
+
+/**
+ * @brief Queue the read of a register.
+ * @return index of the value in program->rx once the program has run
+ */
+uint16_t rc522_program_read(rc522_program_t *program, uint8_t reg) {
+    return rc522_program_read_buffer(program, reg, 1);
+}
+
+/**
+ * @brief Run the sessions of the program in order, the values read are in program->rx.
+ *        A program that overflowed is a bug: its register writes are missing and its reads index rx[0].
+ */
+void rc522_program_run(rc522_program_t *program, rc522_spi_xfer_t xfer) {
+    APP_ERROR_CHECK_BOOL(!program->overflow);
+    uint16_t start = 0;
+    for (uint8_t i = 0; i < program->sessions; i++) {
+        xfer(&program->tx[start], &program->rx[start], program->session_end[i] - start);
+        start = program->session_end[i];
+    }
+}
+
+/**
+ * @brief Queue the start of a command with the card: stop the previous one, clear the interrupt flags,
+ *        fill the FIFO and start the command. The registers are written without reading them first:
+ *        the flags of ComIrqReg are cleared by writing them with Set1 cleared, the other bits of FIFOLevelReg are read only
+ *        and BitFramingReg is back to 0 after every command.
+ * @param tx_last_bits: bits of the last byte to send, 0 for all of them
+ */
+void rc522_program_command_start(rc522_program_t *program, uint8_t command, const uint8_t *data, uint8_t length, uint8_t tx_last_bits) {
+    rc522_program_write(program, CommandReg, PCD_IDLE);
+    rc522_program_write(program, ComIrqReg, 0x7F);
+    rc522_program_write(program, FIFOLevelReg, 0x80);
+    rc522_program_write_buffer(program, FIFODataReg, data, length);
+    rc522_program_write(program, CommandReg, command);
+    if (command == PCD_TRANSCEIVE) {
+        // StartSend
+        rc522_program_write(program, BitFramingReg, 0x80 | tx_last_bits);
+    }
+}
+
+/**
+ * @brief Queue what is needed once the command is done: clear BitFramingReg
+ *        and read ErrorReg, FIFOLevelReg and Control522Reg in one session.
+ * @return index in program->rx of ErrorReg, FIFOLevelReg and Control522Reg follow it
+ */
+uint16_t rc522_program_command_end(rc522_program_t *program, uint8_t command) {
+    if (command == PCD_TRANSCEIVE) {
+        rc522_program_write(program, BitFramingReg, 0x00);
+    }
+    uint16_t index = rc522_program_read(program, ErrorReg);
+    rc522_program_read(program, FIFOLevelReg);
+    rc522_program_read(program, Control522Reg);
+    return index;
+}
@@ -0,0 +1,42 @@
+#ifndef RC522_SPI_H
+#define RC522_SPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rc522.h"
+
+/*
+ * RC522 register programs: register accesses queued in a buffer, then run as a few SPI sessions,
+ * one EasyDMA transfer each. The RC522 writes all the data bytes of a session to the register of its first byte,
+ * so a session is either a write (the FIFO in one burst) or reads of any registers: each address byte
+ * is answered with the value of the register addressed by the previous one.
+ */
+#define RC522_PROGRAM_SIZE          (DEF_FIFO_LENGTH + 32)  // a full FIFO and a few registers
+#define RC522_PROGRAM_SESSIONS      12
+
+// Run one session: chip select, length bytes out of tx, as many into rx
+typedef void (*rc522_spi_xfer_t)(const uint8_t *tx, uint8_t *rx, uint16_t length);
+
+typedef struct {
+    uint8_t tx[RC522_PROGRAM_SIZE];
+    uint8_t rx[RC522_PROGRAM_SIZE];
+    uint16_t length;
+    uint8_t sessions;
+    uint16_t session_end[RC522_PROGRAM_SESSIONS];
+    bool reading;           // the last session reads, the next read joins it
+    bool overflow;          // an access did not fit, running the program is an error
+} rc522_program_t;
+
+void rc522_program_init(rc522_program_t *program);
+void rc522_program_write(rc522_program_t *program, uint8_t reg, uint8_t value);
+void rc522_program_write_buffer(rc522_program_t *program, uint8_t reg, const uint8_t *values, uint8_t length);
+uint16_t rc522_program_read(rc522_program_t *program, uint8_t reg);
+uint16_t rc522_program_read_buffer(rc522_program_t *program, uint8_t reg, uint8_t length);
+void rc522_program_run(rc522_program_t *program, rc522_spi_xfer_t xfer);
+
+// Programs of a RC522 command with the card, see pcd_14a_reader_bytes_transfer_flags()
+void rc522_program_command_start(rc522_program_t *program, uint8_t command, const uint8_t *data, uint8_t length, uint8_t tx_last_bits);
+uint16_t rc522_program_command_end(rc522_program_t *program, uint8_t command);
+
+#endif
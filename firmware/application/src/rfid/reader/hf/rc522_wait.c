@@ -0,0 +1,47 @@
+#include "rc522_wait.h"
+
+
+/**
+ * @brief Arm a wait, before the command is started so that its edge is not lost.
+ */
+void rc522_wait_start(rc522_wait_t *wait, uint8_t reg, uint8_t mask, uint32_t timeout_ms, bool irq_mode) {
+    wait->reg = reg;
+    wait->mask = mask;
+    wait->flags = 0;
+    wait->irq_mode = irq_mode;
+    wait->irq_pending = false;
+    wait->timeout_ms = timeout_ms;
+    wait->state = RC522_WAIT_BUSY;
+    wait->reads = 0;
+}
+
+/**
+ * @brief Falling edge of the IRQ pin, called from the GPIOTE handler.
+ */
+void rc522_wait_irq(rc522_wait_t *wait) {
+    wait->irq_pending = true;
+}
+
+/**
+ * @brief Advance the wait, reads the register only when it may have changed.
+ * @param elapsed_ms: time since the start of the command
+ * @return RC522_WAIT_BUSY while the caller has to wait (and may sleep in irq mode)
+ */
+rc522_wait_state_t rc522_wait_step(rc522_wait_t *wait, uint32_t elapsed_ms, rc522_wait_read_t read) {
+    if (wait->state != RC522_WAIT_BUSY) {
+        return wait->state;
+    }
+    bool timed_out = elapsed_ms > wait->timeout_ms;
+    if (!wait->irq_mode || wait->irq_pending || timed_out) {
+        // cleared before the read, an edge during the read is not lost
+        wait->irq_pending = false;
+        wait->flags = read(wait->reg);
+        wait->reads++;
+        if (wait->flags & wait->mask) {
+            wait->state = RC522_WAIT_DONE;
+        } else if (timed_out) {
+            wait->state = RC522_WAIT_TIMEOUT;
+        }
+    }
+    return wait->state;
+}
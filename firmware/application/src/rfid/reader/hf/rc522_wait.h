@@ -0,0 +1,36 @@
+#ifndef RC522_WAIT_H
+#define RC522_WAIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Wait for the end of a RC522 command: the bits of an interrupt request register.
+ * Without IRQ pin the register is polled over SPI. With it the register is read once per falling edge
+ * of the pin, the CPU sleeps between them, and once more at the timeout in case an edge was missed.
+ */
+typedef enum {
+    RC522_WAIT_BUSY,
+    RC522_WAIT_DONE,
+    RC522_WAIT_TIMEOUT,
+} rc522_wait_state_t;
+
+// Read a RC522 register
+typedef uint8_t (*rc522_wait_read_t)(uint8_t reg);
+
+typedef struct {
+    uint8_t reg;                    // ComIrqReg or DivIrqReg
+    uint8_t mask;                   // bits that end the wait
+    uint8_t flags;                  // last value read of reg
+    bool irq_mode;                  // the IRQ pin is connected
+    volatile bool irq_pending;      // set by the GPIOTE handler
+    uint32_t timeout_ms;
+    rc522_wait_state_t state;
+    uint32_t reads;                 // SPI reads of reg, for the tests
+} rc522_wait_t;
+
+void rc522_wait_start(rc522_wait_t *wait, uint8_t reg, uint8_t mask, uint32_t timeout_ms, bool irq_mode);
+void rc522_wait_irq(rc522_wait_t *wait);
+rc522_wait_state_t rc522_wait_step(rc522_wait_t *wait, uint32_t elapsed_ms, rc522_wait_read_t read);
+
+#endif
@@ -41,6 +41,23 @@ volatile bool g_usb_connected = false;
 volatile bool g_usb_port_opened = false;
 volatile bool g_usb_led_marquee_enable = true;
 
+/**
+ * @brief Start sending the next queued response frame if the cdc is idle.
+ *        The cdc driver does not copy the data, the frame stays with us until TX_DONE,
+ *        which sends the following one.
+ */
+void usb_cdc_tx_start(void) {
+    data_frame_tx_t *tx;
+    while ((tx = data_frame_tx_next()) != NULL) {
+        ret_code_t err_code = app_usbd_cdc_acm_write(&m_app_cdc_acm, tx->buffer, tx->length);
+        if (err_code == NRF_SUCCESS) {
+            return;
+        }
+        NRF_LOG_ERROR("CDC write failed: %d, response dropped.", err_code);
+        data_frame_tx_done();
+    }
+}
+
 /** @brief User event handler @ref app_usbd_cdc_acm_user_ev_handler_t */
 static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const *p_inst, app_usbd_cdc_acm_user_event_t event) {
     static uint8_t cdc_data_buffer[1];
@@ -55,6 +72,8 @@ static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const *p_inst, app_usb
             UNUSED_VARIABLE(ret);
             NRF_LOG_INFO("CDC ACM port opened");
             g_usb_port_opened = true;
+            // a new client negotiates its own frame format
+            data_frame_set_compression(false);
             break;
         }
 
@@ -62,9 +81,12 @@ static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const *p_inst, app_usb
             NRF_LOG_INFO("CDC ACM port closed");
             g_usb_port_opened = false;
             g_usb_led_marquee_enable = true;
+            data_frame_tx_reset();
             break;
 
         case APP_USBD_CDC_ACM_USER_EVT_TX_DONE:
+            data_frame_tx_done();
+            usb_cdc_tx_start();
             break;
 
         case APP_USBD_CDC_ACM_USER_EVT_RX_DONE: {
@@ -133,6 +155,20 @@ static void usbd_user_ev_handler(app_usbd_event_type_t event) {
     }
 }
 
+/**
+ * @brief Back-pressure of the response frames: both are queued or being sent, a command wants another one.
+ *        Usb events are processed here because we are called from the main loop context,
+ *        TX_DONE releases a frame.
+ * @return false if the port is closed, the frames won't be released
+ */
+static bool usb_cdc_tx_wait(void) {
+    if (!g_usb_port_opened) {
+        return false;
+    }
+    while (app_usbd_event_queue_process());
+    return true;
+}
+
 // USB CODE END
 
 void usb_cdc_init(void) {
@@ -149,11 +185,8 @@ void usb_cdc_init(void) {
     app_usbd_class_inst_t const *class_cdc_acm = app_usbd_cdc_acm_class_inst_get(&m_app_cdc_acm);
     ret = app_usbd_class_append(class_cdc_acm);
     APP_ERROR_CHECK(ret);
-}
 
-void usb_cdc_write(const void *p_buf, uint16_t length) {
-    ret_code_t err_code = app_usbd_cdc_acm_write(&m_app_cdc_acm, p_buf, length);
-    APP_ERROR_CHECK(err_code);
+    on_data_frame_tx_wait(usb_cdc_tx_wait);
 }
 
 // override fputc to printf to cdc serial
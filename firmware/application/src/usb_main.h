@@ -5,7 +5,7 @@
 #include <stdbool.h>
 
 void usb_cdc_init(void);
-void usb_cdc_write(const void *p_buf, uint16_t length);
+void usb_cdc_tx_start(void);
 bool is_usb_working(void);
 
 #endif
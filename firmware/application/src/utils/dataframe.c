@@ -1,5 +1,9 @@
 #include "dataframe.h"
 #include "netdata.h"
+#include "tx_frame_queue.h"
+#include "app_status.h"
+#include "crc32.h"
+#include "lz4_block.h"
 
 #define NRF_LOG_MODULE_NAME data_frame
 #include "nrf_log.h"
@@ -8,10 +12,19 @@
 NRF_LOG_MODULE_REGISTER();
 
 static netdata_frame_raw_t m_netdata_frame_rx_buf;
-static netdata_frame_raw_t m_netdata_frame_tx_buf;
-static data_frame_tx_t m_frame_tx_buf_info = {
-    .buffer = (uint8_t *) &m_netdata_frame_tx_buf,  // default buffer
+// response frames, one can be built while the transport still holds the other
+static netdata_frame_raw_t m_netdata_frame_tx_buf[TX_FRAME_QUEUE_DEPTH];
+static data_frame_tx_t m_frame_tx_buf_info[TX_FRAME_QUEUE_DEPTH] = {
+    { .buffer = (uint8_t *) &m_netdata_frame_tx_buf[0] },
+    { .buffer = (uint8_t *) &m_netdata_frame_tx_buf[1] },
 };
+static tx_frame_queue_t m_tx_queue = { .sending = -1 };
+static data_frame_tx_wait_t m_tx_wait_cbk = NULL;
+static uint8_t m_stream_id = 0;
+static const uint8_t *m_stream_data;    // the response data_frame_stream() sends
+static bool m_compression_enabled = false;
+static uint8_t m_compress_buf[NETDATA_MAX_DATA_LENGTH];
+static uint16_t m_compress_table[LZ4_BLOCK_HASH_SIZE];
 static uint16_t m_data_rx_position = 0;
 static uint16_t m_data_cmd;
 static uint16_t m_data_status;
@@ -28,49 +41,263 @@ static uint8_t compute_lrc(uint8_t *buf, uint16_t bufsize) {
     return 0x100 - lrc;
 }
 
+static int data_frame_tx_index(data_frame_tx_t *tx) {
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        if (tx == &m_frame_tx_buf_info[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Take a free response frame, waiting for the transport to release one if they are all in flight.
+ * @return the frame, its data field can be filled before data_frame_make_in_place()
+ */
+data_frame_tx_t *data_frame_tx_acquire(void) {
+    int index;
+    while ((index = tx_frame_queue_acquire(&m_tx_queue)) < 0) {
+        bool in_flight = tx_frame_queue_count(&m_tx_queue, TX_FRAME_QUEUED) + tx_frame_queue_count(&m_tx_queue, TX_FRAME_SENDING) > 0;
+        if (!in_flight || m_tx_wait_cbk == NULL || !m_tx_wait_cbk()) {
+            // nothing will release them, the pending responses are lost anyway.
+            NRF_LOG_ERROR("No tx frame released, pending responses dropped.");
+            tx_frame_queue_drop_pending(&m_tx_queue);
+            if (tx_frame_queue_count(&m_tx_queue, TX_FRAME_FREE) == 0) {
+                tx_frame_queue_discard_filling(&m_tx_queue);
+            }
+        }
+    }
+    return &m_frame_tx_buf_info[index];
+}
+
+/**
+ * @brief Data field of a free response frame, to build a response without copy:
+ *        data_frame_make() with this pointer as data completes the same frame.
+ */
+uint8_t *data_frame_tx_payload(void) {
+    return ((netdata_frame_raw_t *)data_frame_tx_acquire()->buffer)->data;
+}
+
+/**
+ * @brief Queue a complete frame for a transport that sends from the frame buffer,
+ *        it is sent after the ones queued before.
+ */
+void data_frame_tx_commit(data_frame_tx_t *tx) {
+    int index = data_frame_tx_index(tx);
+    if (index >= 0) {
+        tx_frame_queue_commit(&m_tx_queue, index);
+    }
+}
+
 /**
- * @brief: create a packet, put the created data packet into the buffer, and wait for the post to set up a non busy state
+ * @brief Give back a frame that is not queued: sent by a transport that copies it, or not sent at all.
+ */
+void data_frame_tx_discard(data_frame_tx_t *tx) {
+    int index = data_frame_tx_index(tx);
+    if (index >= 0) {
+        tx_frame_queue_discard(&m_tx_queue, index);
+    }
+}
+
+/**
+ * @brief Give back the frames made but not sent by the command handlers, after a command.
+ */
+void data_frame_tx_discard_unsent(void) {
+    tx_frame_queue_discard_filling(&m_tx_queue);
+}
+
+/**
+ * @brief Next queued frame for the transport, NULL if none or if the previous one is not done yet.
+ */
+data_frame_tx_t *data_frame_tx_next(void) {
+    int index = tx_frame_queue_start(&m_tx_queue);
+    return index < 0 ? NULL : &m_frame_tx_buf_info[index];
+}
+
+/**
+ * @brief The transport is done with the frame from data_frame_tx_next(), it can be reused.
+ */
+void data_frame_tx_done(void) {
+    tx_frame_queue_done(&m_tx_queue);
+}
+
+/**
+ * @brief The transport is gone, drop the frames it had not sent.
+ */
+void data_frame_tx_reset(void) {
+    tx_frame_queue_drop_pending(&m_tx_queue);
+}
+
+/**
+ * @brief Register the function run while no response frame is free,
+ *        it processes the transport events and returns false if no frame can be released.
+ */
+void on_data_frame_tx_wait(data_frame_tx_wait_t callback) {
+    m_tx_wait_cbk = callback;
+}
+
+/**
+ * @brief: create a packet in a free response frame
  * @param cmd: instructionResponse
  * @param status:responseStatus
  * @param length: answerDataLength
- * @param data: answerData
+ * @param data: answerData, copied unless it is the pointer given by data_frame_tx_payload()
  */
 data_frame_tx_t *data_frame_make(uint16_t cmd, uint16_t status, uint16_t data_length, uint8_t *data) {
     if (data_length > 0 && data == NULL) {
         NRF_LOG_ERROR("data_frame_make error, null pointer.");
         return NULL;
     }
-    if (data_length > 4096) {
+    if (data_length > NETDATA_MAX_DATA_LENGTH) {
+        NRF_LOG_ERROR("data_frame_make error, too much data.");
+        return NULL;
+    }
+    // built in place already
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        if (data != NULL && data == m_netdata_frame_tx_buf[i].data
+                && m_tx_queue.state[i] == TX_FRAME_FILLING) {
+            return data_frame_make_in_place(&m_frame_tx_buf_info[i], cmd, status, data_length);
+        }
+    }
+    data_frame_tx_t *tx = data_frame_tx_acquire();
+    if (data_length > 0) {
+        memcpy(((netdata_frame_raw_t *)tx->buffer)->data, data, data_length);
+    }
+    return data_frame_make_in_place(tx, cmd, status, data_length);
+}
+
+/**
+ * @brief: create a packet around data already written in the data field of the frame buffer of tx,
+ *         for responses built piece by piece in a frame from data_frame_tx_acquire(), without the copy of data_frame_make
+ * @param tx: frame to complete, its buffer is a netdata_frame_raw_t
+ * @param cmd: instructionResponse
+ * @param status:responseStatus
+ * @param length: answerDataLength
+ */
+data_frame_tx_t *data_frame_make_in_place(data_frame_tx_t *tx, uint16_t cmd, uint16_t status, uint16_t data_length) {
+    netdata_frame_raw_t *frame = (netdata_frame_raw_t *)tx->buffer;
+    if (data_length > NETDATA_MAX_DATA_LENGTH) {
         NRF_LOG_ERROR("data_frame_make error, too much data.");
         return NULL;
     }
     NRF_LOG_INFO("TX Data frame: cmd = 0x%04x (%i), status = 0x%04x, length = %d%s", cmd, cmd, status, data_length, data_length > 0 ? ", data =" : "");
     if (data_length > 0) {
-        NRF_LOG_HEXDUMP_INFO(data, data_length);
+        NRF_LOG_HEXDUMP_INFO(frame->data, data_length);
     }
 
-    netdata_frame_postamble_t *tx_post = (netdata_frame_postamble_t *)((uint8_t *)&m_netdata_frame_tx_buf + sizeof(netdata_frame_preamble_t) + data_length);
+    netdata_frame_postamble_t *tx_post = (netdata_frame_postamble_t *)((uint8_t *)frame + sizeof(netdata_frame_preamble_t) + data_length);
     // sof
-    m_netdata_frame_tx_buf.pre.sof = NETDATA_FRAME_SOF;
+    frame->pre.sof = NETDATA_FRAME_SOF;
     // sof lrc
-    m_netdata_frame_tx_buf.pre.lrc1 = compute_lrc((uint8_t *)&m_netdata_frame_tx_buf.pre, offsetof(netdata_frame_preamble_t, lrc1));
+    frame->pre.lrc1 = compute_lrc((uint8_t *)&frame->pre, offsetof(netdata_frame_preamble_t, lrc1));
     // cmd
-    m_netdata_frame_tx_buf.pre.cmd = U16HTONS(cmd);
+    frame->pre.cmd = U16HTONS(cmd);
     // status
-    m_netdata_frame_tx_buf.pre.status = U16HTONS(status);
+    frame->pre.status = U16HTONS(status);
     // data_length
-    m_netdata_frame_tx_buf.pre.len = U16HTONS(data_length);
+    frame->pre.len = U16HTONS(data_length);
     // head lrc
-    m_netdata_frame_tx_buf.pre.lrc2 = compute_lrc((uint8_t *)&m_netdata_frame_tx_buf.pre, offsetof(netdata_frame_preamble_t, lrc2));
-    // data
-    if (data_length > 0) {
-        memcpy(&m_netdata_frame_tx_buf.data, data, data_length);
-    }
+    frame->pre.lrc2 = compute_lrc((uint8_t *)&frame->pre, offsetof(netdata_frame_preamble_t, lrc2));
     // length out.
-    m_frame_tx_buf_info.length = (sizeof(netdata_frame_preamble_t) + data_length + sizeof(netdata_frame_postamble_t));
+    tx->length = (sizeof(netdata_frame_preamble_t) + data_length + sizeof(netdata_frame_postamble_t));
     // data all lrc
-    tx_post->lrc3 = compute_lrc((uint8_t *)&m_netdata_frame_tx_buf.data, data_length);
-    return (&m_frame_tx_buf_info);
+    tx_post->lrc3 = compute_lrc((uint8_t *)&frame->data, data_length);
+    return tx;
+}
+
+// The filler of data_frame_stream(), the response is in memory
+static void stream_data_fill(uint32_t offset, uint8_t *buffer, uint16_t length) {
+    memcpy(buffer, &m_stream_data[offset], length);
+}
+
+/**
+ * @brief: stream a response larger than a frame, the client reassembles it and checks its crc32.
+ *         A STATUS_STREAM_BEGIN frame gives the stream id, the total length, the crc32 and the status of the command,
+ *         then STATUS_STREAM_DATA frames carry the data in order, each one with the stream id and its offset.
+ *         The frames are built as fast as send() hands them to the transport.
+ * @param cmd: instructionResponse
+ * @param status: responseStatus, given to the client once the whole data is received
+ * @param length: total data length
+ * @param data: answerData
+ * @param send: transport of all the frames but the last one
+ * @return: the last frame, sent by the caller like any response
+ */
+data_frame_tx_t *data_frame_stream(uint16_t cmd, uint16_t status, uint32_t length, const uint8_t *data, data_frame_send_t send) {
+    if (length > 0 && data == NULL) {
+        NRF_LOG_ERROR("data_frame_stream error, null pointer.");
+        return NULL;
+    }
+    m_stream_data = data;
+    return data_frame_stream_fill(cmd, status, length, stream_data_fill, send);
+}
+
+/**
+ * @brief: data_frame_stream() of a response made on the fly, fill() is asked twice for each byte: once for the crc32,
+ *         once for the frames, and must give the same bytes.
+ * @param fill: writes the data at an offset
+ */
+data_frame_tx_t *data_frame_stream_fill(uint16_t cmd, uint16_t status, uint32_t length, data_frame_fill_t fill, data_frame_send_t send) {
+    uint8_t block[256];
+    uint32_t crc32 = 0;
+    for (uint32_t offset = 0; offset < length; offset += sizeof(block)) {
+        uint16_t block_length = MIN(length - offset, sizeof(block));
+        fill(offset, block, block_length);
+        crc32 = crc32_compute(block, block_length, offset == 0 ? NULL : &crc32);
+    }
+    uint8_t id = ++m_stream_id;
+    data_frame_stream_begin_t *begin = (data_frame_stream_begin_t *)data_frame_tx_payload();
+    begin->id = id;
+    begin->length = U32HTONL(length);
+    begin->crc32 = U32HTONL(crc32);
+    begin->status = U16HTONS(status);
+    data_frame_tx_t *tx = data_frame_make(cmd, STATUS_STREAM_BEGIN, sizeof(data_frame_stream_begin_t), (uint8_t *)begin);
+    uint32_t offset = 0;
+    while (offset < length) {
+        send(tx);
+        uint16_t chunk_length = MIN(length - offset, DATA_FRAME_STREAM_CHUNK_MAX);
+        data_frame_stream_data_t *chunk = (data_frame_stream_data_t *)data_frame_tx_payload();
+        chunk->id = id;
+        chunk->offset = U32HTONL(offset);
+        fill(offset, chunk->data, chunk_length);
+        tx = data_frame_make(cmd, STATUS_STREAM_DATA, sizeof(data_frame_stream_data_t) + chunk_length, (uint8_t *)chunk);
+        offset += chunk_length;
+    }
+    return tx;
+}
+
+/**
+ * @brief Let data_frame_compress() compress the responses, asked by the client. Off again for every new connection.
+ */
+void data_frame_set_compression(bool enable) {
+    m_compression_enabled = enable;
+}
+
+bool data_frame_get_compression(void) {
+    return m_compression_enabled;
+}
+
+/**
+ * @brief Replace the data of a complete frame by its LZ4 block and flag its status with NETDATA_STATUS_COMPRESSED,
+ *        when the client enabled it and the data shrinks by at least 1/16. Run just before the frame goes to the transport,
+ *        so the batch results and the stream crc32 are computed on the plain data.
+ */
+void data_frame_compress(data_frame_tx_t *tx) {
+    if (!m_compression_enabled || tx == NULL) {
+        return;
+    }
+    netdata_frame_raw_t *frame = (netdata_frame_raw_t *)tx->buffer;
+    uint16_t status = U16NTOHS(frame->pre.status);
+    uint16_t data_length = U16NTOHS(frame->pre.len);
+    if (data_length < DATA_FRAME_COMPRESS_MIN_LENGTH || (status & NETDATA_STATUS_COMPRESSED)) {
+        return;
+    }
+    uint16_t compressed_length = lz4_block_compress(frame->data, data_length, m_compress_buf,
+                                                    data_length - data_length / 16, m_compress_table);
+    if (compressed_length == 0) {
+        return;
+    }
+    memcpy(frame->data, m_compress_buf, compressed_length);
+    data_frame_make_in_place(tx, U16NTOHS(frame->pre.cmd), status | NETDATA_STATUS_COMPRESSED, compressed_length);
 }
 
 /**
@@ -92,7 +319,7 @@ void data_frame_receive(uint8_t *data, uint16_t length) {
         return;
     }
     // buffer overflow
-    if (m_data_rx_position + length >= sizeof(m_netdata_frame_rx_buf)) {
+    if (m_data_rx_position + length > sizeof(m_netdata_frame_rx_buf)) {
         NRF_LOG_ERROR("Data frame wait overflow.");
         data_frame_reset();
         return;
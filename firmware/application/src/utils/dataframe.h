@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "netdata.h"
+
 // Data frame process callback
 typedef void (*data_frame_cbk_t)(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data);
 
@@ -13,6 +15,33 @@ typedef struct {
     uint16_t length;
 } data_frame_tx_t;
 
+// Wait for a response frame to be released, false if none can be
+typedef bool (*data_frame_tx_wait_t)(void);
+// Hand a complete frame to the transport
+typedef void (*data_frame_send_t)(data_frame_tx_t *tx);
+
+// Streamed responses, see data_frame_stream()
+// Writes the bytes [offset, offset + length) of a streamed response which is not in memory as a whole
+typedef void (*data_frame_fill_t)(uint32_t offset, uint8_t *buffer, uint16_t length);
+
+typedef struct {
+    uint8_t id;
+    uint32_t length;
+    uint32_t crc32;
+    uint16_t status;
+} PACKED data_frame_stream_begin_t;
+
+typedef struct {
+    uint8_t id;
+    uint32_t offset;
+    uint8_t data[];
+} PACKED data_frame_stream_data_t;
+
+#define DATA_FRAME_STREAM_CHUNK_MAX     (NETDATA_MAX_DATA_LENGTH - sizeof(data_frame_stream_data_t))
+
+// Smaller responses are sent as they are, see data_frame_compress()
+#define DATA_FRAME_COMPRESS_MIN_LENGTH  64
+
 void data_frame_receive(uint8_t *data, uint16_t length);
 void data_frame_process(void);
 void on_data_frame_complete(data_frame_cbk_t callback);
@@ -24,5 +53,41 @@ data_frame_tx_t *data_frame_make(
     uint8_t *data
 );
 
+data_frame_tx_t *data_frame_make_in_place(
+    data_frame_tx_t *tx,
+    uint16_t cmd,
+    uint16_t status,
+    uint16_t length
+);
+
+data_frame_tx_t *data_frame_stream(
+    uint16_t cmd,
+    uint16_t status,
+    uint32_t length,
+    const uint8_t *data,
+    data_frame_send_t send
+);
+
+data_frame_tx_t *data_frame_stream_fill(
+    uint16_t cmd,
+    uint16_t status,
+    uint32_t length,
+    data_frame_fill_t fill,
+    data_frame_send_t send
+);
+
+void data_frame_set_compression(bool enable);
+bool data_frame_get_compression(void);
+void data_frame_compress(data_frame_tx_t *tx);
+
+data_frame_tx_t *data_frame_tx_acquire(void);
+uint8_t *data_frame_tx_payload(void);
+void data_frame_tx_commit(data_frame_tx_t *tx);
+void data_frame_tx_discard(data_frame_tx_t *tx);
+void data_frame_tx_discard_unsent(void);
+data_frame_tx_t *data_frame_tx_next(void);
+void data_frame_tx_done(void);
+void data_frame_tx_reset(void);
+void on_data_frame_tx_wait(data_frame_tx_wait_t callback);
 
 #endif // DATAFRAME_H
@@ -22,8 +22,12 @@
  * Each card slot has two types of data, high and low frequency
  * FDS file ID follows the card slot, starting from 0x1100 to 0x1107
  * FDS record key mirrors TAG_SENSE_LF/HF so is 1 for LF, 2 for HF (currently)
+ * The data is stored in chunks (see tag_persistence.h), the record key of a chunk is the sense type in the high byte
+ * and the chunk index in the low byte: 0x0100 onwards for LF, 0x0200 onwards for HF. The data stored before the
+ * chunks, under the key of the sense type, is moved to the chunks when it is read.
  */
 #define FDS_SLOT_TAG_DUMP_FILE_ID_BASE      0x1100
+#define FDS_SLOT_TAG_DUMP_CHUNK_KEY(sense_type, chunk)  (((sense_type) << 8) | (chunk))
 
 /*
  * Each card slot has two types of data, high and low frequency, so it can get two names
@@ -1,5 +1,6 @@
 #include "fds_util.h"
 #include "bsp_wdt.h"
+#include "utils.h"
 
 #define NRF_LOG_MODULE_NAME fds_sync
 #include "nrf_log.h"
@@ -18,6 +19,31 @@ static struct {
     bool ignore_pm;     // ignore peer manager records, defaults to true, set to false by fds_wipe
 } fds_operation_info;
 
+// A queued write, its data in the pool
+typedef struct {
+    uint16_t id;
+    uint16_t key;
+    uint16_t offset;        // in the pool
+    uint16_t size;          // bytes, whole words
+} queue_entry_t;
+
+typedef enum {
+    QUEUE_IDLE,
+    QUEUE_WRITING,          // the first entry, until its event
+    QUEUE_COLLECTING,       // a garbage collection, until its event
+} queue_state_t;
+
+// The queued data, in the order of the entries, the FDS reads the first one until it is written
+static uint8_t m_queue_pool[FDS_QUEUE_POOL_SIZE] ALIGN_U32;
+static queue_entry_t m_queue[FDS_QUEUE_ENTRY_MAX];
+static uint8_t m_queue_count;
+static volatile queue_state_t m_queue_state;
+static volatile bool m_queue_done;      // the event of the operation in progress came
+static bool m_queue_gc_tried;           // the first entry found no room, a GC ran for it
+static bool m_queue_gc_check;           // the flash changed since the watermarks were checked
+static fds_queue_stats_t m_queue_stats;
+static fds_write_failed_t m_write_failed;
+
 
 /**
  *The query record exists, and get the handle of the record
@@ -31,6 +57,120 @@ static bool fds_find_record(uint16_t id, uint16_t key, fds_record_desc_t *desc)
     return false;
 }
 
+static uint16_t queue_pool_used(void) {
+    return m_queue_count == 0 ? 0 : m_queue[m_queue_count - 1].offset + m_queue[m_queue_count - 1].size;
+}
+
+// The data after it moves down, the pool stays packed
+static void queue_remove(uint8_t index) {
+    uint16_t size = m_queue[index].size;
+    uint16_t end = queue_pool_used();
+    uint16_t next = m_queue[index].offset + size;
+    memmove(&m_queue_pool[m_queue[index].offset], &m_queue_pool[next], end - next);
+    for (uint8_t i = index + 1; i < m_queue_count; i++) {
+        m_queue[i].offset -= size;
+        m_queue[i - 1] = m_queue[i];
+    }
+    m_queue_count--;
+}
+
+// The newest entry of the record, -1 if none; with pending_only not the one being written
+static int queue_find(uint16_t id, uint16_t key, bool pending_only) {
+    int first = (pending_only && m_queue_state == QUEUE_WRITING) ? 1 : 0;
+    for (int i = m_queue_count - 1; i >= first; i--) {
+        if (m_queue[i].id == id && m_queue[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Forgets the write of the record not started yet, a later write or a delete takes its place
+static bool queue_drop(uint16_t id, uint16_t key) {
+    int index = queue_find(id, key, true);
+    if (index < 0) {
+        return false;
+    }
+    queue_remove(index);
+    return true;
+}
+
+// The operation in progress is over, a write leaves the queue
+static void queue_complete(void) {
+    if (m_queue_state == QUEUE_WRITING) {
+        queue_remove(0);
+        m_queue_gc_tried = false;
+        m_queue_gc_check = true;
+    }
+    m_queue_state = QUEUE_IDLE;
+}
+
+// The sync helpers do not run along with a queued operation
+static void queue_wait(void) {
+    while (m_queue_state != QUEUE_IDLE) {
+        while (!m_queue_done) {
+            __NOP();
+        }; // Waiting for operation to complete
+        queue_complete();
+    }
+}
+
+static void queue_gc_start(void) {
+    m_queue_done = false;
+    m_queue_state = QUEUE_COLLECTING;
+    ret_code_t err_code = fds_gc();
+    if (err_code != NRF_SUCCESS) {
+        // the FDS queue is full, tried again at the next call
+        NRF_LOG_INFO("FDS gc request failed!");
+        m_queue_state = QUEUE_IDLE;
+    }
+}
+
+static ret_code_t fds_write_record_nogc(uint16_t id, uint16_t key, uint16_t data_length_words, void *buffer);
+
+// Starts the write of the first entry, or the GC it needs to find room
+static void queue_write_start(void) {
+    queue_entry_t *entry = &m_queue[0];
+    m_queue_done = false;
+    m_queue_state = QUEUE_WRITING;
+    ret_code_t err_code = fds_write_record_nogc(entry->id, entry->key, entry->size / 4, &m_queue_pool[entry->offset]);
+    if (err_code == NRF_SUCCESS) {
+        return;
+    }
+    m_queue_state = QUEUE_IDLE;
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH && !m_queue_gc_tried) {
+        NRF_LOG_INFO("FDS no space, gc start.");
+        m_queue_gc_tried = true;
+        m_queue_stats.gc_full++;
+        queue_gc_start();
+    } else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH) {
+        // same as fds_write_sync(), there is no room even after a GC
+        NRF_LOG_ERROR("FDS no space to write FileID: 0x%04x, FileKey: 0x%04x.", entry->id, entry->key);
+        m_queue_stats.failures++;
+        uint16_t id = entry->id;
+        uint16_t key = entry->key;
+        queue_remove(0);
+        m_queue_gc_tried = false;
+        if (m_write_failed != NULL) {
+            m_write_failed(id, key);
+        }
+    } else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+// Whether the free words of the data pages are below the low watermark and a GC would free enough of them
+static bool queue_gc_due(void) {
+    fds_stat_t stat;
+    if (fds_stat(&stat) != NRF_SUCCESS) {
+        return false;
+    }
+    uint32_t words = (uint32_t)stat.pages_available * FDS_VIRTUAL_PAGE_SIZE;
+    uint32_t free_words = words > stat.words_used ? words - stat.words_used : 0;
+    return free_words < words * FDS_QUEUE_GC_LOW_PERCENT / 100
+           && stat.freeable_words >= words * FDS_QUEUE_GC_MIN_PERCENT / 100;
+}
+
 /**
  * @brief Determine whether the record exists.
  *
@@ -41,7 +181,7 @@ static bool fds_find_record(uint16_t id, uint16_t key, fds_record_desc_t *desc)
  */
 bool fds_is_exists(uint16_t id, uint16_t key) {
     fds_record_desc_t record_desc;
-    if (fds_find_record(id, key, &record_desc)) {
+    if (queue_find(id, key, false) >= 0 || fds_find_record(id, key, &record_desc)) {
         return true;
     }
     return false;
@@ -52,25 +192,39 @@ bool fds_is_exists(uint16_t id, uint16_t key) {
  *Read record
  * Length: set it to max length (size of buffer)
  * After execution, length is updated to the real flash record size
+ * A write still queued is read in place of the record
  */
 bool fds_read_sync(uint16_t id, uint16_t key, uint16_t *length, uint8_t *buffer) {
     ret_code_t          err_code;       //The results of the operation
     fds_flash_record_t  flash_record;   // Pointing to the actual information in Flash
     fds_record_desc_t   record_desc;    // Recorded handle
-    if (fds_find_record(id, key, &record_desc)) {
+    int index = queue_find(id, key, false);
+    if (index >= 0) {
+        if (m_queue[index].size <= *length) {
+            memcpy(buffer, &m_queue_pool[m_queue[index].offset], m_queue[index].size);
+            *length = m_queue[index].size;
+            return true;
+        }
+        NRF_LOG_INFO("FDS buffer too small, queued size = %d, buffer size = %d", m_queue[index].size, *length);
+    } else if (fds_find_record(id, key, &record_desc)) {
         err_code = fds_record_open(&record_desc, &flash_record);            //Open the record so that it is marked as the open state
         APP_ERROR_CHECK(err_code);
+        bool read = false;
         if (flash_record.p_header->length_words * 4 <= *length) {        // Read the data in Flash here to the given RAM
             // Make sure that the buffer will not overflow, read this record
             memcpy(buffer, flash_record.p_data, flash_record.p_header->length_words * 4);
             NRF_LOG_INFO("FDS read success.");
             *length = flash_record.p_header->length_words * 4;
-            return true;
+            read = true;
         } else {
             NRF_LOG_INFO("FDS buffer too small, can't run memcpy, fds size = %d, buffer size = %d", flash_record.p_header->length_words * 4, *length);
         }
-        err_code = fds_record_close(&record_desc);                          // Close the file after the operation is completed
+        // Close the file after the operation is completed, the GC skips the pages with records left open
+        err_code = fds_record_close(&record_desc);
         APP_ERROR_CHECK(err_code);
+        if (read) {
+            return true;
+        }
     }
     //If the correct data is not loaded, this record may not exist
     *length = 0;
@@ -106,22 +260,27 @@ static ret_code_t fds_write_record_nogc(uint16_t id, uint16_t key, uint16_t data
 }
 
 /**
- * Write record
+ * Write record, waits for the flash. It takes the place of a write of the record still queued.
  */
 bool fds_write_sync(uint16_t id, uint16_t key, uint16_t length, void *buffer) {
     // Make only one task running
     APP_ERROR_CHECK_BOOL(!fds_operation_info.waiting);
     // write result
     bool ret = true;
+    if (length == 0) {
+        return ret;
+    }
+    queue_wait();
+    if (queue_drop(id, key)) {
+        m_queue_stats.coalesced++;
+    }
+    m_queue_gc_check = true;
     // write or update record info cache
     fds_operation_info.id = id;
     fds_operation_info.key = key;
     fds_operation_info.success = false;
     fds_operation_info.waiting = true;
     // compute needed words
-    if (length == 0) {
-        return ret;
-    }
     uint16_t data_length_words = ((length - 1) / 4) + 1;
 
     // CCall the write implementation function without automatic GC
@@ -133,6 +292,7 @@ bool fds_write_sync(uint16_t id, uint16_t key, uint16_t length, void *buffer) {
     } else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH) {   //Make sure there is space to operate, otherwise GC will be required
         // The current error is an error with insufficient space. Maybe we need GC
         NRF_LOG_INFO("FDS no space, gc auto start.");
+        m_queue_stats.gc_full++;
         fds_gc_sync();
 
         // After the GC is completed, it can be re -operated
@@ -161,13 +321,106 @@ bool fds_write_sync(uint16_t id, uint16_t key, uint16_t length, void *buffer) {
     return ret;
 }
 
+/**
+ * Queue a write of the record, the data is copied. When the queue has no room, the oldest writes are done first.
+ * buffer: readable up to the next whole word, as for fds_write_sync()
+ */
+bool fds_write_async(uint16_t id, uint16_t key, uint16_t length, const void *buffer) {
+    if (length == 0) {
+        return true;
+    }
+    uint16_t size = ((length - 1) / 4 + 1) * 4;
+    if (size > sizeof(m_queue_pool)) {
+        return fds_write_sync(id, key, length, (void *)buffer);
+    }
+    // the last write of a record wins
+    if (queue_drop(id, key)) {
+        m_queue_stats.coalesced++;
+    }
+    while (m_queue_count == FDS_QUEUE_ENTRY_MAX || sizeof(m_queue_pool) - queue_pool_used() < size) {
+        m_queue_stats.stalls++;
+        if (m_queue_state == QUEUE_IDLE) {
+            queue_write_start();
+        }
+        queue_wait();
+    }
+    queue_entry_t *entry = &m_queue[m_queue_count];
+    entry->id = id;
+    entry->key = key;
+    entry->offset = queue_pool_used();
+    entry->size = size;
+    // whole words, as fds_write_sync() writes them
+    memcpy(&m_queue_pool[entry->offset], buffer, size);
+    m_queue_count++;
+    m_queue_stats.writes++;
+    if (m_queue_count > m_queue_stats.depth_max) {
+        m_queue_stats.depth_max = m_queue_count;
+    }
+    return true;
+}
+
+/**
+ * Write the first queued record, or collect the garbage when the flash runs short of free space, call when idle
+ * @return true while there is more to do, false when there is nothing to do
+ */
+bool fds_queue_process(void) {
+    if (m_queue_state != QUEUE_IDLE) {
+        if (!m_queue_done) {
+            return true;
+        }
+        queue_complete();
+    }
+    if (m_queue_count > 0) {
+        queue_write_start();
+        return true;
+    }
+    if (m_queue_gc_check) {
+        m_queue_gc_check = false;
+        if (queue_gc_due()) {
+            NRF_LOG_INFO("FDS free space low, gc start.");
+            m_queue_stats.gc_idle++;
+            queue_gc_start();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Write all the queued records now, before a sleep or a reset
+ */
+void fds_queue_flush(void) {
+    queue_wait();
+    while (m_queue_count > 0) {
+        queue_write_start();
+        queue_wait();
+    }
+}
+
+void fds_queue_get_stats(fds_queue_stats_t *stats) {
+    *stats = m_queue_stats;
+    stats->depth = m_queue_count;
+    stats->bytes = queue_pool_used();
+}
+
+/**
+ * Set the callback told of a queued write dropped. It runs inside the queue: it notes the record to write later,
+ * it does not write it.
+ */
+void on_fds_write_failed(fds_write_failed_t callback) {
+    m_write_failed = callback;
+}
+
 /*
- * Delete Record
+ * Delete Record, and the write of it still queued: counted as a record deleted if it was not in flash
  */
 int fds_delete_sync(uint16_t id, uint16_t key) {
     int                 delete_count = 0;
     fds_record_desc_t   record_desc;
     ret_code_t          err_code;
+    queue_wait();
+    bool dropped = queue_drop(id, key);
+    m_queue_gc_check = true;
     while (fds_find_record(id, key, &record_desc)) {
         fds_operation_info.success = false;
         fds_record_id_from_desc(&record_desc, &fds_operation_info.record_id);
@@ -178,7 +431,7 @@ int fds_delete_sync(uint16_t id, uint16_t key) {
             __NOP();
         }; //Waiting for operation to complete
     }
-    return delete_count;
+    return delete_count == 0 && dropped ? 1 : delete_count;
 }
 
 static bool is_peer_manager_record(uint16_t id_or_key) {
@@ -218,7 +471,10 @@ static void fds_evt_handler(fds_evt_t const *p_evt) {
         case FDS_EVT_UPDATE: {
             if (p_evt->result == NRF_SUCCESS) {
                 NRF_LOG_INFO("Record change: FileID 0x%04x, RecordKey 0x%04x", p_evt->write.file_id, p_evt->write.record_key);
-                if (p_evt->write.file_id == fds_operation_info.id && p_evt->write.record_key == fds_operation_info.key) {
+                if (m_queue_state == QUEUE_WRITING && p_evt->write.file_id == m_queue[0].id && p_evt->write.record_key == m_queue[0].key) {
+                    // The queued write started last is completed, fds_queue_process() takes it out of the queue
+                    m_queue_done = true;
+                } else if (p_evt->write.file_id == fds_operation_info.id && p_evt->write.record_key == fds_operation_info.key) {
                     // The logic above has ensured that the task we are currently writing is completed!
                     NRF_LOG_INFO("Record change success");
                     fds_operation_info.success = true;
@@ -250,7 +506,11 @@ static void fds_evt_handler(fds_evt_t const *p_evt) {
         case FDS_EVT_GC: {
             if (p_evt->result == NRF_SUCCESS) {
                 NRF_LOG_INFO("FDS gc success");
-                fds_operation_info.success = true;
+                if (m_queue_state == QUEUE_COLLECTING) {
+                    m_queue_done = true;
+                } else {
+                    fds_operation_info.success = true;
+                }
             } else {
                 NRF_LOG_INFO("FDS gc failed");
                 APP_ERROR_CHECK(p_evt->result);
@@ -270,6 +530,11 @@ void fds_util_init() {
     fds_operation_info.ignore_pm = true;
     // reset waiting flag
     fds_operation_info.waiting = false;
+    m_queue_count = 0;
+    m_queue_state = QUEUE_IDLE;
+    m_queue_gc_tried = false;
+    m_queue_gc_check = true;
+    memset(&m_queue_stats, 0, sizeof(m_queue_stats));
     //Register the incident first
     ret_code_t err_code = fds_register(fds_evt_handler);
     APP_ERROR_CHECK(err_code);
@@ -279,6 +544,7 @@ void fds_util_init() {
 }
 
 void fds_gc_sync(void) {
+    queue_wait();
     fds_operation_info.success = false;
     ret_code_t err_code = fds_gc();
     APP_ERROR_CHECK(err_code);
@@ -315,6 +581,9 @@ static bool fds_next_record_delete_sync() {
 
 bool fds_wipe(void) {
     NRF_LOG_INFO("Full fds wipe requested");
+    // the queued writes are dropped with the rest
+    queue_wait();
+    m_queue_count = 0;
     fds_operation_info.ignore_pm = false;  // wipe should also delete peer manager files.
     while (fds_next_record_delete_sync()) {
         bsp_wdt_feed();
@@ -3,13 +3,46 @@
 
 #include "fds.h"
 
+/*
+ * Writes queued in RAM, done one at a time by fds_queue_process() while the device is idle: a slot save or a nick
+ * update does not wait for the flash. A write replaces the one queued for the same record, the last one wins. The
+ * reads, fds_is_exists() and the deletes see the queued writes, the other sync helpers wait for the write in
+ * progress. When the flash runs short of free space the garbage is collected while idle, before a write finds no
+ * room and collects it itself. A write that finds no room even then is dropped, and reported to the callback set by
+ * on_fds_write_failed(): the caller was told it was queued.
+ */
+#define FDS_QUEUE_POOL_SIZE         4608    // bytes of queued data, an HF image of a slot in chunks
+#define FDS_QUEUE_ENTRY_MAX         32
+// The idle GC runs when the free words of the data pages fall below the low watermark, and it frees enough of them
+#define FDS_QUEUE_GC_LOW_PERCENT    25
+#define FDS_QUEUE_GC_MIN_PERCENT    5
+
+typedef struct {
+    uint16_t depth;         // records queued, the one being written included
+    uint16_t bytes;         // of the pool they take
+    uint16_t depth_max;     // most records queued at once
+    uint32_t writes;        // fds_write_async() calls
+    uint32_t coalesced;     // queued writes replaced by a later write of the same record before they were done
+    uint32_t stalls;        // times a write waited for room in the queue
+    uint32_t failures;      // writes dropped, no room in flash after a GC
+    uint32_t gc_idle;       // GC run by the watermarks
+    uint32_t gc_full;       // GC run by a write that found no room
+} fds_queue_stats_t;
+
+// A queued write dropped, no room in flash after a GC
+typedef void (*fds_write_failed_t)(uint16_t id, uint16_t key);
 
 bool fds_read_sync(uint16_t id, uint16_t key, uint16_t *length, uint8_t *buffer);
 bool fds_write_sync(uint16_t id, uint16_t key, uint16_t length, void *buffer);
+bool fds_write_async(uint16_t id, uint16_t key, uint16_t length, const void *buffer);
 int fds_delete_sync(uint16_t id, uint16_t key);
 bool fds_is_exists(uint16_t id, uint16_t key);
 void fds_util_init(void);
 void fds_gc_sync(void);
 bool fds_wipe(void);
+bool fds_queue_process(void);
+void fds_queue_flush(void);
+void fds_queue_get_stats(fds_queue_stats_t *stats);
+void on_fds_write_failed(fds_write_failed_t callback);
 
 #endif
@@ -0,0 +1,178 @@
+#include <string.h>
+
+#include "lz4_block.h"
+
+#define MIN_MATCH       4
+#define MF_LIMIT        12      // a match starts at least this far from the end
+#define LAST_LITERALS   5       // the block ends with at least this many literals
+#define RUN_MASK        15
+
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint16_t hash32(uint32_t value) {
+    return (value * 2654435761U) >> (32 - LZ4_BLOCK_HASH_LOG);
+}
+
+static uint16_t length_bytes(uint16_t length) {
+    return length >= RUN_MASK ? (length - RUN_MASK) / 255 + 1 : 0;
+}
+
+static uint8_t *write_length(uint8_t *op, uint16_t length) {
+    length -= RUN_MASK;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = length;
+    return op;
+}
+
+/**
+ * @brief Write a sequence: literals, then a match (match_length 0 for the last sequence, which has none)
+ * @return the end of the output, NULL if it would go past dst_end
+ */
+static uint8_t *write_sequence(uint8_t *op, uint8_t *dst_end, const uint8_t *literals, uint16_t literal_length,
+                               uint16_t offset, uint16_t match_length) {
+    uint16_t needed = 1 + length_bytes(literal_length) + literal_length;
+    if (offset != 0) {
+        needed += 2 + length_bytes(match_length - MIN_MATCH);
+    }
+    if (op + needed > dst_end) {
+        return NULL;
+    }
+    uint8_t *token = op++;
+    *token = (literal_length < RUN_MASK ? literal_length : RUN_MASK) << 4;
+    if (literal_length >= RUN_MASK) {
+        op = write_length(op, literal_length);
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (offset != 0) {
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        match_length -= MIN_MATCH;
+        *token |= match_length < RUN_MASK ? match_length : RUN_MASK;
+        if (match_length >= RUN_MASK) {
+            op = write_length(op, match_length);
+        }
+    }
+    return op;
+}
+
+/**
+ * @brief Compress a buffer of up to 64 KiB in the LZ4 block format
+ * @param table: LZ4_BLOCK_HASH_SIZE entries, scratch
+ * @return compressed length, 0 if it does not fit in dst_max bytes
+ */
+uint16_t lz4_block_compress(const uint8_t *src, uint16_t length, uint8_t *dst, uint16_t dst_max, uint16_t *table) {
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *src_end = src + length;
+    uint8_t *op = dst;
+    uint8_t *dst_end = dst + dst_max;
+
+    if (length > MF_LIMIT) {
+        const uint8_t *match_start_limit = src_end - MF_LIMIT;
+        const uint8_t *match_end_limit = src_end - LAST_LITERALS;
+        memset(table, 0, LZ4_BLOCK_HASH_SIZE * sizeof(uint16_t));
+        ip++;
+        while (ip < match_start_limit) {
+            uint32_t sequence = read32(ip);
+            uint16_t hash = hash32(sequence);
+            const uint8_t *ref = src + table[hash];
+            table[hash] = ip - src;
+            if (ref >= ip || read32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+            // the match may begin in the pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *match_end = ip + MIN_MATCH;
+            ref += MIN_MATCH;
+            while (match_end < match_end_limit && *match_end == *ref) {
+                match_end++;
+                ref++;
+            }
+            op = write_sequence(op, dst_end, anchor, ip - anchor, match_end - ref, match_end - ip);
+            if (op == NULL) {
+                return 0;
+            }
+            // index a position inside the match, helps the runs of the dumps
+            if (match_end - 2 > ip) {
+                table[hash32(read32(match_end - 2))] = match_end - 2 - src;
+            }
+            ip = match_end;
+            anchor = ip;
+        }
+    }
+    op = write_sequence(op, dst_end, anchor, src_end - anchor, 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+    return op - dst;
+}
+
+static const uint8_t *read_length(const uint8_t *ip, const uint8_t *src_end, uint16_t *length) {
+    uint8_t more;
+    do {
+        if (ip >= src_end) {
+            return NULL;
+        }
+        more = *ip++;
+        *length += more;
+    } while (more == 255);
+    return ip;
+}
+
+/**
+ * @brief Decompress a block of the LZ4 block format
+ * @return decompressed length, -1 if the block is malformed or does not fit in dst_max bytes
+ */
+int lz4_block_decompress(const uint8_t *src, uint16_t length, uint8_t *dst, uint16_t dst_max) {
+    const uint8_t *ip = src;
+    const uint8_t *src_end = src + length;
+    uint16_t out = 0;
+    while (ip < src_end) {
+        uint8_t token = *ip++;
+        uint16_t literal_length = token >> 4;
+        if (literal_length == RUN_MASK && (ip = read_length(ip, src_end, &literal_length)) == NULL) {
+            return -1;
+        }
+        if (literal_length > src_end - ip || literal_length > dst_max - out) {
+            return -1;
+        }
+        memcpy(&dst[out], ip, literal_length);
+        ip += literal_length;
+        out += literal_length;
+        if (ip == src_end) {
+            break;      // last sequence, literals only
+        }
+        if (src_end - ip < 2) {
+            return -1;
+        }
+        uint16_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        uint16_t match_length = token & RUN_MASK;
+        if (match_length == RUN_MASK && (ip = read_length(ip, src_end, &match_length)) == NULL) {
+            return -1;
+        }
+        match_length += MIN_MATCH;
+        if (offset == 0 || offset > out || match_length > dst_max - out) {
+            return -1;
+        }
+        // byte by byte, the match may overlap what it writes
+        for (uint8_t *op = &dst[out], *end = op + match_length; op < end; op++) {
+            *op = op[-offset];
+        }
+        out += match_length;
+    }
+    return out;
+}
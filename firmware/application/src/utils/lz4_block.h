@@ -0,0 +1,18 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <stdint.h>
+
+/**
+ * Compressor of the LZ4 block format, sized for one data frame:
+ * no dictionary, no frame header, any LZ4 block decoder reads the output.
+ * Greedy matching with a hash table of LZ4_BLOCK_HASH_SIZE positions given by the caller.
+ * The decoder reads the blocks the firmware keeps for itself, the slot images of the slot cache.
+ */
+#define LZ4_BLOCK_HASH_LOG      10
+#define LZ4_BLOCK_HASH_SIZE     (1 << LZ4_BLOCK_HASH_LOG)
+
+uint16_t lz4_block_compress(const uint8_t *src, uint16_t length, uint8_t *dst, uint16_t dst_max, uint16_t *table);
+int lz4_block_decompress(const uint8_t *src, uint16_t length, uint8_t *dst, uint16_t dst_max);
+
+#endif
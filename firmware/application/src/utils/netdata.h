@@ -35,6 +35,9 @@ typedef struct {
 
 #define NETDATA_FRAME_SOF 0x11
 
+// Status flag of a response whose data is a LZ4 block, once the client enabled it (DATA_CMD_SET_FRAME_COMPRESSION)
+#define NETDATA_STATUS_COMPRESSED   0x8000
+
 typedef struct {
     uint8_t lrc3;
 } PACKED netdata_frame_postamble_t;
@@ -0,0 +1,105 @@
+#include "tx_frame_queue.h"
+
+
+void tx_frame_queue_init(tx_frame_queue_t *queue) {
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        queue->state[i] = TX_FRAME_FREE;
+    }
+    queue->queued_head = 0;
+    queue->queued_count = 0;
+    queue->sending = -1;
+}
+
+/**
+ * @brief Take a free frame to build a response in
+ * @return frame index, -1 when all the frames are in flight (back-pressure, wait for tx_frame_queue_done)
+ */
+int tx_frame_queue_acquire(tx_frame_queue_t *queue) {
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        if (queue->state[i] == TX_FRAME_FREE) {
+            queue->state[i] = TX_FRAME_FILLING;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Give back a frame that won't be sent, or that was sent by a transport which copies the data
+ */
+void tx_frame_queue_discard(tx_frame_queue_t *queue, int index) {
+    if (queue->state[index] == TX_FRAME_FILLING) {
+        queue->state[index] = TX_FRAME_FREE;
+    }
+}
+
+/**
+ * @brief Give back the frames left unsent by the handlers, once a command is over
+ */
+void tx_frame_queue_discard_filling(tx_frame_queue_t *queue) {
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        tx_frame_queue_discard(queue, i);
+    }
+}
+
+/**
+ * @brief Queue a complete frame, frames are sent in commit order
+ */
+void tx_frame_queue_commit(tx_frame_queue_t *queue, int index) {
+    if (queue->state[index] != TX_FRAME_FILLING) {
+        return;
+    }
+    queue->state[index] = TX_FRAME_QUEUED;
+    queue->queued[(queue->queued_head + queue->queued_count) % TX_FRAME_QUEUE_DEPTH] = index;
+    queue->queued_count++;
+}
+
+/**
+ * @brief Hand the oldest queued frame to the transport
+ * @return frame index, -1 if there is none or if the transport is still busy with the previous one
+ */
+int tx_frame_queue_start(tx_frame_queue_t *queue) {
+    if (queue->sending >= 0 || queue->queued_count == 0) {
+        return -1;
+    }
+    int index = queue->queued[queue->queued_head];
+    queue->queued_head = (queue->queued_head + 1) % TX_FRAME_QUEUE_DEPTH;
+    queue->queued_count--;
+    queue->state[index] = TX_FRAME_SENDING;
+    queue->sending = index;
+    return index;
+}
+
+/**
+ * @brief The transport is done with the frame it was sending
+ */
+void tx_frame_queue_done(tx_frame_queue_t *queue) {
+    if (queue->sending < 0) {
+        return;
+    }
+    queue->state[queue->sending] = TX_FRAME_FREE;
+    queue->sending = -1;
+}
+
+/**
+ * @brief The transport is gone: drop the queued frames and the one being sent,
+ *        the frames being filled stay with their handlers.
+ */
+void tx_frame_queue_drop_pending(tx_frame_queue_t *queue) {
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        if (queue->state[i] == TX_FRAME_QUEUED || queue->state[i] == TX_FRAME_SENDING) {
+            queue->state[i] = TX_FRAME_FREE;
+        }
+    }
+    queue->queued_head = 0;
+    queue->queued_count = 0;
+    queue->sending = -1;
+}
+
+uint8_t tx_frame_queue_count(const tx_frame_queue_t *queue, tx_frame_state_t state) {
+    uint8_t count = 0;
+    for (int i = 0; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        count += queue->state[i] == state;
+    }
+    return count;
+}
@@ -0,0 +1,42 @@
+#ifndef TX_FRAME_QUEUE_H
+#define TX_FRAME_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TX_FRAME_QUEUE_DEPTH    2
+
+/**
+ * State of a fixed set of response frames sent by a transport that keeps the buffer
+ * until the transfer is done (USB CDC): the next frames are built while the previous one drains.
+ * Only frame indexes are handled here, no SDK dependency, the caller serializes the accesses.
+ *
+ *   FREE -> acquire -> FILLING -> commit -> QUEUED -> start -> SENDING -> done -> FREE
+ *   FILLING -> discard -> FREE
+ */
+typedef enum {
+    TX_FRAME_FREE,
+    TX_FRAME_FILLING,   // a command handler is writing it
+    TX_FRAME_QUEUED,    // complete, waiting for the transport
+    TX_FRAME_SENDING,   // owned by the transport
+} tx_frame_state_t;
+
+typedef struct {
+    tx_frame_state_t state[TX_FRAME_QUEUE_DEPTH];
+    uint8_t queued[TX_FRAME_QUEUE_DEPTH];   // frame indexes in commit order
+    uint8_t queued_head;
+    uint8_t queued_count;
+    int8_t sending;                         // frame index, -1 when the transport is idle
+} tx_frame_queue_t;
+
+void tx_frame_queue_init(tx_frame_queue_t *queue);
+int tx_frame_queue_acquire(tx_frame_queue_t *queue);
+void tx_frame_queue_discard(tx_frame_queue_t *queue, int index);
+void tx_frame_queue_discard_filling(tx_frame_queue_t *queue);
+void tx_frame_queue_commit(tx_frame_queue_t *queue, int index);
+int tx_frame_queue_start(tx_frame_queue_t *queue);
+void tx_frame_queue_done(tx_frame_queue_t *queue);
+void tx_frame_queue_drop_pending(tx_frame_queue_t *queue);
+uint8_t tx_frame_queue_count(const tx_frame_queue_t *queue, tx_frame_state_t state);
+
+#endif
@@ -0,0 +1,70 @@
+#include <string.h>
+
+#include "tx_ring.h"
+
+
+void tx_ring_init(tx_ring_t *ring, uint8_t *buffer, uint16_t size) {
+    ring->buffer = buffer;
+    ring->size = size;
+    tx_ring_reset(ring);
+}
+
+void tx_ring_reset(tx_ring_t *ring) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->used = 0;
+}
+
+uint16_t tx_ring_used(const tx_ring_t *ring) {
+    return ring->used;
+}
+
+uint16_t tx_ring_free(const tx_ring_t *ring) {
+    return ring->size - ring->used;
+}
+
+/**
+ * @brief Queue a whole frame
+ * @return false if there is not enough room, nothing is queued then
+ */
+bool tx_ring_push(tx_ring_t *ring, const uint8_t *data, uint16_t length) {
+    if (length > tx_ring_free(ring)) {
+        return false;
+    }
+    uint16_t first = ring->size - ring->head;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&ring->buffer[ring->head], data, first);
+    memcpy(ring->buffer, data + first, length - first);
+    ring->head = (ring->head + length) % ring->size;
+    ring->used += length;
+    return true;
+}
+
+/**
+ * @brief Send the queued bytes in chunks of chunk_max bytes until the queue is empty or send refuses a chunk.
+ *        A chunk crossing the end of the buffer is copied in chunk, so all chunks but the last are full.
+ * @param chunk scratch buffer of chunk_max bytes, send must be done with it when it returns
+ * @return number of bytes sent
+ */
+uint16_t tx_ring_drain(tx_ring_t *ring, uint8_t *chunk, uint16_t chunk_max, tx_ring_send_t send) {
+    uint16_t sent = 0;
+    while (ring->used > 0) {
+        uint16_t length = ring->used < chunk_max ? ring->used : chunk_max;
+        uint8_t *data = &ring->buffer[ring->tail];
+        uint16_t first = ring->size - ring->tail;
+        if (first < length) {
+            memcpy(chunk, data, first);
+            memcpy(chunk + first, ring->buffer, length - first);
+            data = chunk;
+        }
+        if (!send(data, length)) {
+            break;
+        }
+        ring->tail = (ring->tail + length) % ring->size;
+        ring->used -= length;
+        sent += length;
+    }
+    return sent;
+}
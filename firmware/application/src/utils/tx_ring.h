@@ -0,0 +1,29 @@
+#ifndef TX_RING_H
+#define TX_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Byte ring buffer for outgoing frames, a frame is queued whole or not at all.
+ * No SDK dependency, the caller serializes the accesses from different contexts.
+ */
+typedef struct {
+    uint8_t *buffer;
+    uint16_t size;
+    uint16_t head;      // next byte written
+    uint16_t tail;      // next byte sent
+    uint16_t used;
+} tx_ring_t;
+
+// Send one chunk, return false if the transport can't take it now (it stays queued)
+typedef bool (*tx_ring_send_t)(uint8_t *data, uint16_t length);
+
+void tx_ring_init(tx_ring_t *ring, uint8_t *buffer, uint16_t size);
+void tx_ring_reset(tx_ring_t *ring);
+uint16_t tx_ring_used(const tx_ring_t *ring);
+uint16_t tx_ring_free(const tx_ring_t *ring);
+bool tx_ring_push(tx_ring_t *ring, const uint8_t *data, uint16_t length);
+uint16_t tx_ring_drain(tx_ring_t *ring, uint8_t *chunk, uint16_t chunk_max, tx_ring_send_t send);
+
+#endif
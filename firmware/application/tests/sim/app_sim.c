@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_sim.h"
+#include "ble_main.h"
+#include "delayed_reset.h"
+#include "hw_connect.h"
+#include "usb_main.h"
+// src/rfid_main.h, the one of sim/tag/ leaves the device mode out
+#include "../../src/rfid_main.h"
+
+static app_sim_frame_t m_frames[APP_SIM_FRAMES_MAX];
+static uint16_t m_frame_count;
+
+uint16_t batt_lvl_in_milli_volts;
+uint8_t percentage_batt_lvl;
+
+void app_sim_reset(void) {
+    m_frame_count = 0;
+}
+
+uint16_t app_sim_frame_count(void) {
+    return m_frame_count;
+}
+
+const app_sim_frame_t *app_sim_frame(uint16_t index) {
+    return index < m_frame_count ? &m_frames[index] : NULL;
+}
+
+//---------------------------------------------------------------------------- BLE, the link of the responses
+
+bool is_nus_working(void) {
+    return true;
+}
+
+bool nus_data_response(uint8_t *p_data, uint16_t length) {
+    netdata_frame_raw_t *raw = (netdata_frame_raw_t *)p_data;
+    uint16_t data_length = U16NTOHS(raw->pre.len);
+    if (m_frame_count == APP_SIM_FRAMES_MAX || raw->pre.sof != NETDATA_FRAME_SOF
+            || length != sizeof(netdata_frame_preamble_t) + data_length + sizeof(netdata_frame_postamble_t)) {
+        printf("app_sim: frame dropped\n");
+        abort();
+    }
+    app_sim_frame_t *frame = &m_frames[m_frame_count++];
+    frame->cmd = U16NTOHS(raw->pre.cmd);
+    frame->status = U16NTOHS(raw->pre.status);
+    frame->length = data_length;
+    memcpy(frame->data, raw->data, data_length);
+    return true;
+}
+
+void ble_get_link_status(ble_link_status_t *p_status) {
+    memset(p_status, 0, sizeof(*p_status));
+    p_status->connected = true;
+}
+
+void advertising_stop(void) {
+}
+
+void delete_bonds_all(void) {
+}
+
+//---------------------------------------------------------------------------- USB, not connected
+
+bool is_usb_working(void) {
+    return false;
+}
+
+void usb_cdc_tx_start(void) {
+}
+
+//---------------------------------------------------------------------------- device
+
+chameleon_device_type_t hw_get_device_type(void) {
+    return CHAMELEON_LITE;
+}
+
+device_mode_t get_device_mode(void) {
+    return DEVICE_MODE_TAG;
+}
+
+void apply_slot_change(uint8_t slot_now, uint8_t slot_new) {
+}
+
+void delayed_reset(uint32_t delay) {
+}
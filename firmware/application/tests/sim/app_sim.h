@@ -0,0 +1,28 @@
+#ifndef APP_SIM_H
+#define APP_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "netdata.h"
+
+/*
+ * The device around app_cmd.c for its host builds: the responses go to a BLE link which keeps a copy of each frame,
+ * the other transports, the power and the reset do nothing. The settings are the real settings.c, on the simulated
+ * flash. A frame is looked at the way a client gets it, preamble fields in host order.
+ */
+#define APP_SIM_FRAMES_MAX      16
+
+typedef struct {
+    uint16_t cmd;
+    uint16_t status;
+    uint16_t length;
+    uint8_t data[NETDATA_MAX_DATA_LENGTH];
+} app_sim_frame_t;
+
+// Forgets the frames sent so far
+void app_sim_reset(void);
+uint16_t app_sim_frame_count(void);
+const app_sim_frame_t *app_sim_frame(uint16_t index);
+
+#endif
@@ -0,0 +1,389 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fds.h"
+#include "fds_sim.h"
+#include "bsp_wdt.h"
+
+#define PAGE_TAG_WORDS      2
+#define HEADER_WORDS        3
+#define PAGE_TAG_MAGIC      0xDEADC0DE
+#define PAGE_TAG_SWAP       0xF11E01FF
+#define PAGE_TAG_DATA       0xF11E01FE      // one bit cleared from the swap tag, the swap page is promoted in place
+#define DIRTY_TL            0xFFFF0000      // written over the key and length word, clears the key
+
+typedef struct {
+    uint32_t *words;
+    uint16_t write_offset;
+    uint16_t records_open;
+    bool can_gc;
+} page_t;
+
+static uint32_t m_flash[FDS_SIM_PAGES_MAX][FDS_SIM_PAGE_WORDS];
+
+static struct {
+    page_t pages[FDS_SIM_PAGES_MAX - 1];
+    uint32_t *swap;
+    uint16_t data_pages;
+    uint16_t gc_run_count;
+    uint32_t last_record_id;
+    fds_cb_t handler;
+    fds_sim_stats_t stats;
+    bool defer;
+    fds_evt_t events[FDS_SIM_EVENTS_MAX];
+    uint16_t event_count;
+} m_fds;
+
+
+//---------------------------------------------------------------------------- flash
+
+// Programming only clears bits, as the NVMC does; the source is any object, a record header or the user data
+static void flash_write(uint32_t *dst, const void *src, uint16_t words) {
+    for (uint16_t i = 0; i < words; i++) {
+        uint32_t word;
+        memcpy(&word, (const uint8_t *)src + i * sizeof(word), sizeof(word));
+        dst[i] &= word;
+    }
+    m_fds.stats.words_written += words;
+    m_fds.stats.flash_us += (uint64_t)words * FDS_SIM_WRITE_US;
+}
+
+static void flash_erase(uint32_t *page) {
+    memset(page, 0xFF, FDS_SIM_PAGE_WORDS * sizeof(uint32_t));
+    m_fds.stats.page_erases += FDS_SIM_PAGE_WORDS / FDS_SIM_PHY_PAGE_WORDS;
+    m_fds.stats.flash_us += (uint64_t)FDS_SIM_PAGE_WORDS / FDS_SIM_PHY_PAGE_WORDS * FDS_SIM_ERASE_US;
+}
+
+static void page_tag(uint32_t *page, uint32_t type) {
+    const uint32_t tag[PAGE_TAG_WORDS] = { PAGE_TAG_MAGIC, type };
+    flash_write(page, tag, PAGE_TAG_WORDS);
+}
+
+void fds_sim_format(uint16_t pages) {
+    if (pages < 2 || pages > FDS_SIM_PAGES_MAX) {
+        abort();
+    }
+    memset(m_flash, 0xFF, sizeof(m_flash));
+    m_fds.data_pages = pages - 1;
+    for (uint16_t i = 0; i < m_fds.data_pages; i++) {
+        m_fds.pages[i] = (page_t) { .words = m_flash[i], .write_offset = PAGE_TAG_WORDS };
+        page_tag(m_flash[i], PAGE_TAG_DATA);
+    }
+    m_fds.swap = m_flash[m_fds.data_pages];
+    page_tag(m_fds.swap, PAGE_TAG_SWAP);
+    m_fds.gc_run_count = 0;
+    m_fds.last_record_id = 0;
+    m_fds.event_count = 0;
+    memset(&m_fds.stats, 0, sizeof(m_fds.stats));
+}
+
+fds_sim_stats_t *fds_sim_stats(void) {
+    return &m_fds.stats;
+}
+
+// fds_wipe() feeds the watchdog between records
+void bsp_wdt_feed(void) {
+}
+
+
+//---------------------------------------------------------------------------- records
+
+static const fds_header_t *header_of(const uint32_t *record) {
+    return (const fds_header_t *)record;
+}
+
+static bool record_is_valid(const uint32_t *record) {
+    return header_of(record)->record_key != FDS_RECORD_KEY_DIRTY && header_of(record)->file_id != FDS_FILE_ID_INVALID;
+}
+
+// The record after the given one on the page, the first with NULL, dirty ones included
+static const uint32_t *record_next(const page_t *page, const uint32_t *record) {
+    const uint32_t *next = record == NULL ? page->words + PAGE_TAG_WORDS
+                           : record + HEADER_WORDS + header_of(record)->length_words;
+    return next < page->words + page->write_offset ? next : NULL;
+}
+
+static page_t *page_of(const uint32_t *record) {
+    for (uint16_t i = 0; i < m_fds.data_pages; i++) {
+        if (record >= m_fds.pages[i].words && record < m_fds.pages[i].words + FDS_SIM_PAGE_WORDS) {
+            return &m_fds.pages[i];
+        }
+    }
+    return NULL;
+}
+
+static const uint32_t *record_by_id(uint32_t record_id) {
+    for (uint16_t i = 0; i < m_fds.data_pages; i++) {
+        for (const uint32_t *record = record_next(&m_fds.pages[i], NULL); record != NULL; record = record_next(&m_fds.pages[i], record)) {
+            if (record_is_valid(record) && header_of(record)->record_id == record_id) {
+                return record;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Where the record of the descriptor is now, a garbage collection may have moved it
+static const uint32_t *record_locate(fds_record_desc_t *desc) {
+    if (desc->p_record == NULL || desc->gc_run_count != m_fds.gc_run_count) {
+        desc->p_record = record_by_id(desc->record_id);
+        desc->gc_run_count = m_fds.gc_run_count;
+    }
+    if (desc->p_record == NULL || !record_is_valid(desc->p_record)) {
+        return NULL;
+    }
+    return desc->p_record;
+}
+
+static void desc_set(fds_record_desc_t *desc, const uint32_t *record) {
+    desc->record_id = header_of(record)->record_id;
+    desc->p_record = record;
+    desc->gc_run_count = m_fds.gc_run_count;
+    desc->record_is_open = false;
+}
+
+static void raise_event(const fds_evt_t *evt) {
+    if (m_fds.defer) {
+        if (m_fds.event_count == FDS_SIM_EVENTS_MAX) {
+            abort();
+        }
+        m_fds.events[m_fds.event_count++] = *evt;
+    } else if (m_fds.handler != NULL) {
+        m_fds.handler(evt);
+    }
+}
+
+void fds_sim_defer_events(bool defer) {
+    m_fds.defer = defer;
+}
+
+uint16_t fds_sim_raise_events(void) {
+    uint16_t count = m_fds.event_count;
+    m_fds.event_count = 0;
+    for (uint16_t i = 0; i < count && m_fds.handler != NULL; i++) {
+        m_fds.handler(&m_fds.events[i]);
+    }
+    return count;
+}
+
+static ret_code_t record_find(bool any, uint16_t file_id, uint16_t record_key, fds_record_desc_t *desc, fds_find_token_t *token) {
+    for (uint16_t i = token->page; i < m_fds.data_pages; i++) {
+        const uint32_t *record = token->p_addr;
+        if (record != NULL && page_of(record) != &m_fds.pages[i]) {
+            record = NULL;
+        }
+        while ((record = record_next(&m_fds.pages[i], record)) != NULL) {
+            const fds_header_t *header = header_of(record);
+            if (record_is_valid(record) && (any || (header->file_id == file_id && header->record_key == record_key))) {
+                token->page = i;
+                token->p_addr = record;
+                desc_set(desc, record);
+                return NRF_SUCCESS;
+            }
+        }
+        token->p_addr = NULL;
+    }
+    return FDS_ERR_NOT_FOUND;
+}
+
+static ret_code_t record_write(fds_record_t const *p_record, const uint32_t **written) {
+    uint16_t length_words = p_record->data.length_words;
+    if (((uintptr_t)p_record->data.p_data & 3) != 0) {
+        return FDS_ERR_UNALIGNED_ADDR;
+    }
+    if (p_record->file_id == FDS_FILE_ID_INVALID || p_record->key == FDS_RECORD_KEY_DIRTY) {
+        return FDS_ERR_INVALID_ARG;
+    }
+    if (length_words + HEADER_WORDS > FDS_SIM_PAGE_WORDS - PAGE_TAG_WORDS) {
+        return FDS_ERR_RECORD_TOO_LARGE;
+    }
+    for (uint16_t i = 0; i < m_fds.data_pages; i++) {
+        page_t *page = &m_fds.pages[i];
+        if (page->write_offset + HEADER_WORDS + length_words > FDS_SIM_PAGE_WORDS) {
+            continue;
+        }
+        uint32_t *record = page->words + page->write_offset;
+        fds_header_t header = {
+            .record_key = p_record->key, .length_words = length_words, .file_id = p_record->file_id,
+            .crc16 = 0xFFFF, .record_id = ++m_fds.last_record_id,
+        };
+        // the data first, the header makes the record valid
+        flash_write(record + HEADER_WORDS, p_record->data.p_data, length_words);
+        flash_write(record, &header, HEADER_WORDS);
+        page->write_offset += HEADER_WORDS + length_words;
+        m_fds.stats.records_written++;
+        *written = record;
+        return NRF_SUCCESS;
+    }
+    return FDS_ERR_NO_SPACE_IN_FLASH;
+}
+
+static void record_flag_dirty(const uint32_t *record) {
+    const uint32_t dirty = DIRTY_TL;
+    flash_write((uint32_t *)record, &dirty, 1);
+    page_of(record)->can_gc = true;
+}
+
+
+//---------------------------------------------------------------------------- API
+
+ret_code_t fds_register(fds_cb_t cb) {
+    m_fds.handler = cb;
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_init(void) {
+    if (m_fds.data_pages == 0) {
+        fds_sim_format(FDS_SIM_PAGES_MAX);
+    }
+    fds_evt_t evt = { .id = FDS_EVT_INIT, .result = NRF_SUCCESS };
+    raise_event(&evt);
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_write(fds_record_desc_t *p_desc, fds_record_t const *p_record) {
+    const uint32_t *record;
+    ret_code_t ret = record_write(p_record, &record);
+    if (ret != NRF_SUCCESS) {
+        return ret;
+    }
+    if (p_desc != NULL) {
+        desc_set(p_desc, record);
+    }
+    fds_evt_t evt = { .id = FDS_EVT_WRITE, .result = NRF_SUCCESS };
+    evt.write.record_id = header_of(record)->record_id;
+    evt.write.file_id = p_record->file_id;
+    evt.write.record_key = p_record->key;
+    raise_event(&evt);
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_update(fds_record_desc_t *p_desc, fds_record_t const *p_record) {
+    const uint32_t *old = record_locate(p_desc);
+    if (old == NULL) {
+        return FDS_ERR_NOT_FOUND;
+    }
+    const uint32_t *record;
+    ret_code_t ret = record_write(p_record, &record);
+    if (ret != NRF_SUCCESS) {
+        return ret;
+    }
+    record_flag_dirty(old);
+    desc_set(p_desc, record);
+    fds_evt_t evt = { .id = FDS_EVT_UPDATE, .result = NRF_SUCCESS };
+    evt.write.record_id = header_of(record)->record_id;
+    evt.write.file_id = p_record->file_id;
+    evt.write.record_key = p_record->key;
+    evt.write.is_record_updated = true;
+    raise_event(&evt);
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_delete(fds_record_desc_t *p_desc) {
+    const uint32_t *record = record_locate(p_desc);
+    if (record == NULL) {
+        return FDS_ERR_NOT_FOUND;
+    }
+    fds_evt_t evt = { .id = FDS_EVT_DEL_RECORD, .result = NRF_SUCCESS };
+    evt.del.record_id = header_of(record)->record_id;
+    evt.del.file_id = header_of(record)->file_id;
+    evt.del.record_key = header_of(record)->record_key;
+    record_flag_dirty(record);
+    raise_event(&evt);
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_iterate(fds_record_desc_t *p_desc, fds_find_token_t *p_token) {
+    return record_find(true, 0, 0, p_desc, p_token);
+}
+
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t *p_desc, fds_find_token_t *p_token) {
+    return record_find(false, file_id, record_key, p_desc, p_token);
+}
+
+ret_code_t fds_record_open(fds_record_desc_t *p_desc, fds_flash_record_t *p_flash_record) {
+    const uint32_t *record = record_locate(p_desc);
+    if (record == NULL) {
+        return FDS_ERR_NOT_FOUND;
+    }
+    if (!p_desc->record_is_open) {
+        page_of(record)->records_open++;
+        p_desc->record_is_open = true;
+    }
+    p_flash_record->p_header = header_of(record);
+    p_flash_record->p_data = record + HEADER_WORDS;
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_close(fds_record_desc_t *p_desc) {
+    const uint32_t *record = record_locate(p_desc);
+    if (record == NULL || !p_desc->record_is_open) {
+        return FDS_ERR_NO_OPEN_RECORDS;
+    }
+    page_of(record)->records_open--;
+    p_desc->record_is_open = false;
+    return NRF_SUCCESS;
+}
+
+/**
+ * Each page with dirty records and none open: its valid records are copied to the swap page, it is erased, the
+ * swap page takes its place and it becomes the swap page.
+ */
+ret_code_t fds_gc(void) {
+    m_fds.gc_run_count++;
+    m_fds.stats.gc_runs++;
+    for (uint16_t i = 0; i < m_fds.data_pages; i++) {
+        page_t *page = &m_fds.pages[i];
+        if (!page->can_gc || page->records_open != 0) {
+            continue;
+        }
+        uint16_t offset = PAGE_TAG_WORDS;
+        for (const uint32_t *record = record_next(page, NULL); record != NULL; record = record_next(page, record)) {
+            if (record_is_valid(record)) {
+                uint16_t words = HEADER_WORDS + header_of(record)->length_words;
+                flash_write(m_fds.swap + offset, record, words);
+                offset += words;
+            }
+        }
+        uint32_t *erased = page->words;
+        flash_erase(erased);
+        const uint32_t data = PAGE_TAG_DATA;
+        flash_write(m_fds.swap + 1, &data, 1);
+        page_tag(erased, PAGE_TAG_SWAP);
+        page->words = m_fds.swap;
+        page->write_offset = offset;
+        page->can_gc = false;
+        m_fds.swap = erased;
+    }
+    fds_evt_t evt = { .id = FDS_EVT_GC, .result = NRF_SUCCESS };
+    raise_event(&evt);
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_id_from_desc(fds_record_desc_t const *p_desc, uint32_t *p_record_id) {
+    *p_record_id = p_desc->record_id;
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_stat(fds_stat_t *p_stat) {
+    memset(p_stat, 0, sizeof(*p_stat));
+    p_stat->pages_available = m_fds.data_pages;
+    for (uint16_t i = 0; i < m_fds.data_pages; i++) {
+        const page_t *page = &m_fds.pages[i];
+        p_stat->open_records += page->records_open;
+        p_stat->words_used += page->write_offset;
+        uint16_t free_words = FDS_SIM_PAGE_WORDS - page->write_offset;
+        if (free_words > p_stat->largest_contig) {
+            p_stat->largest_contig = free_words;
+        }
+        for (const uint32_t *record = record_next(page, NULL); record != NULL; record = record_next(page, record)) {
+            if (record_is_valid(record)) {
+                p_stat->valid_records++;
+            } else {
+                p_stat->dirty_records++;
+                p_stat->freeable_words += HEADER_WORDS + header_of(record)->length_words;
+            }
+        }
+    }
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#ifndef FDS_SIM_H
+#define FDS_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Simulated flash data storage for the host builds: the nRF SDK FDS API (stubs/fds.h) over virtual pages in RAM,
+ * with its semantics, so that the real utils/fds_util.c runs on it. A record is written after the last one of the
+ * first page with room, an update writes a new copy and flags the old one dirty, a deleted or updated record keeps
+ * its words until a garbage collection copies the valid records of the page to the swap page and erases it. Pages
+ * holding an open record are not collected. The operations complete at once, their event is raised before they
+ * return, or when deferred, at fds_sim_raise_events(), as the FDS does it later from the SoftDevice events. What the
+ * flash had to do is counted, and timed with the nRF52840 worst case figures.
+ */
+#define FDS_SIM_PAGES_MAX       22          // FDS_VIRTUAL_PAGES of sdk_config.h, the swap page included
+#define FDS_SIM_PAGE_WORDS      2048        // FDS_VIRTUAL_PAGE_SIZE
+#define FDS_SIM_PHY_PAGE_WORDS  1024        // a 4 kB flash page
+#define FDS_SIM_WRITE_US        41          // tWRITE, a word
+#define FDS_SIM_ERASE_US        85000       // tERASEPAGE, a flash page
+#define FDS_SIM_EVENTS_MAX      8           // events deferred at once
+
+typedef struct {
+    uint32_t words_written;     // record data, headers, dirty flags, page tags and the copies of the collection
+    uint32_t page_erases;       // flash pages
+    uint32_t gc_runs;           // fds_gc() calls
+    uint32_t records_written;   // writes and updates
+    uint64_t flash_us;          // time the flash spent writing and erasing
+} fds_sim_stats_t;
+
+// Erases the storage, pages virtual pages (up to FDS_SIM_PAGES_MAX) of which one is the swap page
+void fds_sim_format(uint16_t pages);
+fds_sim_stats_t *fds_sim_stats(void);
+// Events held until fds_sim_raise_events(), the sync helpers of fds_util.c wait for them: not while they run
+void fds_sim_defer_events(bool defer);
+// Raises the events held, returns their count
+uint16_t fds_sim_raise_events(void);
+
+#endif
@@ -0,0 +1,376 @@
+#include <string.h>
+
+#include "mf1_card_sim.h"
+#include "crc_utils.h"
+#include "parity.h"
+
+#define CMD_REQA            0x26
+#define CMD_WUPA            0x52
+#define CMD_ANTICOLL1       0x93
+#define CMD_AUTH_A          0x60
+#define CMD_AUTH_B          0x61
+#define CMD_AUTH_BACKDOOR_A 0x64
+#define CMD_AUTH_BACKDOOR_B 0x65
+#define CMD_READ            0x30
+#define CMD_WRITE           0xA0
+#define CMD_HALT            0x50
+
+#define ACK                 0x0A
+#define NACK                0x04
+#define NACK_AUTH           0x05
+
+
+static uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static uint32_t uid_u32(const mf1_card_sim_t *card) {
+    return (uint32_t)card->uid[0] << 24 | card->uid[1] << 16 | card->uid[2] << 8 | card->uid[3];
+}
+
+static uint16_t block_count(const mf1_card_sim_t *card) {
+    return card->sectors <= 32 ? card->sectors * 4 : 128 + (card->sectors - 32) * 16;
+}
+
+static uint8_t sector_of(uint8_t block) {
+    return block < 128 ? block / 4 : 32 + (block - 128) / 16;
+}
+
+uint8_t mf1_card_sim_trailer(uint8_t sector) {
+    return sector < 32 ? sector * 4 + 3 : 128 + (sector - 32) * 16 + 15;
+}
+
+/**
+ * @brief A blank card: manufacturer block, transport keys FFFFFFFFFFFF and access bits FF0780 in every trailer.
+ */
+void mf1_card_sim_init(mf1_card_sim_t *card, const uint8_t uid[4], uint8_t sectors, mf1_card_prng_t prng) {
+    static const uint8_t trailer[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+    };
+    memset(card, 0, sizeof(*card));
+    memcpy(card->uid, uid, 4);
+    card->atqa[0] = sectors > 16 ? 0x02 : 0x04;
+    card->sak = sectors > 16 ? 0x18 : 0x08;
+    card->sectors = sectors;
+    card->blocks[0][0] = uid[0];
+    card->blocks[0][1] = uid[1];
+    card->blocks[0][2] = uid[2];
+    card->blocks[0][3] = uid[3];
+    card->blocks[0][4] = uid[0] ^ uid[1] ^ uid[2] ^ uid[3];
+    card->blocks[0][5] = card->sak;
+    card->blocks[0][6] = card->atqa[1];
+    card->blocks[0][7] = card->atqa[0];
+    for (uint8_t sector = 0; sector < sectors; sector++) {
+        memcpy(card->blocks[mf1_card_sim_trailer(sector)], trailer, 16);
+    }
+    card->prng = prng;
+    card->darkside_nack = prng == MF1_CARD_PRNG_WEAK;
+    card->key_b_readable = true;
+    card->key_a_refused_block = -1;
+    card->backdoor_key = 0xA396EFA4E24FULL;
+    card->fdt_ns = MF1_CARD_SIM_FDT_NS;
+    // 32 steps from any state give a valid nonce, its low half follows from its high half
+    card->seed = prng_successor(0x5EED0001, 32);
+    card->random = 0x2545F491;
+    card->state = MF1_CARD_OFF;
+}
+
+void mf1_card_sim_set_key(mf1_card_sim_t *card, uint8_t sector, uint8_t key_type, uint64_t key) {
+    uint8_t *trailer = card->blocks[mf1_card_sim_trailer(sector)];
+    uint8_t *dst = key_type == 0 ? &trailer[0] : &trailer[10];
+    for (int i = 0; i < 6; i++) {
+        dst[i] = key >> (40 - 8 * i);
+    }
+}
+
+uint64_t mf1_card_sim_get_key(const mf1_card_sim_t *card, uint8_t sector, uint8_t key_type) {
+    const uint8_t *trailer = card->blocks[mf1_card_sim_trailer(sector)];
+    const uint8_t *src = key_type == 0 ? &trailer[0] : &trailer[10];
+    uint64_t key = 0;
+    for (int i = 0; i < 6; i++) {
+        key = key << 8 | src[i];
+    }
+    return key;
+}
+
+/**
+ * @brief Nested nonce of a FM11RF08S: the same for each sector and key type, whatever the key used.
+ */
+uint32_t mf1_card_sim_static_nonce(const mf1_card_sim_t *card, uint8_t sector, uint8_t key_type) {
+    return prng_successor(card->seed ^ (sector << 8 | key_type), 32);
+}
+
+void mf1_card_sim_field(mf1_card_sim_t *card, bool on, uint64_t now_ns) {
+    if (on && card->state == MF1_CARD_OFF) {
+        card->state = MF1_CARD_IDLE;
+        card->halted = false;
+        card->power_on_ns = now_ns;
+    } else if (!on) {
+        card->state = MF1_CARD_OFF;
+    }
+}
+
+uint16_t mf1_frame_from_bytes(const uint8_t *bytes, const uint8_t *parity, uint16_t length, uint8_t *bits) {
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            bits[count++] = (bytes[i] >> bit) & 1;
+        }
+        bits[count++] = parity != NULL ? parity[i] : oddparity8(bytes[i]);
+    }
+    return count;
+}
+
+uint16_t mf1_frame_to_bytes(const uint8_t *bits, uint16_t bit_count, uint8_t *bytes, uint8_t *parity) {
+    uint16_t length = bit_count / 9;
+    for (uint16_t i = 0; i < length; i++) {
+        bytes[i] = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            bytes[i] |= bits[i * 9 + bit] << bit;
+        }
+        parity[i] = bits[i * 9 + 8];
+    }
+    return length;
+}
+
+// back to idle (or halt), silent: what a card does with a frame it does not expect
+static uint16_t card_error(mf1_card_sim_t *card) {
+    card->state = card->halted ? MF1_CARD_HALT : MF1_CARD_IDLE;
+    return 0;
+}
+
+static uint16_t answer_plain(const uint8_t *bytes, uint16_t length, uint8_t *answer) {
+    return mf1_frame_from_bytes(bytes, NULL, length, answer);
+}
+
+static uint16_t answer_encrypted(mf1_card_sim_t *card, const uint8_t *bytes, uint16_t length, uint8_t *answer) {
+    uint8_t enc[18], par[18];
+    for (uint16_t i = 0; i < length; i++) {
+        enc[i] = bytes[i] ^ crypto1_byte(&card->cs, 0x00, 0);
+        par[i] = oddparity8(bytes[i]) ^ filter(card->cs.odd);
+    }
+    return mf1_frame_from_bytes(enc, par, length, answer);
+}
+
+static uint16_t answer_4bit(mf1_card_sim_t *card, uint8_t value, bool encrypted, uint8_t *answer) {
+    for (int bit = 0; bit < 4; bit++) {
+        answer[bit] = ((value >> bit) & 1) ^ (encrypted ? crypto1_bit(&card->cs, 0, 0) : 0);
+    }
+    return 4;
+}
+
+static bool crc_ok(const uint8_t *bytes, uint16_t length) {
+    uint8_t crc[2];
+    if (length < 3) {
+        return false;
+    }
+    calc_14a_crc_lut((uint8_t *)bytes, length - 2, crc);
+    return crc[0] == bytes[length - 2] && crc[1] == bytes[length - 1];
+}
+
+static uint32_t card_nonce(mf1_card_sim_t *card, bool nested, uint8_t sector, uint8_t key_type, uint64_t now_ns) {
+    switch (card->prng) {
+        case MF1_CARD_PRNG_WEAK:
+            return prng_successor(card->seed, ((now_ns - card->power_on_ns) / MF1_CARD_SIM_BIT_NS) % 65535);
+        case MF1_CARD_PRNG_STATIC:
+            return card->seed;
+        case MF1_CARD_PRNG_FM11RF08S:
+            if (nested) {
+                return mf1_card_sim_static_nonce(card, sector, key_type);
+            }
+            return xorshift(&card->random);
+        default:
+            return xorshift(&card->random);
+    }
+}
+
+static uint16_t card_auth(mf1_card_sim_t *card, const uint8_t *cmd, bool nested, uint8_t *answer, uint64_t now_ns) {
+    bool backdoor = cmd[0] == CMD_AUTH_BACKDOOR_A || cmd[0] == CMD_AUTH_BACKDOOR_B;
+    if (cmd[1] >= block_count(card) || (backdoor && card->prng != MF1_CARD_PRNG_FM11RF08S)) {
+        return card_error(card);
+    }
+    card->auth_sector = sector_of(cmd[1]);
+    card->auth_key_type = cmd[0] & 0x01;
+    uint64_t key = backdoor ? card->backdoor_key : mf1_card_sim_get_key(card, card->auth_sector, card->auth_key_type);
+    uint32_t uid = uid_u32(card);
+    card->nt = card_nonce(card, nested, card->auth_sector, card->auth_key_type, now_ns);
+    card->auths++;
+    card->state = MF1_CARD_AUTH_NR_AR;
+
+    uint8_t nt[4] = { card->nt >> 24, card->nt >> 16, card->nt >> 8, card->nt };
+    crypto1_init(&card->cs, key);
+    if (!nested) {
+        crypto1_word(&card->cs, uid ^ card->nt, 0);
+        return answer_plain(nt, 4, answer);
+    }
+    // nested: the nonce is encrypted while uid ^ nt is loaded
+    uint8_t enc[4], par[4];
+    for (int i = 0; i < 4; i++) {
+        enc[i] = nt[i] ^ crypto1_byte(&card->cs, ((uid ^ card->nt) >> (24 - 8 * i)) & 0xFF, 0);
+        par[i] = oddparity8(nt[i]) ^ filter(card->cs.odd);
+    }
+    return mf1_frame_from_bytes(enc, par, 4, answer);
+}
+
+static uint16_t card_nr_ar(mf1_card_sim_t *card, const uint8_t *bits, uint16_t bit_count, uint8_t *answer) {
+    uint8_t enc[8], par[8];
+    if (bit_count != 72) {
+        return card_error(card);
+    }
+    mf1_frame_to_bytes(bits, bit_count, enc, par);
+    bool parity_ok = true;
+    uint32_t ar = 0;
+    for (int i = 0; i < 8; i++) {
+        // nr goes into the cipher, ar is only decrypted
+        uint8_t plain = enc[i] ^ crypto1_byte(&card->cs, i < 4 ? enc[i] : 0x00, i < 4);
+        parity_ok &= par[i] == (oddparity8(plain) ^ filter(card->cs.odd));
+        if (i >= 4) {
+            ar = ar << 8 | plain;
+        }
+    }
+    if (!parity_ok) {
+        return card_error(card);
+    }
+    if (ar != prng_successor(card->nt, 64)) {
+        if (!card->darkside_nack) {
+            return card_error(card);
+        }
+        answer_4bit(card, NACK_AUTH, true, answer);
+        card_error(card);
+        return 4;
+    }
+    uint32_t at = prng_successor(card->nt, 96);
+    uint8_t at_bytes[4] = { at >> 24, at >> 16, at >> 8, at };
+    card->state = MF1_CARD_AUTHENTICATED;
+    card->auths_ok++;
+    return answer_encrypted(card, at_bytes, 4, answer);
+}
+
+static uint16_t card_read(mf1_card_sim_t *card, uint8_t block, uint8_t *answer) {
+    uint8_t data[18];
+    if (block >= block_count(card) || sector_of(block) != card->auth_sector
+            || (block == card->key_a_refused_block && card->auth_key_type == 0)) {
+        answer_4bit(card, NACK, true, answer);
+        card_error(card);
+        return 4;
+    }
+    memcpy(data, card->blocks[block], 16);
+    if (block == mf1_card_sim_trailer(card->auth_sector)) {
+        // key A is never readable, key B only with key A when the access bits allow it
+        memset(&data[0], 0, 6);
+        if (!card->key_b_readable || card->auth_key_type != 0) {
+            memset(&data[10], 0, 6);
+        }
+    }
+    calc_14a_crc_lut(data, 16, &data[16]);
+    return answer_encrypted(card, data, 18, answer);
+}
+
+static uint16_t card_command(mf1_card_sim_t *card, const uint8_t *bits, uint16_t bit_count, uint8_t *answer, uint64_t now_ns) {
+    uint8_t bytes[MF1_CARD_SIM_FRAME_MAX / 9], par[MF1_CARD_SIM_FRAME_MAX / 9];
+    uint16_t length = mf1_frame_to_bytes(bits, bit_count, bytes, par);
+    bool encrypted = card->state == MF1_CARD_AUTHENTICATED || card->state == MF1_CARD_WRITE_DATA;
+    if (length == 0 || bit_count % 9) {
+        return card_error(card);
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        if (encrypted) {
+            bytes[i] ^= crypto1_byte(&card->cs, 0x00, 0);
+            if (par[i] != (oddparity8(bytes[i]) ^ filter(card->cs.odd))) {
+                return card_error(card);
+            }
+        } else if (par[i] != oddparity8(bytes[i])) {
+            return card_error(card);
+        }
+    }
+    if (!crc_ok(bytes, length)) {
+        return card_error(card);
+    }
+    if (card->state == MF1_CARD_WRITE_DATA) {
+        if (length != 18) {
+            return card_error(card);
+        }
+        memcpy(card->blocks[card->write_block], bytes, 16);
+        card->state = MF1_CARD_AUTHENTICATED;
+        return answer_4bit(card, ACK, true, answer);
+    }
+    if (length != 4) {
+        return card_error(card);
+    }
+    switch (bytes[0]) {
+        case CMD_AUTH_A:
+        case CMD_AUTH_B:
+        case CMD_AUTH_BACKDOOR_A:
+        case CMD_AUTH_BACKDOOR_B:
+            return card_auth(card, bytes, encrypted, answer, now_ns);
+        case CMD_HALT:
+            card->halted = true;
+            return card_error(card);
+        case CMD_READ:
+            if (!encrypted) {
+                return card_error(card);
+            }
+            return card_read(card, bytes[1], answer);
+        case CMD_WRITE:
+            if (!encrypted || bytes[1] == 0 || bytes[1] >= block_count(card) || sector_of(bytes[1]) != card->auth_sector) {
+                return card_error(card);
+            }
+            card->write_block = bytes[1];
+            card->state = MF1_CARD_WRITE_DATA;
+            return answer_4bit(card, ACK, true, answer);
+        default:
+            return card_error(card);
+    }
+}
+
+uint16_t mf1_card_sim_exchange(mf1_card_sim_t *card, const uint8_t *bits, uint16_t bit_count, uint8_t *answer, uint64_t now_ns) {
+    if (card->state == MF1_CARD_OFF) {
+        return 0;
+    }
+    card->frames++;
+    if (bit_count == 7) {
+        uint8_t cmd = 0;
+        for (int bit = 0; bit < 7; bit++) {
+            cmd |= bits[bit] << bit;
+        }
+        if ((cmd == CMD_REQA && card->state == MF1_CARD_IDLE)
+                || (cmd == CMD_WUPA && (card->state == MF1_CARD_IDLE || card->state == MF1_CARD_HALT))) {
+            card->state = MF1_CARD_READY;
+            uint8_t atqa[2] = { card->atqa[0], card->atqa[1] };
+            return answer_plain(atqa, 2, answer);
+        }
+        return card_error(card);
+    }
+    switch (card->state) {
+        case MF1_CARD_READY: {
+            uint8_t bytes[9], par[9];
+            uint16_t length = mf1_frame_to_bytes(bits, bit_count, bytes, par);
+            if (bit_count == 18 && bytes[0] == CMD_ANTICOLL1 && bytes[1] == 0x20) {
+                uint8_t uid_bcc[5] = { card->uid[0], card->uid[1], card->uid[2], card->uid[3] };
+                uid_bcc[4] = uid_bcc[0] ^ uid_bcc[1] ^ uid_bcc[2] ^ uid_bcc[3];
+                return answer_plain(uid_bcc, 5, answer);
+            }
+            if (bit_count == 81 && bytes[0] == CMD_ANTICOLL1 && bytes[1] == 0x70 && memcmp(&bytes[2], card->uid, 4) == 0
+                    && crc_ok(bytes, length)) {
+                uint8_t sak[3] = { card->sak };
+                calc_14a_crc_lut(sak, 1, &sak[1]);
+                card->state = MF1_CARD_ACTIVE;
+                return answer_plain(sak, 3, answer);
+            }
+            return card_error(card);
+        }
+        case MF1_CARD_ACTIVE:
+        case MF1_CARD_AUTHENTICATED:
+        case MF1_CARD_WRITE_DATA:
+            return card_command(card, bits, bit_count, answer, now_ns);
+        case MF1_CARD_AUTH_NR_AR:
+            return card_nr_ar(card, bits, bit_count, answer);
+        default:
+            // idle or halted: only REQA/WUPA
+            return 0;
+    }
+}
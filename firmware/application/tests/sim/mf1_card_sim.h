@@ -0,0 +1,80 @@
+#ifndef MF1_CARD_SIM_H
+#define MF1_CARD_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mf1_crapto1.h"
+
+/*
+ * Virtual MIFARE Classic card for the host tests of the reader: ISO14443-3A selection and the Crypto1
+ * authentication, read, write and halt of a 1K/4K card, on frames of bits (one bit per byte, parity
+ * bits included) as they go over the field. The card keeps its own clock for the nonces.
+ */
+#define MF1_CARD_SIM_FRAME_MAX  (64 * 9 + 8)    // a full RC522 FIFO with parity
+#define MF1_CARD_SIM_BIT_NS     9440            // one bit at 106 kbps, 128 / 13.56 MHz
+#define MF1_CARD_SIM_FDT_NS     86400           // frame delay time of the answers, 1172 / 13.56 MHz
+
+typedef enum {
+    MF1_CARD_PRNG_WEAK,         // 16 bits LFSR clocked from the power up: darkside, nested
+    MF1_CARD_PRNG_STATIC,       // the same nonce for every authentication: static nested
+    MF1_CARD_PRNG_HARD,         // unpredictable nonces: hardnested
+    MF1_CARD_PRNG_FM11RF08S,    // hard first nonces, static nested nonces, backdoor authentication
+} mf1_card_prng_t;
+
+typedef enum {
+    MF1_CARD_OFF,
+    MF1_CARD_IDLE,
+    MF1_CARD_READY,
+    MF1_CARD_ACTIVE,
+    MF1_CARD_AUTH_NR_AR,        // nonce sent, waits for {nr}{ar}
+    MF1_CARD_AUTHENTICATED,
+    MF1_CARD_WRITE_DATA,        // write acknowledged, waits for the block
+    MF1_CARD_HALT,
+} mf1_card_state_t;
+
+typedef struct {
+    // configuration
+    uint8_t uid[4];
+    uint8_t atqa[2];
+    uint8_t sak;
+    uint8_t sectors;                // 16 (1K) or 40 (4K)
+    uint8_t blocks[256][16];        // keys in the trailers
+    mf1_card_prng_t prng;
+    bool darkside_nack;             // encrypted NACK when only the parity of {nr}{ar} is right
+    bool key_b_readable;            // key B can be read from the trailer with key A
+    int16_t key_a_refused_block;    // block whose read with key A gets a NACK, -1 for none
+    uint64_t backdoor_key;          // FM11RF08S, authentication commands 0x64/0x65
+    uint32_t fdt_ns;
+    uint32_t seed;
+    // state
+    mf1_card_state_t state;
+    bool halted;                    // state to go back to on an error
+    uint64_t power_on_ns;
+    struct Crypto1State cs;
+    uint32_t nt;
+    uint8_t auth_sector;
+    uint8_t auth_key_type;          // 0 key A, 1 key B
+    uint8_t write_block;
+    uint32_t random;
+    // statistics
+    uint32_t frames;                // frames received while powered
+    uint32_t auths;                 // authentications started, nonces given
+    uint32_t auths_ok;
+} mf1_card_sim_t;
+
+void mf1_card_sim_init(mf1_card_sim_t *card, const uint8_t uid[4], uint8_t sectors, mf1_card_prng_t prng);
+void mf1_card_sim_set_key(mf1_card_sim_t *card, uint8_t sector, uint8_t key_type, uint64_t key);
+uint64_t mf1_card_sim_get_key(const mf1_card_sim_t *card, uint8_t sector, uint8_t key_type);
+uint8_t mf1_card_sim_trailer(uint8_t sector);
+uint32_t mf1_card_sim_static_nonce(const mf1_card_sim_t *card, uint8_t sector, uint8_t key_type);
+
+void mf1_card_sim_field(mf1_card_sim_t *card, bool on, uint64_t now_ns);
+// Frame from the reader ending at now_ns, returns the bit count of the answer, 0 if the card stays silent
+uint16_t mf1_card_sim_exchange(mf1_card_sim_t *card, const uint8_t *bits, uint16_t bit_count, uint8_t *answer, uint64_t now_ns);
+
+// frames of bits
+uint16_t mf1_frame_from_bytes(const uint8_t *bytes, const uint8_t *parity, uint16_t length, uint8_t *bits);
+uint16_t mf1_frame_to_bytes(const uint8_t *bits, uint16_t bit_count, uint8_t *bytes, uint8_t *parity);
+
+#endif
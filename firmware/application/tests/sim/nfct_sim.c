@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "nfct_sim.h"
+#include "nrfx_nfct.h"
+#include "crc_utils.h"
+#include "parity.h"
+#include "fds_sim.h"
+#include "fds_util.h"
+#include "hw_connect.h"
+#include "nfc_mf1.h"
+#include "syssleep.h"
+#include "lf_tag_em.h"
+#include "rgb_marquee.h"
+#include "tag_emulation.h"
+#include "tag_persistence.h"
+
+static struct {
+    nrfx_nfct_handler_t handler;
+    int perf_fd;
+    nfct_sim_stats_t stats;
+} m_nfct = { .perf_fd = -1 };
+
+
+//---------------------------------------------------------------------------- measures
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void perf_open(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_nfct.perf_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static uint64_t instructions(void) {
+    uint64_t count = 0;
+    if (m_nfct.perf_fd < 0 || read(m_nfct.perf_fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+bool nfct_sim_has_pmu(void) {
+    return m_nfct.perf_fd >= 0;
+}
+
+
+//---------------------------------------------------------------------------- NFCT
+
+static void raise_event(nrfx_nfct_evt_id_t id) {
+    nrfx_nfct_evt_t event = { .evt_id = id };
+    if (m_nfct.handler != NULL) {
+        m_nfct.handler(&event);
+    }
+}
+
+nrfx_err_t nrfx_nfct_init(nrfx_nfct_config_t const *p_config) {
+    m_nfct.handler = p_config->cb;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_nfct_uninit(void) {
+    m_nfct.handler = NULL;
+}
+
+void nrfx_nfct_enable(void) {
+}
+
+void nrfx_nfct_autocolres_disable(void) {
+}
+
+void nrfx_nfct_state_force(nrfx_nfct_state_t state) {
+}
+
+void nfct_sim_init(void) {
+    // nfc_14a.c gives the NFCT 32 bits buffer addresses and writes a register by its address
+    void *page = mmap((void *)NRF_NFCT_BASE, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page != (void *)NRF_NFCT_BASE) {
+        fprintf(stderr, "cannot map the NFCT registers at 0x%08lX\n", NRF_NFCT_BASE);
+        exit(EXIT_FAILURE);
+    }
+    memset(&m_nfct.stats, 0, sizeof(m_nfct.stats));
+    perf_open();
+    // and the flash the factory data of the slots is written to
+    fds_util_init();
+}
+
+void nfct_sim_field_on(void) {
+    raise_event(NRFX_NFCT_EVT_FIELD_DETECTED);
+}
+
+void nfct_sim_field_off(void) {
+    NRF_NFCT->TASKS_ENABLERXDATA = 0;
+    raise_event(NRFX_NFCT_EVT_FIELD_LOST);
+}
+
+/**
+ * @brief Bits the NFCT puts on the field for the frame the firmware started: parity and CRC are added
+ * by the peripheral when TXD.FRAMECONFIG asks for them, otherwise the buffer holds the bits as they go.
+ */
+static uint16_t tx_bits(uint8_t *answer) {
+    const uint8_t *data = (const uint8_t *)(uintptr_t)NRF_NFCT->PACKETPTR;
+    uint32_t config = NRF_NFCT->TXD.FRAMECONFIG;
+    uint32_t amount = NRF_NFCT->TXD.AMOUNT & (NFCT_TXD_AMOUNT_TXDATABYTES_Msk | NFCT_TXD_AMOUNT_TXDATABITS_Msk);
+    uint16_t count = 0;
+    if (config & NFCT_TXD_FRAMECONFIG_PARITY_Msk) {
+        uint8_t frame[MAX_NFC_TX_BUFFER_SIZE + NFC_TAG_14A_CRC_LENGTH];
+        uint16_t length = amount >> NFCT_TXD_AMOUNT_TXDATABYTES_Pos;
+        memcpy(frame, data, length);
+        if (config & NFCT_TXD_FRAMECONFIG_CRCMODETX_Msk) {
+            calc_14a_crc_lut(frame, length, &frame[length]);
+            length += NFC_TAG_14A_CRC_LENGTH;
+        }
+        for (uint16_t i = 0; i < length; i++) {
+            for (int bit = 0; bit < 8; bit++) {
+                answer[count++] = (frame[i] >> bit) & 1;
+            }
+            answer[count++] = oddparity8(frame[i]);
+        }
+    } else {
+        for (; count < amount; count++) {
+            answer[count] = (data[count / 8] >> (count % 8)) & 1;
+        }
+    }
+    return count;
+}
+
+uint16_t nfct_sim_exchange(const uint8_t *bits, uint16_t count, uint8_t *answer) {
+    m_nfct.stats.frames++;
+    if (!NRF_NFCT->TASKS_ENABLERXDATA) {
+        m_nfct.stats.rx_not_enabled++;
+        return 0;
+    }
+    // the bits of the frame as they came, parity included, the firmware removes it
+    uint8_t *rx = (uint8_t *)(uintptr_t)NRF_NFCT->PACKETPTR;
+    uint32_t max_length = (NRF_NFCT->MAXLEN & NFCT_MAXLEN_MAXLEN_Msk) >> NFCT_MAXLEN_MAXLEN_Pos;
+    if ((count + 7) / 8 > max_length) {
+        count = max_length * 8;
+    }
+    memset(rx, 0, (count + 7) / 8);
+    for (uint16_t i = 0; i < count; i++) {
+        rx[i / 8] |= (bits[i] & 1) << (i % 8);
+    }
+    NRF_NFCT->RXD.AMOUNT = count;
+    NRF_NFCT->TASKS_ENABLERXDATA = 0;
+    NRF_NFCT->TASKS_STARTTX = 0;
+
+    uint64_t start_instructions = instructions();
+    uint64_t start_ns = now_ns();
+    raise_event(NRFX_NFCT_EVT_RX_FRAMEEND);
+    m_nfct.stats.last_ns = now_ns() - start_ns;
+    m_nfct.stats.last_instructions = instructions() - start_instructions;
+
+    if (!NRF_NFCT->TASKS_STARTTX) {
+        return 0;
+    }
+    NRF_NFCT->TASKS_STARTTX = 0;
+    m_nfct.stats.answers++;
+    uint16_t answer_count = tx_bits(answer);
+    raise_event(NRFX_NFCT_EVT_TX_FRAMESTART);
+    raise_event(NRFX_NFCT_EVT_TX_FRAMEEND);
+    return answer_count;
+}
+
+nfct_sim_stats_t *nfct_sim_stats(void) {
+    return &m_nfct.stats;
+}
+
+
+//---------------------------------------------------------------------------- board
+
+bool g_usb_led_marquee_enable;
+uint32_t g_led_field;
+
+void set_slot_light_color(chameleon_rgb_type_t color) {
+}
+
+void sleep_timer_start(uint32_t time_ms) {
+}
+
+void sleep_timer_stop(void) {
+}
+
+
+//---------------------------------------------------------------------------- LF field and marquee, not simulated
+
+void lf_tag_125khz_sense_switch(bool enable) {
+}
+
+int lf_tag_data_loadcb(tag_specific_type_t type, tag_data_buffer_t *buffer) {
+    return 0;
+}
+
+int lf_tag_em410x_data_savecb(tag_specific_type_t type, tag_data_buffer_t *buffer) {
+    return 0;
+}
+
+bool lf_tag_em410x_data_factory(uint8_t slot, tag_specific_type_t tag_type) {
+    return false;
+}
+
+int lf_tag_hidprox_data_savecb(tag_specific_type_t type, tag_data_buffer_t *buffer) {
+    return 0;
+}
+
+bool lf_tag_hidprox_data_factory(uint8_t slot, tag_specific_type_t tag_type) {
+    return false;
+}
+
+int lf_tag_viking_data_savecb(tag_specific_type_t type, tag_data_buffer_t *buffer) {
+    return 0;
+}
+
+bool lf_tag_viking_data_factory(uint8_t slot, tag_specific_type_t tag_type) {
+    return false;
+}
+
+void rgb_marquee_reset(void) {
+}
+
+
+//---------------------------------------------------------------------------- flash, sim/fds_sim.c
+
+const uint8_t *nfct_sim_fds_record(uint16_t *length) {
+    static uint8_t data[TAG_PERSISTENCE_CHUNK_MAX * TAG_PERSISTENCE_CHUNK_SIZE] __attribute__((aligned(4)));
+    *length = sizeof(data);
+    return tag_persistence_read(0, TAG_SENSE_HF, data, length) ? data : NULL;
+}
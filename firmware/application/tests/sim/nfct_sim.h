@@ -0,0 +1,38 @@
+#ifndef NFCT_SIM_H
+#define NFCT_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Simulated NFCT peripheral and field for the host builds of the tag emulation (rfid/nfctag/hf): the
+ * registers nfc_14a.c programs live in a page mapped at NRF_NFCT_BASE, the nrfx driver events are raised
+ * from here. A reader frame goes in as bits (one bit per byte, parity bits included) the way it comes over
+ * the field, the NFCT interrupt handler runs on it and the answer comes out the same way, with the parity
+ * and CRC the NFCT adds when the firmware asks for them. The host time and, with a PMU, the instructions
+ * spent in the interrupt of each frame are measured.
+ */
+#define NFCT_SIM_FRAME_MAX      (257 * 9)       // MAX_NFC_RX_BUFFER_SIZE bytes with parity
+#define NFCT_SIM_FDT_NS         86430           // ISO14443-3 frame delay time, 1172 / 13.56 MHz
+
+typedef struct {
+    uint32_t frames;            // frames given to the tag
+    uint32_t answers;           // frames the tag answered
+    uint32_t rx_not_enabled;    // frames dropped, the firmware did not enable the receiver again
+    uint64_t last_ns;           // host time spent in the interrupt of the last frame
+    uint64_t last_instructions; // instructions retired in it, 0 without a PMU
+} nfct_sim_stats_t;
+
+// Maps the registers and sets up the flash, call before nfc_tag_14a_sense_switch() and the slot factory data
+void nfct_sim_init(void);
+// Whether the instructions are counted, perf events are not available everywhere
+bool nfct_sim_has_pmu(void);
+void nfct_sim_field_on(void);
+void nfct_sim_field_off(void);
+// One reader frame, returns the bit count of the answer, 0 when the tag stays silent
+uint16_t nfct_sim_exchange(const uint8_t *bits, uint16_t count, uint8_t *answer);
+nfct_sim_stats_t *nfct_sim_stats(void);
+// The HF data of slot 0 in flash, the factory data the tests write there
+const uint8_t *nfct_sim_fds_record(uint16_t *length);
+
+#endif
@@ -0,0 +1,461 @@
+#include <string.h>
+
+#include "rc522_sim.h"
+#include "rc522.h"
+#include "crc_utils.h"
+#include "parity.h"
+#include "nrf_spim.h"
+#include "bsp_delay.h"
+#include "bsp_time.h"
+#include "bsp_wdt.h"
+#include "hw_connect.h"
+#include "rgb_marquee.h"
+
+NRF_SPIM_Type g_nrf_spim0;
+
+static struct {
+    mf1_card_sim_t *card;
+    uint8_t regs[64];
+    uint8_t fifo[DEF_FIFO_LENGTH];
+    uint8_t fifo_length;
+    uint8_t fifo_read;
+    struct Crypto1State cs;         // reader side of MFCrypto1On
+    uint32_t random;
+    uint64_t tx_end_ns;
+    bool stuck;                     // the command waits for an answer that never comes
+    bool crc_stall;                 // CalcCRC never completes
+    // result of the running command, visible from done_ns
+    bool pending;
+    uint64_t done_ns;
+    uint8_t result_fifo[DEF_FIFO_LENGTH];
+    uint8_t result_length;
+    uint8_t result_last_bits;
+    uint8_t result_irq;
+    uint8_t result_error;
+    bool result_crypto_on;
+    rc522_sim_stats_t stats;
+} m_chip;
+
+static autotimer m_timers[TIMER_BSP_COUNT];
+static uint64_t m_next_tick_ns;
+
+
+//---------------------------------------------------------------------------- time
+
+void rc522_sim_advance(uint64_t ns) {
+    m_chip.stats.now_ns += ns;
+    while (m_chip.stats.now_ns >= m_next_tick_ns) {
+        m_next_tick_ns += 10000000;
+        for (int i = 0; i < TIMER_BSP_COUNT; i++) {
+            if (m_timers[i].busy) {
+                m_timers[i].time += 10;
+            }
+        }
+    }
+}
+
+void bsp_delay_ms(uint16_t nms) {
+    rc522_sim_advance(nms * 1000000ULL);
+}
+
+void bsp_delay_us(uint32_t nus) {
+    rc522_sim_advance(nus * 1000ULL);
+}
+
+autotimer *bsp_obtain_timer(uint32_t start_value) {
+    for (int i = 0; i < TIMER_BSP_COUNT; i++) {
+        if (!m_timers[i].busy) {
+            m_timers[i].time = start_value;
+            m_timers[i].busy = 1;
+            return &m_timers[i];
+        }
+    }
+    return &m_timers[TIMER_BSP_COUNT - 1];
+}
+
+uint8_t bsp_set_timer(autotimer *timer, uint32_t start_value) {
+    if (timer->busy == 0) return 0;
+    timer->time = start_value;
+    return 1;
+}
+
+void bsp_return_timer(autotimer *timer) {
+    timer->busy = 0;
+    timer->time = 0;
+}
+
+void bsp_wdt_feed(void) {
+}
+
+
+//---------------------------------------------------------------------------- board
+
+uint32_t g_led_field;
+uint32_t g_led_num = MAX_LED_NUM;
+uint32_t g_hf_spi_select;
+uint32_t g_hf_spi_miso;
+uint32_t g_hf_spi_mosi;
+uint32_t g_hf_spi_sck;
+uint32_t g_hf_rc522_irq = HW_PIN_NOT_CONNECTED;
+
+uint32_t *hw_get_led_array(void) {
+    static uint32_t leds[MAX_LED_NUM];
+    return leds;
+}
+
+void set_slot_light_color(chameleon_rgb_type_t color) {
+}
+
+void rgb_marquee_stop(void) {
+}
+
+
+//---------------------------------------------------------------------------- field
+
+static uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static bool chip_parity(void) {
+    return (m_chip.regs[MfRxReg] & 0x10) == 0;
+}
+
+static bool chip_crypto(void) {
+    return (m_chip.regs[Status2Reg] & 0x08) != 0;
+}
+
+/**
+ * @brief Bits of the frame on the field: parity added and Crypto1 applied as the chip does, unless disabled.
+ */
+static uint16_t chip_tx_bits(const uint8_t *data, uint8_t length, uint8_t last_bits, bool parity, bool crypto, uint8_t *bits) {
+    uint16_t count = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t bit_count = (i == length - 1 && last_bits) ? last_bits : 8;
+        uint8_t value = data[i];
+        if (bit_count == 8 && parity) {
+            uint8_t par = oddparity8(value);
+            if (crypto) {
+                value ^= crypto1_byte(&m_chip.cs, 0x00, 0);
+                par ^= filter(m_chip.cs.odd);
+            }
+            for (int bit = 0; bit < 8; bit++) {
+                bits[count++] = (value >> bit) & 1;
+            }
+            bits[count++] = par;
+        } else {
+            for (int bit = 0; bit < bit_count; bit++) {
+                bits[count++] = ((value >> bit) & 1) ^ ((crypto && parity) ? crypto1_bit(&m_chip.cs, 0, 0) : 0);
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Answer of the card into the result FIFO: parity checked and removed, Crypto1 removed, unless disabled.
+ */
+static void chip_rx_bits(const uint8_t *bits, uint16_t count, bool parity, bool crypto) {
+    uint8_t length = 0;
+    uint16_t pos = 0;
+    m_chip.result_error = 0;
+    if (parity) {
+        for (; pos + 9 <= count && length < DEF_FIFO_LENGTH; pos += 9) {
+            uint8_t value = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                value |= bits[pos + bit] << bit;
+            }
+            uint8_t par = bits[pos + 8];
+            if (crypto) {
+                value ^= crypto1_byte(&m_chip.cs, 0x00, 0);
+                par ^= filter(m_chip.cs.odd);
+            }
+            if (par != oddparity8(value)) {
+                m_chip.result_error |= 0x02;    // ParityErr
+            }
+            m_chip.result_fifo[length++] = value;
+        }
+    }
+    // remaining bits, a 4 bits ACK/NACK or the whole frame without parity
+    m_chip.result_last_bits = (count - pos) % 8;
+    while (pos < count && length < DEF_FIFO_LENGTH) {
+        uint8_t value = 0;
+        for (int bit = 0; bit < 8 && pos < count; bit++, pos++) {
+            value |= (bits[pos] ^ ((crypto && parity) ? crypto1_bit(&m_chip.cs, 0, 0) : 0)) << bit;
+        }
+        m_chip.result_fifo[length++] = value;
+    }
+    m_chip.result_length = length;
+}
+
+/**
+ * @brief One frame on the field, starting now, returns the answer bit count (0: no answer) and when it ends.
+ */
+static uint16_t field_exchange(const uint8_t *bits, uint16_t count, uint8_t *answer, uint64_t start_ns, uint64_t *end_ns) {
+    m_chip.stats.rf_frames++;
+    uint64_t tx_end_ns = start_ns + (uint64_t)count * MF1_CARD_SIM_BIT_NS;
+    m_chip.tx_end_ns = tx_end_ns;
+    uint16_t answer_count = m_chip.card ? mf1_card_sim_exchange(m_chip.card, bits, count, answer, tx_end_ns) : 0;
+    if (answer_count) {
+        m_chip.stats.rf_answers++;
+        *end_ns = tx_end_ns + m_chip.card->fdt_ns + (uint64_t)answer_count * MF1_CARD_SIM_BIT_NS;
+    } else {
+        *end_ns = tx_end_ns;
+    }
+    return answer_count;
+}
+
+static void chip_transceive(void) {
+    static uint8_t bits[MF1_CARD_SIM_FRAME_MAX], answer[MF1_CARD_SIM_FRAME_MAX];
+    bool parity = chip_parity();
+    bool crypto = chip_crypto();
+    uint16_t count = chip_tx_bits(m_chip.fifo, m_chip.fifo_length, m_chip.regs[BitFramingReg] & 0x07, parity, crypto, bits);
+    m_chip.fifo_length = 0;
+    m_chip.fifo_read = 0;
+    uint64_t end_ns;
+    uint16_t answer_count = field_exchange(bits, count, answer, m_chip.stats.now_ns, &end_ns);
+    if (answer_count == 0) {
+        // no timer in the chip (TModeReg = 0): it keeps receiving
+        m_chip.stuck = true;
+        return;
+    }
+    chip_rx_bits(answer, answer_count, parity, crypto);
+    m_chip.result_irq = 0x30 | (m_chip.result_error ? 0x02 : 0x00);
+    m_chip.result_crypto_on = crypto;
+    m_chip.done_ns = end_ns;
+    m_chip.pending = true;
+}
+
+/**
+ * @brief MFAuthent: FIFO = command, block, key[6], uid[4]. The chip gets the nonce, answers {nr}{ar}
+ *        and checks {at}, MFCrypto1On is set on success.
+ */
+static void chip_authent(void) {
+    static uint8_t bits[MF1_CARD_SIM_FRAME_MAX], answer[MF1_CARD_SIM_FRAME_MAX];
+    uint8_t cmd[4] = { m_chip.fifo[0], m_chip.fifo[1] };
+    uint64_t key = 0;
+    for (int i = 0; i < 6; i++) {
+        key = key << 8 | m_chip.fifo[2 + i];
+    }
+    uint32_t uid = (uint32_t)m_chip.fifo[8] << 24 | m_chip.fifo[9] << 16 | m_chip.fifo[10] << 8 | m_chip.fifo[11];
+    m_chip.fifo_length = 0;
+    m_chip.fifo_read = 0;
+    calc_14a_crc_lut(cmd, 2, &cmd[2]);
+
+    uint64_t end_ns;
+    uint16_t count = mf1_frame_from_bytes(cmd, NULL, 4, bits);
+    uint16_t answer_count = field_exchange(bits, count, answer, m_chip.stats.now_ns, &end_ns);
+    uint8_t nt_bytes[4], par[8];
+    if (answer_count != 36) {
+        m_chip.stuck = true;
+        return;
+    }
+    mf1_frame_to_bytes(answer, answer_count, nt_bytes, par);
+    uint32_t nt = (uint32_t)nt_bytes[0] << 24 | nt_bytes[1] << 16 | nt_bytes[2] << 8 | nt_bytes[3];
+
+    crypto1_init(&m_chip.cs, key);
+    crypto1_word(&m_chip.cs, uid ^ nt, 0);
+    uint32_t nr = xorshift(&m_chip.random);
+    uint32_t ar = prng_successor(nt, 64);
+    uint8_t nr_ar[8];
+    for (int i = 0; i < 8; i++) {
+        uint8_t plain = i < 4 ? nr >> (24 - 8 * i) : ar >> (56 - 8 * i);
+        nr_ar[i] = plain ^ crypto1_byte(&m_chip.cs, i < 4 ? plain : 0x00, 0);
+        par[i] = oddparity8(plain) ^ filter(m_chip.cs.odd);
+    }
+    count = mf1_frame_from_bytes(nr_ar, par, 8, bits);
+    answer_count = field_exchange(bits, count, answer, end_ns, &end_ns);
+    if (answer_count == 0) {
+        m_chip.stuck = true;
+        return;
+    }
+    m_chip.result_length = 0;
+    m_chip.result_last_bits = 0;
+    m_chip.result_crypto_on = false;
+    m_chip.result_error = 0x01;     // ProtocolErr: a NACK, not the 32 bits of {at}
+    if (answer_count == 36) {
+        uint8_t at_bytes[4];
+        mf1_frame_to_bytes(answer, answer_count, at_bytes, par);
+        uint32_t at = 0;
+        bool parity_ok = true;
+        for (int i = 0; i < 4; i++) {
+            uint8_t plain = at_bytes[i] ^ crypto1_byte(&m_chip.cs, 0x00, 0);
+            parity_ok &= par[i] == (oddparity8(plain) ^ filter(m_chip.cs.odd));
+            at = at << 8 | plain;
+        }
+        m_chip.result_crypto_on = parity_ok && at == prng_successor(nt, 96);
+        m_chip.result_error = m_chip.result_crypto_on ? 0x00 : 0x08;
+    }
+    m_chip.result_irq = 0x10 | (m_chip.result_error ? 0x02 : 0x00);
+    m_chip.done_ns = end_ns;
+    m_chip.pending = true;
+}
+
+static void chip_calc_crc(void) {
+    if (m_chip.crc_stall) {
+        return;
+    }
+    uint8_t crc[2];
+    calc_14a_crc_lut(m_chip.fifo, m_chip.fifo_length, crc);
+    m_chip.regs[CRCResultRegL] = crc[0];
+    m_chip.regs[CRCResultRegM] = crc[1];
+    m_chip.fifo_length = 0;
+    m_chip.fifo_read = 0;
+    m_chip.regs[DivIrqReg] |= 0x04;
+}
+
+static void chip_reset(void) {
+    memset(m_chip.regs, 0, sizeof(m_chip.regs));
+    m_chip.regs[ComIEnReg] = 0x80;
+    m_chip.regs[TxControlReg] = 0x80;
+    m_chip.fifo_length = 0;
+    m_chip.fifo_read = 0;
+    m_chip.pending = false;
+    m_chip.stuck = false;
+    if (m_chip.card) {
+        mf1_card_sim_field(m_chip.card, false, m_chip.stats.now_ns);
+    }
+}
+
+// the result of the running command appears once its frames are over
+static void chip_update(void) {
+    if (m_chip.pending && m_chip.stats.now_ns >= m_chip.done_ns) {
+        m_chip.pending = false;
+        memcpy(m_chip.fifo, m_chip.result_fifo, m_chip.result_length);
+        m_chip.fifo_length = m_chip.result_length;
+        m_chip.fifo_read = 0;
+        m_chip.regs[Control522Reg] = m_chip.result_last_bits;
+        m_chip.regs[ErrorReg] = m_chip.result_error;
+        m_chip.regs[ComIrqReg] |= m_chip.result_irq;
+        m_chip.regs[Status2Reg] = (m_chip.regs[Status2Reg] & ~0x08) | (m_chip.result_crypto_on ? 0x08 : 0x00);
+        m_chip.regs[CommandReg] = PCD_IDLE;
+    }
+}
+
+static void chip_command(uint8_t command) {
+    if (m_chip.stuck || m_chip.pending) {
+        m_chip.stats.timeouts += m_chip.stuck;
+        m_chip.stuck = false;
+        m_chip.pending = false;
+    }
+    m_chip.regs[CommandReg] = command;
+    switch (command) {
+        case PCD_AUTHENT:
+            chip_authent();
+            break;
+        case PCD_CALCCRC:
+            chip_calc_crc();
+            break;
+        case PCD_RESET:
+            m_chip.stats.resets++;
+            chip_reset();
+            break;
+        default:
+            break;
+    }
+}
+
+static void chip_write(uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case CommandReg:
+            chip_command(value & 0x0F);
+            break;
+        case ComIrqReg:
+        case DivIrqReg:
+            // Set1/Set2 sets the marked bits, else they are cleared
+            m_chip.regs[reg] = (value & 0x80) ? (m_chip.regs[reg] | (value & 0x7F)) : (m_chip.regs[reg] & ~value);
+            break;
+        case FIFOLevelReg:
+            if (value & 0x80) {
+                m_chip.fifo_length = 0;
+                m_chip.fifo_read = 0;
+            }
+            break;
+        case FIFODataReg:
+            if (m_chip.fifo_length < DEF_FIFO_LENGTH) {
+                m_chip.fifo[m_chip.fifo_length++] = value;
+            }
+            break;
+        case BitFramingReg:
+            m_chip.regs[reg] = value;
+            if ((value & 0x80) && m_chip.regs[CommandReg] == PCD_TRANSCEIVE) {
+                chip_transceive();
+            }
+            break;
+        case TxControlReg:
+            m_chip.regs[reg] = value;
+            if (m_chip.card) {
+                mf1_card_sim_field(m_chip.card, (value & 0x03) != 0, m_chip.stats.now_ns);
+            }
+            break;
+        case Status2Reg:
+            // only MFCrypto1On and the test bits are writable
+            m_chip.regs[reg] = (m_chip.regs[reg] & 0x07) | (value & 0xF8);
+            break;
+        default:
+            m_chip.regs[reg] = value;
+            break;
+    }
+}
+
+static uint8_t chip_read(uint8_t reg) {
+    switch (reg) {
+        case FIFOLevelReg:
+            return m_chip.fifo_length - m_chip.fifo_read;
+        case FIFODataReg:
+            return m_chip.fifo_read < m_chip.fifo_length ? m_chip.fifo[m_chip.fifo_read++] : 0;
+        case Status2Reg:
+            // ModemState: 011 while sending, then 110 receiving
+            return (m_chip.regs[reg] & 0xF8) | (m_chip.stats.now_ns < m_chip.tx_end_ns ? 0x03 : 0x06);
+        case VersionReg:
+            return 0x92;
+        default:
+            return m_chip.regs[reg];
+    }
+}
+
+/**
+ * @brief One SPI session, as rc522_spim_xfer() starts it: the whole EasyDMA transfer is done at once.
+ */
+void nrf_spim_task_trigger(NRF_SPIM_Type *p_reg, nrf_spim_task_t task) {
+    const uint8_t *tx = p_reg->tx;
+    uint8_t *rx = p_reg->rx;
+    uint16_t length = p_reg->tx_length;
+    m_chip.stats.spi_sessions++;
+    m_chip.stats.spi_bytes += length;
+    rc522_sim_advance(RC522_SIM_SPI_SESSION_NS + (uint64_t)length * RC522_SIM_SPI_BYTE_NS);
+    chip_update();
+    rx[0] = 0;
+    if (tx[0] & 0x80) {
+        // each byte answers the address sent before it
+        for (uint16_t i = 1; i < length; i++) {
+            rx[i] = chip_read((tx[i - 1] >> 1) & 0x3F);
+        }
+    } else {
+        for (uint16_t i = 1; i < length; i++) {
+            rx[i] = 0;
+            chip_write((tx[0] >> 1) & 0x3F, tx[i]);
+        }
+    }
+    p_reg->end = true;
+}
+
+void rc522_sim_init(mf1_card_sim_t *card) {
+    // the timers stay with the board, rc522.c obtains its own only once
+    memset(&m_chip, 0, sizeof(m_chip));
+    m_next_tick_ns = 10000000;
+    m_chip.card = card;
+    m_chip.random = 0x1234ABCD;
+    chip_reset();
+}
+
+void rc522_sim_crc_stall(bool stall) {
+    m_chip.crc_stall = stall;
+}
+
+rc522_sim_stats_t *rc522_sim_stats(void) {
+    return &m_chip.stats;
+}
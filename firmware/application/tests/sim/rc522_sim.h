@@ -0,0 +1,34 @@
+#ifndef RC522_SIM_H
+#define RC522_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mf1_card_sim.h"
+
+/*
+ * Simulated RC522 behind the SPIM stub, for the host builds of rc522.c and of the reader code on top of it:
+ * registers, FIFO, Transceive/MFAuthent/CalcCRC, the parity and the Crypto1 of the chip, and the field
+ * to a virtual card. Time is simulated: the SPI sessions, the frames on the field and bsp_delay_*()
+ * advance it, the bsp timers tick every 10 ms of it.
+ */
+#define RC522_SIM_SPI_BYTE_NS       1000    // 8 Mbps
+#define RC522_SIM_SPI_SESSION_NS    500     // chip select and EasyDMA setup
+
+typedef struct {
+    uint64_t now_ns;
+    uint32_t spi_sessions;
+    uint32_t spi_bytes;
+    uint32_t rf_frames;         // frames sent on the field
+    uint32_t rf_answers;        // frames the card answered
+    uint32_t timeouts;          // commands given up by the firmware, still running in the chip
+    uint32_t resets;            // soft resets, the field restarts of the firmware
+} rc522_sim_stats_t;
+
+void rc522_sim_init(mf1_card_sim_t *card);
+void rc522_sim_advance(uint64_t ns);
+// CalcCRC leaves CRCIRq and CRCResultReg as they are, a lost RC522
+void rc522_sim_crc_stall(bool stall);
+rc522_sim_stats_t *rc522_sim_stats(void);
+
+#endif
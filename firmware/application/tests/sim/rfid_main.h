@@ -0,0 +1,15 @@
+#ifndef RFID_MAIN_H
+#define RFID_MAIN_H
+
+/*
+ * Stands for src/rfid_main.h in the host builds of the reader: only the headers the reader code
+ * needs, not the tag emulation.
+ */
+#include "bsp_delay.h"
+#include "bsp_time.h"
+#include "hw_connect.h"
+#include "nrf_gpio.h"
+#include "mf1_toolbox.h"
+#include "rc522.h"
+
+#endif
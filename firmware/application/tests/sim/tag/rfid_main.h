@@ -0,0 +1,15 @@
+#ifndef RFID_MAIN_H
+#define RFID_MAIN_H
+
+/*
+ * Stands for src/rfid_main.h in the host builds of the tag emulation: only the headers the HF tag code
+ * needs, not the reader.
+ */
+#include "hw_connect.h"
+#include "nrf_gpio.h"
+#include "nfc_14a.h"
+#include "nfc_mf0_ntag.h"
+#include "nfc_mf1.h"
+#include "tag_emulation.h"
+
+#endif
@@ -0,0 +1,15 @@
+// Host stub of the nRF SDK error checks, an error aborts the test.
+#ifndef APP_ERROR_H
+#define APP_ERROR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS                 0
+#define NRF_ERROR_INVALID_PARAM     7
+#define APP_ERROR_CHECK(err_code)   do { if ((err_code) != NRF_SUCCESS) abort(); } while (0)
+#define APP_ERROR_CHECK_BOOL(cond)  do { if (!(cond)) abort(); } while (0)
+
+#endif
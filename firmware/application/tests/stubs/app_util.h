@@ -0,0 +1,7 @@
+// Host stub of the nRF SDK app_util.h
+#ifndef APP_UTIL_H
+#define APP_UTIL_H
+
+#define STATIC_ASSERT(EXPR) _Static_assert((EXPR), #EXPR)
+
+#endif
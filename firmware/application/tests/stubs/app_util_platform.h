@@ -0,0 +1,8 @@
+// Host stub of the nRF SDK app_util_platform.h, the host tests run no interrupts
+#ifndef APP_UTIL_PLATFORM_H
+#define APP_UTIL_PLATFORM_H
+
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
+
+#endif
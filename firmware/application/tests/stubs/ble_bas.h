@@ -0,0 +1,5 @@
+// Host stub, enough for ble_main.h
+#ifndef BLE_BAS_H__
+#define BLE_BAS_H__
+
+#endif
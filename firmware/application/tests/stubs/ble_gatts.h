@@ -0,0 +1,8 @@
+// Host stub, enough for ble_main.h and the SoC API its users get through it
+#ifndef BLE_GATTS_H__
+#define BLE_GATTS_H__
+
+#include "nrf.h"
+#include "nrf_soc.h"
+
+#endif
@@ -0,0 +1,10 @@
+// Host stub of the CMSIS intrinsics used by the firmware headers.
+#ifndef CMSIS_GCC_H
+#define CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __REV(value) __builtin_bswap32(value)
+#define __NOP()      do {} while (0)
+
+#endif
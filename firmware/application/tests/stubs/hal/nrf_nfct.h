@@ -0,0 +1,85 @@
+// Host stub of the nRF NFCT HAL: the registers nfc_14a.c programs, at their nRF52840 offsets.
+// The host test maps the page of NRF_NFCT_BASE, nfc_14a.c also writes it through a raw address.
+#ifndef NRF_NFCT_H__
+#define NRF_NFCT_H__
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t FRAMECONFIG;
+    uint32_t AMOUNT;
+} NFCT_TXD_Type;
+
+typedef struct {
+    uint32_t FRAMECONFIG;
+    uint32_t AMOUNT;
+} NFCT_RXD_Type;
+
+typedef struct {
+    volatile uint32_t TASKS_ACTIVATE;           // 0x000
+    volatile uint32_t TASKS_DISABLE;            // 0x004
+    volatile uint32_t TASKS_SENSE;              // 0x008
+    volatile uint32_t TASKS_STARTTX;            // 0x00C
+    volatile uint32_t TASKS_STOPTX;             // 0x010, undocumented, written by nfc_fdt_reset()
+    uint32_t RESERVED[2];
+    volatile uint32_t TASKS_ENABLERXDATA;       // 0x01C
+    uint32_t RESERVED1[184];
+    volatile uint32_t INTEN;                    // 0x300
+    volatile uint32_t INTENSET;                 // 0x304
+    volatile uint32_t INTENCLR;                 // 0x308
+    uint32_t RESERVED2[126];
+    volatile uint32_t FRAMEDELAYMIN;            // 0x504
+    volatile uint32_t FRAMEDELAYMAX;            // 0x508
+    volatile uint32_t FRAMEDELAYMODE;           // 0x50C
+    volatile uint32_t PACKETPTR;                // 0x510
+    volatile uint32_t MAXLEN;                   // 0x514
+    volatile NFCT_TXD_Type TXD;                 // 0x518
+    volatile NFCT_RXD_Type RXD;                 // 0x520
+} NRF_NFCT_Type;
+
+#define NRF_NFCT_BASE   0x40005000UL
+#define NRF_NFCT        ((NRF_NFCT_Type *)NRF_NFCT_BASE)
+
+#define NFCT_TXD_FRAMECONFIG_PARITY_Msk         (0x1UL << 0)
+#define NFCT_TXD_FRAMECONFIG_DISCARDMODE_Msk    (0x1UL << 1)
+#define NFCT_TXD_FRAMECONFIG_SOF_Msk            (0x1UL << 2)
+#define NFCT_TXD_FRAMECONFIG_CRCMODETX_Msk      (0x1UL << 4)
+#define NFCT_TXD_AMOUNT_TXDATABITS_Pos          (0UL)
+#define NFCT_TXD_AMOUNT_TXDATABITS_Msk          (0x7UL << NFCT_TXD_AMOUNT_TXDATABITS_Pos)
+#define NFCT_TXD_AMOUNT_TXDATABYTES_Pos         (3UL)
+#define NFCT_TXD_AMOUNT_TXDATABYTES_Msk         (0x1FFUL << NFCT_TXD_AMOUNT_TXDATABYTES_Pos)
+#define NFCT_RXD_AMOUNT_RXDATABITS_Pos          (0UL)
+#define NFCT_RXD_AMOUNT_RXDATABITS_Msk          (0x7UL << NFCT_RXD_AMOUNT_RXDATABITS_Pos)
+#define NFCT_RXD_AMOUNT_RXDATABYTES_Pos         (3UL)
+#define NFCT_RXD_AMOUNT_RXDATABYTES_Msk         (0x1FFUL << NFCT_RXD_AMOUNT_RXDATABYTES_Pos)
+#define NFCT_MAXLEN_MAXLEN_Pos                  (0UL)
+#define NFCT_MAXLEN_MAXLEN_Msk                  (0x1FFUL << NFCT_MAXLEN_MAXLEN_Pos)
+#define NFCT_FRAMEDELAYMAX_FRAMEDELAYMAX_Msk    (0xFFFFFUL)
+
+typedef enum {
+    NRF_NFCT_INT_FIELDDETECTED_MASK = (0x1UL << 1),
+    NRF_NFCT_INT_FIELDLOST_MASK     = (0x1UL << 2),
+    NRF_NFCT_INT_TXFRAMESTART_MASK  = (0x1UL << 3),
+    NRF_NFCT_INT_TXFRAMEEND_MASK    = (0x1UL << 4),
+    NRF_NFCT_INT_RXFRAMESTART_MASK  = (0x1UL << 5),
+    NRF_NFCT_INT_RXFRAMEEND_MASK    = (0x1UL << 6),
+    NRF_NFCT_INT_ERROR_MASK         = (0x1UL << 7),
+    NRF_NFCT_INT_RXERROR_MASK       = (0x1UL << 10),
+    NRF_NFCT_INT_SELECTED_MASK      = (0x1UL << 19),
+} nrf_nfct_int_mask_t;
+
+typedef enum {
+    NRF_NFCT_FRAME_DELAY_MODE_WINDOWGRID = 3,
+} nrf_nfct_frame_delay_mode_t;
+
+typedef enum {
+    NRF_NFCT_TASK_ACTIVATE,
+    NRF_NFCT_TASK_DISABLE,
+    NRF_NFCT_TASK_SENSE,
+} nrf_nfct_task_t;
+
+static inline void nrf_nfct_frame_delay_max_set(uint32_t frame_delay_max) {
+    NRF_NFCT->FRAMEDELAYMAX = frame_delay_max & NFCT_FRAMEDELAYMAX_FRAMEDELAYMAX_Msk;
+}
+
+#endif
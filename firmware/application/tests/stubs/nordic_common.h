@@ -0,0 +1,9 @@
+// Host stub of the nRF SDK common macros used by the firmware parts built on the host.
+#ifndef NORDIC_COMMON_H
+#define NORDIC_COMMON_H
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#endif
@@ -0,0 +1,15 @@
+// Host stub of the nRF52840 registers the firmware parts built on the host read, zeroed.
+#ifndef NRF_H
+#define NRF_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t DEVICEID[2];
+    uint32_t DEVICEADDR[2];
+} NRF_FICR_Type;
+
+__attribute__((unused)) static NRF_FICR_Type m_host_ficr;
+#define NRF_FICR (&m_host_ficr)
+
+#endif
@@ -0,0 +1,7 @@
+// Host stub of the nRF SDK assert. The firmware is built without DEBUG_NRF, ASSERT() compiles to nothing.
+#ifndef NRF_ASSERT_H_
+#define NRF_ASSERT_H_
+
+#define ASSERT(expr)
+
+#endif
@@ -0,0 +1,7 @@
+// Host stub, enough for rgb_marquee.h
+#ifndef NRF_DRV_PWM_H
+#define NRF_DRV_PWM_H
+
+#include <stdbool.h>
+
+#endif
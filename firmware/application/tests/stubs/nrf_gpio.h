@@ -0,0 +1,20 @@
+// Host stub of the nRF GPIO HAL, pins are not modelled.
+#ifndef NRF_GPIO_H
+#define NRF_GPIO_H
+
+#include <stdint.h>
+
+#define NRF_GPIO_PIN_MAP(port, pin)     (((port) << 5) | ((pin) & 0x1F))
+
+typedef enum {
+    NRF_GPIO_PIN_NOPULL,
+    NRF_GPIO_PIN_PULLDOWN,
+    NRF_GPIO_PIN_PULLUP = 3,
+} nrf_gpio_pin_pull_t;
+
+static inline void nrf_gpio_cfg_output(uint32_t pin) { (void)pin; }
+static inline void nrf_gpio_cfg_input(uint32_t pin, nrf_gpio_pin_pull_t pull) { (void)pin; (void)pull; }
+static inline void nrf_gpio_pin_set(uint32_t pin) { (void)pin; }
+static inline void nrf_gpio_pin_clear(uint32_t pin) { (void)pin; }
+
+#endif
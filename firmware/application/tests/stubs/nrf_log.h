@@ -0,0 +1,22 @@
+// Host stub of the nRF SDK logger, logs are dropped.
+#ifndef NRF_LOG_H
+#define NRF_LOG_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "sdk_common.h"
+
+// the arguments stay evaluated in dead code, a variable only logged is not reported unused
+static inline void nrf_log_drop(const char *format, ...) {
+    (void)format;
+}
+
+#define NRF_LOG_MODULE_REGISTER()       extern int nrf_log_module_unused
+#define NRF_LOG_INFO(...)               do { if (0) nrf_log_drop(__VA_ARGS__); } while (0)
+#define NRF_LOG_ERROR(...)              do { if (0) nrf_log_drop(__VA_ARGS__); } while (0)
+#define NRF_LOG_WARNING(...)            do { if (0) nrf_log_drop(__VA_ARGS__); } while (0)
+#define NRF_LOG_DEBUG(...)              do { if (0) nrf_log_drop(__VA_ARGS__); } while (0)
+#define NRF_LOG_HEXDUMP_INFO(p, len)    do { (void)(p); (void)(len); } while (0)
+
+#endif
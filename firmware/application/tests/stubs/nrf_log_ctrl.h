@@ -0,0 +1,9 @@
+// Host stub, see nrf_log.h
+#ifndef NRF_LOG_CTRL_H
+#define NRF_LOG_CTRL_H
+
+#include <stdbool.h>
+
+#define NRF_LOG_PROCESS()   false
+
+#endif
@@ -0,0 +1 @@
+// Host stub, see nrf_log.h
@@ -0,0 +1,7 @@
+// Host stub, enough for hw_connect.h
+#ifndef NRF_LPCOMP_H
+#define NRF_LPCOMP_H
+
+typedef int nrf_lpcomp_input_t;
+
+#endif
@@ -0,0 +1,15 @@
+// Host stub of the nRF SDK power management, the device does not shut down.
+#ifndef NRF_PWR_MGMT_H__
+#define NRF_PWR_MGMT_H__
+
+typedef enum {
+    NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF,
+    NRF_PWR_MGMT_SHUTDOWN_STAY_IN_SYSOFF,
+    NRF_PWR_MGMT_SHUTDOWN_GOTO_DFU,
+    NRF_PWR_MGMT_SHUTDOWN_RESET,
+    NRF_PWR_MGMT_SHUTDOWN_CONTINUE,
+} nrf_pwr_mgmt_shutdown_t;
+
+static inline void nrf_pwr_mgmt_shutdown(nrf_pwr_mgmt_shutdown_t shutdown_type) { (void)shutdown_type; }
+
+#endif
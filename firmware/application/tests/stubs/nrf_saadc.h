@@ -0,0 +1,7 @@
+// Host stub, enough for hw_connect.h
+#ifndef NRF_SAADC_H
+#define NRF_SAADC_H
+
+typedef int nrf_saadc_input_t;
+
+#endif
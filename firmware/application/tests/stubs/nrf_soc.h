@@ -0,0 +1,11 @@
+// Host stub of the SoftDevice SoC API.
+#ifndef NRF_SOC_H
+#define NRF_SOC_H
+
+#include <stdint.h>
+
+static inline uint32_t sd_app_evt_wait(void) { return 0; }
+static inline uint32_t sd_power_gpregret_clr(uint32_t gpregret_id, uint32_t gpregret_msk) { return 0; }
+static inline uint32_t sd_power_gpregret_set(uint32_t gpregret_id, uint32_t gpregret_msk) { return 0; }
+
+#endif
@@ -0,0 +1,47 @@
+// Host stub of the nRF SPIM HAL: a transfer runs at once, in nrf_spim_task_trigger(), which the host test provides.
+#ifndef NRF_SPIM_H
+#define NRF_SPIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct {
+    const uint8_t *tx;
+    uint8_t *rx;
+    size_t tx_length;
+    size_t rx_length;
+    bool end;
+} NRF_SPIM_Type;
+
+extern NRF_SPIM_Type g_nrf_spim0;
+#define NRF_SPIM0   (&g_nrf_spim0)
+
+typedef enum { NRF_SPIM_TASK_START } nrf_spim_task_t;
+typedef enum { NRF_SPIM_EVENT_END } nrf_spim_event_t;
+typedef enum { NRF_SPIM_FREQ_8M } nrf_spim_frequency_t;
+typedef enum { NRF_SPIM_MODE_0 } nrf_spim_mode_t;
+typedef enum { NRF_SPIM_BIT_ORDER_MSB_FIRST } nrf_spim_bit_order_t;
+
+void nrf_spim_task_trigger(NRF_SPIM_Type *p_reg, nrf_spim_task_t task);
+
+static inline void nrf_spim_tx_buffer_set(NRF_SPIM_Type *p_reg, const uint8_t *p_buffer, size_t length) {
+    p_reg->tx = p_buffer;
+    p_reg->tx_length = length;
+}
+
+static inline void nrf_spim_rx_buffer_set(NRF_SPIM_Type *p_reg, uint8_t *p_buffer, size_t length) {
+    p_reg->rx = p_buffer;
+    p_reg->rx_length = length;
+}
+
+static inline void nrf_spim_event_clear(NRF_SPIM_Type *p_reg, nrf_spim_event_t event) { p_reg->end = false; }
+static inline bool nrf_spim_event_check(NRF_SPIM_Type *p_reg, nrf_spim_event_t event) { return p_reg->end; }
+static inline void nrf_spim_pins_set(NRF_SPIM_Type *p_reg, uint32_t sck, uint32_t mosi, uint32_t miso) {}
+static inline void nrf_spim_frequency_set(NRF_SPIM_Type *p_reg, nrf_spim_frequency_t frequency) {}
+static inline void nrf_spim_configure(NRF_SPIM_Type *p_reg, nrf_spim_mode_t mode, nrf_spim_bit_order_t order) {}
+static inline void nrf_spim_orc_set(NRF_SPIM_Type *p_reg, uint8_t orc) {}
+static inline void nrf_spim_enable(NRF_SPIM_Type *p_reg) {}
+static inline void nrf_spim_disable(NRF_SPIM_Type *p_reg) {}
+
+#endif
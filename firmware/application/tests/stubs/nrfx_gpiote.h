@@ -0,0 +1,32 @@
+// Host stub of the nRF GPIOTE driver, no pin ever changes.
+#ifndef NRFX_GPIOTE_H
+#define NRFX_GPIOTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "nrf_gpio.h"
+#include "app_error.h"
+
+typedef uint32_t nrfx_gpiote_pin_t;
+typedef enum { NRF_GPIOTE_POLARITY_LOTOHI = 1, NRF_GPIOTE_POLARITY_HITOLO } nrf_gpiote_polarity_t;
+
+typedef struct {
+    nrf_gpiote_polarity_t sense;
+    nrf_gpio_pin_pull_t pull;
+    bool hi_accuracy;
+} nrfx_gpiote_in_config_t;
+
+typedef void (*nrfx_gpiote_evt_handler_t)(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+
+#define NRFX_GPIOTE_CONFIG_IN_SENSE_LOTOHI(hi_accu) { NRF_GPIOTE_POLARITY_LOTOHI, NRF_GPIO_PIN_NOPULL, hi_accu }
+#define NRFX_GPIOTE_CONFIG_IN_SENSE_HITOLO(hi_accu) { NRF_GPIOTE_POLARITY_HITOLO, NRF_GPIO_PIN_NOPULL, hi_accu }
+
+static inline ret_code_t nrfx_gpiote_in_init(nrfx_gpiote_pin_t pin, const nrfx_gpiote_in_config_t *config,
+                                             nrfx_gpiote_evt_handler_t handler) {
+    return NRF_SUCCESS;
+}
+static inline void nrfx_gpiote_in_uninit(nrfx_gpiote_pin_t pin) {}
+static inline void nrfx_gpiote_in_event_enable(nrfx_gpiote_pin_t pin, bool int_enable) {}
+
+#endif
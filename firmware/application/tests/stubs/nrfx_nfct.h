@@ -0,0 +1,59 @@
+// Host stub of the nrfx NFCT driver: the events nfc_14a.c handles, the host test raises them.
+#ifndef NRFX_NFCT_H__
+#define NRFX_NFCT_H__
+
+#include <stdint.h>
+
+#include "hal/nrf_nfct.h"
+
+typedef enum {
+    NRFX_SUCCESS,
+} nrfx_err_t;
+
+typedef enum {
+    NRFX_NFCT_STATE_DISABLED  = NRF_NFCT_TASK_DISABLE,
+    NRFX_NFCT_STATE_SENSING   = NRF_NFCT_TASK_SENSE,
+    NRFX_NFCT_STATE_ACTIVATED = NRF_NFCT_TASK_ACTIVATE,
+} nrfx_nfct_state_t;
+
+typedef enum {
+    NRFX_NFCT_EVT_FIELD_DETECTED = NRF_NFCT_INT_FIELDDETECTED_MASK,
+    NRFX_NFCT_EVT_FIELD_LOST     = NRF_NFCT_INT_FIELDLOST_MASK,
+    NRFX_NFCT_EVT_SELECTED       = NRF_NFCT_INT_SELECTED_MASK,
+    NRFX_NFCT_EVT_RX_FRAMESTART  = NRF_NFCT_INT_RXFRAMESTART_MASK,
+    NRFX_NFCT_EVT_RX_FRAMEEND    = NRF_NFCT_INT_RXFRAMEEND_MASK,
+    NRFX_NFCT_EVT_TX_FRAMESTART  = NRF_NFCT_INT_TXFRAMESTART_MASK,
+    NRFX_NFCT_EVT_TX_FRAMEEND    = NRF_NFCT_INT_TXFRAMEEND_MASK,
+    NRFX_NFCT_EVT_ERROR          = NRF_NFCT_INT_ERROR_MASK,
+} nrfx_nfct_evt_id_t;
+
+typedef enum {
+    NRFX_NFCT_ERROR_FRAMEDELAYTIMEOUT,
+    NRFX_NFCT_ERROR_NUM,
+} nrfx_nfct_error_t;
+
+typedef struct {
+    nrfx_nfct_error_t reason;
+} nrfx_nfct_evt_error_t;
+
+typedef struct {
+    nrfx_nfct_evt_id_t evt_id;
+    union {
+        nrfx_nfct_evt_error_t error;
+    } params;
+} nrfx_nfct_evt_t;
+
+typedef void (*nrfx_nfct_handler_t)(nrfx_nfct_evt_t const *p_event);
+
+typedef struct {
+    uint32_t rxtx_int_mask;
+    nrfx_nfct_handler_t cb;
+} nrfx_nfct_config_t;
+
+nrfx_err_t nrfx_nfct_init(nrfx_nfct_config_t const *p_config);
+void nrfx_nfct_uninit(void);
+void nrfx_nfct_enable(void);
+void nrfx_nfct_autocolres_disable(void);
+void nrfx_nfct_state_force(nrfx_nfct_state_t state);
+
+#endif
@@ -0,0 +1,12 @@
+// Host stub, enough for ble_main.h
+#ifndef NRFX_SAADC_H__
+#define NRFX_SAADC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nrf_saadc.h"
+
+typedef int16_t nrf_saadc_value_t;
+
+#endif
@@ -0,0 +1,14 @@
+// Host stub, enough for the SDK crc32.c, the logger stub and the error checks
+#ifndef SDK_COMMON_H
+#define SDK_COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "app_error.h"
+#include "nordic_common.h"
+#include "nrf_assert.h"
+
+#define NRF_MODULE_ENABLED(module) 1
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * Host test of the ISO14443A parity framing of the tag emulation: nfc_tag_14a_wrap_frame(), nfc_tag_14a_unwrap_frame()
+ * (nfc_14a.c) and mf_crypto1_encrypt_frame() (crypto1_helper.c), against the bit by bit framing they replaced, kept
+ * here as the reference. Every value of every data byte and parity bit is framed at every position, every frame
+ * length is unwrapped, in place too, and the whole output buffers are compared, bytes written past the frame included.
+ * The fused encryption must leave the frame and the cipher state of mf_crypto1_encryptEx() then the framing.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nfc_14a.h"
+#include "crypto1_helper.h"
+#include "byte_mirror.h"
+#include "test_util.h"
+
+// a READ answer, 16 bytes and the CRC
+#define FRAME_BYTES_MAX     18
+#define UNWRAP_BITS_MAX     (64 * 9 + 8)
+#define SENTINEL            0xA5
+
+
+//---------------------------------------------------------------------------- reference, nfc_14a.c before
+
+static uint8_t reference_wrap_frame(const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtFrame) {
+    uint8_t btData;
+    uint32_t uiBitPos;
+    uint32_t uiDataPos = 0;
+    size_t szBitsLeft = szTxBits;
+    size_t szFrameBits = 0;
+
+    if (szBitsLeft == 0)
+        return 0;
+    if (szBitsLeft < 9) {
+        *pbtFrame = *pbtTx;
+        szFrameBits = szTxBits;
+        return szFrameBits;
+    }
+    szFrameBits = szTxBits + (szTxBits / 8);
+    while (1) {
+        uint8_t btFrame = 0;
+        for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
+            btData = byte_mirror[pbtTx[uiDataPos]];
+            btFrame |= (btData >> uiBitPos);
+            *pbtFrame = byte_mirror[btFrame];
+            btFrame = (btData << (8 - uiBitPos));
+            btFrame |= ((pbtTxPar[uiDataPos] & 0x01) << (7 - uiBitPos));
+            pbtFrame++;
+            *pbtFrame = byte_mirror[btFrame];
+            uiDataPos++;
+            if (szBitsLeft < 9)
+                return szFrameBits;
+            szBitsLeft -= 8;
+        }
+        pbtFrame++;
+    }
+}
+
+static uint8_t reference_unwrap_frame(const uint8_t *pbtFrame, const size_t szFrameBits, uint8_t *pbtRx, uint8_t *pbtRxPar) {
+    uint8_t btFrame;
+    uint8_t btData;
+    uint8_t uiBitPos;
+    uint32_t uiDataPos = 0;
+    uint8_t *pbtFramePos = (uint8_t *)pbtFrame;
+    size_t szBitsLeft = szFrameBits;
+    size_t szRxBits = 0;
+
+    if (szBitsLeft == 0)
+        return 0;
+    if (szBitsLeft < 9) {
+        *pbtRx = *pbtFrame;
+        szRxBits = szFrameBits;
+        return szRxBits;
+    }
+    szRxBits = szFrameBits - (szFrameBits / 9);
+    while (1) {
+        for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
+            btFrame = byte_mirror[pbtFramePos[uiDataPos]];
+            btData = (btFrame << uiBitPos);
+            btFrame = byte_mirror[pbtFramePos[uiDataPos + 1]];
+            btData |= (btFrame >> (8 - uiBitPos));
+            pbtRx[uiDataPos] = byte_mirror[btData];
+            if (pbtRxPar != NULL)
+                pbtRxPar[uiDataPos] = ((btFrame >> (7 - uiBitPos)) & 0x01);
+            uiDataPos++;
+            if (szBitsLeft < 9)
+                return szRxBits;
+            szBitsLeft -= 9;
+        }
+        pbtFramePos++;
+    }
+}
+
+
+//---------------------------------------------------------------------------- equivalence
+
+static void random_bytes(uint8_t *buffer, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = rand();
+    }
+}
+
+static bool wrap_matches(const uint8_t *data, size_t bits, const uint8_t *par) {
+    uint8_t expected[FRAME_BYTES_MAX * 9 / 8 + 4], actual[sizeof(expected)];
+    memset(expected, SENTINEL, sizeof(expected));
+    memset(actual, SENTINEL, sizeof(actual));
+    uint8_t expected_bits = reference_wrap_frame(data, bits, par, expected);
+    uint8_t actual_bits = nfc_tag_14a_wrap_frame(data, bits, par, actual);
+    return expected_bits == actual_bits && memcmp(expected, actual, sizeof(expected)) == 0;
+}
+
+static void test_wrap(void) {
+    uint8_t data[FRAME_BYTES_MAX], par[FRAME_BYTES_MAX];
+    uint32_t mismatches = 0;
+    // every byte value and parity at every position of every frame length, the other bytes random
+    for (int bytes = 1; bytes <= FRAME_BYTES_MAX; bytes++) {
+        for (int pos = 0; pos < bytes; pos++) {
+            for (int value = 0; value < 512; value++) {
+                random_bytes(data, sizeof(data));
+                random_bytes(par, sizeof(par));
+                data[pos] = value;
+                par[pos] = value >> 8;
+                mismatches += !wrap_matches(data, bytes * 8, par);
+            }
+        }
+    }
+    // bit counts which are not whole bytes, the short frames included
+    for (int bits = 1; bits <= FRAME_BYTES_MAX * 8; bits++) {
+        for (int round = 0; round < 64; round++) {
+            random_bytes(data, sizeof(data));
+            random_bytes(par, sizeof(par));
+            mismatches += !wrap_matches(data, bits, par);
+        }
+    }
+    CHECK(mismatches == 0, "%u wrapped frames differ from the reference", mismatches);
+}
+
+static bool unwrap_matches(const uint8_t *frame, size_t bits, bool with_parity) {
+    uint8_t expected[UNWRAP_BITS_MAX / 8 + 4], actual[sizeof(expected)];
+    uint8_t expected_par[sizeof(expected)], actual_par[sizeof(expected)];
+    memset(expected, SENTINEL, sizeof(expected));
+    memset(actual, SENTINEL, sizeof(actual));
+    memset(expected_par, SENTINEL, sizeof(expected_par));
+    memset(actual_par, SENTINEL, sizeof(actual_par));
+    uint8_t expected_bits = reference_unwrap_frame(frame, bits, expected, with_parity ? expected_par : NULL);
+    uint8_t actual_bits = nfc_tag_14a_unwrap_frame(frame, bits, actual, with_parity ? actual_par : NULL);
+    if (expected_bits != actual_bits || memcmp(expected, actual, sizeof(expected)) || memcmp(expected_par, actual_par, sizeof(expected_par))) {
+        return false;
+    }
+    // in place, as nfc_tag_14a_data_process() does
+    uint8_t in_place[sizeof(expected)];
+    memcpy(in_place, frame, sizeof(in_place));
+    actual_bits = nfc_tag_14a_unwrap_frame(in_place, bits, in_place, NULL);
+    memcpy(expected, frame, sizeof(expected));
+    expected_bits = reference_unwrap_frame(expected, bits, expected, NULL);
+    return expected_bits == actual_bits && memcmp(expected, in_place, sizeof(expected)) == 0;
+}
+
+static void test_unwrap(void) {
+    uint8_t frame[UNWRAP_BITS_MAX / 8 + 4];
+    uint32_t mismatches = 0;
+    // every 9 bits value at every position of a WRITE data frame, 16 bytes and the CRC
+    for (int pos = 0; pos < FRAME_BYTES_MAX; pos++) {
+        for (int value = 0; value < 512; value++) {
+            random_bytes(frame, sizeof(frame));
+            for (int bit = 0; bit < 9; bit++) {
+                int at = pos * 9 + bit;
+                frame[at / 8] = (frame[at / 8] & ~(1 << (at % 8))) | (((value >> bit) & 1) << (at % 8));
+            }
+            mismatches += !unwrap_matches(frame, FRAME_BYTES_MAX * 9, pos & 1);
+        }
+    }
+    // every frame length
+    for (int bits = 1; bits <= UNWRAP_BITS_MAX; bits++) {
+        for (int round = 0; round < 16; round++) {
+            random_bytes(frame, sizeof(frame));
+            mismatches += !unwrap_matches(frame, bits, round & 1);
+        }
+    }
+    CHECK(mismatches == 0, "%u unwrapped frames differ from the reference", mismatches);
+}
+
+static void test_encrypt_frame(void) {
+    uint8_t data[FRAME_BYTES_MAX], keystream[FRAME_BYTES_MAX];
+    uint32_t mismatches = 0;
+    for (int round = 0; round < 20000; round++) {
+        uint64_t key = ((uint64_t)rand() << 32 | (uint32_t)rand()) & 0xFFFFFFFFFFFFULL;
+        // from 2 bytes, the framing leaves a single byte as it is
+        uint16_t len = 2 + round % (FRAME_BYTES_MAX - 1);
+        bool with_keystream = round & 1;
+        random_bytes(data, sizeof(data));
+        random_bytes(keystream, sizeof(keystream));
+
+        struct Crypto1State expected_cs, actual_cs;
+        crypto1_init(&expected_cs, key);
+        crypto1_word(&expected_cs, rand(), 0);
+        actual_cs = expected_cs;
+
+        uint8_t encrypted[FRAME_BYTES_MAX], par[FRAME_BYTES_MAX];
+        uint8_t expected[FRAME_BYTES_MAX * 9 / 8 + 4], actual[sizeof(expected)];
+        memset(expected, SENTINEL, sizeof(expected));
+        memset(actual, SENTINEL, sizeof(actual));
+        mf_crypto1_encryptEx(&expected_cs, data, with_keystream ? keystream : NULL, encrypted, len, par);
+        uint16_t expected_bits = reference_wrap_frame(encrypted, len * 8, par, expected);
+        uint16_t actual_bits = mf_crypto1_encrypt_frame(&actual_cs, data, with_keystream ? keystream : NULL, len, actual);
+        if (expected_bits != actual_bits || memcmp(expected, actual, sizeof(expected)) ||
+                expected_cs.odd != actual_cs.odd || expected_cs.even != actual_cs.even) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0, "%u encrypted frames differ from mf_crypto1_encryptEx() and the framing", mismatches);
+}
+
+
+//---------------------------------------------------------------------------- benchmark
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void benchmark(void) {
+    const int rounds = 1000000;
+    uint8_t data[FRAME_BYTES_MAX], par[FRAME_BYTES_MAX], frame[FRAME_BYTES_MAX * 9 / 8 + 4];
+    uint8_t rx[FRAME_BYTES_MAX + 1];
+    volatile uint32_t sink = 0;
+    random_bytes(data, sizeof(data));
+    random_bytes(par, sizeof(par));
+    random_bytes(frame, sizeof(frame));
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        data[0] = i;
+        sink += reference_wrap_frame(data, FRAME_BYTES_MAX * 8, par, frame);
+    }
+    uint64_t reference_ns = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        data[0] = i;
+        sink += nfc_tag_14a_wrap_frame(data, FRAME_BYTES_MAX * 8, par, frame);
+    }
+    printf("wrap of 18 bytes: %.1f ns, was %.1f ns\n", (double)(now_ns() - start) / rounds, (double)reference_ns / rounds);
+
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        frame[0] = i;
+        sink += reference_unwrap_frame(frame, FRAME_BYTES_MAX * 9, rx, NULL);
+    }
+    reference_ns = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        frame[0] = i;
+        sink += nfc_tag_14a_unwrap_frame(frame, FRAME_BYTES_MAX * 9, rx, NULL);
+    }
+    printf("unwrap of 18 bytes: %.1f ns, was %.1f ns\n", (double)(now_ns() - start) / rounds, (double)reference_ns / rounds);
+
+    struct Crypto1State cs;
+    crypto1_init(&cs, 0xFFFFFFFFFFFFULL);
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        uint8_t encrypted[FRAME_BYTES_MAX];
+        mf_crypto1_encryptEx(&cs, data, NULL, encrypted, FRAME_BYTES_MAX, par);
+        sink += reference_wrap_frame(encrypted, FRAME_BYTES_MAX * 8, par, frame);
+    }
+    reference_ns = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        sink += mf_crypto1_encrypt_frame(&cs, data, NULL, FRAME_BYTES_MAX, frame);
+    }
+    printf("encrypt and wrap of 18 bytes: %.1f ns, was %.1f ns\n", (double)(now_ns() - start) / rounds, (double)reference_ns / rounds);
+}
+
+
+int main(void) {
+    srand(1);
+    test_wrap();
+    test_unwrap();
+    test_encrypt_frame();
+    benchmark();
+
+    return test_result("test_14a_frame");
+}
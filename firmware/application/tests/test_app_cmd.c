@@ -0,0 +1,422 @@
+/**
+ * Host test of the commands of app_cmd.c built whole, with the tag emulation on the simulated NFCT and flash and the
+ * device of sim/app_sim.c around it, the requests going through on_data_frame_received() as they come from a client.
+ * A batch must answer the results of its sub requests in order, each the response the command gives alone, and stop
+ * at a truncated sub request or one longer than the batch, the results before it still sent. A batch inside a batch
+ * is refused, the batch around it goes on. The partial responses of a sub command are STATUS_MORE_DATA results, and
+ * results larger than a frame are sent in STATUS_MORE_DATA frames of the batch.
+ * The bulk commands of the emulator memory are run on MIFARE Classic and NTAG slots: what is written in chunks must
+ * be the memory of the card, read back whole or in part, with its crc32 the one of zlib. A range past the memory is
+ * refused and writes nothing, a slot without HF memory is refused, and a 4K card read in a batch comes in
+ * STATUS_MORE_DATA frames.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "app_cmd.h"
+#include "app_status.h"
+#include "data_cmd.h"
+#include "nfc_mf0_ntag.h"
+#include "nfc_mf1.h"
+#include "nfc_mf1_log.h"
+#include "tag_emulation.h"
+#include "sim/app_sim.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+#define RESULTS_MAX     32
+#define LOG_SIZE        sizeof(nfc_tag_mf1_auth_log_t)
+
+// the HF card of each slot while the test runs, slot 3 has only an LF card
+static const tag_specific_type_t m_slot_types[] = {
+    TAG_TYPE_MIFARE_1024, TAG_TYPE_NTAG_215, TAG_TYPE_MIFARE_4096, TAG_TYPE_UNDEFINED,
+};
+
+typedef struct {
+    uint16_t cmd;
+    uint16_t status;
+    uint16_t length;
+    const uint8_t *data;
+} result_t;
+
+// the results of the last batch, their data in m_batch_data
+static uint8_t m_batch_data[APP_SIM_FRAMES_MAX * NETDATA_MAX_DATA_LENGTH];
+static result_t m_results[RESULTS_MAX];
+static uint16_t m_result_count;
+
+static void put16(uint8_t *bytes, uint16_t value) {
+    bytes[0] = value >> 8;
+    bytes[1] = value;
+}
+
+static uint16_t get16(const uint8_t *bytes) {
+    return (bytes[0] << 8) | bytes[1];
+}
+
+static void put32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+}
+
+// One request as a client sends it, the frames of its response in app_sim
+static void request(uint16_t cmd, uint16_t length, const uint8_t *data) {
+    static uint8_t buffer[NETDATA_MAX_DATA_LENGTH];
+    if (length > 0) {
+        memcpy(buffer, data, length);
+    }
+    app_sim_reset();
+    on_data_frame_received(cmd, 0, length, buffer);
+}
+
+// The only frame of a response to a request sent alone
+static const app_sim_frame_t *response(uint16_t cmd, uint16_t length, const uint8_t *data) {
+    request(cmd, length, data);
+    CHECK(app_sim_frame_count() == 1, "cmd %u: %u frames", cmd, app_sim_frame_count());
+    return app_sim_frame(0);
+}
+
+// A sub request appended to a batch, returns the batch length
+static uint16_t batch_add(uint8_t *batch, uint16_t offset, uint16_t cmd, uint16_t length, const uint8_t *data) {
+    put16(&batch[offset], cmd);
+    put16(&batch[offset + 2], length);
+    if (length > 0) {
+        memcpy(&batch[offset + 4], data, length);
+    }
+    return offset + 4 + length;
+}
+
+/**
+ * Sends a batch and splits its results, returns the status of its last frame. The frames before it must be
+ * STATUS_MORE_DATA frames of the batch cmd, counted in frames.
+ */
+static uint16_t batch_run(const uint8_t *batch, uint16_t length, uint16_t *frames) {
+    request(DATA_CMD_BATCH, length, batch);
+    uint32_t batch_length = 0;
+    uint16_t count = app_sim_frame_count();
+    for (uint16_t i = 0; i < count; i++) {
+        const app_sim_frame_t *frame = app_sim_frame(i);
+        CHECK(frame->cmd == DATA_CMD_BATCH, "frame %u of the batch of cmd %u", i, frame->cmd);
+        CHECK(i == count - 1 || (frame->status == STATUS_MORE_DATA && frame->length == NETDATA_MAX_DATA_LENGTH),
+              "frame %u of %u: status 0x%02x, %u bytes", i, count, frame->status, frame->length);
+        memcpy(&m_batch_data[batch_length], frame->data, frame->length);
+        batch_length += frame->length;
+    }
+    m_result_count = 0;
+    uint32_t offset = 0;
+    while (offset + 6 <= batch_length && m_result_count < RESULTS_MAX) {
+        result_t *result = &m_results[m_result_count++];
+        result->cmd = get16(&m_batch_data[offset]);
+        result->status = get16(&m_batch_data[offset + 2]);
+        result->length = get16(&m_batch_data[offset + 4]);
+        result->data = &m_batch_data[offset + 6];
+        offset += 6 + result->length;
+    }
+    CHECK(offset == batch_length, "results of %u bytes in a batch of %u", offset, batch_length);
+    if (frames != NULL) {
+        *frames = count;
+    }
+    return count > 0 ? app_sim_frame(count - 1)->status : 0;
+}
+
+static bool result_is(uint16_t index, uint16_t cmd, uint16_t status, uint16_t length, const uint8_t *data) {
+    if (index >= m_result_count) {
+        return false;
+    }
+    const result_t *result = &m_results[index];
+    return result->cmd == cmd && result->status == status && result->length == length
+           && (length == 0 || memcmp(result->data, data, length) == 0);
+}
+
+// A result of the batch is the response of the command sent alone
+static bool result_is_response(uint16_t index, const app_sim_frame_t *frame) {
+    return result_is(index, frame->cmd, frame->status, frame->length, frame->data);
+}
+
+static uint8_t active_slot(void) {
+    const app_sim_frame_t *frame = response(DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    return frame->length == 1 ? frame->data[0] : 0xFF;
+}
+
+static void setup(void) {
+    nfct_sim_init();
+    tag_emulation_init();
+    tag_emulation_factory_init();
+    for (uint8_t slot = 0; slot < sizeof(m_slot_types) / sizeof(m_slot_types[0]); slot++) {
+        tag_emulation_change_slot(slot, false);
+        if (m_slot_types[slot] == TAG_TYPE_UNDEFINED) {
+            tag_emulation_delete_data(slot, TAG_SENSE_HF);
+            tag_emulation_change_type(slot, TAG_TYPE_EM410X);
+            tag_emulation_slot_set_enable(slot, TAG_SENSE_LF, true);
+            continue;
+        }
+        tag_emulation_change_type(slot, m_slot_types[slot]);
+        tag_emulation_slot_set_enable(slot, TAG_SENSE_HF, true);
+        CHECK(tag_emulation_factory_data(slot, m_slot_types[slot]), "factory data of slot %d", slot);
+    }
+    tag_emulation_change_slot(0, false);
+}
+
+// Sub requests of all kinds, their results in order
+static void test_results(void) {
+    static app_sim_frame_t version, slot_info;
+    version = *response(DATA_CMD_GET_APP_VERSION, 0, NULL);
+    slot_info = *response(DATA_CMD_GET_SLOT_INFO, 0, NULL);
+
+    uint8_t batch[64];
+    uint8_t slot = 1, unknown_data[2] = {0x12, 0x34};
+    uint16_t length = batch_add(batch, 0, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    length = batch_add(batch, length, DATA_CMD_SET_ACTIVE_SLOT, 1, &slot);
+    length = batch_add(batch, length, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    length = batch_add(batch, length, DATA_CMD_GET_APP_VERSION, 0, NULL);
+    length = batch_add(batch, length, 999, sizeof(unknown_data), unknown_data);
+    length = batch_add(batch, length, DATA_CMD_SET_ACTIVE_SLOT, 0, NULL);
+    length = batch_add(batch, length, DATA_CMD_GET_SLOT_INFO, 0, NULL);
+    uint16_t frames;
+    CHECK(batch_run(batch, length, &frames) == STATUS_SUCCESS && frames == 1, "batch status, %u frames", frames);
+    CHECK(m_result_count == 7, "%u results, 7 expected", m_result_count);
+    uint8_t slot0 = 0;
+    CHECK(result_is(0, DATA_CMD_GET_ACTIVE_SLOT, STATUS_SUCCESS, 1, &slot0), "slot before the change");
+    CHECK(result_is(1, DATA_CMD_SET_ACTIVE_SLOT, STATUS_SUCCESS, 0, NULL), "slot change");
+    CHECK(result_is(2, DATA_CMD_GET_ACTIVE_SLOT, STATUS_SUCCESS, 1, &slot), "slot after the change");
+    CHECK(result_is_response(3, &version), "app version");
+    CHECK(result_is(4, 999, STATUS_INVALID_CMD, 0, NULL), "unknown cmd");
+    CHECK(result_is(5, DATA_CMD_SET_ACTIVE_SLOT, STATUS_PAR_ERR, 0, NULL), "slot change without a slot");
+    CHECK(result_is_response(6, &slot_info), "slot info");
+    CHECK(active_slot() == 1, "slot change of the batch lost");
+
+    // nothing to run
+    CHECK(batch_run(batch, 0, &frames) == STATUS_SUCCESS && frames == 1 && m_result_count == 0, "empty batch");
+    tag_emulation_change_slot(0, false);
+}
+
+// A sub request cut short, or longer than the batch: the results before it, the batch fails
+static void test_truncated(void) {
+    uint8_t batch[64];
+    uint8_t slot = 1;
+    uint16_t length = batch_add(batch, 0, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    // the header of a sub request, less its length
+    put16(&batch[length], DATA_CMD_SET_ACTIVE_SLOT);
+    CHECK(batch_run(batch, length + 3, NULL) == STATUS_PAR_ERR, "truncated header accepted");
+    CHECK(m_result_count == 1 && m_results[0].cmd == DATA_CMD_GET_ACTIVE_SLOT, "%u results before the truncated header",
+          m_result_count);
+
+    // a slot change claiming 2 bytes, only 1 in the batch
+    uint16_t oversized = batch_add(batch, length, DATA_CMD_SET_ACTIVE_SLOT, 1, &slot);
+    put16(&batch[length + 2], 2);
+    CHECK(batch_run(batch, oversized, NULL) == STATUS_PAR_ERR, "oversized sub request accepted");
+    CHECK(m_result_count == 1 && m_results[0].cmd == DATA_CMD_GET_ACTIVE_SLOT, "%u results before the oversized one",
+          m_result_count);
+    CHECK(active_slot() == 0, "oversized sub request run");
+
+    // as long as the batch, it runs
+    put16(&batch[length + 2], 1);
+    CHECK(batch_run(batch, oversized, NULL) == STATUS_SUCCESS && m_result_count == 2, "sub request up to the end");
+    CHECK(active_slot() == 1, "last sub request not run");
+    tag_emulation_change_slot(0, false);
+}
+
+// A batch in a batch is refused, the other sub requests run
+static void test_nested(void) {
+    uint8_t inner[8], batch[64];
+    uint16_t inner_length = batch_add(inner, 0, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    uint16_t length = batch_add(batch, 0, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    length = batch_add(batch, length, DATA_CMD_BATCH, inner_length, inner);
+    length = batch_add(batch, length, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    CHECK(batch_run(batch, length, NULL) == STATUS_SUCCESS, "batch with a nested one failed");
+    uint8_t slot = 0;
+    CHECK(m_result_count == 3, "%u results, 3 expected", m_result_count);
+    CHECK(result_is(0, DATA_CMD_GET_ACTIVE_SLOT, STATUS_SUCCESS, 1, &slot), "result before the nested batch");
+    CHECK(result_is(1, DATA_CMD_BATCH, STATUS_PAR_ERR, 0, NULL), "nested batch not refused");
+    CHECK(result_is(2, DATA_CMD_GET_ACTIVE_SLOT, STATUS_SUCCESS, 1, &slot), "result after the nested batch");
+
+    // the next batch runs
+    CHECK(batch_run(inner, inner_length, NULL) == STATUS_SUCCESS && result_is(0, DATA_CMD_GET_ACTIVE_SLOT, STATUS_SUCCESS, 1, &slot),
+          "batch after a nested one");
+}
+
+/**
+ * A detection log of more records than a frame holds: the pages of the log are STATUS_MORE_DATA results, and
+ * with their headers the results take two frames of the batch.
+ */
+static void test_more_data(void) {
+    const uint32_t page_count = NETDATA_MAX_DATA_LENGTH / LOG_SIZE;
+    const uint32_t count = page_count + 73;
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_STOP);
+    nfc_tag_mf1_log_clear();
+    for (uint32_t n = 0; n < count; n++) {
+        nfc_tag_mf1_auth_log_t log;
+        memset(&log, 0, sizeof(log));
+        log.block = n;
+        log.is_key_b = n & 1;
+        put32(log.uid, 0xDEADBEEF);
+        put32(log.nt, n * 2654435761u);
+        put32(log.nr, n);
+        CHECK(nfc_tag_mf1_log_append(&log), "record %u not stored", n);
+    }
+    static uint8_t expected[(NETDATA_MAX_DATA_LENGTH / LOG_SIZE + 73) * LOG_SIZE];
+    nfc_tag_mf1_log_copy(0, expected, count * LOG_SIZE);
+
+    uint8_t batch[16];
+    uint16_t length = batch_add(batch, 0, DATA_CMD_MF1_GET_DETECTION_LOG, 0, NULL);
+    length = batch_add(batch, length, DATA_CMD_GET_ACTIVE_SLOT, 0, NULL);
+    uint16_t frames;
+    CHECK(batch_run(batch, length, &frames) == STATUS_SUCCESS, "batch failed");
+    CHECK(frames == 2, "results in %u frames, 2 expected", frames);
+    uint8_t slot = 0;
+    CHECK(m_result_count == 3, "%u results, 3 expected", m_result_count);
+    CHECK(result_is(0, DATA_CMD_MF1_GET_DETECTION_LOG, STATUS_MORE_DATA, page_count * LOG_SIZE, expected),
+          "first page of the log");
+    CHECK(result_is(1, DATA_CMD_MF1_GET_DETECTION_LOG, STATUS_SUCCESS, (count - page_count) * LOG_SIZE,
+                    &expected[page_count * LOG_SIZE]), "last page of the log");
+    CHECK(result_is(2, DATA_CMD_GET_ACTIVE_SLOT, STATUS_SUCCESS, 1, &slot), "result after the log");
+    nfc_tag_mf1_log_clear();
+}
+
+static uint64_t m_rng = 0x0123456789ABCDEFULL;
+
+static uint32_t random32(void) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    return (uint32_t)m_rng;
+}
+
+static bool is_mf1(tag_specific_type_t type) {
+    return nfc_tag_mf1_get_nr_blocks_by_tag_type(type) > 0;
+}
+
+static uint8_t *memory_of(uint8_t slot) {
+    uint8_t *buffer = get_buffer_by_tag_type(m_slot_types[slot])->buffer;
+    if (is_mf1(m_slot_types[slot])) {
+        return buffer + offsetof(nfc_tag_mf1_information_t, memory);
+    }
+    return buffer + offsetof(nfc_tag_mf0_ntag_information_t, memory);
+}
+
+static uint16_t memory_size_of(uint8_t slot) {
+    tag_specific_type_t type = m_slot_types[slot];
+    if (is_mf1(type)) {
+        return nfc_tag_mf1_get_nr_blocks_by_tag_type(type) * NFC_TAG_MF1_DATA_SIZE;
+    }
+    return nfc_tag_mf0_ntag_get_nr_pages_by_tag_type(type) * NFC_TAG_MF0_NTAG_DATA_SIZE;
+}
+
+// The payload of a read or a crc32: offset and length of the range
+static uint8_t *range(uint16_t offset, uint16_t length) {
+    static uint8_t payload[4];
+    put16(payload, offset);
+    put16(&payload[2], length);
+    return payload;
+}
+
+static uint16_t bulk_write(uint16_t offset, const uint8_t *data, uint16_t length) {
+    static uint8_t payload[NETDATA_MAX_DATA_LENGTH];
+    put16(payload, offset);
+    memcpy(&payload[2], data, length);
+    return response(DATA_CMD_EMU_MEMORY_BULK_WRITE, 2 + length, payload)->status;
+}
+
+static bool read_is(uint16_t offset, uint16_t length, uint16_t status, const uint8_t *expected, uint16_t expected_length) {
+    const app_sim_frame_t *frame = response(DATA_CMD_EMU_MEMORY_BULK_READ, 4, range(offset, length));
+    return frame->status == status && frame->length == expected_length
+           && (expected_length == 0 || memcmp(frame->data, expected, expected_length) == 0);
+}
+
+static bool crc_is(uint16_t offset, uint16_t length, uint16_t status, const uint8_t *expected, uint16_t expected_length) {
+    const app_sim_frame_t *frame = response(DATA_CMD_EMU_MEMORY_GET_CRC32, 4, range(offset, length));
+    if (status != STATUS_SUCCESS) {
+        return frame->status == status && frame->length == 0;
+    }
+    uint32_t crc = crc32(0L, expected, expected_length);
+    uint8_t crc_bytes[4];
+    put32(crc_bytes, crc);
+    return frame->status == status && frame->length == 4 && memcmp(frame->data, crc_bytes, 4) == 0;
+}
+
+// The memory of a slot written in chunks of odd sizes, then read back and checked, whole and in part
+static void test_emu_memory(uint8_t slot) {
+    static uint8_t image[NETDATA_MAX_DATA_LENGTH];
+    CHECK(response(DATA_CMD_SET_ACTIVE_SLOT, 1, &slot)->status == STATUS_SUCCESS, "slot %u not active", slot);
+    uint16_t size = memory_size_of(slot);
+    for (uint16_t i = 0; i < size; i++) {
+        image[i] = random32();
+    }
+    for (uint16_t offset = 0; offset < size; offset += 100) {
+        uint16_t chunk = size - offset < 100 ? size - offset : 100;
+        CHECK(bulk_write(offset, &image[offset], chunk) == STATUS_SUCCESS, "slot %u: write at %u", slot, offset);
+    }
+    CHECK(memcmp(memory_of(slot), image, size) == 0, "slot %u: memory of the card not written", slot);
+
+    CHECK(read_is(0, 0, STATUS_SUCCESS, image, size), "slot %u: whole memory", slot);
+    CHECK(read_is(size / 3, 17, STATUS_SUCCESS, &image[size / 3], 17), "slot %u: range", slot);
+    CHECK(read_is(size - 16, 16, STATUS_SUCCESS, &image[size - 16], 16), "slot %u: range up to the end", slot);
+    CHECK(read_is(size - 16, 0, STATUS_SUCCESS, &image[size - 16], 16), "slot %u: offset to the end", slot);
+    CHECK(read_is(size, 0, STATUS_SUCCESS, NULL, 0), "slot %u: empty range at the end", slot);
+    CHECK(crc_is(0, 0, STATUS_SUCCESS, image, size), "slot %u: crc32 of the memory", slot);
+    CHECK(crc_is(size / 3, 17, STATUS_SUCCESS, &image[size / 3], 17), "slot %u: crc32 of a range", slot);
+
+    // past the memory
+    CHECK(read_is(size + 1, 0, STATUS_PAR_ERR, NULL, 0), "slot %u: offset past the end read", slot);
+    CHECK(read_is(size - 16, 17, STATUS_PAR_ERR, NULL, 0), "slot %u: range past the end read", slot);
+    CHECK(read_is(0, size + 1, STATUS_PAR_ERR, NULL, 0), "slot %u: range larger than the memory read", slot);
+    CHECK(crc_is(size + 1, 0, STATUS_PAR_ERR, NULL, 0), "slot %u: crc32 past the end", slot);
+    CHECK(crc_is(size - 16, 17, STATUS_PAR_ERR, NULL, 0), "slot %u: crc32 of a range past the end", slot);
+    CHECK(response(DATA_CMD_EMU_MEMORY_BULK_READ, 3, range(0, 0))->status == STATUS_PAR_ERR, "slot %u: short range", slot);
+    CHECK(response(DATA_CMD_EMU_MEMORY_GET_CRC32, 5, range(0, 0))->status == STATUS_PAR_ERR, "slot %u: long range", slot);
+    uint8_t ones[5] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    CHECK(bulk_write(size - 4, ones, 5) == STATUS_PAR_ERR, "slot %u: write past the end", slot);
+    CHECK(bulk_write(size + 1, ones, 0) == STATUS_PAR_ERR, "slot %u: write at an offset past the end", slot);
+    CHECK(response(DATA_CMD_EMU_MEMORY_BULK_WRITE, 1, ones)->status == STATUS_PAR_ERR, "slot %u: write without an offset", slot);
+    CHECK(memcmp(memory_of(slot), image, size) == 0, "slot %u: memory changed by a refused write", slot);
+    CHECK(bulk_write(size - 4, ones, 4) == STATUS_SUCCESS, "slot %u: write up to the end", slot);
+    memcpy(&image[size - 4], ones, 4);
+    CHECK(read_is(size - 4, 4, STATUS_SUCCESS, ones, 4) && crc_is(0, 0, STATUS_SUCCESS, image, size),
+          "slot %u: last bytes written", slot);
+}
+
+// A slot with an LF card only has no memory to read
+static void test_emu_memory_none(void) {
+    uint8_t slot = 3;
+    CHECK(response(DATA_CMD_SET_ACTIVE_SLOT, 1, &slot)->status == STATUS_SUCCESS, "slot %u not active", slot);
+    CHECK(read_is(0, 0, STATUS_INVALID_SLOT_TYPE, NULL, 0), "read of a slot without HF memory");
+    CHECK(crc_is(0, 0, STATUS_INVALID_SLOT_TYPE, NULL, 0), "crc32 of a slot without HF memory");
+    uint8_t data[4] = {0};
+    CHECK(bulk_write(0, data, sizeof(data)) == STATUS_INVALID_SLOT_TYPE, "write of a slot without HF memory");
+}
+
+// The whole of a 4K card and its crc32 in a batch: a frame of results, then the rest in the last one
+static void test_emu_memory_batch(void) {
+    uint8_t slot = 2;
+    CHECK(response(DATA_CMD_SET_ACTIVE_SLOT, 1, &slot)->status == STATUS_SUCCESS, "slot %u not active", slot);
+    uint16_t size = memory_size_of(slot);
+    uint8_t batch[16];
+    uint16_t length = batch_add(batch, 0, DATA_CMD_EMU_MEMORY_BULK_READ, 4, range(0, 0));
+    length = batch_add(batch, length, DATA_CMD_EMU_MEMORY_GET_CRC32, 4, range(0, 0));
+    uint16_t frames;
+    CHECK(batch_run(batch, length, &frames) == STATUS_SUCCESS, "batch failed");
+    CHECK(frames == 2, "results in %u frames, 2 expected", frames);
+    CHECK(result_is(0, DATA_CMD_EMU_MEMORY_BULK_READ, STATUS_SUCCESS, size, memory_of(slot)), "4K memory in a batch");
+    uint8_t crc_bytes[4];
+    put32(crc_bytes, crc32(0L, memory_of(slot), size));
+    CHECK(result_is(1, DATA_CMD_EMU_MEMORY_GET_CRC32, STATUS_SUCCESS, 4, crc_bytes), "crc32 of the 4K memory in a batch");
+}
+
+int main(void) {
+    setup();
+    test_results();
+    test_truncated();
+    test_nested();
+    test_more_data();
+    test_emu_memory(0);
+    test_emu_memory(1);
+    test_emu_memory(2);
+    test_emu_memory_none();
+    test_emu_memory_batch();
+
+    return test_result("test_app_cmd");
+}
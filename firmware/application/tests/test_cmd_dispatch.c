@@ -0,0 +1,114 @@
+/**
+ * Host test of the command table of app_cmd.c, built with stub handlers.
+ * Checks that every listed command routes to its own processor and
+ * compares the lookup cost with the linear search it replaced.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "data_cmd.h"
+#include "app_cmd.h"
+#include "test_util.h"
+
+#define LOOKUP_ROUNDS 20000
+
+static uint16_t m_processor_cmd;
+
+#define STUB_BEFORE_AFTER(name)                                                                     \
+    __attribute__((unused))                                                                          \
+    static data_frame_tx_t *name(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {    \
+        return NULL;                                                                                 \
+    }
+#define STUB_PROCESSOR(name)                                                                        \
+    static data_frame_tx_t *name(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {    \
+        m_processor_cmd = cmd;                                                                       \
+        return NULL;                                                                                 \
+    }
+
+// shared by many commands, defined once, not used by the lite table
+STUB_BEFORE_AFTER(before_reader_run)
+STUB_BEFORE_AFTER(before_hf_reader_run)
+STUB_BEFORE_AFTER(after_hf_reader_run)
+
+// a stub for every processor of the table
+#pragma push_macro("CMD_MAP")
+#undef CMD_MAP
+#define CMD_MAP(cmd, before, processor, after) STUB_PROCESSOR(processor)
+#include "app_cmd_map.h"
+#pragma pop_macro("CMD_MAP")
+
+// same as app_cmd.c
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Woverride-init"
+static const cmd_data_map_t m_data_cmd_map[CMD_MAP_SIZE] = {
+#include "app_cmd_map.h"
+};
+#pragma GCC diagnostic pop
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+int main(void) {
+    // same list as cmd_processor_get_device_capabilities()
+    uint16_t commands[CMD_MAP_SIZE];
+    cmd_data_map_t linear_map[CMD_MAP_SIZE];
+    size_t count = 0;
+    for (size_t i = 0; i < CMD_MAP_SIZE; i++) {
+        if (m_data_cmd_map[i].cmd != 0) {
+            linear_map[count] = m_data_cmd_map[i];
+            commands[count++] = m_data_cmd_map[i].cmd;
+        }
+    }
+    CHECK(count > 0, "empty table");
+
+    for (size_t i = 0; i < count; i++) {
+        const cmd_data_map_t *entry = cmd_map_find(m_data_cmd_map, commands[i]);
+        CHECK(entry != NULL && entry->cmd == commands[i], "cmd %d not found", commands[i]);
+        if (entry == NULL) {
+            continue;
+        }
+        CHECK(entry->cmd_processor != NULL, "cmd %d without processor", commands[i]);
+        m_processor_cmd = 0;
+        entry->cmd_processor(commands[i], 0, 0, NULL);
+        CHECK(m_processor_cmd == commands[i], "cmd %d routed to the processor of cmd %d", commands[i], m_processor_cmd);
+        for (size_t j = 0; j < i; j++) {
+            CHECK(linear_map[j].cmd_processor != entry->cmd_processor, "cmd %d and %d share a processor", commands[j], commands[i]);
+        }
+    }
+
+    // commands around and between the ranges
+    const uint16_t unknown[] = {0, 1, 999, 1999, 2099, 2999, 3999, 4999, 5999, 6000, 0xFFFF};
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        CHECK(cmd_map_find(m_data_cmd_map, unknown[i]) == NULL, "unknown cmd %d found", unknown[i]);
+    }
+
+    struct timespec start, end;
+    volatile uintptr_t sink = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (size_t i = 0; i < count; i++) {
+            sink += (uintptr_t)cmd_map_find(m_data_cmd_map, commands[i]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double indexed_ns = elapsed_ns(&start, &end) / ((double)LOOKUP_ROUNDS * count);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = 0; j < count; j++) {
+                if (linear_map[j].cmd == commands[i]) {
+                    sink += (uintptr_t)&linear_map[j];
+                    break;
+                }
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double linear_ns = elapsed_ns(&start, &end) / ((double)LOOKUP_ROUNDS * count);
+
+    printf("%zu commands, lookup: indexed %.1f ns, linear %.1f ns\n", count, indexed_ns, linear_ns);
+    return test_result("test_cmd_dispatch");
+}
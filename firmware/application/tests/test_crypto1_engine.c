@@ -0,0 +1,227 @@
+/**
+ * Host test of the Crypto1 of the tag emulation (crypto1_helper.c) against crypto1.c and crapto1.c of the
+ * software tools: the keystream of the byte and word clocks, the key and nonce setup, the nested setup
+ * frame and the state after each of them must be the ones of the reference, the nested frame must give the
+ * key back to the nested attack the software runs. The engine and the reference are then timed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "crapto1.h"
+#include "parity.h"
+#include "crypto1_helper.h"
+#include "test_util.h"
+
+static uint64_t m_rng = 0x0123456789ABCDEFULL;
+
+static uint32_t random32(void) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    return (uint32_t)m_rng;
+}
+
+static void random_bytes(uint8_t *bytes, int length) {
+    for (int i = 0; i < length; i++) {
+        bytes[i] = random32();
+    }
+}
+
+static uint64_t key_to_num(const uint8_t *key) {
+    uint64_t num = 0;
+    for (int i = 0; i < 6; i++) {
+        num = num << 8 | key[i];
+    }
+    return num;
+}
+
+static uint32_t bytes_to_u32(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool same_state(const struct Crypto1State *a, const struct Crypto1State *b) {
+    return a->odd == b->odd && a->even == b->even;
+}
+
+// the nested authentication nonce the way the emulation framed it before: crypto1_init(), then each byte of
+// the nonce encrypted with the keystream of uid ^ nt and followed by its encrypted parity
+static uint16_t reference_setup_nested(struct Crypto1State *s, const uint8_t *key, const uint8_t *uid, const uint8_t *nt,
+                                       uint8_t *frame) {
+    crypto1_init(s, key_to_num(key));
+    memset(frame, 0, 5);
+    for (int i = 0; i < 4; i++) {
+        uint8_t enc = crypto1_byte(s, uid[i] ^ nt[i], 0) ^ nt[i];
+        uint8_t par = filter(s->odd) ^ oddparity8(nt[i]);
+        for (int bit = 0; bit < 9; bit++) {
+            uint8_t value = bit < 8 ? (enc >> bit) & 1 : par;
+            frame[(i * 9 + bit) / 8] |= value << ((i * 9 + bit) % 8);
+        }
+    }
+    return 36;
+}
+
+static void test_clocks(void) {
+    uint32_t mismatches = 0;
+    for (int round = 0; round < 200000; round++) {
+        // any state, the bits above the 24th included, they are shifted the same way by both
+        struct Crypto1State reference = { random32(), random32() };
+        struct Crypto1State engine = reference;
+        uint32_t in = random32();
+        int is_encrypted = round & 1;
+        switch (round % 3) {
+            case 0:
+                if (crypto1_byte(&reference, in, is_encrypted) != mf_crypto1_byte(&engine, in, is_encrypted)) {
+                    mismatches++;
+                }
+                break;
+            case 1:
+                if (crypto1_word(&reference, in, is_encrypted) != mf_crypto1_word(&engine, in, is_encrypted)) {
+                    mismatches++;
+                }
+                break;
+            default: {
+                // the 4 bits of an encrypted ACK or NAK
+                uint8_t expected = 0;
+                for (int bit = 0; bit < 4; bit++) {
+                    expected |= (crypto1_bit(&reference, 0, 0) ^ BIT(in, bit)) << bit;
+                }
+                if (expected != mf_crypto1_encrypt4bit(&engine, in)) {
+                    mismatches++;
+                }
+                break;
+            }
+        }
+        if (!same_state(&reference, &engine)) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0, "%u byte, word or nibble clocks differ from crypto1_bit()", mismatches);
+}
+
+static void test_setup(void) {
+    uint32_t mismatches = 0;
+    for (int round = 0; round < 100000; round++) {
+        uint8_t key[6], uid[4], nt[4];
+        random_bytes(key, 6);
+        random_bytes(uid, 4);
+        random_bytes(nt, 4);
+
+        struct Crypto1State reference;
+        struct Crypto1State engine;
+        crypto1_init(&reference, key_to_num(key));
+        crypto1_word(&reference, bytes_to_u32(uid) ^ bytes_to_u32(nt), 0);
+        mf_crypto1_setup(&engine, key, uid, nt);
+        if (!same_state(&reference, &engine)) {
+            mismatches++;
+        }
+
+        // the answer of the reader, {nr} shifted in encrypted, then ar decrypted
+        uint32_t nr = random32();
+        if (crypto1_word(&reference, nr, 1) != mf_crypto1_word(&engine, nr, 1) ||
+                crypto1_word(&reference, 0, 0) != mf_crypto1_word(&engine, 0, 0) || !same_state(&reference, &engine)) {
+            mismatches++;
+        }
+
+        uint8_t expected[5];
+        uint8_t frame[5] = { 0 };
+        reference_setup_nested(&reference, key, uid, nt, expected);
+        if (mf_crypto1_setup_nested(&engine, key, uid, nt, frame) != 36 || memcmp(frame, expected, 4) != 0 ||
+                (frame[4] & 0x0f) != (expected[4] & 0x0f) || !same_state(&reference, &engine)) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0, "%u setups differ from crypto1_init() and crypto1_word()", mismatches);
+}
+
+// what a reader learns from a nested authentication is enough to get the key back
+static void test_nested_recovery(void) {
+    static const uint8_t key[6] = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5 };
+    static const uint8_t uid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+    static const uint8_t nt[4] = { 0x01, 0x20, 0x01, 0x45 };
+    struct Crypto1State engine;
+    uint8_t frame[5] = { 0 };
+    mf_crypto1_setup_nested(&engine, key, uid, nt, frame);
+
+    uint32_t nt_enc = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8_t enc = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            enc |= ((frame[(i * 9 + bit) / 8] >> ((i * 9 + bit) % 8)) & 1) << bit;
+        }
+        nt_enc = nt_enc << 8 | enc;
+    }
+    uint32_t ks = nt_enc ^ bytes_to_u32(nt);
+    uint32_t uid_nt = bytes_to_u32(uid) ^ bytes_to_u32(nt);
+
+    bool found = false;
+    struct Crypto1State *states = lfsr_recovery32(ks, uid_nt);
+    for (struct Crypto1State *s = states; s != NULL && (s->odd || s->even); s++) {
+        uint64_t candidate;
+        lfsr_rollback_word(s, uid_nt, 0);
+        crypto1_get_lfsr(s, &candidate);
+        found |= candidate == key_to_num(key);
+    }
+    free(states);
+    CHECK(found, "the key is not among the states recovered from the nested nonce");
+}
+
+#define BENCH(label, rounds, reference, engine) do {                                    \
+    uint64_t ref_ns = now_ns(), ref_cycles = cycles();                                  \
+    for (int i = 0; i < (rounds); i++) { reference; }                                   \
+    ref_cycles = cycles() - ref_cycles;                                                 \
+    ref_ns = now_ns() - ref_ns;                                                         \
+    uint64_t eng_ns = now_ns(), eng_cycles = cycles();                                  \
+    for (int i = 0; i < (rounds); i++) { engine; }                                      \
+    eng_cycles = cycles() - eng_cycles;                                                 \
+    eng_ns = now_ns() - eng_ns;                                                         \
+    printf("%-14s crapto1 %7.1f ns %7.1f cycles, engine %7.1f ns %7.1f cycles\n", label,  \
+           (double)ref_ns / (rounds), (double)ref_cycles / (rounds),                    \
+           (double)eng_ns / (rounds), (double)eng_cycles / (rounds));                   \
+} while (0)
+
+static void benchmark(void) {
+    const int rounds = 1000000;
+    static const uint8_t key[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    static const uint8_t uid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+    static const uint8_t nt[4] = { 0x01, 0x20, 0x01, 0x45 };
+    struct Crypto1State reference = { 0x123456, 0x654321 };
+    struct Crypto1State engine = reference;
+    uint8_t frame[5];
+    volatile uint32_t sink = 0;
+
+    BENCH("byte", rounds, sink += crypto1_byte(&reference, i, 0), sink += mf_crypto1_byte(&engine, i, 0));
+    BENCH("word", rounds, sink += crypto1_word(&reference, i, 1), sink += mf_crypto1_word(&engine, i, 1));
+    BENCH("setup", rounds,
+          crypto1_init(&reference, key_to_num(key)); sink += crypto1_word(&reference, bytes_to_u32(uid) ^ bytes_to_u32(nt), 0),
+          mf_crypto1_setup(&engine, key, uid, nt); sink += engine.odd);
+    BENCH("setup nested", rounds, sink += reference_setup_nested(&reference, key, uid, nt, frame),
+          sink += mf_crypto1_setup_nested(&engine, key, uid, nt, frame));
+}
+
+int main(void) {
+    test_clocks();
+    test_setup();
+    test_nested_recovery();
+    benchmark();
+
+    return test_result("test_crypto1_engine");
+}
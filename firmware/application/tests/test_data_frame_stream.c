@@ -0,0 +1,193 @@
+/**
+ * Host test of the streamed responses of utils/dataframe.c over a loopback transport:
+ * the frames the firmware sends are fed back to its own frame parser, as a client would receive them,
+ * then the stream is reassembled and checked against its crc32.
+ * Runs a transport that copies the frames (BLE NUS) and one that sends from the frame buffer
+ * and releases it later (USB CDC, with back-pressure), and prints the frames needed for a detection log.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dataframe.h"
+#include "app_status.h"
+#include "crc32.h"
+#include "nordic_common.h"
+#include "test_util.h"
+
+#define CMD_TEST            4006    // any cmd, the stream does not care
+#define DETECTION_LOG_SIZE  (1000 * 18)  // MF1_AUTH_LOG_MAX_SIZE records
+
+// client side: reassembled stream
+static struct {
+    uint32_t frames;
+    uint32_t bytes;             // frame bytes on the link
+    bool begun;
+    uint8_t id;
+    uint32_t length;
+    uint32_t crc;
+    uint16_t status;
+    uint8_t data[DETECTION_LOG_SIZE + 8192];
+    uint32_t received;
+    bool complete;
+    bool error;
+} m_client;
+
+static void client_reset(void) {
+    memset(&m_client, 0, sizeof(m_client));
+}
+
+static void client_frame(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    m_client.frames++;
+    CHECK(cmd == CMD_TEST, "frame of cmd %u", cmd);
+    CHECK(!m_client.complete, "frame after the end of the stream");
+    if (status == STATUS_STREAM_BEGIN) {
+        data_frame_stream_begin_t *begin = (data_frame_stream_begin_t *)data;
+        CHECK(length == sizeof(*begin) && !m_client.begun, "bad begin frame");
+        m_client.begun = true;
+        m_client.id = begin->id;
+        m_client.length = U32NTOHL(begin->length);
+        m_client.crc = U32NTOHL(begin->crc32);
+        m_client.status = U16NTOHS(begin->status);
+    } else if (status == STATUS_STREAM_DATA) {
+        data_frame_stream_data_t *chunk = (data_frame_stream_data_t *)data;
+        uint16_t chunk_length = length - sizeof(*chunk);
+        if (!m_client.begun || chunk->id != m_client.id || U32NTOHL(chunk->offset) != m_client.received
+                || m_client.received + chunk_length > m_client.length) {
+            m_client.error = true;
+            return;
+        }
+        memcpy(&m_client.data[m_client.received], chunk->data, chunk_length);
+        m_client.received += chunk_length;
+    } else {
+        CHECK(0, "unexpected status 0x%02x", status);
+        return;
+    }
+    if (m_client.begun && m_client.received == m_client.length) {
+        m_client.complete = true;
+        m_client.error |= crc32_compute(m_client.data, m_client.length, NULL) != m_client.crc;
+    }
+}
+
+// loopback: the frame goes through the firmware parser, in chunks like the transports deliver them
+static void loopback(data_frame_tx_t *tx) {
+    m_client.bytes += tx->length;
+    for (uint16_t offset = 0; offset < tx->length; offset += 244) {
+        data_frame_receive(&tx->buffer[offset], MIN(244, tx->length - offset));
+    }
+    data_frame_process();
+}
+
+// BLE NUS like: copies the frame, gives it back at once
+static void send_copy(data_frame_tx_t *tx) {
+    loopback(tx);
+    data_frame_tx_discard(tx);
+}
+
+// USB CDC like: the frame is queued, the transfer ends when the next frame is needed
+static uint32_t m_waits;
+
+static void usb_start(void) {
+    // nothing to do, the transfer "runs" until usb_wait()
+}
+
+static bool usb_wait(void) {
+    data_frame_tx_t *tx = data_frame_tx_next();
+    if (tx == NULL) {
+        return false;
+    }
+    m_waits++;
+    loopback(tx);
+    data_frame_tx_done();
+    return true;
+}
+
+static void send_queued(data_frame_tx_t *tx) {
+    data_frame_tx_commit(tx);
+    usb_start();
+}
+
+static void usb_flush(void) {
+    while (usb_wait());
+}
+
+static void fill_pattern(uint8_t *data, uint32_t length, uint32_t seed) {
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(i * 31 + seed + (i >> 9));
+    }
+}
+
+static void check_stream(uint32_t length, bool queued) {
+    static uint8_t data[DETECTION_LOG_SIZE + 8192];
+    fill_pattern(data, length, length);
+    client_reset();
+    m_waits = 0;
+    on_data_frame_tx_wait(queued ? usb_wait : NULL);
+
+    data_frame_tx_t *last = data_frame_stream(CMD_TEST, STATUS_HF_TAG_OK, length, data, queued ? send_queued : send_copy);
+    CHECK(last != NULL, "no last frame");
+    if (last == NULL) {
+        return;
+    }
+    // the dispatcher sends the returned frame like any response
+    if (queued) {
+        send_queued(last);
+        usb_flush();
+    } else {
+        send_copy(last);
+    }
+    uint32_t expected_frames = 1 + (length + DATA_FRAME_STREAM_CHUNK_MAX - 1) / DATA_FRAME_STREAM_CHUNK_MAX;
+    CHECK(m_client.complete && !m_client.error, "length %u: stream not reassembled", length);
+    CHECK(m_client.frames == expected_frames, "length %u: %u frames, expected %u", length, m_client.frames, expected_frames);
+    CHECK(m_client.status == STATUS_HF_TAG_OK, "length %u: status 0x%02x", length, m_client.status);
+    CHECK(memcmp(m_client.data, data, length) == 0, "length %u: data differs", length);
+    CHECK(!queued || m_waits >= m_client.frames - 1, "length %u: frames sent without back-pressure", length);
+}
+
+static void test_stream_ids(void) {
+    uint8_t data[10] = {0};
+    on_data_frame_tx_wait(NULL);
+    client_reset();
+    send_copy(data_frame_stream(CMD_TEST, STATUS_SUCCESS, sizeof(data), data, send_copy));
+    uint8_t first = m_client.id;
+    client_reset();
+    send_copy(data_frame_stream(CMD_TEST, STATUS_SUCCESS, sizeof(data), data, send_copy));
+    CHECK(m_client.id == (uint8_t)(first + 1), "stream id not incremented");
+}
+
+static void test_lost_frame_detected(void) {
+    // the client drops one data frame: the next offset does not match
+    static uint8_t data[3 * 4096];
+    fill_pattern(data, sizeof(data), 1);
+    on_data_frame_tx_wait(NULL);
+    client_reset();
+    data_frame_tx_t *tx = data_frame_stream(CMD_TEST, STATUS_SUCCESS, sizeof(data), data, send_copy);
+    CHECK(m_client.begun && !m_client.error, "stream broken before the loss");
+    // forge a gap: pretend the client missed some bytes
+    m_client.received -= 1;
+    send_copy(tx);
+    CHECK(m_client.error, "lost data not detected");
+}
+
+int main(void) {
+    on_data_frame_complete(client_frame);
+    const uint32_t lengths[] = {
+        0, 1, DATA_FRAME_STREAM_CHUNK_MAX, DATA_FRAME_STREAM_CHUNK_MAX + 1, 2 * DATA_FRAME_STREAM_CHUNK_MAX,
+        NETDATA_MAX_DATA_LENGTH * 4, DETECTION_LOG_SIZE,
+    };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        check_stream(lengths[i], false);
+        check_stream(lengths[i], true);
+    }
+    test_stream_ids();
+    test_lost_frame_detected();
+
+    // detection log: one request instead of paging 227 records (4086 bytes) per request
+    check_stream(DETECTION_LOG_SIZE, false);
+    uint32_t records_per_page = NETDATA_MAX_DATA_LENGTH / 18;
+    uint32_t pages = (1000 + records_per_page - 1) / records_per_page;
+    printf("Detection log of %d bytes: 1 request, %u frames, %u bytes on the link (paging: %u requests)\n",
+           DETECTION_LOG_SIZE, m_client.frames, m_client.bytes, pages);
+
+    return test_result("test_data_frame_stream");
+}
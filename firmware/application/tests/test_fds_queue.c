@@ -0,0 +1,242 @@
+/**
+ * Host test of the flash write queue of utils/fds_util.c on the simulated flash of sim/fds_sim.c. Writes of the same
+ * record queued one after the other must leave one write for the flash, the last; reads, fds_is_exists() and the
+ * deletes must see the queued writes, also while one is in progress, its event deferred. A queue without room must
+ * write its oldest records first, and a record updated over and over must have its garbage collected while idle,
+ * by the free space watermarks, before a write finds the flash full. A write dropped on a full flash must be reported
+ * to the callback. The flash time a caller waits for is compared with fds_write_sync().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fds_util.h"
+#include "sim/fds_sim.h"
+#include "test_util.h"
+
+#define FILE_ID     0x1000
+#define RECORD_SIZE 256
+
+static uint8_t m_data[FDS_QUEUE_POOL_SIZE] __attribute__((aligned(4)));
+static uint8_t m_read[FDS_QUEUE_POOL_SIZE] __attribute__((aligned(4)));
+
+static uint64_t m_rng = 0x0123456789ABCDEFULL;
+
+static uint32_t random32(void) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    return (uint32_t)m_rng;
+}
+
+static void data_fill(uint8_t *data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        data[i] = random32();
+    }
+}
+
+static bool record_is(uint16_t key, const uint8_t *expected, uint16_t length) {
+    uint16_t read_length = sizeof(m_read);
+    return fds_read_sync(FILE_ID, key, &read_length, m_read) && read_length == length
+           && memcmp(m_read, expected, length) == 0;
+}
+
+static fds_queue_stats_t queue_stats(void) {
+    fds_queue_stats_t stats;
+    fds_queue_get_stats(&stats);
+    return stats;
+}
+
+static void idle(void) {
+    while (fds_queue_process());
+}
+
+static void setup(uint16_t pages) {
+    fds_sim_format(pages);
+    fds_util_init();
+}
+
+// The same record written ten times, and the record of each of them
+static void test_coalesce(void) {
+    setup(FDS_SIM_PAGES_MAX);
+    fds_sim_stats_t *flash = fds_sim_stats();
+    uint32_t records = flash->records_written;
+    for (int i = 0; i < 10; i++) {
+        data_fill(m_data, RECORD_SIZE);
+        CHECK(fds_write_async(FILE_ID, 1, RECORD_SIZE, m_data), "write %d queued", i);
+        CHECK(fds_write_async(FILE_ID, 2 + i, RECORD_SIZE, m_data), "record %d queued", 2 + i);
+        CHECK(record_is(1, m_data, RECORD_SIZE), "queued record read, write %d", i);
+    }
+    CHECK(flash->records_written == records, "flash written before the device is idle");
+    fds_queue_stats_t stats = queue_stats();
+    CHECK(stats.depth == 11, "%u records queued, 11 expected", stats.depth);
+    CHECK(stats.coalesced == 9, "%u writes coalesced, 9 expected", stats.coalesced);
+    CHECK(fds_is_exists(FILE_ID, 11) && !fds_is_exists(FILE_ID, 12), "queued records exist");
+
+    idle();
+    CHECK(flash->records_written - records == 11, "%u records written, 11 expected", flash->records_written - records);
+    CHECK(queue_stats().depth == 0, "records left in the queue");
+    CHECK(record_is(1, m_data, RECORD_SIZE), "last write of the record in flash");
+
+    // a queued write deleted, and a record in flash with a write of it queued
+    CHECK(fds_write_async(FILE_ID, 20, RECORD_SIZE, m_data), "record 20 queued");
+    CHECK(fds_delete_sync(FILE_ID, 20) == 1, "queued record deleted");
+    CHECK(fds_write_async(FILE_ID, 1, RECORD_SIZE, m_data), "record 1 queued");
+    CHECK(fds_delete_sync(FILE_ID, 1) == 1, "record deleted");
+    idle();
+    CHECK(!fds_is_exists(FILE_ID, 20) && !fds_is_exists(FILE_ID, 1), "deleted records written");
+
+    // a sync write takes the place of the queued one
+    CHECK(fds_write_async(FILE_ID, 2, RECORD_SIZE, m_data), "record 2 queued");
+    uint8_t sync_data[16] __attribute__((aligned(4))) = "sync write";
+    CHECK(fds_write_sync(FILE_ID, 2, sizeof(sync_data), sync_data), "record 2 written");
+    idle();
+    CHECK(record_is(2, sync_data, sizeof(sync_data)), "sync write overwritten by the queued one");
+}
+
+// The events of the flash come later, as on the device: the write in progress stays readable and is not replaced
+static void test_in_progress(void) {
+    setup(FDS_SIM_PAGES_MAX);
+    static uint8_t first[RECORD_SIZE] __attribute__((aligned(4)));
+    data_fill(first, sizeof(first));
+    data_fill(m_data, RECORD_SIZE);
+    fds_sim_defer_events(true);
+    CHECK(fds_write_async(FILE_ID, 1, sizeof(first), first), "first write queued");
+    CHECK(fds_queue_process(), "write not started");
+    CHECK(fds_queue_process(), "write over before its event");
+    CHECK(record_is(1, first, sizeof(first)), "record in progress read");
+    CHECK(fds_write_async(FILE_ID, 1, RECORD_SIZE, m_data), "second write queued");
+    CHECK(queue_stats().depth == 2 && queue_stats().coalesced == 0, "write in progress replaced");
+    CHECK(record_is(1, m_data, RECORD_SIZE), "second write read");
+    CHECK(fds_sim_raise_events() == 1, "event of the first write");
+    CHECK(fds_queue_process(), "second write not started");
+    CHECK(fds_sim_raise_events() == 1, "event of the second write");
+    CHECK(!fds_queue_process(), "queue left busy");
+    fds_sim_defer_events(false);
+    CHECK(queue_stats().depth == 0, "records left in the queue");
+    CHECK(record_is(1, m_data, RECORD_SIZE), "last write of the record in flash");
+}
+
+// More than the queue holds: the oldest records are written, the last ones stay queued
+static void test_full(void) {
+    static uint8_t data[FDS_QUEUE_POOL_SIZE + 4 * RECORD_SIZE] __attribute__((aligned(4)));
+    setup(FDS_SIM_PAGES_MAX);
+    uint16_t count = sizeof(data) / RECORD_SIZE;
+    data_fill(data, sizeof(data));
+    for (uint16_t i = 0; i < count; i++) {
+        CHECK(fds_write_async(FILE_ID, 1 + i, RECORD_SIZE, &data[i * RECORD_SIZE]), "record %d queued", 1 + i);
+    }
+    fds_queue_stats_t stats = queue_stats();
+    CHECK(stats.stalls >= 4, "%u stalls for 4 records too many", stats.stalls);
+    CHECK(stats.depth_max <= FDS_QUEUE_ENTRY_MAX && stats.bytes <= FDS_QUEUE_POOL_SIZE, "queue overfilled");
+    fds_queue_flush();
+    for (uint16_t i = 0; i < count; i++) {
+        CHECK(record_is(1 + i, &data[i * RECORD_SIZE], RECORD_SIZE), "record %d", 1 + i);
+    }
+}
+
+/**
+ * A few records updated over and over on a small flash, the device idle between the updates: the garbage is
+ * collected by the watermarks. Without the idle time, the writes find the flash full.
+ */
+static void test_gc(bool with_idle) {
+    setup(4);
+    fds_sim_stats_t *flash = fds_sim_stats();
+    for (int i = 0; i < 400; i++) {
+        uint16_t key = 1 + i % 8;
+        data_fill(m_data, RECORD_SIZE);
+        CHECK(fds_write_async(FILE_ID, key, RECORD_SIZE, m_data), "update %d queued", i);
+        if (with_idle) {
+            idle();
+        } else {
+            fds_queue_flush();
+        }
+        CHECK(record_is(key, m_data, RECORD_SIZE), "record of update %d", i);
+    }
+    fds_queue_stats_t stats = queue_stats();
+    CHECK(stats.failures == 0, "%u writes failed", stats.failures);
+    if (with_idle) {
+        CHECK(stats.gc_idle > 0, "no idle GC");
+        CHECK(stats.gc_full == 0, "%u GC run by a full flash", stats.gc_full);
+    } else {
+        CHECK(stats.gc_full > 0, "no GC run by a full flash");
+    }
+    fds_stat_t stat;
+    fds_stat(&stat);
+    printf("%s: %u GC idle, %u on a full flash, %u page erases, %u/%u words used, %u freeable\n",
+           with_idle ? "updates, idle" : "updates", stats.gc_idle, stats.gc_full, flash->page_erases,
+           stat.words_used, stat.pages_available * FDS_VIRTUAL_PAGE_SIZE, stat.freeable_words);
+}
+
+static uint16_t m_failed_keys[64];
+static uint16_t m_failed_count;
+
+static void on_failed(uint16_t id, uint16_t key) {
+    CHECK(id == FILE_ID, "dropped write of file 0x%04x", id);
+    if (m_failed_count < 64) {
+        m_failed_keys[m_failed_count] = key;
+    }
+    m_failed_count++;
+}
+
+// More records than a small flash holds: the writes dropped are reported, each one once, and only those
+static void test_failed(void) {
+    setup(3);
+    m_failed_count = 0;
+    on_fds_write_failed(on_failed);
+    uint16_t count = 2 * FDS_SIM_PAGE_WORDS * 4 / RECORD_SIZE;
+    for (uint16_t i = 0; i < count; i++) {
+        data_fill(m_data, RECORD_SIZE);
+        CHECK(fds_write_async(FILE_ID, 1 + i, RECORD_SIZE, m_data), "record %d queued", 1 + i);
+    }
+    fds_queue_flush();
+    fds_queue_stats_t stats = queue_stats();
+    CHECK(stats.failures > 0, "records of more than the flash holds all written");
+    CHECK(m_failed_count == stats.failures, "%u writes dropped, %u reported", stats.failures, m_failed_count);
+    for (uint16_t i = 0; i < m_failed_count && i < 64; i++) {
+        CHECK(!fds_is_exists(FILE_ID, m_failed_keys[i]), "record %d reported dropped is in flash", m_failed_keys[i]);
+    }
+    uint16_t written = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        written += fds_is_exists(FILE_ID, 1 + i);
+    }
+    CHECK(written + m_failed_count == count, "%u records written, %u reported dropped, of %u", written, m_failed_count,
+          count);
+    on_fds_write_failed(NULL);
+}
+
+// The flash time a settings or slot save waits for
+static void test_latency(void) {
+    setup(FDS_SIM_PAGES_MAX);
+    fds_sim_stats_t *flash = fds_sim_stats();
+    data_fill(m_data, sizeof(m_data));
+    uint16_t count = sizeof(m_data) / RECORD_SIZE;
+
+    uint64_t flash_us = flash->flash_us;
+    for (uint16_t i = 0; i < count; i++) {
+        fds_write_sync(FILE_ID, 1 + i, RECORD_SIZE, &m_data[i * RECORD_SIZE]);
+    }
+    uint64_t sync_us = flash->flash_us - flash_us;
+
+    flash_us = flash->flash_us;
+    for (uint16_t i = 0; i < count; i++) {
+        fds_write_async(FILE_ID, 1 + i, RECORD_SIZE, &m_data[i * RECORD_SIZE]);
+    }
+    uint64_t async_us = flash->flash_us - flash_us;
+    idle();
+    CHECK(async_us == 0, "queued writes of %u records waited %llu us for the flash", count, (unsigned long long)async_us);
+    printf("%u records of %d bytes: %llu us of flash in fds_write_sync(), %llu us in fds_write_async()\n", count,
+           RECORD_SIZE, (unsigned long long)sync_us, (unsigned long long)async_us);
+}
+
+int main(void) {
+    test_coalesce();
+    test_in_progress();
+    test_full();
+    test_gc(true);
+    test_gc(false);
+    test_latency();
+    test_failed();
+
+    return test_result("test_fds_queue");
+}
@@ -0,0 +1,292 @@
+/**
+ * Host test of the response compression: utils/lz4_block.c and data_frame_compress() of utils/dataframe.c.
+ * Every block is decoded again with a minimal LZ4 block decoder, the same as the one of the client, and with
+ * the decoder of the firmware, and a compressed frame goes through the frame parser of the firmware as the
+ * client would receive it.
+ * Prints the ratio and the encode time of each frame for a few typical payloads,
+ * and for the dump files given as arguments: test_frame_compress dump.bin ...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dataframe.h"
+#include "lz4_block.h"
+#include "app_status.h"
+#include "nordic_common.h"
+#include "test_util.h"
+
+#define CMD_TEST            4008    // any cmd
+#define ENCODE_ROUNDS       200
+#define CORPUS_MAX          (64 * 1024)
+
+static uint16_t m_table[LZ4_BLOCK_HASH_SIZE];
+static uint32_t m_random = 0x12345678;
+
+static uint8_t next_random(void) {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+static double elapsed_us(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/**
+ * LZ4 block decoder of the client, -1 if the block is malformed or does not fit in dst_max.
+ */
+static int client_decompress(const uint8_t *src, int length, uint8_t *dst, int dst_max) {
+    const uint8_t *ip = src;
+    const uint8_t *src_end = src + length;
+    int out = 0;
+    while (ip < src_end) {
+        uint8_t token = *ip++;
+        int literal_length = token >> 4;
+        if (literal_length == 15) {
+            uint8_t more;
+            do {
+                if (ip >= src_end) {
+                    return -1;
+                }
+                more = *ip++;
+                literal_length += more;
+            } while (more == 255);
+        }
+        if (ip + literal_length > src_end || out + literal_length > dst_max) {
+            return -1;
+        }
+        memcpy(&dst[out], ip, literal_length);
+        ip += literal_length;
+        out += literal_length;
+        if (ip == src_end) {
+            break;      // last sequence, literals only
+        }
+        if (ip + 2 > src_end) {
+            return -1;
+        }
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        int match_length = (token & 15) + 4;
+        if ((token & 15) == 15) {
+            uint8_t more;
+            do {
+                if (ip >= src_end) {
+                    return -1;
+                }
+                more = *ip++;
+                match_length += more;
+            } while (more == 255);
+        }
+        if (offset == 0 || offset > out || out + match_length > dst_max) {
+            return -1;
+        }
+        // byte by byte, the match may overlap what it writes
+        for (int i = 0; i < match_length; i++, out++) {
+            dst[out] = dst[out - offset];
+        }
+    }
+    return out;
+}
+
+/**
+ * Compress data frame by frame, as data_frame_compress() does, and check every frame decodes to its data.
+ */
+static void measure(const char *name, const uint8_t *data, uint32_t length) {
+    static uint8_t compressed[NETDATA_MAX_DATA_LENGTH];
+    static uint8_t decoded[NETDATA_MAX_DATA_LENGTH];
+    uint32_t total = 0;
+    double encode_us = 0;
+    uint32_t frames = 0;
+    for (uint32_t offset = 0; offset < length; offset += NETDATA_MAX_DATA_LENGTH) {
+        uint16_t chunk_length = MIN(length - offset, NETDATA_MAX_DATA_LENGTH);
+        uint16_t compressed_length = 0;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int round = 0; round < ENCODE_ROUNDS; round++) {
+            compressed_length = lz4_block_compress(&data[offset], chunk_length, compressed, chunk_length, m_table);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        encode_us += elapsed_us(&start, &end) / ENCODE_ROUNDS;
+        frames++;
+        if (compressed_length == 0) {
+            total += chunk_length;     // sent as it is
+            continue;
+        }
+        int decoded_length = client_decompress(compressed, compressed_length, decoded, sizeof(decoded));
+        CHECK(decoded_length == chunk_length && memcmp(decoded, &data[offset], chunk_length) == 0,
+              "%s: frame at %u does not decode", name, offset);
+        memset(decoded, 0, chunk_length);
+        decoded_length = lz4_block_decompress(compressed, compressed_length, decoded, sizeof(decoded));
+        CHECK(decoded_length == chunk_length && memcmp(decoded, &data[offset], chunk_length) == 0,
+              "%s: frame at %u does not decode in the firmware", name, offset);
+        total += compressed_length;
+    }
+    printf("  %-28s %6u -> %6u bytes (%5.1f%%), encode %6.1f us per frame\n",
+           name, length, total, 100.0 * total / length, encode_us / frames);
+}
+
+static uint32_t make_mf1_4k_dump(uint8_t *dump) {
+    uint32_t length = 0;
+    for (int block = 0; block < 256; block++) {
+        uint8_t *data = &dump[block * 16];
+        bool trailer = block < 128 ? (block % 4 == 3) : (block % 16 == 15);
+        memset(data, 0, 16);
+        if (block == 0) {
+            const uint8_t manufacturer[] = {0xDE, 0xAD, 0xBE, 0xEF, 0x22, 0x18, 0x02, 0x00, 0x46, 0x44, 0x53, 0x37, 0x30, 0x56, 0x30, 0x31};
+            memcpy(data, manufacturer, 16);
+        } else if (trailer) {
+            const uint8_t factory[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+            memcpy(data, factory, 16);
+        }
+        length += 16;
+    }
+    return length;
+}
+
+static uint32_t make_ntag215_dump(uint8_t *dump) {
+    memset(dump, 0, 135 * 4);
+    const uint8_t head[] = {0x04, 0x68, 0x95, 0x71, 0xFA, 0x5C, 0x64, 0x80, 0x42, 0x48, 0x00, 0x00, 0xE1, 0x10, 0x3E, 0x00, 0x03, 0x00, 0xFE};
+    const uint8_t config[] = {0x01, 0x00, 0x0F, 0xBD, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x05, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
+    memcpy(dump, head, sizeof(head));
+    memcpy(&dump[130 * 4], config, sizeof(config));
+    return 135 * 4;
+}
+
+// records of nfc_tag_mf1_auth_log_t: a few readers trying a few blocks of the same card
+static uint32_t make_detection_log(uint8_t *log) {
+    const uint8_t uid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+    uint32_t length = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint8_t *record = &log[length];
+        record[0] = (i / 8) % 64;
+        record[1] = i & 1;
+        memcpy(&record[2], uid, 4);
+        for (int j = 6; j < 18; j++) {
+            record[j] = next_random();
+        }
+        length += 18;
+    }
+    return length;
+}
+
+static uint32_t make_random(uint8_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = next_random();
+    }
+    return length;
+}
+
+static void test_edge_cases(void) {
+    static uint8_t data[NETDATA_MAX_DATA_LENGTH];
+    static uint8_t compressed[NETDATA_MAX_DATA_LENGTH + 64];
+    static uint8_t decoded[NETDATA_MAX_DATA_LENGTH];
+    // short inputs are literals only, a run longer than the length fields of the token
+    const uint16_t lengths[] = {0, 1, 12, 13, 14, 15, 16, 300, 4095, 4096};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        memset(data, 0xFF, lengths[i]);
+        uint16_t compressed_length = lz4_block_compress(data, lengths[i], compressed, sizeof(compressed), m_table);
+        CHECK(compressed_length > 0, "length %u not compressed", lengths[i]);
+        int decoded_length = client_decompress(compressed, compressed_length, decoded, sizeof(decoded));
+        CHECK(decoded_length == lengths[i] && memcmp(decoded, data, lengths[i]) == 0, "length %u does not decode", lengths[i]);
+        decoded_length = lz4_block_decompress(compressed, compressed_length, decoded, sizeof(decoded));
+        CHECK(decoded_length == lengths[i] && memcmp(decoded, data, lengths[i]) == 0, "length %u does not decode in the firmware", lengths[i]);
+        // an output one byte short is refused, so is a block cut anywhere
+        if (lengths[i] > 0) {
+            CHECK(lz4_block_decompress(compressed, compressed_length, decoded, lengths[i] - 1) == -1, "length %u overflows", lengths[i]);
+        }
+        for (uint16_t cut = 1; cut < compressed_length; cut++) {
+            decoded_length = lz4_block_decompress(compressed, cut, decoded, sizeof(decoded));
+            CHECK(decoded_length < lengths[i], "length %u cut at %u decodes", lengths[i], cut);
+        }
+    }
+    // the literals of random data do not fit in a smaller output
+    make_random(data, sizeof(data));
+    CHECK(lz4_block_compress(data, sizeof(data), compressed, sizeof(data), m_table) == 0, "random data compressed");
+    uint16_t compressed_length = lz4_block_compress(data, sizeof(data), compressed, sizeof(compressed), m_table);
+    CHECK(compressed_length > sizeof(data), "random data without literal header");
+    CHECK(client_decompress(compressed, compressed_length, decoded, sizeof(decoded)) == sizeof(data)
+          && memcmp(decoded, data, sizeof(data)) == 0, "random data does not decode");
+    CHECK(lz4_block_decompress(compressed, compressed_length, decoded, sizeof(decoded)) == sizeof(data)
+          && memcmp(decoded, data, sizeof(data)) == 0, "random data does not decode in the firmware");
+}
+
+// client side of the frame test
+static struct {
+    uint16_t status;
+    uint16_t length;
+    uint8_t data[NETDATA_MAX_DATA_LENGTH];
+} m_client;
+
+static void client_frame(uint16_t cmd, uint16_t status, uint16_t length, uint8_t *data) {
+    m_client.status = status;
+    m_client.length = length;
+    memcpy(m_client.data, data, length);
+}
+
+static void send_frame(uint16_t status, const uint8_t *data, uint16_t length) {
+    data_frame_tx_t *tx = data_frame_make(CMD_TEST, status, length, (uint8_t *)data);
+    data_frame_compress(tx);
+    memset(&m_client, 0, sizeof(m_client));
+    data_frame_receive(tx->buffer, tx->length);
+    data_frame_process();
+    data_frame_tx_discard(tx);
+}
+
+static void test_frames(void) {
+    static uint8_t dump[NETDATA_MAX_DATA_LENGTH];
+    static uint8_t decoded[NETDATA_MAX_DATA_LENGTH];
+    uint32_t length = make_mf1_4k_dump(dump);
+    on_data_frame_complete(client_frame);
+
+    send_frame(STATUS_SUCCESS, dump, length);
+    CHECK(m_client.status == STATUS_SUCCESS && m_client.length == length, "compressed before the client asked");
+
+    data_frame_set_compression(true);
+    send_frame(STATUS_SUCCESS, dump, length);
+    CHECK(m_client.status == (STATUS_SUCCESS | NETDATA_STATUS_COMPRESSED), "dump frame not compressed");
+    int decoded_length = client_decompress(m_client.data, m_client.length, decoded, sizeof(decoded));
+    CHECK(decoded_length == length && memcmp(decoded, dump, length) == 0, "dump frame does not decode");
+
+    send_frame(STATUS_MORE_DATA, dump, DATA_FRAME_COMPRESS_MIN_LENGTH - 1);
+    CHECK(m_client.status == STATUS_MORE_DATA, "small frame compressed");
+
+    make_random(dump, 1024);
+    send_frame(STATUS_SUCCESS, dump, 1024);
+    CHECK(m_client.status == STATUS_SUCCESS && m_client.length == 1024 && memcmp(m_client.data, dump, 1024) == 0,
+          "random frame not sent as it is");
+
+    data_frame_set_compression(false);
+}
+
+static void measure_file(const char *path) {
+    static uint8_t data[CORPUS_MAX];
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        CHECK(false, "cannot open %s", path);
+        return;
+    }
+    uint32_t length = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    const char *name = strrchr(path, '/');
+    measure(name != NULL ? name + 1 : path, data, length);
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t corpus[CORPUS_MAX];
+    test_edge_cases();
+    test_frames();
+
+    printf("LZ4 block per frame of %d bytes:\n", NETDATA_MAX_DATA_LENGTH);
+    measure("MF1 4K factory dump", corpus, make_mf1_4k_dump(corpus));
+    measure("NTAG215 blank dump", corpus, make_ntag215_dump(corpus));
+    measure("MF1 detection log", corpus, make_detection_log(corpus));
+    measure("random nonces", corpus, make_random(corpus, 4096));
+    for (int i = 1; i < argc; i++) {
+        measure_file(argv[i]);
+    }
+
+    return test_result("test_frame_compress");
+}
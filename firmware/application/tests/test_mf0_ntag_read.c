@@ -0,0 +1,227 @@
+/**
+ * Host test of the READ and FAST_READ answers of the MF0/NTAG emulation (nfc_mf0_ntag.c): the answer built a run
+ * of pages at a time must be, byte for byte, the one the page by page loop it replaced builds, kept here as the
+ * reference, for every supported tag type, random memory, UID and counter, every mirror mode, byte and page,
+ * the UID magic mode on and off, limits set by AUTH0 and reads that wrap at the limit. Both are then timed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nfc_mf0_ntag.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+// the configuration defines of nfc_mf0_ntag.c
+#define CONF_MIRROR_BYTE                   0
+#define CONF_MIRROR_PAGE_BYTE              2
+#define MIRROR_CONF_UID                    1
+#define MIRROR_CONF_CNT                    2
+#define MIRROR_CONF_UID_CNT                3
+#define MIRROR_UID_CNT_SIZE               21
+
+static const tag_specific_type_t m_types[] = {
+    TAG_TYPE_MF0ICU1, TAG_TYPE_MF0ICU2, TAG_TYPE_MF0UL11, TAG_TYPE_MF0UL21,
+    TAG_TYPE_NTAG_210, TAG_TYPE_NTAG_212, TAG_TYPE_NTAG_213, TAG_TYPE_NTAG_215, TAG_TYPE_NTAG_216,
+};
+
+static uint8_t m_data[sizeof(nfc_tag_14a_coll_res_entity_t) + sizeof(nfc_tag_mf0_ntag_configure_t) +
+                      NFC_TAG_NTAG_BLOCK_MAX * NFC_TAG_MF0_NTAG_DATA_SIZE] __attribute__((aligned(4)));
+
+// room for the bytes the reference writes past the answer, a mirror page at its end
+#define ANSWER_MAX      (NFC_TAG_NTAG_BLOCK_MAX * NFC_TAG_MF0_NTAG_DATA_SIZE + 8)
+static uint8_t m_expected[ANSWER_MAX];
+static uint8_t m_answer[ANSWER_MAX];
+
+static nfc_tag_mf0_ntag_information_t *info(void) {
+    return (nfc_tag_mf0_ntag_information_t *)m_data;
+}
+
+static uint64_t m_rng = 0x0123456789ABCDEFULL;
+
+static uint32_t random32(void) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    return (uint32_t)m_rng;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static char hex_digit(int n) {
+    if (n < 10) return '0' + n;
+    else return 'A' + n - 10;
+}
+
+static void bytes2hex(const uint8_t *bytes, char *hex, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        *hex++ = hex_digit(bytes[i] >> 4);
+        *hex++ = hex_digit(bytes[i] & 0x0F);
+    }
+}
+
+// handle_any_read() of nfc_mf0_ntag.c before the builder, on the decoded state of the slot
+static void reference_read(uint8_t *tx_buffer, uint8_t block_num, uint8_t block_cnt, uint8_t block_max) {
+    const nfc_tag_mf0_ntag_state_t *state = nfc_tag_mf0_ntag_get_state();
+    uint8_t pwd_page = state->pwd_page;
+    int mirror_page_off = state->mirror_page;
+    int mirror_page_end = state->mirror_page_end;
+    int mirror_byte_off = state->mirror_byte;
+    int mirror_size = state->mirror_size;
+
+    uint8_t mirror_buf[MIRROR_UID_CNT_SIZE];
+    switch (state->mirror_mode) {
+        case MIRROR_CONF_UID:
+            bytes2hex(info()->res_coll.uid, (char *)mirror_buf, 7);
+            break;
+        case MIRROR_CONF_CNT:
+            bytes2hex(nfc_tag_mf0_ntag_get_counter_data_by_index(0), (char *)mirror_buf, 3);
+            break;
+        case MIRROR_CONF_UID_CNT:
+            bytes2hex(info()->res_coll.uid, (char *)mirror_buf, 7);
+            mirror_buf[7] = 'x';
+            bytes2hex(nfc_tag_mf0_ntag_get_counter_data_by_index(0), (char *)&mirror_buf[8], 3);
+            break;
+        default:
+            break;
+    }
+
+    for (uint8_t block = 0; block < block_cnt; block++) {
+        uint8_t block_to_read = (block_num + block) % block_max;
+        uint8_t *tx_buf_ptr = tx_buffer + block * NFC_TAG_MF0_NTAG_DATA_SIZE;
+
+        // In case PWD or PACK pages are read we need to write zero to the output buffer. In UID magic mode we don't care.
+        if (info()->config.mode_uid_magic || (pwd_page == 0) || (block_to_read < pwd_page) || (block_to_read > (pwd_page + 1))) {
+            memcpy(tx_buf_ptr, info()->memory[block_to_read], NFC_TAG_MF0_NTAG_DATA_SIZE);
+        } else {
+            memset(tx_buf_ptr, 0, NFC_TAG_MF0_NTAG_DATA_SIZE);
+        }
+
+        // apply mirroring if needed
+        if ((mirror_page_off > 0) && (mirror_size > 0) && (block_to_read >= mirror_page_off) && (block_to_read < mirror_page_end)) {
+            int mirror_buf_off = (block_to_read - mirror_page_off) * NFC_TAG_MF0_NTAG_DATA_SIZE;
+            int offset_in_cur_block = mirror_byte_off;
+            if (mirror_buf_off != 0) {
+                mirror_buf_off -= mirror_byte_off;
+                offset_in_cur_block = 0;
+            }
+
+            int mirror_copy_size = mirror_size - mirror_buf_off;
+            if (mirror_copy_size > NFC_TAG_MF0_NTAG_DATA_SIZE) mirror_copy_size = NFC_TAG_MF0_NTAG_DATA_SIZE;
+
+            memcpy(&tx_buf_ptr[offset_in_cur_block], &mirror_buf[mirror_buf_off], mirror_copy_size);
+        }
+    }
+}
+
+static void factory_load(tag_specific_type_t type) {
+    uint16_t length;
+    CHECK(nfc_tag_mf0_ntag_data_factory(0, type), "factory data of type %d", type);
+    memset(m_data, 0, sizeof(m_data));
+    memcpy(m_data, nfct_sim_fds_record(&length), length);
+    tag_data_buffer_t buffer = { .length = length, .buffer = m_data };
+    nfc_tag_mf0_ntag_data_loadcb(type, &buffer);
+}
+
+// one answer against the reference, the bytes past it are not compared
+static bool same_answer(uint8_t block_num, uint8_t block_cnt, uint8_t block_max) {
+    memset(m_expected, 0xA5, sizeof(m_expected));
+    memset(m_answer, 0xA5, sizeof(m_answer));
+    reference_read(m_expected, block_num, block_cnt, block_max);
+    uint16_t length = nfc_tag_mf0_ntag_build_read(m_answer, block_num, block_cnt, block_max);
+    return length == block_cnt * NFC_TAG_MF0_NTAG_DATA_SIZE && memcmp(m_answer, m_expected, length) == 0;
+}
+
+// the READ of each page, wrapping at the limit, and FAST_READs of random ranges within it
+static uint32_t compare_reads(uint8_t block_max) {
+    uint32_t mismatches = 0;
+    for (int block_num = 0; block_num < block_max; block_num++) {
+        mismatches += !same_answer(block_num, 4, block_max);
+    }
+    for (int round = 0; round < 64; round++) {
+        uint8_t block_num = random32() % block_max;
+        uint8_t block_cnt = 1 + random32() % (block_max - block_num);
+        mismatches += !same_answer(block_num, block_cnt, block_max);
+    }
+    // and the whole memory
+    mismatches += !same_answer(0, block_max, block_max);
+    return mismatches;
+}
+
+static void test_type(tag_specific_type_t type) {
+    factory_load(type);
+    const nfc_tag_mf0_ntag_state_t *state = nfc_tag_mf0_ntag_get_state();
+    int nr_pages = state->nr_pages;
+    int first_cfg_page = state->first_cfg_page;
+    int total_pages = nr_pages + 16;
+    uint32_t mismatches = 0;
+    uint32_t mirrored = 0;
+
+    for (int round = 0; round < 300; round++) {
+        for (int page = 0; page < total_pages && page < NFC_TAG_NTAG_BLOCK_MAX; page++) {
+            uint32_t value = random32();
+            memcpy(info()->memory[page], &value, NFC_TAG_MF0_NTAG_DATA_SIZE);
+        }
+        for (int i = 0; i < 7; i++) {
+            info()->res_coll.uid[i] = random32();
+        }
+        info()->config.mode_uid_magic = round & 1;
+        if (first_cfg_page != 0) {
+            // every mirror mode and byte, the mirror page around the end of the user memory
+            info()->memory[first_cfg_page][CONF_MIRROR_BYTE] = (round % 16) << 4;
+            info()->memory[first_cfg_page][CONF_MIRROR_PAGE_BYTE] = random32() % (state->user_data_end + 4);
+        }
+        nfc_tag_mf0_ntag_state_invalidate();
+        state = nfc_tag_mf0_ntag_get_state();
+        mirrored += state->mirror_size != 0;
+
+        mismatches += compare_reads(nr_pages);
+        // a limit of AUTH0, which may cut the mirror or the password pages
+        mismatches += compare_reads(1 + random32() % nr_pages);
+    }
+    CHECK(mismatches == 0, "%u answers of type %d differ from the reference", mismatches, type);
+    bool ultralight = type == TAG_TYPE_MF0ICU1 || type == TAG_TYPE_MF0ICU2 || type == TAG_TYPE_MF0UL11 || type == TAG_TYPE_MF0UL21;
+    CHECK(ultralight || mirrored > 0, "no mirror configuration of type %d was valid", type);
+}
+
+#define BENCH(label, rounds, block_num, block_cnt, block_max) do {                              \
+    uint64_t start = now_ns();                                                                  \
+    for (int i = 0; i < (rounds); i++) { reference_read(m_expected, block_num, block_cnt, block_max); } \
+    uint64_t reference_ns = now_ns() - start;                                                   \
+    start = now_ns();                                                                           \
+    for (int i = 0; i < (rounds); i++) { nfc_tag_mf0_ntag_build_read(m_answer, block_num, block_cnt, block_max); } \
+    uint64_t builder_ns = now_ns() - start;                                                     \
+    printf("%-28s page by page %7.1f ns, builder %7.1f ns\n", label,                            \
+           (double)reference_ns / (rounds), (double)builder_ns / (rounds));                     \
+} while (0)
+
+static void benchmark(void) {
+    const int rounds = 200000;
+    factory_load(TAG_TYPE_NTAG_216);
+    // UID mirror on page 4, the way NDEF URL records use it
+    info()->memory[0xE3][CONF_MIRROR_BYTE] = MIRROR_CONF_UID << 6;
+    info()->memory[0xE3][CONF_MIRROR_PAGE_BYTE] = 4;
+    nfc_tag_mf0_ntag_state_invalidate();
+    uint8_t nr_pages = nfc_tag_mf0_ntag_get_state()->nr_pages;
+
+    BENCH("READ page 16", rounds, 16, 4, nr_pages);
+    BENCH("READ page 4, mirror", rounds, 4, 4, nr_pages);
+    BENCH("FAST_READ 15 pages, mirror", rounds, 4, 15, nr_pages);
+    BENCH("FAST_READ all pages", rounds / 10, 0, nr_pages, nr_pages);
+}
+
+int main(void) {
+    nfct_sim_init();
+
+    for (size_t i = 0; i < sizeof(m_types) / sizeof(m_types[0]); i++) {
+        test_type(m_types[i]);
+    }
+    benchmark();
+
+    return test_result("test_mf0_ntag_read");
+}
@@ -0,0 +1,438 @@
+/**
+ * Host test of the decoded state of the MF0/NTAG emulation (nfc_mf0_ntag.c): for every supported tag type and
+ * random lock bytes, AUTH0, ACCESS and mirror configurations, the lock bitmap, the configuration, password and
+ * PACK pages, the pages readable and writable before PWD_AUTH and the mirror configuration must be what the
+ * functions it replaced, kept here as the reference, work out on each READ and WRITE. The state must follow
+ * the pages once invalidated and keep its values until then, a new slot load rebuilds it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nfc_mf0_ntag.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+// the layout defines of nfc_mf0_ntag.c
+#define MF0ICU2_USER_MEMORY_END         0x28
+#define MF0ICU2_CNT_PAGE                0x29
+#define MF0ICU2_FIRST_KEY_PAGE          0x2C
+#define MF0UL11_FIRST_CFG_PAGE          0x10
+#define MF0UL11_USER_MEMORY_END         (MF0UL11_FIRST_CFG_PAGE)
+#define MF0UL21_FIRST_CFG_PAGE          0x25
+#define MF0UL21_USER_MEMORY_END         0x24
+#define NTAG210_FIRST_CFG_PAGE          0x10
+#define NTAG210_USER_MEMORY_END         (NTAG210_FIRST_CFG_PAGE)
+#define NTAG212_FIRST_CFG_PAGE          0x25
+#define NTAG212_USER_MEMORY_END         0x24
+#define NTAG213_FIRST_CFG_PAGE          0x29
+#define NTAG213_USER_MEMORY_END         0x28
+#define NTAG215_FIRST_CFG_PAGE          0x83
+#define NTAG215_USER_MEMORY_END         0x82
+#define NTAG216_FIRST_CFG_PAGE          0xE3
+#define NTAG216_USER_MEMORY_END         0xE2
+
+#define CONF_MIRROR_BYTE                   0
+#define CONF_MIRROR_PAGE_BYTE              2
+#define CONF_ACCESS_PAGE_OFFSET            1
+#define CONF_ACCESS_BYTE                   0
+#define CONF_AUTH0_BYTE                 0x03
+#define CONF_PWD_PAGE_OFFSET               2
+#define CONF_PACK_PAGE_OFFSET              3
+#define CONF_ACCESS_CFGLCK              0x40
+#define CONF_ACCESS_PROT                0x80
+
+#define MIRROR_BYTE_BYTE_MASK           0x30
+#define MIRROR_BYTE_BYTE_SHIFT             4
+#define MIRROR_BYTE_CONF_MASK           0xC0
+#define MIRROR_BYTE_CONF_SHIFT             6
+#define MIRROR_CONF_DISABLED               0
+#define MIRROR_CONF_UID                    1
+#define MIRROR_CONF_CNT                    2
+#define MIRROR_CONF_UID_CNT                3
+#define MIRROR_UID_SIZE                   14
+#define MIRROR_CNT_SIZE                    6
+#define MIRROR_UID_CNT_SIZE               21
+
+static const tag_specific_type_t m_types[] = {
+    TAG_TYPE_MF0ICU1, TAG_TYPE_MF0ICU2, TAG_TYPE_MF0UL11, TAG_TYPE_MF0UL21,
+    TAG_TYPE_NTAG_210, TAG_TYPE_NTAG_212, TAG_TYPE_NTAG_213, TAG_TYPE_NTAG_215, TAG_TYPE_NTAG_216,
+};
+
+static uint8_t m_data[sizeof(nfc_tag_14a_coll_res_entity_t) + sizeof(nfc_tag_mf0_ntag_configure_t) +
+                      NFC_TAG_NTAG_BLOCK_MAX * NFC_TAG_MF0_NTAG_DATA_SIZE] __attribute__((aligned(4)));
+static uint16_t m_length;
+
+static uint8_t (*memory(void))[NFC_TAG_MF0_NTAG_DATA_SIZE] {
+    return ((nfc_tag_mf0_ntag_information_t *)m_data)->memory;
+}
+
+static uint64_t m_rng = 0x0123456789ABCDEFULL;
+
+static uint32_t random32(void) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    return (uint32_t)m_rng;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool is_ntag(tag_specific_type_t type) {
+    return type == TAG_TYPE_NTAG_210 || type == TAG_TYPE_NTAG_212 || type == TAG_TYPE_NTAG_213 ||
+           type == TAG_TYPE_NTAG_215 || type == TAG_TYPE_NTAG_216;
+}
+
+// get_first_cfg_page_by_tag_type() of nfc_mf0_ntag.c
+static int reference_first_cfg_page(tag_specific_type_t tag_type) {
+    switch (tag_type) {
+        case TAG_TYPE_MF0UL11:
+            return MF0UL11_FIRST_CFG_PAGE;
+        case TAG_TYPE_MF0UL21:
+            return MF0UL21_FIRST_CFG_PAGE;
+        case TAG_TYPE_NTAG_210:
+            return NTAG210_FIRST_CFG_PAGE;
+        case TAG_TYPE_NTAG_212:
+            return NTAG212_FIRST_CFG_PAGE;
+        case TAG_TYPE_NTAG_213:
+            return NTAG213_FIRST_CFG_PAGE;
+        case TAG_TYPE_NTAG_215:
+            return NTAG215_FIRST_CFG_PAGE;
+        case TAG_TYPE_NTAG_216:
+            return NTAG216_FIRST_CFG_PAGE;
+        default:
+            return 0;
+    }
+}
+
+// get_user_data_end_by_tag_type() of nfc_mf0_ntag.c
+static int reference_user_data_end(tag_specific_type_t type) {
+    switch (type) {
+        case TAG_TYPE_MF0ICU1:
+            return MF0ICU1_PAGES;
+        case TAG_TYPE_MF0ICU2:
+            return MF0ICU2_USER_MEMORY_END;
+        case TAG_TYPE_MF0UL11:
+            return MF0UL11_USER_MEMORY_END;
+        case TAG_TYPE_MF0UL21:
+            return MF0UL21_USER_MEMORY_END;
+        case TAG_TYPE_NTAG_210:
+            return NTAG210_USER_MEMORY_END;
+        case TAG_TYPE_NTAG_212:
+            return NTAG212_USER_MEMORY_END;
+        case TAG_TYPE_NTAG_213:
+            return NTAG213_USER_MEMORY_END;
+        case TAG_TYPE_NTAG_215:
+            return NTAG215_USER_MEMORY_END;
+        default:
+            return NTAG216_USER_MEMORY_END;
+    }
+}
+
+// get_block_max_by_tag_type() of nfc_mf0_ntag.c, for a reader not authenticated and no UID magic mode
+static int reference_block_max(tag_specific_type_t tag_type, bool read) {
+    int max_pages = nfc_tag_mf0_ntag_get_nr_pages_by_tag_type(tag_type);
+    int first_cfg_page = reference_first_cfg_page(tag_type);
+
+    if (first_cfg_page == 0) return max_pages;
+
+    uint8_t auth0 = memory()[first_cfg_page][CONF_AUTH0_BYTE];
+    uint8_t access = memory()[first_cfg_page + 1][0];
+
+    if (!read || ((access & CONF_ACCESS_PROT) != 0)) return (max_pages > auth0) ? auth0 : max_pages;
+    else return max_pages;
+}
+
+// check_ro_lock_on_page() of nfc_mf0_ntag.c before the lock bitmap
+static bool reference_ro_lock(tag_specific_type_t m_tag_type, int block_num) {
+    if (block_num < 3) return true;
+    else if (block_num == 3) return (memory()[2][2] & 9) != 0; // bits 0 and 3
+    else if (block_num <= MF0ICU1_PAGES) {
+        bool locked = false;
+
+        // check block locking bits
+        if (block_num <= 9) locked |= (memory()[2][2] & 2) == 2;
+        else locked |= (memory()[2][2] & 4) == 4;
+
+        locked |= (((*(uint16_t *)&memory()[2][2]) >> block_num) & 1) == 1;
+
+        return locked;
+    } else {
+        uint8_t *p_lock_bytes = NULL;
+        int user_memory_end = 0;
+        int dyn_lock_bit_page_cnt = 0;
+        int index = block_num - MF0ICU1_PAGES;
+
+        switch (m_tag_type) {
+            case TAG_TYPE_MF0ICU1:
+                return true;
+            case TAG_TYPE_MF0ICU2: {
+                p_lock_bytes = memory()[MF0ICU2_USER_MEMORY_END];
+
+                if (block_num < MF0ICU2_USER_MEMORY_END) {
+                    uint8_t byte2 = p_lock_bytes[0];
+
+                    // Account for block locking bits first.
+                    bool locked = (byte2 & (0x10 * (block_num >= 28))) != 0;
+                    locked |= (byte2 >> (1 + (index / 4) + (block_num >= 28)));
+                    return locked;
+                } else if (block_num == MF0ICU2_USER_MEMORY_END) {
+                    return false;
+                } else if (block_num < MF0ICU2_FIRST_KEY_PAGE) {
+                    uint8_t byte3 = p_lock_bytes[1];
+                    return ((byte3 >> (block_num - MF0ICU2_CNT_PAGE)) & 1) != 0;
+                } else {
+                    uint8_t byte3 = p_lock_bytes[1];
+                    return (byte3 & 0x80) != 0;
+                }
+            }
+            // for the next two we reuse the check for CFGLCK bit used for NTAG
+            case TAG_TYPE_MF0UL11:
+                user_memory_end = MF0UL11_USER_MEMORY_END;
+                break;
+            case TAG_TYPE_MF0UL21: {
+                user_memory_end = MF0UL11_USER_MEMORY_END;
+                if (block_num < user_memory_end) {
+                    p_lock_bytes = memory()[MF0UL21_USER_MEMORY_END];
+                    uint16_t lock_word = (((uint16_t)p_lock_bytes[1]) << 8) | (uint16_t)p_lock_bytes[0];
+                    bool locked = ((lock_word >> (index / 2)) & 1) != 0;
+                    locked |= ((p_lock_bytes[2] >> (index / 4)) & 1) != 0;
+                    return locked;
+                }
+                break;
+            }
+            case TAG_TYPE_NTAG_210:
+                user_memory_end = NTAG210_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 0; // NTAG 210 doesn't have dynamic lock bits
+                break;
+            case TAG_TYPE_NTAG_212:
+                user_memory_end = NTAG212_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 2;
+                break;
+            case TAG_TYPE_NTAG_213:
+                user_memory_end = NTAG213_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 2;
+                break;
+            case TAG_TYPE_NTAG_215:
+                user_memory_end = NTAG215_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 16;
+                break;
+            case TAG_TYPE_NTAG_216:
+                user_memory_end = NTAG216_USER_MEMORY_END;
+                dyn_lock_bit_page_cnt = 16;
+                break;
+            default:
+                break;
+        }
+
+        if (block_num < user_memory_end) {
+            p_lock_bytes = memory()[user_memory_end];
+            uint16_t lock_word = (((uint16_t)p_lock_bytes[1]) << 8) | (uint16_t)p_lock_bytes[0];
+
+            bool locked_small_range = ((lock_word >> (index / dyn_lock_bit_page_cnt)) & 1) != 0;
+            bool locked_large_range = ((p_lock_bytes[2] >> (index / dyn_lock_bit_page_cnt / 2)) & 1) != 0;
+
+            return locked_small_range | locked_large_range;
+        } else {
+            // check CFGLCK bit
+            int first_cfg_page = reference_first_cfg_page(m_tag_type);
+            uint8_t access = memory()[first_cfg_page + CONF_ACCESS_PAGE_OFFSET][CONF_ACCESS_BYTE];
+            if ((access & CONF_ACCESS_CFGLCK) != 0)
+                return (block_num >= first_cfg_page) && ((block_num - first_cfg_page) <= 1);
+            else
+                return false;
+        }
+    }
+}
+
+typedef struct {
+    int page_off;
+    int page_end;
+    int byte_off;
+    int mode;
+    int size;
+} reference_mirror_t;
+
+// the mirror configuration handle_any_read() of nfc_mf0_ntag.c extracted, page_off 0 when nothing is mirrored
+static reference_mirror_t reference_mirror(tag_specific_type_t m_tag_type) {
+    reference_mirror_t mirror_conf = { 0 };
+    if (!is_ntag(m_tag_type)) return mirror_conf;
+
+    uint8_t first_cfg_page = reference_first_cfg_page(m_tag_type);
+    uint8_t mirror = memory()[first_cfg_page][CONF_MIRROR_BYTE];
+    int mirror_page_off = memory()[first_cfg_page][CONF_MIRROR_PAGE_BYTE];
+    int mirror_mode = (mirror & MIRROR_BYTE_CONF_MASK) >> MIRROR_BYTE_CONF_SHIFT;
+    int mirror_byte_off = (mirror & MIRROR_BYTE_BYTE_MASK) >> MIRROR_BYTE_BYTE_SHIFT;
+    int mirror_size = 0;
+    int mirror_page_end = 0;
+
+    // NTAG 210/212 don't have a counter thus no mirror mode
+    if (m_tag_type == TAG_TYPE_NTAG_210 || m_tag_type == TAG_TYPE_NTAG_212) mirror_mode = MIRROR_CONF_UID;
+
+    if ((mirror_page_off > 3) && (mirror_mode != MIRROR_CONF_DISABLED)) {
+        mirror_size = mirror_mode == MIRROR_CONF_UID ? MIRROR_UID_SIZE
+                      : mirror_mode == MIRROR_CONF_CNT ? MIRROR_CNT_SIZE : MIRROR_UID_CNT_SIZE;
+        int user_data_end = reference_user_data_end(m_tag_type);
+        int pages_needed =
+            (mirror_byte_off + mirror_size + (NFC_TAG_MF0_NTAG_DATA_SIZE - 1)) / NFC_TAG_MF0_NTAG_DATA_SIZE;
+
+        if ((pages_needed >= user_data_end) || ((user_data_end - pages_needed) < mirror_page_off)) {
+            mirror_page_off = 0;
+        } else {
+            mirror_page_end = mirror_page_off + pages_needed;
+        }
+    }
+
+    if ((mirror_page_off > 0) && (mirror_size > 0)) {
+        mirror_conf.page_off = mirror_page_off;
+        mirror_conf.page_end = mirror_page_end;
+        mirror_conf.byte_off = mirror_byte_off;
+        mirror_conf.mode = mirror_mode;
+        mirror_conf.size = mirror_size;
+    }
+    return mirror_conf;
+}
+
+static bool state_page_locked(const nfc_tag_mf0_ntag_state_t *state, int page) {
+    return (state->lock_bitmap[page / 8] >> (page % 8)) & 1;
+}
+
+static void load(tag_specific_type_t type) {
+    tag_data_buffer_t buffer = { .length = m_length, .buffer = m_data };
+    nfc_tag_mf0_ntag_data_loadcb(type, &buffer);
+}
+
+static void factory_load(tag_specific_type_t type) {
+    CHECK(nfc_tag_mf0_ntag_data_factory(0, type), "factory data of type %d", type);
+    memset(m_data, 0, sizeof(m_data));
+    const uint8_t *record = nfct_sim_fds_record(&m_length);
+    memcpy(m_data, record, m_length);
+    load(type);
+}
+
+// the number of fields of the state that differ from the reference
+static uint32_t compare_state(tag_specific_type_t type) {
+    const nfc_tag_mf0_ntag_state_t *state = nfc_tag_mf0_ntag_get_state();
+    int nr_pages = nfc_tag_mf0_ntag_get_nr_pages_by_tag_type(type);
+    int first_cfg_page = reference_first_cfg_page(type);
+    uint32_t mismatches = 0;
+
+    mismatches += state->nr_pages != nr_pages;
+    mismatches += state->first_cfg_page != first_cfg_page;
+    mismatches += state->pwd_page != (first_cfg_page ? first_cfg_page + CONF_PWD_PAGE_OFFSET : 0);
+    mismatches += first_cfg_page && state->pack_page != first_cfg_page + CONF_PACK_PAGE_OFFSET;
+    mismatches += state->read_max != reference_block_max(type, true);
+    mismatches += state->write_max != reference_block_max(type, false);
+    for (int page = 0; page < nr_pages; page++) {
+        mismatches += state_page_locked(state, page) != reference_ro_lock(type, page);
+    }
+
+    reference_mirror_t mirror = reference_mirror(type);
+    if (mirror.page_off == 0) {
+        mismatches += state->mirror_mode != MIRROR_CONF_DISABLED || state->mirror_size != 0;
+    } else {
+        mismatches += state->mirror_mode != mirror.mode || state->mirror_page != mirror.page_off ||
+                      state->mirror_page_end != mirror.page_end || state->mirror_byte != mirror.byte_off ||
+                      state->mirror_size != mirror.size;
+    }
+    return mismatches;
+}
+
+// random lock bytes, dynamic lock bytes and configuration pages
+static void randomize(tag_specific_type_t type) {
+    int user_data_end = reference_user_data_end(type);
+    int first_cfg_page = reference_first_cfg_page(type);
+    uint32_t value = random32();
+    memory()[2][2] = value;
+    memory()[2][3] = value >> 8;
+    // a lock byte in four is zero, to lock only some of the pages
+    if ((value >> 16) % 4 == 0) memory()[2][2] = memory()[2][3] = 0;
+    if (user_data_end < NFC_TAG_NTAG_BLOCK_MAX) {
+        value = random32();
+        memcpy(memory()[user_data_end], &value, 3);
+        if ((value >> 24) % 4 == 0) memset(memory()[user_data_end], 0, 3);
+    }
+    if (first_cfg_page != 0) {
+        value = random32();
+        memcpy(memory()[first_cfg_page], &value, 4);
+        // the mirror page around the end of the user memory
+        memory()[first_cfg_page][CONF_MIRROR_PAGE_BYTE] = random32() % (user_data_end + 8);
+        value = random32();
+        memcpy(memory()[first_cfg_page + 1], &value, 4);
+    }
+}
+
+static void test_all_types(void) {
+    for (size_t i = 0; i < sizeof(m_types) / sizeof(m_types[0]); i++) {
+        tag_specific_type_t type = m_types[i];
+        factory_load(type);
+        uint32_t mismatches = compare_state(type);
+        CHECK(mismatches == 0, "%u fields of the factory state of type %d differ from the reference", mismatches, type);
+
+        mismatches = 0;
+        for (int round = 0; round < 20000; round++) {
+            randomize(type);
+            nfc_tag_mf0_ntag_state_invalidate();
+            mismatches += compare_state(type);
+        }
+        CHECK(mismatches == 0, "%u fields of the state of type %d differ from the reference", mismatches, type);
+    }
+}
+
+static void test_invalidation(void) {
+    factory_load(TAG_TYPE_NTAG_215);
+    // the factory lock bytes lock the first pages, start from none
+    memory()[2][2] = memory()[2][3] = 0;
+    load(TAG_TYPE_NTAG_215);
+    CHECK(!state_page_locked(nfc_tag_mf0_ntag_get_state(), 4), "page 4 without lock bits");
+    // the decoded state stays until the pages are written through the emulation or the slot reloaded
+    memory()[2][2] = 0x10;
+    CHECK(!state_page_locked(nfc_tag_mf0_ntag_get_state(), 4), "cached lock of page 4");
+    nfc_tag_mf0_ntag_state_invalidate();
+    CHECK(state_page_locked(nfc_tag_mf0_ntag_get_state(), 4), "lock of page 4 after the invalidation");
+    memory()[NTAG215_FIRST_CFG_PAGE][CONF_AUTH0_BYTE] = 0x10;
+    load(TAG_TYPE_NTAG_215);
+    CHECK(nfc_tag_mf0_ntag_get_state()->write_max == 0x10, "AUTH0 after the load");
+}
+
+static void benchmark(void) {
+    const int rounds = 20000;
+    volatile uint32_t sink = 0;
+    factory_load(TAG_TYPE_NTAG_216);
+    uint64_t start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        int page = 4 + i % 220;
+        sink += reference_ro_lock(TAG_TYPE_NTAG_216, page) + reference_block_max(TAG_TYPE_NTAG_216, false);
+        sink += reference_mirror(TAG_TYPE_NTAG_216).page_off;
+    }
+    uint64_t reference_ns = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        const nfc_tag_mf0_ntag_state_t *state = nfc_tag_mf0_ntag_get_state();
+        sink += state_page_locked(state, 4 + i % 220) + state->write_max + state->mirror_page;
+    }
+    uint64_t cached_ns = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        nfc_tag_mf0_ntag_state_invalidate();
+        sink += nfc_tag_mf0_ntag_get_state()->write_max;
+    }
+    uint64_t rebuild_ns = now_ns() - start;
+    printf("NTAG216 lock, AUTH0 and mirror lookup: decoded %.1f ns, cached %.1f ns, rebuild %.1f ns\n",
+           (double)reference_ns / rounds, (double)cached_ns / rounds, (double)rebuild_ns / rounds);
+}
+
+int main(void) {
+    nfct_sim_init();
+
+    test_all_types();
+    test_invalidation();
+    benchmark();
+
+    return test_result("test_mf0_ntag_state");
+}
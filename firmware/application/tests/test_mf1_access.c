@@ -0,0 +1,154 @@
+/**
+ * Host test of the access conditions cache of the MIFARE Classic emulation (nfc_mf1.c): every value of the three
+ * access bytes of a trailer, consistent or not, is decoded by the cache and by the decoder it replaced, kept here
+ * as the reference, for every block of a small and of a large (4K) sector. The cache must follow the trailer once
+ * invalidated and keep the decoded conditions until then, a new slot load invalidates it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nfc_mf1.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+#define BYTE_SWAP(x) (((uint8_t)(x)>>4)|((uint8_t)(x)<<4))
+#define NO_ACCESS 0x07
+
+// GetAccessCondition() of nfc_mf1.c before the cache, on the access bytes of the trailer
+static uint8_t reference_access_condition(const uint8_t *acs, uint8_t Block) {
+    uint8_t  InvSAcc0;
+    uint8_t  InvSAcc1;
+    uint8_t  Acc0 = acs[0];
+    uint8_t  Acc1 = acs[1];
+    uint8_t  Acc2 = acs[2];
+    uint8_t  ResultForBlock = 0;
+
+    InvSAcc0 = ~BYTE_SWAP(Acc0);
+    InvSAcc1 = ~BYTE_SWAP(Acc1);
+
+    /* Check */
+    if (((InvSAcc0 ^ Acc1) & 0xf0) ||    /* C1x */
+            ((InvSAcc0 ^ Acc2) & 0x0f) ||   /* C2x */
+            ((InvSAcc1 ^ Acc2) & 0xf0)) {   /* C3x */
+        return (NO_ACCESS);
+    }
+    /* Fix for MFClassic 4K cards */
+    if (Block < 128)
+        Block &= 3;
+    else {
+        Block &= 15;
+        if (Block & 15)
+            Block = 3;
+        else if (Block <= 4)
+            Block = 0;
+        else if (Block <= 9)
+            Block = 1;
+        else
+            Block = 2;
+    }
+
+    Acc0 = ~Acc0;       /* C1x Bits to bit 0..3 */
+    Acc1 =  Acc2;       /* C2x Bits to bit 0..3 */
+    Acc2 =  Acc2 >> 4;  /* C3x Bits to bit 0..3 */
+
+    if (Block) {
+        Acc0 >>= Block;
+        Acc1 >>= Block;
+        Acc2 >>= Block;
+    }
+    /* combine the bits */
+    ResultForBlock = ((Acc2 & 1) << 2) |
+                     ((Acc1 & 1) << 1) |
+                     (Acc0 & 1);
+    return (ResultForBlock);
+}
+
+static uint8_t m_data[sizeof(nfc_tag_mf1_information_t)];
+
+static nfc_tag_mf1_information_t *info(void) {
+    return (nfc_tag_mf1_information_t *)m_data;
+}
+
+static void load(void) {
+    tag_data_buffer_t buffer = { .length = sizeof(m_data), .buffer = m_data };
+    nfc_tag_mf1_data_loadcb(TAG_TYPE_MIFARE_4096, &buffer);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// all the access bytes of a sector against the reference, for each block of the sector
+static void test_all_trailers(uint8_t sector, uint8_t first_block, uint8_t blocks) {
+    uint8_t *acs = info()->memory[first_block + blocks - 1] + 6;
+    uint32_t mismatches = 0;
+    for (uint32_t value = 0; value < (1 << 24); value++) {
+        acs[0] = value >> 16;
+        acs[1] = value >> 8;
+        acs[2] = value;
+        nfc_tag_mf1_access_cache_invalidate();
+        for (uint8_t i = 0; i < blocks; i++) {
+            uint8_t block = first_block + i;
+            if (nfc_tag_mf1_access_condition(sector, block) != reference_access_condition(acs, block)) {
+                if (mismatches++ < 4) {
+                    printf("sector %u block %u access bytes %06X: %u, expected %u\n", sector, block, value,
+                           nfc_tag_mf1_access_condition(sector, block), reference_access_condition(acs, block));
+                }
+            }
+        }
+    }
+    CHECK(mismatches == 0, "%u access conditions of sector %u differ from the reference", mismatches, sector);
+}
+
+static void test_invalidation(void) {
+    // transport configuration: data blocks 000, trailer 001
+    static const uint8_t transport[3] = { 0xFF, 0x07, 0x80 };
+    // read/write blocks with key B: data blocks 100, trailer 011
+    static const uint8_t key_b[3] = { 0x78, 0x77, 0x88 };
+    uint8_t *acs = info()->memory[7] + 6;
+
+    memcpy(acs, transport, 3);
+    load();
+    CHECK(nfc_tag_mf1_access_condition(1, 4) == 0 && nfc_tag_mf1_access_condition(1, 7) == 4, "transport configuration");
+    // the decoded conditions stay until the trailer is written through the emulation or the slot reloaded
+    memcpy(acs, key_b, 3);
+    CHECK(nfc_tag_mf1_access_condition(1, 4) == 0, "cached conditions of sector 1");
+    load();
+    CHECK(nfc_tag_mf1_access_condition(1, 4) == 1 && nfc_tag_mf1_access_condition(1, 7) == 6,
+          "conditions of sector 1 after the load");
+}
+
+static void benchmark(void) {
+    const int rounds = 1000000;
+    volatile uint32_t sink = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        sink += reference_access_condition(info()->memory[7] + 6, i & 3);
+    }
+    uint64_t reference_ns = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        sink += nfc_tag_mf1_access_condition(1, 4 + (i & 3));
+    }
+    uint64_t cached_ns = now_ns() - start;
+    printf("access condition: decoded %.1f ns, cached %.1f ns\n", (double)reference_ns / rounds, (double)cached_ns / rounds);
+}
+
+int main(void) {
+    uint16_t length;
+    nfct_sim_init();
+    CHECK(nfc_tag_mf1_data_factory(0, TAG_TYPE_MIFARE_4096), "MF1 factory data");
+    memcpy(m_data, nfct_sim_fds_record(&length), length);
+    load();
+
+    test_all_trailers(1, 4, 4);
+    test_all_trailers(32, 128, 16);
+    test_invalidation();
+    benchmark();
+
+    return test_result("test_mf1_access");
+}
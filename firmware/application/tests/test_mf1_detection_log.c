@@ -0,0 +1,267 @@
+/**
+ * Host test of the MIFARE Classic detection log (nfc_mf1_log.c): the records read back are the
+ * nfc_tag_mf1_auth_log_t of the detection log command, in order, from any byte offset, a record already
+ * in the log is dropped, a full log keeps its first records or overwrites the oldest by its policy and
+ * the UID table gives its entries back once no record refers to them. A held log reads the same while records come. The authentication steps of
+ * nfc_mf1.c must store their record, and the records held in the RAM of the former log are counted.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nfc_mf1.h"
+#include "nfc_mf1_log.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+// the steps the MF1 state machine runs for each authentication
+void append_mf1_auth_log_step1(bool isKeyB, bool isNested, uint8_t block, uint8_t *nonce);
+void append_mf1_auth_log_step2(uint8_t *nr, uint8_t *ar);
+void append_mf1_auth_log_step3(bool is_auth_success);
+
+#define RECORD_MAX      NFC_TAG_MF1_LOG_RECORD_MAX
+#define LOG_SIZE        sizeof(nfc_tag_mf1_auth_log_t)
+
+static nfc_tag_mf1_auth_log_t m_read[RECORD_MAX + 1];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void put32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+}
+
+// a record told apart from the others by its number
+static nfc_tag_mf1_auth_log_t make_log(uint32_t n, uint32_t uid) {
+    nfc_tag_mf1_auth_log_t log;
+    memset(&log, 0, sizeof(log));
+    log.block = n * 7;
+    log.is_key_b = n & 1;
+    log.is_nested = (n >> 1) & 1;
+    put32(log.uid, uid);
+    put32(log.nt, n * 2654435761u);
+    put32(log.nr, n ^ 0x5A5A5A5A);
+    put32(log.ar, n + 0x01020304);
+    return log;
+}
+
+static bool read_all(uint32_t count) {
+    memset(m_read, 0xEE, sizeof(m_read));
+    nfc_tag_mf1_log_copy(0, (uint8_t *)m_read, count * LOG_SIZE);
+    return nfc_tag_mf1_log_count() == count;
+}
+
+static void test_append_and_duplicates(void) {
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_STOP);
+    nfc_tag_mf1_log_clear();
+    for (uint32_t n = 0; n < 100; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        CHECK(nfc_tag_mf1_log_append(&log), "record %u not stored", n);
+    }
+    // a reader retrying the same authentications
+    for (uint32_t n = 0; n < 100; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        CHECK(!nfc_tag_mf1_log_append(&log), "duplicate of record %u stored", n);
+    }
+    // the same authentication of another card is not a duplicate
+    nfc_tag_mf1_auth_log_t other = make_log(5, 0x01020304);
+    CHECK(nfc_tag_mf1_log_append(&other), "record of another UID not stored");
+
+    uint32_t duplicates, dropped;
+    nfc_tag_mf1_log_get_stats(&duplicates, &dropped);
+    CHECK(duplicates == 100 && dropped == 0, "%u duplicates and %u dropped, expected 100 and 0", duplicates, dropped);
+    CHECK(read_all(101), "%u records, expected 101", nfc_tag_mf1_log_count());
+    uint32_t mismatches = 0;
+    for (uint32_t n = 0; n < 100; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        mismatches += memcmp(&m_read[n], &log, LOG_SIZE) != 0;
+    }
+    mismatches += memcmp(&m_read[100], &other, LOG_SIZE) != 0;
+    CHECK(mismatches == 0, "%u records read back differ", mismatches);
+
+    // from any byte offset, as the stream and the pages of the command ask for them
+    uint8_t bytes[64];
+    for (uint32_t offset = 0; offset < 101 * LOG_SIZE - sizeof(bytes); offset += 13) {
+        nfc_tag_mf1_log_copy(offset, bytes, sizeof(bytes));
+        if (memcmp(bytes, (uint8_t *)m_read + offset, sizeof(bytes)) != 0) {
+            CHECK(false, "bytes from offset %u differ", offset);
+            break;
+        }
+    }
+}
+
+static void test_policies(void) {
+    uint32_t duplicates, dropped;
+
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_STOP);
+    nfc_tag_mf1_log_clear();
+    for (uint32_t n = 0; n < RECORD_MAX + 300; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        nfc_tag_mf1_log_append(&log);
+    }
+    nfc_tag_mf1_log_get_stats(&duplicates, &dropped);
+    CHECK(dropped == 300, "stop policy: %u dropped, expected 300", dropped);
+    CHECK(read_all(RECORD_MAX), "stop policy: %u records", nfc_tag_mf1_log_count());
+    nfc_tag_mf1_auth_log_t first = make_log(0, 0xDEADBEEF);
+    nfc_tag_mf1_auth_log_t last = make_log(RECORD_MAX - 1, 0xDEADBEEF);
+    CHECK(memcmp(&m_read[0], &first, LOG_SIZE) == 0 && memcmp(&m_read[RECORD_MAX - 1], &last, LOG_SIZE) == 0,
+          "stop policy: the first records are not kept");
+
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_OVERWRITE);
+    nfc_tag_mf1_log_clear();
+    CHECK(nfc_tag_mf1_log_get_policy() == NFC_TAG_MF1_LOG_POLICY_OVERWRITE, "the policy does not survive a clear");
+    const uint32_t total = 3 * RECORD_MAX + 123;
+    for (uint32_t n = 0; n < total; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        nfc_tag_mf1_log_append(&log);
+    }
+    CHECK(read_all(RECORD_MAX), "overwrite policy: %u records", nfc_tag_mf1_log_count());
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < RECORD_MAX; i++) {
+        nfc_tag_mf1_auth_log_t log = make_log(total - RECORD_MAX + i, 0xDEADBEEF);
+        mismatches += memcmp(&m_read[i], &log, LOG_SIZE) != 0;
+    }
+    CHECK(mismatches == 0, "overwrite policy: %u records are not the last ones in order", mismatches);
+    // an overwritten record is not a duplicate anymore
+    nfc_tag_mf1_auth_log_t old = make_log(0, 0xDEADBEEF);
+    CHECK(nfc_tag_mf1_log_append(&old), "overwrite policy: a record gone from the log is taken as a duplicate");
+}
+
+/**
+ * The detection log command copies the log twice, for the crc32 and for the frames, while the NFCT interrupt
+ * appends: held, a full log of the overwrite policy drops the new records instead of moving its head.
+ */
+static void test_hold(void) {
+    static nfc_tag_mf1_auth_log_t before[RECORD_MAX];
+    uint32_t duplicates, dropped;
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_OVERWRITE);
+    nfc_tag_mf1_log_clear();
+    uint32_t n = 0;
+    for (; n < RECORD_MAX - 10; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        nfc_tag_mf1_log_append(&log);
+    }
+    nfc_tag_mf1_log_hold(true);
+    uint32_t count = nfc_tag_mf1_log_count();
+    nfc_tag_mf1_log_copy(0, (uint8_t *)before, count * LOG_SIZE);
+    for (uint32_t i = 0; i < 100; i++, n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+        nfc_tag_mf1_log_append(&log);
+    }
+    CHECK(read_all(count), "held: %u records, %u when held", nfc_tag_mf1_log_count(), count);
+    CHECK(memcmp(m_read, before, count * LOG_SIZE) == 0, "held: the records changed");
+    nfc_tag_mf1_log_get_stats(&duplicates, &dropped);
+    CHECK(dropped == 90, "held: %u dropped, expected 90", dropped);
+
+    nfc_tag_mf1_log_hold(false);
+    CHECK(read_all(RECORD_MAX), "released: %u records", nfc_tag_mf1_log_count());
+    nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+    CHECK(nfc_tag_mf1_log_append(&log), "released: a full log does not overwrite");
+    nfc_tag_mf1_auth_log_t second = make_log(1, 0xDEADBEEF);
+    CHECK(read_all(RECORD_MAX) && memcmp(&m_read[0], &second, LOG_SIZE) == 0, "released: the oldest record is kept");
+}
+
+static void test_uid_table(void) {
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_OVERWRITE);
+    nfc_tag_mf1_log_clear();
+    for (uint32_t uid = 0; uid < NFC_TAG_MF1_LOG_UID_MAX; uid++) {
+        nfc_tag_mf1_auth_log_t log = make_log(uid, 0x10000000 + uid);
+        nfc_tag_mf1_log_append(&log);
+    }
+    nfc_tag_mf1_auth_log_t extra = make_log(1000, 0x20000000);
+    CHECK(!nfc_tag_mf1_log_append(&extra), "a 17th UID stored while the 16 others are in use");
+
+    // once the records of the first UIDs are overwritten, their entries take new UIDs
+    for (uint32_t n = 0; n < RECORD_MAX; n++) {
+        nfc_tag_mf1_auth_log_t log = make_log(5000 + n, 0x1000000F);
+        nfc_tag_mf1_log_append(&log);
+    }
+    CHECK(nfc_tag_mf1_log_append(&extra), "a new UID not stored once the table has unused entries");
+    CHECK(read_all(RECORD_MAX), "UID table: %u records", nfc_tag_mf1_log_count());
+    CHECK(memcmp(&m_read[RECORD_MAX - 1], &extra, LOG_SIZE) == 0 && memcmp(m_read[RECORD_MAX - 2].uid, "\x10\x00\x00\x0F", 4) == 0,
+          "UID table: the UIDs read back differ");
+}
+
+static void test_emulation_steps(uint8_t *data) {
+    nfc_tag_mf1_information_t *info = (nfc_tag_mf1_information_t *)data;
+    static const uint8_t nt[4] = { 0x01, 0x20, 0x01, 0x45 };
+    static const uint8_t nr[4] = { 0xAA, 0xBB, 0xCC, 0xDD };
+    static const uint8_t ar[4] = { 0x11, 0x22, 0x33, 0x44 };
+
+    // the UID the reader selected, the 14a layer asks for it at the anticollision
+    get_mifare_coll_res();
+    nfc_tag_mf1_log_clear();
+    nfc_tag_mf1_set_detection_enable(true);
+    for (int retry = 0; retry < 3; retry++) {
+        append_mf1_auth_log_step1(true, true, 9, (uint8_t *)nt);
+        append_mf1_auth_log_step2((uint8_t *)nr, (uint8_t *)ar);
+        append_mf1_auth_log_step3(false);
+    }
+    CHECK(read_all(1), "%u records from 3 equal authentications, expected 1", nfc_tag_mf1_log_count());
+    CHECK(m_read[0].block == 9 && m_read[0].is_key_b && m_read[0].is_nested && memcmp(m_read[0].uid, info->res_coll.uid, 4) == 0
+          && memcmp(m_read[0].nt, nt, 4) == 0 && memcmp(m_read[0].nr, nr, 4) == 0 && memcmp(m_read[0].ar, ar, 4) == 0,
+          "record of the authentication steps");
+
+    nfc_tag_mf1_set_detection_enable(false);
+    append_mf1_auth_log_step1(false, false, 4, (uint8_t *)nt);
+    append_mf1_auth_log_step2((uint8_t *)ar, (uint8_t *)nr);
+    append_mf1_auth_log_step3(false);
+    CHECK(nfc_tag_mf1_log_count() == 1, "record stored with the detection disabled");
+}
+
+static void density_and_benchmark(void) {
+    printf("detection log in %u bytes: %u records of %u bytes, was %u of %u bytes\n", (unsigned)NFC_TAG_MF1_LOG_RAM_SIZE,
+           (unsigned)RECORD_MAX, (unsigned)sizeof(nfc_tag_mf1_log_record_t), 1000, (unsigned)LOG_SIZE);
+    // readers retry: every authentication three times, the log holds three times as many authentications
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_STOP);
+    nfc_tag_mf1_log_clear();
+    uint32_t authentications = 0;
+    for (uint32_t n = 0; nfc_tag_mf1_log_count() < RECORD_MAX; n++) {
+        for (int retry = 0; retry < 3; retry++) {
+            nfc_tag_mf1_auth_log_t log = make_log(n, 0xDEADBEEF);
+            nfc_tag_mf1_log_append(&log);
+            authentications++;
+        }
+    }
+    printf("with 3 tries of each authentication: %u authentications logged, was 1000\n", authentications);
+
+    const int rounds = 1000000;
+    nfc_tag_mf1_log_set_policy(NFC_TAG_MF1_LOG_POLICY_OVERWRITE);
+    nfc_tag_mf1_log_clear();
+    uint64_t start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        nfc_tag_mf1_auth_log_t log = make_log(i, 0xDEADBEEF);
+        nfc_tag_mf1_log_append(&log);
+    }
+    printf("append: %.1f ns per record\n", (double)(now_ns() - start) / rounds);
+}
+
+int main(void) {
+    static uint8_t data[sizeof(nfc_tag_mf1_information_t)];
+    uint16_t length;
+    nfct_sim_init();
+    CHECK(nfc_tag_mf1_data_factory(0, TAG_TYPE_MIFARE_1024), "MF1 factory data");
+    memcpy(data, nfct_sim_fds_record(&length), length);
+    tag_data_buffer_t buffer = { .length = sizeof(data), .buffer = data };
+    nfc_tag_mf1_data_loadcb(TAG_TYPE_MIFARE_1024, &buffer);
+
+    CHECK(nfc_tag_mf1_log_count() == 0 && nfc_tag_mf1_log_get_policy() == NFC_TAG_MF1_LOG_POLICY_STOP,
+          "a new log is not empty with the stop policy");
+    CHECK(sizeof(nfc_tag_mf1_log_header_t) + RECORD_MAX * (sizeof(nfc_tag_mf1_log_record_t) + 1) <= NFC_TAG_MF1_LOG_RAM_SIZE,
+          "the log is larger than the former one");
+    test_append_and_duplicates();
+    test_policies();
+    test_hold();
+    test_uid_table();
+    test_emulation_steps(data);
+    density_and_benchmark();
+
+    return test_result("test_mf1_detection_log");
+}
@@ -0,0 +1,331 @@
+/**
+ * Host test of the MIFARE Classic attacks and tools of the reader (rfid/reader/hf/mf1_toolbox.c) running on
+ * rc522.c against a simulated RC522 and virtual cards (sim/), in simulated time: PRNG detection, darkside,
+ * nested, static nested, hardnested and static encrypted nonces acquisition, check keys and sectors read, and the
+ * CRC of the RC522 when it gives none.
+ * The results are checked against the keys of the card. Prints the simulated nonces per second and the RF
+ * exchanges per checked key, the simulation is deterministic and so are these numbers.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mf1_toolbox.h"
+#include "rc522.h"
+#include "app_status.h"
+#include "crc_utils.h"
+#include "bsp_delay.h"
+#include "hex_utils.h"
+#include "parity.h"
+#include "sim/mf1_card_sim.h"
+#include "sim/rc522_sim.h"
+#include "test_util.h"
+
+#define KEY_KNOWN       0xFFFFFFFFFFFFULL
+#define KEY_TARGET      0x4D3A99C351DDULL
+
+static const uint8_t m_uid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+static mf1_card_sim_t m_card;
+
+static uint32_t uid_u32(void) {
+    return bytes_to_num((uint8_t *)m_uid, 4);
+}
+
+// a card with the target key as key A and B of sector 1, on a reader just powered
+static void setup(mf1_card_prng_t prng) {
+    mf1_card_sim_init(&m_card, m_uid, 16, prng);
+    mf1_card_sim_set_key(&m_card, 1, 0, KEY_TARGET);
+    mf1_card_sim_set_key(&m_card, 1, 1, KEY_TARGET);
+    rc522_sim_init(&m_card);
+    pcd_14a_reader_init();
+    pcd_14a_reader_reset();
+    pcd_14a_reader_antenna_on();
+    bsp_delay_ms(8);
+}
+
+static double elapsed_s(uint64_t from_ns) {
+    return (rc522_sim_stats()->now_ns - from_ns) / 1e9;
+}
+
+// the nonce of a nested authentication, decrypted with the key of the target
+static uint32_t nested_nonce(uint64_t key, uint32_t nt_enc) {
+    struct Crypto1State cs;
+    crypto1_init(&cs, key);
+    return crypto1_word(&cs, nt_enc ^ uid_u32(), 1) ^ nt_enc;
+}
+
+static bool prng_reaches(uint32_t from, uint32_t to) {
+    for (uint32_t n = 0; n < 65536; n++) {
+        if (prng_successor(from, n) == to) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_prng_type(void) {
+    static const struct {
+        mf1_card_prng_t card;
+        mf1_prng_type_t expected;
+    } cases[] = {
+        { MF1_CARD_PRNG_WEAK, PRNG_WEAK },
+        { MF1_CARD_PRNG_STATIC, PRNG_STATIC },
+        { MF1_CARD_PRNG_HARD, PRNG_HARD },
+        { MF1_CARD_PRNG_FM11RF08S, PRNG_HARD },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        setup(cases[i].card);
+        mf1_prng_type_t type = 0xFF;
+        uint8_t status = check_prng_type(&type);
+        CHECK(status == STATUS_HF_TAG_OK, "prng type %zu: status %02X", i, status);
+        CHECK(type == cases[i].expected, "prng type %zu: %d instead of %d", i, type, cases[i].expected);
+    }
+}
+
+/**
+ * The keystream of each NACK must be the one of the key, on the nonce and reader nonces darkside reports.
+ */
+static void test_darkside(void) {
+    DarksideCore_t dc;
+    mf1_darkside_status_t darkside_status = 0xFF;
+    setup(MF1_CARD_PRNG_WEAK);
+    mf1_card_sim_set_key(&m_card, 0, 0, KEY_TARGET);
+    uint64_t start_ns = rc522_sim_stats()->now_ns;
+    uint8_t status = darkside_recover_key(3, PICC_AUTHENT1A, true, 30, &dc, &darkside_status);
+    CHECK(status == STATUS_HF_TAG_OK && darkside_status == DARKSIDE_OK, "darkside: status %02X/%d", status, darkside_status);
+    CHECK(memcmp(dc.uid, m_uid, 4) == 0, "darkside: uid");
+    uint32_t nt = bytes_to_num(dc.nt, 4);
+    for (int i = 0; i < 8; i++) {
+        struct Crypto1State cs;
+        crypto1_init(&cs, KEY_TARGET);
+        crypto1_word(&cs, uid_u32() ^ nt, 0);
+        for (int j = 0; j < 4; j++) {
+            uint8_t nr = j == 3 ? (dc.nr[3] & 0x1F) | (i << 5) : dc.nr[j];
+            crypto1_byte(&cs, nr, 1);
+        }
+        crypto1_word(&cs, 0, 0);
+        uint8_t ks = 0;
+        for (int bit = 0; bit < 4; bit++) {
+            ks |= crypto1_bit(&cs, 0, 0) << bit;
+        }
+        CHECK((dc.ks_list[i] & 0x0F) == ks, "darkside: keystream %d %X instead of %X", i, dc.ks_list[i] & 0x0F, ks);
+    }
+    printf("  darkside: %.2f s, %u frames\n", elapsed_s(start_ns), rc522_sim_stats()->rf_frames);
+}
+
+static void test_nested(void) {
+    mf1_nested_core_t ncs[SETS_NR];
+    uint8_t key[6], uid[4];
+    uint32_t distance = 0;
+    setup(MF1_CARD_PRNG_WEAK);
+    num_to_bytes(KEY_KNOWN, 6, key);
+    uint8_t status = nested_distance_detect(0, PICC_AUTHENT1A, key, uid, &distance);
+    CHECK(status == STATUS_HF_TAG_OK, "nested distance: status %02X", status);
+    CHECK(memcmp(uid, m_uid, 4) == 0, "nested distance: uid");
+    CHECK(distance > 0 && distance < 65535, "nested distance: %u", distance);
+
+    status = nested_recover_key(KEY_KNOWN, 0, PICC_AUTHENT1A, 4, PICC_AUTHENT1A, ncs);
+    CHECK(status == STATUS_HF_TAG_OK, "nested: status %02X", status);
+    for (int i = 0; i < SETS_NR; i++) {
+        uint32_t nt1 = bytes_to_num(ncs[i].nt1, 4);
+        uint32_t nt2 = nested_nonce(KEY_TARGET, bytes_to_num(ncs[i].nt2, 4));
+        CHECK(prng_reaches(nt1, nt2), "nested %d: %08X does not follow %08X", i, nt2, nt1);
+    }
+}
+
+static void test_static_nested(void) {
+    mf1_static_nested_core_t sncs;
+    setup(MF1_CARD_PRNG_STATIC);
+    uint8_t status = static_nested_recover_key(KEY_KNOWN, 0, PICC_AUTHENT1A, 4, PICC_AUTHENT1B, &sncs);
+    CHECK(status == STATUS_HF_TAG_OK, "static nested: status %02X", status);
+    CHECK(memcmp(sncs.uid, m_uid, 4) == 0, "static nested: uid");
+    for (int i = 0; i < 2; i++) {
+        uint32_t nt1 = bytes_to_num(sncs.core[i].nt1, 4);
+        uint32_t nt2 = nested_nonce(KEY_TARGET, bytes_to_num(sncs.core[i].nt2, 4));
+        CHECK(nt1 == m_card.seed && nt2 == m_card.seed, "static nested %d: %08X %08X", i, nt1, nt2);
+    }
+}
+
+static void test_hardnested(void) {
+    uint8_t nonces[9 * 16];
+    uint8_t count = 0;
+    setup(MF1_CARD_PRNG_HARD);
+    uint64_t start_ns = rc522_sim_stats()->now_ns;
+    uint8_t status = mf1_hardnested_nonces_acquire(false, 0, PICC_AUTHENT1A, KEY_KNOWN, 4, PICC_AUTHENT1A, nonces, sizeof(nonces), &count);
+    CHECK(status == STATUS_HF_TAG_OK, "hardnested: status %02X", status);
+    CHECK(count == 32, "hardnested: %u nonces", count);
+    // each record: two encrypted nonces then their parity bits
+    for (int i = 0; i < count; i++) {
+        const uint8_t *record = &nonces[i / 2 * 9];
+        uint32_t nt_enc = bytes_to_num((uint8_t *)&record[i % 2 * 4], 4);
+        uint8_t par = i % 2 ? record[8] & 0x0F : record[8] >> 4;
+        // the parity bits are encrypted with the first bit of keystream after each byte
+        uint32_t nt = nested_nonce(KEY_TARGET, nt_enc);
+        struct Crypto1State cs;
+        crypto1_init(&cs, KEY_TARGET);
+        uint8_t expected = 0;
+        for (int j = 0; j < 4; j++) {
+            crypto1_byte(&cs, (nt_enc ^ uid_u32()) >> (24 - 8 * j), 1);
+            expected |= (oddparity8(nt >> (24 - 8 * j)) ^ filter(cs.odd)) << (3 - j);
+        }
+        CHECK(par == expected, "hardnested %d: parity %X instead of %X", i, par, expected);
+    }
+    printf("  hardnested: %.1f nonces/s\n", count / elapsed_s(start_ns));
+}
+
+static void test_static_encrypted_nonces(void) {
+    static uint8_t sector_data[40][sizeof(mf1_static_nonce_sector_t)];
+    uint8_t acquired = 0;
+    uint32_t uid = 0;
+    setup(MF1_CARD_PRNG_FM11RF08S);
+    uint64_t start_ns = rc522_sim_stats()->now_ns;
+    uint8_t status = mf1_static_encrypted_nonces_acquire(m_card.backdoor_key, 16, 0, sector_data, &acquired, &uid);
+    CHECK(status == STATUS_HF_TAG_OK, "static encrypted: status %02X", status);
+    CHECK(acquired == 16 && uid == uid_u32(), "static encrypted: %u sectors, uid %08X", acquired, uid);
+    for (uint8_t sector = 0; sector < acquired; sector++) {
+        const mf1_static_nonce_sector_t *nonces = (const mf1_static_nonce_sector_t *)sector_data[sector];
+        for (uint8_t key_type = 0; key_type < 2; key_type++) {
+            const mf1_static_nonce_keytype_t *keytype = key_type ? &nonces->key_b : &nonces->key_a;
+            uint32_t expected = mf1_card_sim_static_nonce(&m_card, sector, key_type);
+            uint64_t key = mf1_card_sim_get_key(&m_card, sector, key_type);
+            CHECK(bytes_to_num((uint8_t *)keytype->nt_first_half, 2) == expected >> 16,
+                  "static encrypted %u/%u: first half", sector, key_type);
+            CHECK(nested_nonce(key, bytes_to_num((uint8_t *)keytype->nt_enc, 4)) == expected,
+                  "static encrypted %u/%u: nonce", sector, key_type);
+        }
+    }
+    printf("  static encrypted nonces: %.1f nonces/s\n", acquired * 2 / elapsed_s(start_ns));
+}
+
+static mf1_toolbox_check_keys_hit_t m_hits[80];
+static int m_hits_count;
+
+static void on_hits(mf1_toolbox_check_keys_hit_t *hits, uint8_t count) {
+    for (int i = 0; i < count && m_hits_count < 80; i++) {
+        m_hits[m_hits_count++] = hits[i];
+    }
+}
+
+/**
+ * Keys of a 1K card checked against a large dictionary with duplicates, the known key in its middle and the target key
+ * of sector 1 at its end: a wrong key costs a timeout of the reader, the key of sector 0 is tried first on the next ones.
+ */
+static void test_check_keys(void) {
+    static mf1_toolbox_check_keys_of_sectors_out_t out;
+    static mf1_key_t keys[MF1_TOOLBOX_CHECK_KEYS_MAX];
+    const uint16_t keys_len = 300;
+    setup(MF1_CARD_PRNG_WEAK);
+    for (int i = 0; i < keys_len; i++) {
+        num_to_bytes(0xA0A1A2A3A4A0ULL + i % 250, 6, keys[i].key);
+    }
+    num_to_bytes(KEY_KNOWN, 6, keys[120].key);
+    num_to_bytes(KEY_KNOWN, 6, keys[121].key);
+    num_to_bytes(KEY_TARGET, 6, keys[249].key);
+    mf1_toolbox_check_keys_of_sectors_in_t in = { .keys_len = keys_len, .keys = keys, .on_hits = on_hits };
+    memset(in.mask.b, 0x00, sizeof(in.mask.b));
+    memset(&in.mask.b[4], 0xFF, 6);         // sectors 16 to 39 are not on the card
+    m_hits_count = 0;
+
+    rc522_sim_stats_t before = *rc522_sim_stats();
+    uint32_t auths = m_card.auths;
+    uint16_t status = mf1_toolbox_check_keys_of_sectors(&in, &out);
+    CHECK(status == STATUS_HF_TAG_OK, "check keys: status %04X", status);
+    CHECK(in.keys_len == 249, "check keys: %u unique keys", in.keys_len);
+    CHECK(bytes_to_num(keys[0].key, 6) == KEY_KNOWN && bytes_to_num(keys[1].key, 6) == KEY_TARGET, "check keys: hits first");
+    CHECK(m_hits_count == 32, "check keys: %d hits", m_hits_count);
+    for (uint8_t sector = 0; sector < 16; sector++) {
+        uint8_t found = (out.found.b[sector / 4] >> (6 - sector % 4 * 2)) & 0b11;
+        uint64_t expected = sector == 1 ? KEY_TARGET : KEY_KNOWN;
+        CHECK(found == 0b11, "check keys %u: found %u", sector, found);
+        CHECK(bytes_to_num(out.keys[sector][0].key, 6) == expected && bytes_to_num(out.keys[sector][1].key, 6) == expected,
+              "check keys %u: keys", sector);
+        for (uint8_t key_type = 0; key_type < 2 && sector * 2 + key_type < m_hits_count; key_type++) {
+            mf1_toolbox_check_keys_hit_t *hit = &m_hits[sector * 2 + key_type];
+            CHECK(hit->sector == sector && hit->key_type == PICC_AUTHENT1A + key_type && bytes_to_num(hit->key.key, 6) == expected,
+                  "check keys %u: hit %u", sector, key_type);
+        }
+    }
+    rc522_sim_stats_t *after = rc522_sim_stats();
+    auths = m_card.auths - auths;
+    printf("  check keys: %u keys, %u authentications in %.2f s, %.1f RF exchanges and %.1f SPI sessions per authentication,"
+           " %u timeouts\n", keys_len, auths, (after->now_ns - before.now_ns) / 1e9, (double)(after->rf_frames - before.rf_frames) / auths,
+           (double)(after->spi_sessions - before.spi_sessions) / auths, after->timeouts - before.timeouts);
+}
+
+static void test_read_sectors(void) {
+    static mf1_toolbox_read_sectors_block_t out[256];
+    mf1_toolbox_read_sectors_keys_t keys[2];
+    uint16_t out_len = 0;
+    setup(MF1_CARD_PRNG_WEAK);
+    for (int i = 0; i < 4; i++) {
+        memset(m_card.blocks[4 + i < 7 ? 4 + i : 8 + i], 0x11 * (i + 1), 16);
+    }
+    num_to_bytes(KEY_TARGET, 6, keys[0].key_a.key);
+    num_to_bytes(KEY_TARGET, 6, keys[0].key_b.key);
+    num_to_bytes(KEY_KNOWN, 6, keys[1].key_a.key);
+    num_to_bytes(KEY_KNOWN, 6, keys[1].key_b.key);
+    mf1_toolbox_read_sectors_in_t in = { .keys_len = 2, .keys = keys };
+    memset(in.mask.b, 0x00, sizeof(in.mask.b));
+    in.mask.b[0] = 0b00110010;              // keys A and B of sector 1, key A of sector 3
+    // a block key A can not read, read again with key B after the tag is selected again, without a field restart
+    m_card.key_a_refused_block = 5;
+
+    uint32_t resets = rc522_sim_stats()->resets;
+    uint16_t status = mf1_toolbox_read_sectors(&in, out, &out_len);
+    CHECK(status == STATUS_HF_TAG_OK, "read sectors: status %04X", status);
+    CHECK(rc522_sim_stats()->resets == resets, "read sectors: %u field restarts", rc522_sim_stats()->resets - resets);
+    CHECK(out_len == 8, "read sectors: %u blocks", out_len);
+    for (int i = 0; i < out_len; i++) {
+        uint8_t block = i < 4 ? 4 + i : 12 + i - 4;
+        uint8_t expected[16];
+        memcpy(expected, m_card.blocks[block], 16);
+        if (block % 4 == 3) {
+            memset(expected, 0x00, 6);      // key A is never read
+        }
+        CHECK(out[i].status == STATUS_HF_TAG_OK, "read sectors: block %u status %02X", block, out[i].status);
+        CHECK(memcmp(out[i].data, expected, 16) == 0, "read sectors: block %u data", block);
+    }
+
+    // more keys than the sectors selected, as many as a frame holds: the count must not wrap to the right one
+    in.keys_len = 256 + 2;
+    status = mf1_toolbox_read_sectors(&in, out, &out_len);
+    CHECK(status == STATUS_PAR_ERR, "read sectors: %u keys for 2 sectors, status %04X", in.keys_len, status);
+}
+
+// The CRC of the RC522, and of the MCU when the RC522 gives none: not later than two ticks of the timeout timer
+static void test_calc_crc(void) {
+    uint8_t data[] = { PICC_READ, 0x04 };
+    uint8_t expected[2];
+    uint8_t crc[2];
+    calc_14a_crc_lut(data, sizeof(data), expected);
+    setup(MF1_CARD_PRNG_WEAK);
+    pcd_14a_reader_calc_crc(data, sizeof(data), crc);
+    CHECK(memcmp(crc, expected, 2) == 0, "calc crc: %02X%02X instead of %02X%02X", crc[0], crc[1], expected[0], expected[1]);
+
+    // CRCResultReg keeps the CRC of the first block
+    data[1] = 0x08;
+    calc_14a_crc_lut(data, sizeof(data), expected);
+    rc522_sim_crc_stall(true);
+    uint64_t start_ns = rc522_sim_stats()->now_ns;
+    pcd_14a_reader_calc_crc(data, sizeof(data), crc);
+    double waited_s = elapsed_s(start_ns);
+    rc522_sim_crc_stall(false);
+    CHECK(memcmp(crc, expected, 2) == 0, "calc crc timeout: %02X%02X instead of %02X%02X", crc[0], crc[1], expected[0],
+          expected[1]);
+    CHECK(waited_s >= 0.010 && waited_s <= 0.021, "calc crc timeout after %.1f ms", waited_s * 1e3);
+}
+
+int main(void) {
+    printf("MIFARE Classic toolbox on the simulated RC522:\n");
+    test_prng_type();
+    test_darkside();
+    test_nested();
+    test_static_nested();
+    test_hardnested();
+    test_static_encrypted_nonces();
+    test_check_keys();
+    test_read_sectors();
+    test_calc_crc();
+
+    return test_result("test_mf1_toolbox");
+}
@@ -0,0 +1,166 @@
+/**
+ * Host test of the NUS transmit queue (utils/tx_ring.c) with a model of the softdevice:
+ * a notification queue of a few packets, emptied once per connection event.
+ * Checks the byte stream and the flow control, then prints the throughput for a few link setups
+ * and how long the command handler was blocked by a single frame with the previous busy-wait loop.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tx_ring.h"
+#include "netdata.h"
+#include "test_util.h"
+
+// largest frame: the header, NETDATA_MAX_DATA_LENGTH bytes of data and the LRC
+#define FRAME_SIZE      (sizeof(netdata_frame_preamble_t) + NETDATA_MAX_DATA_LENGTH + sizeof(netdata_frame_postamble_t))
+#define RING_SIZE       (2 * FRAME_SIZE)    // same as NUS_TX_RING_SIZE in ble_main.c
+#define STREAM_FRAMES   32
+
+// softdevice model
+static struct {
+    uint16_t queue_size;        // notifications the softdevice accepts before NRF_ERROR_RESOURCES
+    uint16_t queued;
+    uint16_t chunk_max;
+    uint8_t *received;          // what the peer got, in order
+    uint32_t received_length;
+    uint32_t short_chunks;      // chunks smaller than chunk_max
+} m_sd;
+
+static bool sd_send(uint8_t *data, uint16_t length) {
+    if (m_sd.queued == m_sd.queue_size) {
+        return false;
+    }
+    // the softdevice copies the notification
+    memcpy(&m_sd.received[m_sd.received_length], data, length);
+    m_sd.received_length += length;
+    m_sd.short_chunks += length < m_sd.chunk_max;
+    m_sd.queued++;
+    return true;
+}
+
+static void sd_reset(uint16_t queue_size, uint16_t chunk_max, uint8_t *received) {
+    memset(&m_sd, 0, sizeof(m_sd));
+    m_sd.queue_size = queue_size;
+    m_sd.chunk_max = chunk_max;
+    m_sd.received = received;
+}
+
+static void fill_pattern(uint8_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+}
+
+static void test_push_whole_frames(void) {
+    static uint8_t buffer[100];
+    uint8_t data[60] = {0};
+    tx_ring_t ring;
+    tx_ring_init(&ring, buffer, sizeof(buffer));
+    CHECK(tx_ring_push(&ring, data, 60), "first frame refused");
+    CHECK(!tx_ring_push(&ring, data, 41), "frame larger than the free room queued");
+    CHECK(tx_ring_used(&ring) == 60, "refused frame partially queued");
+    CHECK(tx_ring_push(&ring, data, 40), "frame filling the ring refused");
+    CHECK(tx_ring_free(&ring) == 0, "ring should be full");
+    tx_ring_reset(&ring);
+    CHECK(tx_ring_used(&ring) == 0, "reset ring not empty");
+}
+
+static void test_chunks_across_wrap(void) {
+    static uint8_t buffer[100];
+    static uint8_t received[1000];
+    uint8_t stream[1000];
+    uint8_t chunk[20];
+    fill_pattern(stream, sizeof(stream));
+    tx_ring_t ring;
+    tx_ring_init(&ring, buffer, sizeof(buffer));
+    sd_reset(0xFFFF, sizeof(chunk), received);
+
+    // odd frame sizes so that the chunks cross the end of the buffer at different offsets
+    uint32_t pushed = 0;
+    while (pushed < sizeof(stream)) {
+        uint16_t length = 37;
+        if (length > sizeof(stream) - pushed) {
+            length = sizeof(stream) - pushed;
+        }
+        CHECK(tx_ring_push(&ring, &stream[pushed], length), "push refused at %u", pushed);
+        pushed += length;
+        // keep a few bytes queued so the next drain starts mid-buffer
+        if (tx_ring_used(&ring) > 50) {
+            tx_ring_drain(&ring, chunk, sizeof(chunk), sd_send);
+        }
+    }
+    tx_ring_drain(&ring, chunk, sizeof(chunk), sd_send);
+    CHECK(m_sd.received_length == sizeof(stream), "received %u bytes", m_sd.received_length);
+    CHECK(memcmp(received, stream, sizeof(stream)) == 0, "stream corrupted");
+}
+
+static void test_drain_stops_when_refused(void) {
+    static uint8_t buffer[100];
+    static uint8_t received[100];
+    uint8_t data[90] = {0};
+    uint8_t chunk[20];
+    tx_ring_t ring;
+    tx_ring_init(&ring, buffer, sizeof(buffer));
+    sd_reset(2, sizeof(chunk), received);
+    tx_ring_push(&ring, data, sizeof(data));
+    CHECK(tx_ring_drain(&ring, chunk, sizeof(chunk), sd_send) == 40, "drain ignored the softdevice queue");
+    CHECK(tx_ring_used(&ring) == 50, "refused chunk left the queue");
+    m_sd.queued = 0;
+    CHECK(tx_ring_drain(&ring, chunk, sizeof(chunk), sd_send) == 40, "drain did not resume");
+}
+
+/**
+ * Stream STREAM_FRAMES full frames: the handler queues a frame as soon as there is room,
+ * each connection event sends up to packets_per_event notifications then reports them done,
+ * which feeds the next chunks (BLE_GATTS_EVT_HVN_TX_COMPLETE).
+ */
+static void simulate_link(double interval_ms, uint16_t mtu, uint16_t packets_per_event, uint16_t queue_size) {
+    static uint8_t buffer[RING_SIZE];
+    static uint8_t stream[FRAME_SIZE * STREAM_FRAMES];
+    static uint8_t received[FRAME_SIZE * STREAM_FRAMES];
+    uint8_t chunk[256];
+    uint16_t chunk_max = mtu - 3;
+    fill_pattern(stream, sizeof(stream));
+    tx_ring_t ring;
+    tx_ring_init(&ring, buffer, sizeof(buffer));
+    sd_reset(queue_size, chunk_max, received);
+
+    uint32_t frames = 0;
+    uint32_t events = 0;
+    uint32_t first_frame_events = 0;
+    while (m_sd.received_length < sizeof(stream)) {
+        while (frames < STREAM_FRAMES && tx_ring_push(&ring, &stream[frames * FRAME_SIZE], FRAME_SIZE)) {
+            frames++;
+        }
+        tx_ring_drain(&ring, chunk, chunk_max, sd_send);
+        // connection event: the peer gets up to packets_per_event notifications
+        events++;
+        m_sd.queued = m_sd.queued > packets_per_event ? m_sd.queued - packets_per_event : 0;
+        tx_ring_drain(&ring, chunk, chunk_max, sd_send);
+        if (first_frame_events == 0 && m_sd.received_length >= FRAME_SIZE) {
+            first_frame_events = events;
+        }
+    }
+    CHECK(memcmp(received, stream, sizeof(stream)) == 0, "stream corrupted (interval %.1f, mtu %u)", interval_ms, mtu);
+    CHECK(m_sd.short_chunks <= STREAM_FRAMES, "%u short chunks", m_sd.short_chunks);
+
+    double seconds = events * interval_ms / 1000;
+    printf("  interval %5.1f ms, mtu %3u, %2u packets/event, sd queue %2u: %6.1f kB/s, one frame busy-waited %6.0f ms\n",
+           interval_ms, mtu, packets_per_event, queue_size, sizeof(stream) / 1024.0 / seconds,
+           first_frame_events * interval_ms);
+}
+
+int main(void) {
+    test_push_whole_frames();
+    test_chunks_across_wrap();
+    test_drain_stops_when_refused();
+
+    printf("NUS queue model, %d frames of %d bytes:\n", STREAM_FRAMES, (int)FRAME_SIZE);
+    simulate_link(75, 23, 1, 1);
+    simulate_link(30, 247, 1, 1);
+    simulate_link(15, 247, 3, 4);
+    simulate_link(7.5, 247, 6, 8);
+
+    return test_result("test_nus_tx_ring");
+}
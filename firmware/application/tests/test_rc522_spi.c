@@ -0,0 +1,295 @@
+/**
+ * Host test of the RC522 register programs (rfid/reader/hf/rc522_spi.c) on a mock RC522:
+ * it decodes the SPI sessions like the chip, keeps its registers and FIFO, and answers a transceive
+ * with the response of a card. Checks the sessions the programs make, then compares the SPI traffic
+ * of a few card exchanges with the register accesses of pcd_14a_reader_bytes_transfer() before the programs.
+ * A program overfilled, in bytes or in sessions, must not run: the error check stops the firmware.
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "rc522_spi.h"
+#include "test_util.h"
+
+// SPI at 8 Mbps, estimated overheads of a chip select session and, for the polled SPI, of each byte
+#define SPI_BYTE_US             1.0
+#define SESSION_OVERHEAD_US     0.5
+#define POLLED_BYTE_OVERHEAD_US 0.3
+
+// mock RC522
+static struct {
+    uint8_t regs[64];
+    uint8_t fifo[DEF_FIFO_LENGTH];
+    uint8_t fifo_length;
+    uint8_t fifo_read;
+    // the card
+    uint8_t sent[DEF_FIFO_LENGTH];
+    uint8_t sent_length;
+    uint8_t sent_last_bits;
+    const uint8_t *response;
+    uint8_t response_length;
+    // bus
+    uint32_t sessions;
+    uint32_t bytes;
+} m_chip;
+
+static void chip_reset(const uint8_t *response, uint8_t response_length) {
+    memset(&m_chip, 0, sizeof(m_chip));
+    m_chip.response = response;
+    m_chip.response_length = response_length;
+}
+
+static void chip_transceive(void) {
+    memcpy(m_chip.sent, m_chip.fifo, m_chip.fifo_length);
+    m_chip.sent_length = m_chip.fifo_length;
+    m_chip.sent_last_bits = m_chip.regs[BitFramingReg] & 0x07;
+    memcpy(m_chip.fifo, m_chip.response, m_chip.response_length);
+    m_chip.fifo_length = m_chip.response_length;
+    m_chip.fifo_read = 0;
+    m_chip.regs[ComIrqReg] |= 0x30;     // RxIRq, IdleIRq
+    m_chip.regs[Control522Reg] = 0;
+}
+
+static void chip_write(uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case ComIrqReg:
+            // Set1 sets the marked bits, else they are cleared
+            m_chip.regs[reg] = (value & 0x80) ? (m_chip.regs[reg] | (value & 0x7F)) : (m_chip.regs[reg] & ~value);
+            break;
+        case FIFOLevelReg:
+            if (value & 0x80) {
+                m_chip.fifo_length = 0;
+                m_chip.fifo_read = 0;
+            }
+            break;
+        case FIFODataReg:
+            CHECK(m_chip.fifo_length < DEF_FIFO_LENGTH, "FIFO overflow");
+            m_chip.fifo[m_chip.fifo_length++] = value;
+            break;
+        case BitFramingReg:
+            m_chip.regs[reg] = value;
+            if ((value & 0x80) && m_chip.regs[CommandReg] == PCD_TRANSCEIVE) {
+                chip_transceive();
+            }
+            break;
+        default:
+            m_chip.regs[reg] = value;
+            break;
+    }
+}
+
+static uint8_t chip_read(uint8_t reg) {
+    switch (reg) {
+        case FIFOLevelReg:
+            return m_chip.fifo_length - m_chip.fifo_read;
+        case FIFODataReg:
+            return m_chip.fifo_read < m_chip.fifo_length ? m_chip.fifo[m_chip.fifo_read++] : 0;
+        default:
+            return m_chip.regs[reg];
+    }
+}
+
+static void chip_xfer(const uint8_t *tx, uint8_t *rx, uint16_t length) {
+    m_chip.sessions++;
+    m_chip.bytes += length;
+    uint8_t reg = (tx[0] >> 1) & 0x3F;
+    if (tx[0] & 0x80) {
+        // each byte answers the address sent before it, the last address byte is a dummy
+        rx[0] = 0;
+        for (uint16_t i = 1; i < length; i++) {
+            CHECK(tx[i - 1] & 0x80, "write address in a read session");
+            rx[i] = chip_read((tx[i - 1] >> 1) & 0x3F);
+        }
+    } else {
+        for (uint16_t i = 1; i < length; i++) {
+            chip_write(reg, tx[i]);
+        }
+    }
+}
+
+// register accesses of rc522.c before the programs: one session each, masks read then write
+static uint8_t legacy_read(uint8_t reg) {
+    uint8_t tx[2] = { ((reg << 1) & 0x7E) | 0x80, 0 }, rx[2];
+    chip_xfer(tx, rx, 2);
+    return rx[1];
+}
+
+static void legacy_write(uint8_t reg, uint8_t value) {
+    uint8_t tx[2] = { (reg << 1) & 0x7E, value }, rx[2];
+    chip_xfer(tx, rx, 2);
+}
+
+static void legacy_read_buffer(uint8_t reg, uint8_t *out, uint8_t length) {
+    uint8_t tx[DEF_FIFO_LENGTH + 1], rx[DEF_FIFO_LENGTH + 1];
+    memset(tx, ((reg << 1) & 0x7E) | 0x80, length + 1);
+    chip_xfer(tx, rx, length + 1);
+    memcpy(out, &rx[1], length);
+}
+
+static void legacy_write_buffer(uint8_t reg, const uint8_t *values, uint8_t length) {
+    uint8_t tx[DEF_FIFO_LENGTH + 1], rx[DEF_FIFO_LENGTH + 1];
+    tx[0] = (reg << 1) & 0x7E;
+    memcpy(&tx[1], values, length);
+    chip_xfer(tx, rx, length + 1);
+}
+
+static void legacy_set_mask(uint8_t reg, uint8_t mask) {
+    legacy_write(reg, legacy_read(reg) | mask);
+}
+
+static void legacy_clear_mask(uint8_t reg, uint8_t mask) {
+    legacy_write(reg, legacy_read(reg) & ~mask);
+}
+
+// pcd_14a_reader_bits_transfer() then pcd_14a_reader_bytes_transfer() before the programs, card answering at once
+static uint8_t legacy_transceive(const uint8_t *data, uint8_t length, uint8_t last_bits, uint8_t *out) {
+    if (last_bits) {
+        legacy_set_mask(BitFramingReg, last_bits);
+    }
+    legacy_write(CommandReg, PCD_IDLE);
+    legacy_clear_mask(ComIrqReg, 0x80);
+    legacy_set_mask(FIFOLevelReg, 0x80);
+    legacy_write_buffer(FIFODataReg, data, length);
+    legacy_write(CommandReg, PCD_TRANSCEIVE);
+    legacy_set_mask(BitFramingReg, 0x80);
+    while (!(legacy_read(ComIrqReg) & 0x30));
+    legacy_clear_mask(BitFramingReg, 0x80);
+    uint8_t n = legacy_read(FIFOLevelReg);
+    legacy_read(Control522Reg);
+    legacy_read_buffer(FIFODataReg, out, n);
+    if (last_bits) {
+        legacy_clear_mask(BitFramingReg, last_bits);
+    }
+    return n;
+}
+
+// the same with the programs of pcd_14a_reader_transfer()
+static uint8_t program_transceive(const uint8_t *data, uint8_t length, uint8_t last_bits, uint8_t *out) {
+    static rc522_program_t program;
+    rc522_program_init(&program);
+    rc522_program_command_start(&program, PCD_TRANSCEIVE, data, length, last_bits);
+    rc522_program_run(&program, chip_xfer);
+    while (!(legacy_read(ComIrqReg) & 0x30));
+    rc522_program_init(&program);
+    uint16_t result = rc522_program_command_end(&program, PCD_TRANSCEIVE);
+    rc522_program_run(&program, chip_xfer);
+    uint8_t n = program.rx[result + 1];
+    rc522_program_init(&program);
+    uint16_t index = rc522_program_read_buffer(&program, FIFODataReg, n);
+    rc522_program_run(&program, chip_xfer);
+    memcpy(out, &program.rx[index], n);
+    return n;
+}
+
+static void test_program_sessions(void) {
+    static rc522_program_t program;
+    const uint8_t fifo[3] = {0x30, 0x04, 0x26};
+    chip_reset(NULL, 0);
+    m_chip.regs[ErrorReg] = 0x11;
+    m_chip.regs[Control522Reg] = 0x22;
+    rc522_program_init(&program);
+    rc522_program_write(&program, CommandReg, PCD_IDLE);
+    rc522_program_write_buffer(&program, FIFODataReg, fifo, sizeof(fifo));
+    uint16_t error = rc522_program_read(&program, ErrorReg);
+    uint16_t level = rc522_program_read(&program, FIFOLevelReg);
+    uint16_t control = rc522_program_read(&program, Control522Reg);
+    uint16_t data = rc522_program_read_buffer(&program, FIFODataReg, 2);
+    rc522_program_write(&program, BitFramingReg, 0x00);
+    CHECK(program.sessions == 4, "%u sessions, the reads should share one", program.sessions);
+    rc522_program_run(&program, chip_xfer);
+    CHECK(m_chip.sessions == 4 && m_chip.bytes == 2 + 4 + 6 + 2, "%u sessions, %u bytes", m_chip.sessions, m_chip.bytes);
+    CHECK(program.rx[error] == 0x11 && program.rx[level] == 3 && program.rx[control] == 0x22, "registers read back wrong");
+    CHECK(program.rx[data] == 0x30 && program.rx[data + 1] == 0x04, "FIFO read back wrong");
+
+}
+
+// Whether running the program stops the firmware, APP_ERROR_CHECK_BOOL() aborting on the host
+static bool program_run_aborts(rc522_program_t *program) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        rc522_program_run(program, chip_xfer);
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+// A full program drops what does not fit instead of writing past its buffers, and does not run
+static void test_program_overflow(void) {
+    static rc522_program_t program;
+    uint8_t large[DEF_FIFO_LENGTH] = {0};
+    chip_reset(NULL, 0);
+    rc522_program_init(&program);
+    rc522_program_write_buffer(&program, FIFODataReg, large, sizeof(large));
+    CHECK(!program.overflow && !program_run_aborts(&program), "full FIFO write overflowed");
+    rc522_program_write_buffer(&program, FIFODataReg, large, sizeof(large));
+    CHECK(program.sessions == 1 && program.length == sizeof(large) + 1, "program overflow");
+    CHECK(program.overflow && program_run_aborts(&program), "overflowed program run");
+
+    // the reads that do not fit, after a full FIFO write
+    rc522_program_init(&program);
+    rc522_program_write_buffer(&program, FIFODataReg, large, sizeof(large));
+    rc522_program_read(&program, ErrorReg);
+    rc522_program_read_buffer(&program, FIFODataReg, RC522_PROGRAM_SIZE - sizeof(large) - 1);
+    CHECK(program.overflow && program_run_aborts(&program), "program of reads too long run");
+
+    rc522_program_init(&program);
+    for (int i = 0; i < RC522_PROGRAM_SESSIONS + 2; i++) {
+        rc522_program_write(&program, CommandReg, PCD_IDLE);
+    }
+    CHECK(program.sessions == RC522_PROGRAM_SESSIONS, "too many sessions");
+    CHECK(program.overflow && program_run_aborts(&program), "program of too many sessions run");
+    rc522_program_init(&program);
+    CHECK(!program.overflow, "overflow left after a new program");
+}
+
+static void compare_exchange(const char *name, const uint8_t *data, uint8_t length, uint8_t last_bits,
+                             const uint8_t *response, uint8_t response_length) {
+    uint8_t out[DEF_FIFO_LENGTH];
+    chip_reset(response, response_length);
+    uint8_t n = legacy_transceive(data, length, last_bits, out);
+    uint32_t legacy_sessions = m_chip.sessions, legacy_bytes = m_chip.bytes;
+    CHECK(n == response_length && memcmp(out, response, n) == 0, "%s: legacy response", name);
+
+    chip_reset(response, response_length);
+    n = program_transceive(data, length, last_bits, out);
+    CHECK(m_chip.sent_length == length && memcmp(m_chip.sent, data, length) == 0, "%s: card got other data", name);
+    CHECK(m_chip.sent_last_bits == last_bits, "%s: sent %u last bits", name, m_chip.sent_last_bits);
+    CHECK(n == response_length && memcmp(out, response, n) == 0, "%s: response", name);
+    CHECK(m_chip.regs[BitFramingReg] == 0, "%s: BitFramingReg left at 0x%02x", name, m_chip.regs[BitFramingReg]);
+    CHECK(m_chip.sessions < legacy_sessions, "%s: no session saved", name);
+
+    double legacy_us = legacy_sessions * SESSION_OVERHEAD_US + legacy_bytes * (SPI_BYTE_US + POLLED_BYTE_OVERHEAD_US);
+    double program_us = m_chip.sessions * SESSION_OVERHEAD_US + m_chip.bytes * SPI_BYTE_US;
+    printf("  %-22s polled %2u sessions %3u bytes %6.1f us, programs %2u sessions %3u bytes %6.1f us\n",
+           name, legacy_sessions, legacy_bytes, legacy_us, m_chip.sessions, m_chip.bytes, program_us);
+}
+
+int main(void) {
+    test_program_sessions();
+    test_program_overflow();
+
+    const uint8_t reqa[] = {0x26};
+    const uint8_t atqa[] = {0x04, 0x00};
+    const uint8_t read[] = {0x30, 0x04, 0x26, 0xEE};
+    uint8_t block[18];
+    for (int i = 0; i < 18; i++) {
+        block[i] = i * 17;
+    }
+    const uint8_t ack[] = {0x0A};
+    uint8_t write[18];
+    memcpy(write, block, sizeof(write));
+
+    printf("RC522 SPI traffic of one exchange with the card:\n");
+    compare_exchange("REQA (7 bits)", reqa, sizeof(reqa), 7, atqa, sizeof(atqa));
+    compare_exchange("MF1 READ", read, sizeof(read), 0, block, sizeof(block));
+    compare_exchange("MF1 WRITE data", write, sizeof(write), 0, ack, sizeof(ack));
+
+    return test_result("test_rc522_spi");
+}
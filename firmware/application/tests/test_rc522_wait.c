@@ -0,0 +1,142 @@
+/**
+ * Host test of the wait for the end of a RC522 command (rfid/reader/hf/rc522_wait.c) in simulated time:
+ * the command ends after the latency of the card, the RC522 then sets its interrupt request and,
+ * when the IRQ pin is routed, drives a falling edge. The MCU reads the register over SPI, or sleeps
+ * until the edge or the next tick of the 10 ms timeout timer. Checks the end, a spurious edge, a missed edge
+ * and a card that does not answer, and prints the register reads and the busy CPU time of polling and of the IRQ.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rc522.h"
+#include "rc522_wait.h"
+#include "test_util.h"
+
+#define READ_US         2.5     // one register read session at 8 Mbps
+#define WAKE_US         5.0     // interrupt entry, step and sleep again
+#define TICK_US         10000.0 // tick of the bsp timer, it adds 10 ms
+#define NEVER           1e12
+
+// simulated RC522 and clock
+static struct {
+    double now_us;
+    double busy_us;             // CPU awake
+    double done_us;             // the interrupt request is set
+    double edge_us;             // next edge of the IRQ pin
+    double spurious_us;         // an edge with no request set
+    uint8_t irq_bits;
+} m_sim;
+
+static uint8_t sim_read(uint8_t reg) {
+    m_sim.now_us += READ_US;
+    m_sim.busy_us += READ_US;
+    return m_sim.now_us >= m_sim.done_us ? m_sim.irq_bits : 0x00;
+}
+
+static uint32_t sim_elapsed_ms(void) {
+    return (uint32_t)(m_sim.now_us / TICK_US) * 10;
+}
+
+typedef struct {
+    rc522_wait_state_t state;
+    uint32_t reads;
+    double end_us;
+    double busy_us;
+} result_t;
+
+/**
+ * Run a wait like pcd_14a_reader_transfer() does, latency_us is the time until the request is set.
+ */
+static result_t run_wait(bool irq_mode, double latency_us, bool edge, double spurious_us, uint32_t timeout_ms) {
+    rc522_wait_t wait;
+    memset(&m_sim, 0, sizeof(m_sim));
+    m_sim.done_us = latency_us;
+    m_sim.edge_us = edge ? latency_us : NEVER;
+    m_sim.spurious_us = spurious_us;
+    m_sim.irq_bits = 0x30;
+    rc522_wait_start(&wait, ComIrqReg, 0x30, timeout_ms, irq_mode);
+    while (rc522_wait_step(&wait, sim_elapsed_ms(), sim_read) == RC522_WAIT_BUSY) {
+        if (!irq_mode) {
+            continue;
+        }
+        // sleep until the first of: an edge, the next timer tick
+        double next_tick = (double)((uint32_t)(m_sim.now_us / TICK_US) + 1) * TICK_US;
+        double wake = next_tick;
+        if (m_sim.spurious_us > m_sim.now_us && m_sim.spurious_us < wake) {
+            wake = m_sim.spurious_us;
+        }
+        if (m_sim.edge_us > m_sim.now_us && m_sim.edge_us < wake) {
+            wake = m_sim.edge_us;
+        }
+        m_sim.now_us = wake;
+        m_sim.busy_us += WAKE_US;
+        if (wake == m_sim.edge_us || wake == m_sim.spurious_us) {
+            rc522_wait_irq(&wait);
+        }
+    }
+    // the state holds, no more reads
+    uint32_t reads = wait.reads;
+    CHECK(rc522_wait_step(&wait, sim_elapsed_ms(), sim_read) == wait.state && wait.reads == reads, "step after the end");
+    CHECK(wait.state != RC522_WAIT_DONE || (wait.flags & 0x30), "done without the request bits");
+    return (result_t) { wait.state, wait.reads, m_sim.now_us, m_sim.busy_us };
+}
+
+static void test_completion(void) {
+    // REQA answered after ~100 us, an authentication after ~1 ms
+    const double latencies[] = {100, 1000, 9990, 12000};
+    for (size_t i = 0; i < sizeof(latencies) / sizeof(latencies[0]); i++) {
+        result_t poll = run_wait(false, latencies[i], true, NEVER, DEF_COM_TIMEOUT);
+        result_t irq = run_wait(true, latencies[i], true, NEVER, DEF_COM_TIMEOUT);
+        CHECK(poll.state == RC522_WAIT_DONE && irq.state == RC522_WAIT_DONE, "latency %.0f us not done", latencies[i]);
+        CHECK(poll.end_us - latencies[i] <= READ_US, "latency %.0f us: polling ends late", latencies[i]);
+        CHECK(irq.end_us - latencies[i] <= READ_US, "latency %.0f us: irq ends late", latencies[i]);
+        CHECK(irq.reads <= 1 + (uint32_t)(latencies[i] / TICK_US), "latency %.0f us: %u reads with irq", latencies[i], irq.reads);
+    }
+}
+
+static void test_spurious_edge(void) {
+    // an edge with no request set: one read, then sleep again
+    result_t irq = run_wait(true, 500, true, 200, DEF_COM_TIMEOUT);
+    CHECK(irq.state == RC522_WAIT_DONE && irq.reads == 2, "spurious edge: state %d, %u reads", irq.state, irq.reads);
+    CHECK(irq.end_us - 500 <= READ_US, "spurious edge: ends late");
+}
+
+static void test_missed_edge(void) {
+    // the request is set but the edge is lost: found by the read at the timeout, not reported as no tag
+    result_t irq = run_wait(true, 500, false, NEVER, DEF_COM_TIMEOUT);
+    CHECK(irq.state == RC522_WAIT_DONE, "missed edge not caught at the timeout");
+    CHECK(irq.end_us > DEF_COM_TIMEOUT * 1000, "missed edge: ends before the timeout");
+}
+
+static void test_no_answer(void) {
+    result_t poll = run_wait(false, NEVER, false, NEVER, DEF_COM_TIMEOUT);
+    result_t irq = run_wait(true, NEVER, false, NEVER, DEF_COM_TIMEOUT);
+    CHECK(poll.state == RC522_WAIT_TIMEOUT && irq.state == RC522_WAIT_TIMEOUT, "no answer not timed out");
+    // the same timeout as NO_TIMEOUT_1MS(): the first tick over the timeout
+    double timeout_us = (DEF_COM_TIMEOUT / 10 + 1) * TICK_US;
+    CHECK(poll.end_us >= timeout_us && poll.end_us <= timeout_us + READ_US, "polling timeout at %.0f us", poll.end_us);
+    CHECK(irq.end_us >= timeout_us && irq.end_us <= timeout_us + READ_US, "irq timeout at %.0f us", irq.end_us);
+    CHECK(irq.reads == 1, "irq timeout: %u reads", irq.reads);
+}
+
+static void report(const char *name, double latency_us) {
+    result_t poll = run_wait(false, latency_us, true, NEVER, DEF_COM_TIMEOUT);
+    result_t irq = run_wait(true, latency_us, true, NEVER, DEF_COM_TIMEOUT);
+    printf("  %-22s poll: %5u reads, CPU busy %8.1f us   irq: %u reads, CPU busy %5.1f us\n",
+           name, poll.reads, poll.busy_us, irq.reads, irq.busy_us);
+}
+
+int main(void) {
+    test_completion();
+    test_spurious_edge();
+    test_missed_edge();
+    test_no_answer();
+
+    printf("Wait for the end of a RC522 command:\n");
+    report("REQA (100 us)", 100);
+    report("MF1 auth (1 ms)", 1000);
+    report("no tag (25 ms timeout)", NEVER);
+
+    return test_result("test_rc522_wait");
+}
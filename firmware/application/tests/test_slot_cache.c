@@ -0,0 +1,357 @@
+/**
+ * Host test of the slot cache (rfid/nfctag/tag_slot_cache.c) through the slot changes of tag_emulation.c, on the
+ * simulated flash of sim/fds_sim.c. Slots are cycled through with their emulator memory changed at every visit:
+ * the memory found on arrival must be the one left, and after tag_emulation_save() the flash must hold the last
+ * memory of every slot, whether the changes were written at the slot change, written back when idle, or left in
+ * the cache until the save, through the flash write queue of fds_util.c. A changed slot that gets its factory data or is deleted must not be written back.
+ * Built a second time with the cache left out (TAG_SLOT_CACHE_SIZE=0), the same checks hold and the switch times,
+ * host and modelled flash time, of the two builds can be compared. The chunks of tag_persistence.c are checked on
+ * their own: a change of a block rewrites only its chunk, data stored as a single record is stored again in chunks,
+ * and shorter data leaves no chunks of the longer one behind, a reset after the records are replaced losing neither.
+ * Chunks whose queued write finds the flash full must be written at the next save once there is room again, those
+ * of the active slot and those of a slot left, without the idle upkeep trying them over and over meanwhile.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fds_util.h"
+#include "nfc_mf0_ntag.h"
+#include "nfc_mf1.h"
+#include "tag_emulation.h"
+#include "tag_persistence.h"
+#include "tag_slot_cache.h"
+#include "sim/fds_sim.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+#define ROUNDS  4
+
+// the HF card of each slot, slot 2 has only an LF card, four 4K cards do not fit the cache when they are random
+static const tag_specific_type_t m_slot_types[TAG_MAX_SLOT_NUM] = {
+    TAG_TYPE_MIFARE_1024, TAG_TYPE_MIFARE_4096, TAG_TYPE_UNDEFINED, TAG_TYPE_NTAG_215,
+    TAG_TYPE_MIFARE_4096, TAG_TYPE_MF0ICU1, TAG_TYPE_MIFARE_4096, TAG_TYPE_MIFARE_4096,
+};
+
+// what the emulator memory of each slot must be
+static uint8_t m_shadow[TAG_MAX_SLOT_NUM][TAG_SLOT_CACHE_IMAGE_MAX];
+static uint16_t m_length[TAG_MAX_SLOT_NUM];
+
+static uint8_t m_flash_image[TAG_SLOT_CACHE_IMAGE_MAX] __attribute__((aligned(4)));
+
+static uint64_t m_rng = 0x0123456789ABCDEFULL;
+
+static uint32_t random32(void) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 7;
+    m_rng ^= m_rng << 17;
+    return (uint32_t)m_rng;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool is_mf1(tag_specific_type_t type) {
+    return type == TAG_TYPE_MIFARE_1024 || type == TAG_TYPE_MIFARE_4096;
+}
+
+static uint8_t *memory_of(uint8_t slot) {
+    uint8_t *buffer = get_buffer_by_tag_type(m_slot_types[slot])->buffer;
+    if (is_mf1(m_slot_types[slot])) {
+        return buffer + offsetof(nfc_tag_mf1_information_t, memory);
+    }
+    return buffer + offsetof(nfc_tag_mf0_ntag_information_t, memory);
+}
+
+// Whether the slot data in flash is the one expected
+static bool flash_is(uint8_t slot, const uint8_t *expected, uint16_t length) {
+    uint16_t flash_length = sizeof(m_flash_image);
+    if (!tag_persistence_read(slot, TAG_SENSE_HF, m_flash_image, &flash_length)) {
+        return false;
+    }
+    return flash_length == length && memcmp(m_flash_image, expected, length) == 0;
+}
+
+// The factory data just written
+static void shadow_from_flash(uint8_t slot) {
+    m_length[slot] = sizeof(m_shadow[slot]);
+    CHECK(tag_persistence_read(slot, TAG_SENSE_HF, m_shadow[slot], &m_length[slot]), "data of slot %d", slot);
+}
+
+static void check_flash(const char *phase) {
+    for (uint8_t slot = 0; slot < TAG_MAX_SLOT_NUM; slot++) {
+        if (m_slot_types[slot] != TAG_TYPE_UNDEFINED) {
+            CHECK(flash_is(slot, m_shadow[slot], m_length[slot]), "%s: flash data of slot %d", phase, slot);
+        }
+    }
+}
+
+// A few bytes of the data pages or blocks of the active slot, or all of its blocks, and what they must stay
+static void memory_change(bool all) {
+    uint8_t slot = tag_emulation_get_slot();
+    uint8_t *memory = memory_of(slot);
+    if (all && is_mf1(m_slot_types[slot])) {
+        uint16_t length = m_length[slot] - (memory - get_buffer_by_tag_type(m_slot_types[slot])->buffer);
+        for (uint16_t i = 0; i < length; i++) {
+            memory[i] = random32();
+        }
+        tag_emulation_data_changed(memory, length);
+    } else {
+        // past block 0 and the first pages, the ones with the UID, locks and OTP
+        for (int i = 0; i < 4; i++) {
+            uint8_t *byte = &memory[16 + random32() % 32];
+            *byte = random32();
+            tag_emulation_data_changed(byte, 1);
+        }
+    }
+    memcpy(m_shadow[slot], get_buffer_by_tag_type(m_slot_types[slot])->buffer, m_length[slot]);
+}
+
+typedef struct {
+    uint32_t switches;
+    uint64_t switch_ns;         // host time in tag_emulation_change_slot()
+    uint64_t switch_flash_us;   // modelled flash time in it
+    uint64_t idle_flash_us;     // and in the slot cache upkeep between the switches
+} phase_cost_t;
+
+static void slot_switch(uint8_t slot, phase_cost_t *cost) {
+    uint64_t flash_us = fds_sim_stats()->flash_us;
+    uint64_t start = now_ns();
+    tag_emulation_change_slot(slot, false);
+    cost->switch_ns += now_ns() - start;
+    cost->switch_flash_us += fds_sim_stats()->flash_us - flash_us;
+    cost->switches++;
+    CHECK(m_slot_types[slot] == TAG_TYPE_UNDEFINED ||
+          memcmp(get_buffer_by_tag_type(m_slot_types[slot])->buffer, m_shadow[slot], m_length[slot]) == 0,
+          "memory of slot %d on arrival", slot);
+}
+
+static void idle(phase_cost_t *cost) {
+    uint64_t flash_us = fds_sim_stats()->flash_us;
+    while (tag_emulation_slot_cache_process() || fds_queue_process());
+    cost->idle_flash_us += fds_sim_stats()->flash_us - flash_us;
+}
+
+// Every slot visited, forward, ROUNDS times, the memory changed at each visit
+static phase_cost_t cycle(const char *name, bool all, bool with_idle) {
+    phase_cost_t cost = {0};
+    for (int round = 0; round < ROUNDS; round++) {
+        for (uint8_t i = 0; i < TAG_MAX_SLOT_NUM; i++) {
+            uint8_t slot = tag_emulation_slot_find_next(tag_emulation_get_slot());
+            slot_switch(slot, &cost);
+            if (m_slot_types[slot] != TAG_TYPE_UNDEFINED) {
+                memory_change(all);
+            }
+            if (with_idle) {
+                idle(&cost);
+            }
+        }
+    }
+    uint64_t flash_us = fds_sim_stats()->flash_us;
+    tag_emulation_save();
+    fds_queue_flush();
+    uint64_t save_us = fds_sim_stats()->flash_us - flash_us;
+    check_flash(name);
+    printf("%-22s %3u switches: %6.1f us host, %8.1f us flash each, %8.1f us idle flash each, %6.1f ms save\n",
+           name, cost.switches, cost.switch_ns / 1e3 / cost.switches, (double)cost.switch_flash_us / cost.switches,
+           (double)cost.idle_flash_us / cost.switches, save_us / 1e3);
+    return cost;
+}
+
+static void setup(void) {
+    nfct_sim_init();
+    tag_emulation_init();
+    tag_emulation_factory_init();
+    // each slot set up while it is active, as the client does it
+    for (uint8_t slot = 0; slot < TAG_MAX_SLOT_NUM; slot++) {
+        tag_specific_type_t type = m_slot_types[slot];
+        tag_emulation_change_slot(slot, false);
+        if (type == TAG_TYPE_UNDEFINED) {
+            tag_emulation_delete_data(slot, TAG_SENSE_HF);
+            tag_emulation_change_type(slot, TAG_TYPE_EM410X);
+            tag_emulation_slot_set_enable(slot, TAG_SENSE_LF, true);
+            continue;
+        }
+        tag_emulation_change_type(slot, type);
+        tag_emulation_slot_set_enable(slot, TAG_SENSE_HF, true);
+        CHECK(tag_emulation_factory_data(slot, type), "factory data of slot %d", slot);
+        shadow_from_flash(slot);
+    }
+    tag_emulation_change_slot(0, false);
+    tag_emulation_save();
+    fds_queue_flush();
+    check_flash("factory");
+}
+
+// A slot changed and left, then given its factory data or deleted: the changes must not come back
+static void test_drop(void) {
+    phase_cost_t cost = {0};
+    uint8_t slot = 3;
+    slot_switch(slot, &cost);
+    memory_change(false);
+    slot_switch(4, &cost);
+    CHECK(tag_emulation_factory_data(slot, m_slot_types[slot]), "factory data of slot %d", slot);
+    shadow_from_flash(slot);
+    slot_switch(slot, &cost);
+    tag_emulation_save();
+    fds_queue_flush();
+    check_flash("factory data of a changed slot");
+
+    slot = 5;
+    slot_switch(slot, &cost);
+    memory_change(false);
+    slot_switch(6, &cost);
+    tag_emulation_delete_data(slot, TAG_SENSE_HF);
+    tag_emulation_save();
+    fds_queue_flush();
+    CHECK(!tag_persistence_exists(slot, TAG_SENSE_HF), "data of the deleted slot %d written back", slot);
+}
+
+// The device reset: the flash keeps its records, the writes still queued are lost
+static void reset(void) {
+    fds_util_init();
+}
+
+// On the HF data of slot 2, which has only an LF card, a reset right after the chunks that replace records
+static void test_chunks(void) {
+    static uint8_t data[TAG_SLOT_CACHE_IMAGE_MAX] __attribute__((aligned(4)));
+    uint8_t slot = 2;
+    uint16_t length = 4096;
+    for (uint16_t i = 0; i < length; i++) {
+        data[i] = random32();
+    }
+    fds_sim_stats_t *flash = fds_sim_stats();
+    uint32_t words = flash->words_written;
+    CHECK(tag_persistence_write(slot, TAG_SENSE_HF, data, length, TAG_PERSISTENCE_CHUNKS_ALL), "chunks written");
+    fds_queue_flush();
+    uint32_t whole_words = flash->words_written - words;
+    CHECK(flash_is(slot, data, length), "chunks read");
+
+    // a block changed, in the middle of the data
+    data[1000] ^= 0xFF;
+    words = flash->words_written;
+    CHECK(tag_persistence_write(slot, TAG_SENSE_HF, data, length, tag_persistence_chunk_mask(1000, 16)),
+          "changed chunk written");
+    fds_queue_flush();
+    uint32_t chunk_words = flash->words_written - words;
+    CHECK(flash_is(slot, data, length), "data with the changed chunk");
+    CHECK(chunk_words * (length / TAG_PERSISTENCE_CHUNK_SIZE) <= whole_words + 64,
+          "a changed chunk wrote %u words, the whole data %u", chunk_words, whole_words);
+    printf("chunks: %u words written for the whole data, %u for a block\n", whole_words, chunk_words);
+
+    // a single record, as stored before the chunks
+    fds_slot_record_map_t map_info;
+    get_fds_map_by_slot_sense_type_for_dump(slot, TAG_SENSE_HF, &map_info);
+    tag_persistence_delete(slot, TAG_SENSE_HF);
+    CHECK(fds_write_sync(map_info.id, map_info.key, length, data), "single record written");
+    CHECK(flash_is(slot, data, length), "single record read");
+    CHECK(!fds_is_exists(map_info.id, map_info.key), "single record left after it is stored in chunks");
+    reset();
+    CHECK(flash_is(slot, data, length), "chunks of the single record read after a reset");
+
+    // shorter data, a 1K card in place of a 4K one
+    length = 1024;
+    for (uint16_t i = 0; i < length; i++) {
+        data[i] = random32();
+    }
+    CHECK(tag_persistence_write(slot, TAG_SENSE_HF, data, length, TAG_PERSISTENCE_CHUNKS_ALL), "shorter data written");
+    reset();
+    CHECK(flash_is(slot, data, length), "shorter data read after a reset");
+
+    CHECK(tag_persistence_delete(slot, TAG_SENSE_HF) == length / TAG_PERSISTENCE_CHUNK_SIZE, "chunks deleted");
+    CHECK(!tag_persistence_exists(slot, TAG_SENSE_HF), "data left after the delete");
+}
+
+#define FILLER_FILE_ID  0x2000
+
+// Records of another file in all the room left, the largest first
+static uint16_t flash_fill(void) {
+    static uint8_t filler[4096] __attribute__((aligned(4)));
+    uint16_t key = 1;
+    for (uint16_t size = sizeof(filler); size >= 4; size /= 4) {
+        while (fds_write_sync(FILLER_FILE_ID, key, size, filler)) {
+            key++;
+        }
+    }
+    return key - 1;
+}
+
+// The active slot and a slot left changed, the flash full at the save: the chunks are written at the next save
+static void test_flash_full(void) {
+    phase_cost_t cost = {0};
+    slot_switch(1, &cost);
+    memory_change(false);
+    slot_switch(0, &cost);
+    memory_change(false);
+    fds_queue_flush();
+    uint16_t fillers = flash_fill();
+    fds_queue_stats_t queue;
+    fds_queue_get_stats(&queue);
+    uint32_t failures = queue.failures;
+
+    tag_emulation_save();
+    fds_queue_flush();
+    fds_queue_get_stats(&queue);
+    CHECK(queue.failures > failures, "chunks written to a full flash");
+    CHECK(!flash_is(0, m_shadow[0], m_length[0]), "active slot written to a full flash");
+    int steps = 0;
+    while ((tag_emulation_slot_cache_process() || fds_queue_process()) && steps < 1000) {
+        steps++;
+    }
+    CHECK(steps < 1000, "idle upkeep busy with a full flash");
+
+    for (uint16_t key = 1; key <= fillers; key++) {
+        fds_delete_sync(FILLER_FILE_ID, key);
+    }
+    fds_gc_sync();
+    tag_emulation_save();
+    fds_queue_flush();
+    CHECK(flash_is(0, m_shadow[0], m_length[0]), "active slot after the flash full at the save");
+    CHECK(flash_is(1, m_shadow[1], m_length[1]), "slot left after the flash full at the save");
+}
+
+int main(void) {
+    setup();
+
+    fds_sim_stats_t *flash = fds_sim_stats();
+    uint32_t gc_runs = flash->gc_runs;
+    phase_cost_t changes = cycle("changes", false, false);
+    phase_cost_t changes_idle = cycle("changes, idle", false, true);
+    cycle("random 4K, idle", true, true);
+    fds_queue_stats_t queue;
+    fds_queue_get_stats(&queue);
+    uint32_t queued = queue.writes;
+    cycle("random 4K", true, false);
+    fds_queue_get_stats(&queue);
+    printf("%u records written, %u flash page erases, %u GC\n", flash->records_written, flash->page_erases,
+           flash->gc_runs - gc_runs);
+#if TAG_SLOT_CACHE_SIZE > 0
+    const tag_slot_cache_stats_t *stats = tag_slot_cache_get_stats();
+    printf("slot cache %d bytes: %u hits, %u misses, %u prefetches, %u write backs, %u evictions, %u rejects\n",
+           TAG_SLOT_CACHE_SIZE, stats->hits, stats->misses, stats->prefetches, stats->write_backs, stats->evictions,
+           stats->rejects);
+    // the changes of all the slots fit, compressed: a slot change does not write
+    CHECK(changes.switch_flash_us == 0, "flash written at a slot change, changes fit the cache");
+    CHECK(changes_idle.switch_flash_us == 0, "flash written at a slot change, idle");
+    // and with the writes and reads done when idle, the slot is in the cache when it is switched to
+    CHECK(stats->prefetches > 0, "no slot prefetched");
+    // four random 4K images do not fit: the last is queued for the flash at the slot change
+    CHECK(stats->rejects > 0, "random 4K images all cached");
+    CHECK(queue.writes > queued, "random 4K images, no flash write queued at a slot change");
+#else
+    (void)changes;
+    (void)changes_idle;
+    (void)queued;
+    printf("no slot cache\n");
+#endif
+    test_drop();
+    test_chunks();
+    test_flash_full();
+
+    return test_result("test_slot_cache");
+}
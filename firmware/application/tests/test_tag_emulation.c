@@ -0,0 +1,536 @@
+/**
+ * Host test of the HF tag emulation (rfid/nfctag/hf: nfc_14a.c, nfc_mf1.c, nfc_mf0_ntag.c and their Crypto1) on
+ * a simulated NFCT (sim/nfct_sim.c). Scripted reader traces go through the NFCT interrupt handler as they would
+ * come over the field: anticollision, authentication, nested authentication, read and write of a MIFARE Classic
+ * 1K, anticollision, GET_VERSION, READ, FAST_READ, PWD_AUTH and WRITE of an NTAG215, with the factory data of the
+ * slots. A FAST_READ of more pages than the NFCT TX buffer holds must get a NAK.
+ * The answers are checked the way a reader does, Crypto1 and parity included.
+ *
+ * Each trace is replayed many times and the cost of every answer is reported: the host time spent in the
+ * interrupt and, when a PMU is available, the instructions it retired. The host is far faster than the nRF52 but
+ * the ranking holds: the answers that cost the most against the SELECT one are those that risk missing the frame
+ * delay time on the device.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nfc_14a.h"
+#include "nfc_mf1.h"
+#include "nfc_mf0_ntag.h"
+#include "crc_utils.h"
+#include "hex_utils.h"
+#include "mf1_crapto1.h"
+#include "parity.h"
+#include "sim/nfct_sim.h"
+#include "test_util.h"
+
+#define TRACE_REPEAT    200
+
+
+//---------------------------------------------------------------------------- costs of the answers
+
+typedef enum {
+    COST_WUPA,
+    COST_ANTICOLL,
+    COST_SELECT,
+    COST_MF1_AUTH,
+    COST_MF1_AUTH_NR_AR,
+    COST_MF1_NESTED_AUTH,
+    COST_MF1_READ,
+    COST_MF1_WRITE,
+    COST_MF1_WRITE_DATA,
+    COST_MF1_HALT,
+    COST_NTAG_GET_VERSION,
+    COST_NTAG_READ,
+    COST_NTAG_FAST_READ,
+    COST_NTAG_PWD_AUTH,
+    COST_NTAG_WRITE,
+    COST_NTAG_HALT,
+    COST_COUNT,
+} cost_id_t;
+
+static struct {
+    const char *name;
+    uint32_t count;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t total_ns;
+    uint64_t min_instructions;
+} m_costs[COST_COUNT] = {
+    [COST_WUPA] = { "WUPA" },
+    [COST_ANTICOLL] = { "ANTICOLL" },
+    [COST_SELECT] = { "SELECT" },
+    [COST_MF1_AUTH] = { "MF1 AUTH" },
+    [COST_MF1_AUTH_NR_AR] = { "MF1 AUTH {nr}{ar}" },
+    [COST_MF1_NESTED_AUTH] = { "MF1 nested AUTH" },
+    [COST_MF1_READ] = { "MF1 READ" },
+    [COST_MF1_WRITE] = { "MF1 WRITE" },
+    [COST_MF1_WRITE_DATA] = { "MF1 WRITE data" },
+    [COST_MF1_HALT] = { "MF1 HALT" },
+    [COST_NTAG_GET_VERSION] = { "NTAG GET_VERSION" },
+    [COST_NTAG_READ] = { "NTAG READ" },
+    [COST_NTAG_FAST_READ] = { "NTAG FAST_READ 15 pages" },
+    [COST_NTAG_PWD_AUTH] = { "NTAG PWD_AUTH" },
+    [COST_NTAG_WRITE] = { "NTAG WRITE" },
+    [COST_NTAG_HALT] = { "NTAG HALT" },
+};
+
+static void cost_add(cost_id_t id) {
+    nfct_sim_stats_t *stats = nfct_sim_stats();
+    if (m_costs[id].count == 0 || stats->last_ns < m_costs[id].min_ns) {
+        m_costs[id].min_ns = stats->last_ns;
+    }
+    if (m_costs[id].count == 0 || stats->last_instructions < m_costs[id].min_instructions) {
+        m_costs[id].min_instructions = stats->last_instructions;
+    }
+    if (stats->last_ns > m_costs[id].max_ns) {
+        m_costs[id].max_ns = stats->last_ns;
+    }
+    m_costs[id].total_ns += stats->last_ns;
+    m_costs[id].count++;
+}
+
+static void print_costs(void) {
+    bool pmu = nfct_sim_has_pmu();
+    uint64_t reference = m_costs[COST_SELECT].min_ns ? m_costs[COST_SELECT].min_ns : 1;
+    cost_id_t slowest = COST_WUPA;
+    printf("%-24s %8s %8s %8s %8s %10s\n", "answer", "min ns", "mean ns", "max ns", "x SELECT", pmu ? "instr." : "");
+    for (int id = 0; id < COST_COUNT; id++) {
+        if (m_costs[id].count == 0) {
+            continue;
+        }
+        if (m_costs[id].min_ns > m_costs[slowest].min_ns) {
+            slowest = id;
+        }
+        printf("%-24s %8llu %8llu %8llu %8.1f", m_costs[id].name,
+               (unsigned long long)m_costs[id].min_ns,
+               (unsigned long long)(m_costs[id].total_ns / m_costs[id].count),
+               (unsigned long long)m_costs[id].max_ns,
+               (double)m_costs[id].min_ns / reference);
+        if (pmu) {
+            printf(" %10llu", (unsigned long long)m_costs[id].min_instructions);
+        }
+        printf("\n");
+    }
+    printf("slowest answer: %s, %.1f x SELECT; on the device the answer is due %u ns after the end of the frame\n",
+           m_costs[slowest].name, (double)m_costs[slowest].min_ns / reference, NFCT_SIM_FDT_NS);
+}
+
+
+//---------------------------------------------------------------------------- reader
+
+static uint8_t m_air[NFCT_SIM_FRAME_MAX];
+static uint8_t m_answer[NFCT_SIM_FRAME_MAX];
+static uint16_t m_answer_bits;
+static struct Crypto1State m_cs;
+static bool m_crypto_on;
+// the answer decoded: bytes, their count, the bits of a short frame, and whether the parity matched
+static uint8_t m_rx[NFCT_SIM_FRAME_MAX / 9];
+static uint16_t m_rx_length;
+static uint8_t m_rx_bits;
+static bool m_rx_parity_ok;
+
+static uint16_t air_byte(uint16_t count, uint8_t value, uint8_t par) {
+    for (int bit = 0; bit < 8; bit++) {
+        m_air[count++] = (value >> bit) & 1;
+    }
+    m_air[count++] = par;
+    return count;
+}
+
+// the answer of the tag into m_rx, Crypto1 removed when it is on
+static void decode_answer(void) {
+    m_rx_length = 0;
+    m_rx_bits = 0;
+    m_rx_parity_ok = true;
+    if (m_answer_bits < 8) {
+        uint8_t value = 0;
+        for (int bit = 0; bit < m_answer_bits; bit++) {
+            value |= (m_answer[bit] ^ (m_crypto_on ? crypto1_bit(&m_cs, 0, 0) : 0)) << bit;
+        }
+        m_rx[0] = value;
+        m_rx_bits = m_answer_bits;
+        return;
+    }
+    for (uint16_t pos = 0; pos + 9 <= m_answer_bits; pos += 9) {
+        uint8_t value = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            value |= m_answer[pos + bit] << bit;
+        }
+        uint8_t par = m_answer[pos + 8];
+        if (m_crypto_on) {
+            value ^= crypto1_byte(&m_cs, 0x00, 0);
+            par ^= filter(m_cs.odd);
+        }
+        m_rx_parity_ok &= par == oddparity8(value);
+        m_rx[m_rx_length++] = value;
+    }
+}
+
+static void exchange(uint16_t count, cost_id_t cost) {
+    m_answer_bits = nfct_sim_exchange(m_air, count, m_answer);
+    cost_add(cost);
+    decode_answer();
+}
+
+static void send_short(uint8_t command, cost_id_t cost) {
+    for (int bit = 0; bit < 7; bit++) {
+        m_air[bit] = (command >> bit) & 1;
+    }
+    exchange(7, cost);
+}
+
+// a standard frame, with its CRC if asked, encrypted when Crypto1 is on
+static void send_frame(const uint8_t *data, uint16_t length, bool crc, cost_id_t cost) {
+    uint8_t frame[NFCT_SIM_FRAME_MAX / 9];
+    memcpy(frame, data, length);
+    if (crc) {
+        calc_14a_crc_lut(frame, length, &frame[length]);
+        length += NFC_TAG_14A_CRC_LENGTH;
+    }
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t value = frame[i];
+        uint8_t par = oddparity8(value);
+        if (m_crypto_on) {
+            value ^= crypto1_byte(&m_cs, 0x00, 0);
+            par ^= filter(m_cs.odd);
+        }
+        count = air_byte(count, value, par);
+    }
+    exchange(count, cost);
+}
+
+static bool answer_is(const uint8_t *expected, uint16_t length, bool crc) {
+    if (!m_rx_parity_ok || m_rx_length != length + (crc ? NFC_TAG_14A_CRC_LENGTH : 0)) {
+        return false;
+    }
+    if (crc && !nfc_tag_14a_checks_crc(m_rx, m_rx_length)) {
+        return false;
+    }
+    return memcmp(m_rx, expected, length) == 0;
+}
+
+static bool answer_is_ack(void) {
+    return m_rx_length == 0 && m_rx_bits == 4 && m_rx[0] == ACK_VALUE;
+}
+
+// WUPA and the cascade levels of the UID, returns the SAK
+static uint8_t reader_select(const uint8_t *uid, uint8_t uid_size, const uint8_t *atqa) {
+    m_crypto_on = false;
+    send_short(NFC_TAG_14A_CMD_WUPA, COST_WUPA);
+    CHECK(answer_is(atqa, 2, false), "ATQA");
+    uint8_t levels = uid_size == NFC_TAG_14A_UID_DOUBLE_SIZE ? 2 : 1;
+    uint8_t sak = 0;
+    for (uint8_t level = 0; level < levels; level++) {
+        uint8_t sel = NFC_TAG_14A_CMD_ANTICOLL_OR_SELECT_1 + level * 2;
+        uint8_t cl[5];
+        if (level + 1 < levels) {
+            cl[0] = NFC_TAG_14A_CASCADE_CT;
+            memcpy(&cl[1], &uid[level * 3], 3);
+        } else {
+            memcpy(cl, &uid[level * 3], 4);
+        }
+        cl[4] = cl[0] ^ cl[1] ^ cl[2] ^ cl[3];
+        uint8_t anticoll[] = { sel, 0x20 };
+        send_frame(anticoll, sizeof(anticoll), false, COST_ANTICOLL);
+        CHECK(answer_is(cl, 5, false), "anticollision of cascade level %d", level + 1);
+        uint8_t select[7] = { sel, 0x70 };
+        memcpy(&select[2], cl, 5);
+        send_frame(select, sizeof(select), true, COST_SELECT);
+        CHECK(m_rx_length == 3 && nfc_tag_14a_checks_crc(m_rx, 3), "SAK of cascade level %d", level + 1);
+        sak = m_rx[0];
+    }
+    return sak;
+}
+
+
+//---------------------------------------------------------------------------- MIFARE Classic
+
+static const uint8_t m_mf1_uid[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+static const uint8_t m_mf1_atqa[2] = { 0x04, 0x00 };
+static uint8_t m_mf1_data[sizeof(nfc_tag_mf1_information_t)];
+
+static uint32_t mf1_uid_u32(void) {
+    return bytes_to_num((uint8_t *)m_mf1_uid, 4);
+}
+
+// the factory data of a 1K slot, loaded as tag_emulation.c does
+static void mf1_load(void) {
+    uint16_t length;
+    CHECK(nfc_tag_mf1_data_factory(0, TAG_TYPE_MIFARE_1024), "MF1 factory data");
+    const uint8_t *record = nfct_sim_fds_record(&length);
+    memcpy(m_mf1_data, record, length);
+    tag_data_buffer_t buffer = { .length = sizeof(m_mf1_data), .buffer = m_mf1_data };
+    nfc_tag_mf1_data_loadcb(TAG_TYPE_MIFARE_1024, &buffer);
+}
+
+/**
+ * @brief : Three pass authentication, nested when Crypto1 is already on, returns whether the tag
+ * proved it has the key.
+ */
+static bool mf1_auth(uint8_t key_type, uint8_t block, uint64_t key, uint32_t nr) {
+    bool nested = m_crypto_on;
+    uint8_t auth[] = { key_type, block };
+    send_frame(auth, sizeof(auth), true, nested ? COST_MF1_NESTED_AUTH : COST_MF1_AUTH);
+    if (m_answer_bits != 36) {
+        return false;
+    }
+    uint32_t nt;
+    crypto1_init(&m_cs, key);
+    if (nested) {
+        // the nonce comes encrypted, each parity bit leaks a keystream bit
+        uint8_t nt_enc[4], uid_nt[4], nt_bytes[4];
+        bool parity_ok = true;
+        for (int i = 0; i < 4; i++) {
+            nt_enc[i] = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                nt_enc[i] |= m_answer[i * 9 + bit] << bit;
+            }
+        }
+        num_to_bytes(mf1_uid_u32() ^ bytes_to_num(nt_enc, 4), 4, uid_nt);
+        for (int i = 0; i < 4; i++) {
+            nt_bytes[i] = nt_enc[i] ^ crypto1_byte(&m_cs, uid_nt[i], 1);
+            parity_ok &= (m_answer[i * 9 + 8] ^ filter(m_cs.odd)) == oddparity8(nt_bytes[i]);
+        }
+        CHECK(parity_ok, "parity of the nested nonce");
+        nt = bytes_to_num(nt_bytes, 4);
+    } else {
+        CHECK(m_rx_parity_ok, "parity of the nonce");
+        nt = bytes_to_num(m_rx, 4);
+        crypto1_word(&m_cs, mf1_uid_u32() ^ nt, 0);
+    }
+    m_crypto_on = true;
+    // {nr}{ar}, the reader nonce feeds the cipher
+    uint8_t nr_bytes[4], ar_bytes[4];
+    num_to_bytes(nr, 4, nr_bytes);
+    num_to_bytes(prng_successor(nt, 64), 4, ar_bytes);
+    uint16_t count = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8_t value = crypto1_byte(&m_cs, nr_bytes[i], 0) ^ nr_bytes[i];
+        count = air_byte(count, value, filter(m_cs.odd) ^ oddparity8(nr_bytes[i]));
+    }
+    for (int i = 0; i < 4; i++) {
+        uint8_t value = crypto1_byte(&m_cs, 0x00, 0) ^ ar_bytes[i];
+        count = air_byte(count, value, filter(m_cs.odd) ^ oddparity8(ar_bytes[i]));
+    }
+    exchange(count, COST_MF1_AUTH_NR_AR);
+    if (m_rx_length != 4 || !m_rx_parity_ok || bytes_to_num(m_rx, 4) != prng_successor(nt, 96)) {
+        m_crypto_on = false;
+        return false;
+    }
+    return true;
+}
+
+static bool mf1_read(uint8_t block, uint8_t *data) {
+    uint8_t read[] = { 0x30, block };
+    send_frame(read, sizeof(read), true, COST_MF1_READ);
+    if (m_rx_length != NFC_TAG_MF1_FRAME_SIZE || !m_rx_parity_ok || !nfc_tag_14a_checks_crc(m_rx, m_rx_length)) {
+        return false;
+    }
+    memcpy(data, m_rx, NFC_TAG_MF1_DATA_SIZE);
+    return true;
+}
+
+static bool mf1_write(uint8_t block, const uint8_t *data) {
+    uint8_t write[] = { 0xA0, block };
+    send_frame(write, sizeof(write), true, COST_MF1_WRITE);
+    if (!answer_is_ack()) {
+        return false;
+    }
+    send_frame(data, NFC_TAG_MF1_DATA_SIZE, true, COST_MF1_WRITE_DATA);
+    return answer_is_ack();
+}
+
+static void mf1_trace(uint32_t round) {
+    uint8_t block[NFC_TAG_MF1_DATA_SIZE];
+    uint8_t written[NFC_TAG_MF1_DATA_SIZE];
+    for (int i = 0; i < sizeof(written); i++) {
+        written[i] = round + i;
+    }
+
+    uint8_t sak = reader_select(m_mf1_uid, NFC_TAG_14A_UID_SINGLE_SIZE, m_mf1_atqa);
+    CHECK(sak == 0x08, "SAK of the 1K: %02X", sak);
+    CHECK(mf1_auth(0x60, 4, 0xFFFFFFFFFFFFULL, 0x01020304 + round), "authentication, sector 1 key A");
+    CHECK(mf1_read(4, block) && memcmp(block, m_mf1_data + 4 * NFC_TAG_MF1_DATA_SIZE + offsetof(nfc_tag_mf1_information_t, memory), 16) == 0,
+          "read of block 4");
+    CHECK(mf1_write(5, written), "write of block 5");
+    CHECK(mf1_read(5, block) && memcmp(block, written, sizeof(written)) == 0, "read back of block 5");
+    CHECK(mf1_auth(0x61, 8, 0xFFFFFFFFFFFFULL, 0x0A0B0C0D), "nested authentication, sector 2 key B");
+    CHECK(mf1_read(8, block), "read of block 8 after the nested authentication");
+    // HALT, then the tag sleeps until a WUPA
+    uint8_t halt[] = { NFC_TAG_14A_CMD_HALT, 0x00 };
+    send_frame(halt, sizeof(halt), true, COST_MF1_HALT);
+    CHECK(m_answer_bits == 0, "no answer to HALT");
+    m_crypto_on = false;
+    send_short(NFC_TAG_14A_CMD_REQA, COST_WUPA);
+    CHECK(m_answer_bits == 0, "no answer of a halted tag to REQA");
+}
+
+// a trailer written by the reader changes at once what a read of it shows
+static void mf1_trailer_write(void) {
+    // sector 1: key A, read/write blocks with key B, data blocks 100, trailer 011
+    static const uint8_t trailer[NFC_TAG_MF1_DATA_SIZE] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x78, 0x77, 0x88, 0x69, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5
+    };
+    uint8_t block[NFC_TAG_MF1_DATA_SIZE];
+    reader_select(m_mf1_uid, NFC_TAG_14A_UID_SINGLE_SIZE, m_mf1_atqa);
+    CHECK(mf1_auth(0x60, 7, 0xFFFFFFFFFFFFULL, 0x01020304), "authentication of the trailer, sector 1 key A");
+    // transport configuration, key A reads the access bytes and key B
+    CHECK(mf1_read(7, block) && memcmp(&block[6], "\xFF\x07\x80\x69\xFF\xFF\xFF\xFF\xFF\xFF", 10) == 0,
+          "read of the transport trailer");
+    CHECK(mf1_write(7, trailer), "write of the trailer");
+    // now key A only reads the access bytes
+    CHECK(mf1_read(7, block) && memcmp(&block[6], &trailer[6], 4) == 0 && memcmp(&block[10], "\0\0\0\0\0\0", 6) == 0,
+          "read of the written trailer");
+}
+
+static void test_mf1(void) {
+    mf1_load();
+    nfct_sim_field_on();
+    for (uint32_t round = 0; round < TRACE_REPEAT; round++) {
+        mf1_trace(round);
+    }
+    // a wrong key: the tag stays silent and resets
+    reader_select(m_mf1_uid, NFC_TAG_14A_UID_SINGLE_SIZE, m_mf1_atqa);
+    CHECK(!mf1_auth(0x60, 4, 0x112233445566ULL, 0x01020304), "authentication with a wrong key");
+    CHECK(m_answer_bits == 0, "no answer to {nr}{ar} of a wrong key");
+    mf1_trailer_write();
+    nfct_sim_field_off();
+}
+
+
+//---------------------------------------------------------------------------- NTAG
+
+static const uint8_t m_ntag_uid[7] = { 0x04, 0x68, 0x95, 0x71, 0xFA, 0x5C, 0x64 };
+static const uint8_t m_ntag_atqa[2] = { 0x44, 0x00 };
+static uint8_t m_ntag_data[sizeof(nfc_tag_mf1_information_t)];
+
+static uint8_t *ntag_page(uint8_t page) {
+    nfc_tag_mf0_ntag_information_t *info = (nfc_tag_mf0_ntag_information_t *)m_ntag_data;
+    return info->memory[page];
+}
+
+static void ntag_load(void) {
+    uint16_t length;
+    CHECK(nfc_tag_mf0_ntag_data_factory(0, TAG_TYPE_NTAG_215), "NTAG factory data");
+    const uint8_t *record = nfct_sim_fds_record(&length);
+    memcpy(m_ntag_data, record, length);
+    tag_data_buffer_t buffer = { .length = length, .buffer = m_ntag_data };
+    nfc_tag_mf0_ntag_data_loadcb(TAG_TYPE_NTAG_215, &buffer);
+    // user data to read back
+    for (int page = 4; page < 20; page++) {
+        for (int i = 0; i < NFC_TAG_MF0_NTAG_DATA_SIZE; i++) {
+            ntag_page(page)[i] = page * 4 + i;
+        }
+    }
+}
+
+static void ntag_trace(void) {
+    uint8_t sak = reader_select(m_ntag_uid, NFC_TAG_14A_UID_DOUBLE_SIZE, m_ntag_atqa);
+    CHECK(sak == 0x00, "SAK of the NTAG: %02X", sak);
+
+    uint8_t get_version[] = { 0x60 };
+    send_frame(get_version, sizeof(get_version), true, COST_NTAG_GET_VERSION);
+    CHECK(m_rx_length == NFC_TAG_MF0_NTAG_VER_SIZE + NFC_TAG_14A_CRC_LENGTH && m_rx[0] == 0x00 && m_rx[1] == 0x04,
+          "GET_VERSION");
+
+    uint8_t read[] = { 0x30, 0x04 };
+    send_frame(read, sizeof(read), true, COST_NTAG_READ);
+    CHECK(answer_is(ntag_page(4), 16, true), "READ of page 4");
+
+    // pages 4 to 18, 60 bytes, within the TX buffer of nfc_14a.c
+    uint8_t fast_read[] = { 0x3A, 0x04, 0x13 };
+    send_frame(fast_read, sizeof(fast_read), true, COST_NTAG_FAST_READ);
+    CHECK(m_rx_length > NFC_TAG_14A_CRC_LENGTH && m_rx_length <= MAX_NFC_TX_BUFFER_SIZE + NFC_TAG_14A_CRC_LENGTH &&
+          m_rx_parity_ok && nfc_tag_14a_checks_crc(m_rx, m_rx_length) &&
+          memcmp(m_rx, ntag_page(4), m_rx_length - NFC_TAG_14A_CRC_LENGTH) == 0, "FAST_READ from page 4");
+
+    uint8_t wrong_pwd[] = { 0x1B, 0x12, 0x34, 0x56, 0x78 };
+    send_frame(wrong_pwd, sizeof(wrong_pwd), true, COST_NTAG_PWD_AUTH);
+    CHECK(m_rx_bits == 4 && m_rx[0] == NAK_INVALID_OPERATION_TBIV, "NAK of a wrong password");
+    uint8_t pwd_auth[] = { 0x1B, 0xFF, 0xFF, 0xFF, 0xFF };
+    send_frame(pwd_auth, sizeof(pwd_auth), true, COST_NTAG_PWD_AUTH);
+    // the PACK is in the 4th configuration page of an NTAG215, they start at page 0x83
+    CHECK(answer_is(ntag_page(0x83 + 3), 2, true), "PACK of the factory password");
+
+    uint8_t halt[] = { NFC_TAG_14A_CMD_HALT, 0x00 };
+    send_frame(halt, sizeof(halt), true, COST_NTAG_HALT);
+    CHECK(m_answer_bits == 0, "no answer to HALT");
+}
+
+static bool ntag_write(uint8_t page, const uint8_t *data) {
+    uint8_t write[2 + NFC_TAG_MF0_NTAG_DATA_SIZE] = { 0xA2, page };
+    memcpy(&write[2], data, NFC_TAG_MF0_NTAG_DATA_SIZE);
+    send_frame(write, sizeof(write), true, COST_NTAG_WRITE);
+    return answer_is_ack();
+}
+
+static void ntag_lock_and_mirror_write(void) {
+    static const uint8_t data[NFC_TAG_MF0_NTAG_DATA_SIZE] = { 0x11, 0x22, 0x33, 0x44 };
+    // lock bit of page 5
+    static const uint8_t lock[NFC_TAG_MF0_NTAG_DATA_SIZE] = { 0x00, 0x00, 0x20, 0x00 };
+    // UID mirror from the first byte of page 5, STRG_MOD_EN and AUTH0 as the factory sets them
+    static const uint8_t mirror[NFC_TAG_MF0_NTAG_DATA_SIZE] = { 0x44, 0x00, 0x05, 0xFF };
+    // the factory lock bytes lock the first pages, the slot is edited the way the client does it
+    ntag_page(2)[2] = ntag_page(2)[3] = 0;
+    nfc_tag_mf0_ntag_state_invalidate();
+
+    reader_select(m_ntag_uid, NFC_TAG_14A_UID_DOUBLE_SIZE, m_ntag_atqa);
+    CHECK(ntag_write(5, data) && memcmp(ntag_page(5), data, sizeof(data)) == 0, "WRITE of page 5");
+    CHECK(ntag_write(2, lock), "WRITE of the lock bytes");
+    CHECK(!ntag_write(5, data) && m_rx_bits == 4 && m_rx[0] == NAK_INVALID_OPERATION_TBV, "NAK of locked page 5");
+
+    CHECK(ntag_write(0x83, mirror), "WRITE of the mirror configuration");
+    uint8_t read[] = { 0x30, 0x05 };
+    send_frame(read, sizeof(read), true, COST_NTAG_READ);
+    CHECK(m_rx_length == 16 + NFC_TAG_14A_CRC_LENGTH && memcmp(m_rx, "04689571FA5C64", 14) == 0, "READ of the UID mirror");
+}
+
+// The TX buffer of nfc_14a.c holds 16 pages, a reader asking for more must not get them
+static void ntag_fast_read_limit(void) {
+    reader_select(m_ntag_uid, NFC_TAG_14A_UID_DOUBLE_SIZE, m_ntag_atqa);
+    uint8_t pages = MAX_NFC_TX_BUFFER_SIZE / NFC_TAG_MF0_NTAG_DATA_SIZE;
+    uint8_t fast_read[] = { 0x3A, 0x04, 0x04 + pages };
+    send_frame(fast_read, sizeof(fast_read), true, COST_NTAG_FAST_READ);
+    CHECK(answer_is(ntag_page(4), MAX_NFC_TX_BUFFER_SIZE, true), "FAST_READ of a full TX buffer");
+    fast_read[2]++;
+    send_frame(fast_read, sizeof(fast_read), true, COST_NTAG_FAST_READ);
+    CHECK(m_rx_bits == 4 && m_rx[0] == NAK_INVALID_OPERATION_TBV, "NAK of a FAST_READ past the TX buffer");
+    // all the pages, as the reader of a phone may ask for them
+    uint8_t fast_read_all[] = { 0x3A, 0x00, 0x86 };
+    send_frame(fast_read_all, sizeof(fast_read_all), true, COST_NTAG_FAST_READ);
+    CHECK(m_rx_bits == 4 && m_rx[0] == NAK_INVALID_OPERATION_TBV, "NAK of a FAST_READ of all the pages");
+
+    uint8_t halt[] = { NFC_TAG_14A_CMD_HALT, 0x00 };
+    send_frame(halt, sizeof(halt), true, COST_NTAG_HALT);
+}
+
+static void test_ntag(void) {
+    ntag_load();
+    nfct_sim_field_on();
+    for (uint32_t round = 0; round < TRACE_REPEAT; round++) {
+        ntag_trace();
+    }
+    ntag_fast_read_limit();
+    ntag_lock_and_mirror_write();
+    nfct_sim_field_off();
+}
+
+
+int main(void) {
+    srand(1);
+    nfct_sim_init();
+    nfc_tag_14a_sense_switch(true);
+
+    test_mf1();
+    test_ntag();
+
+    nfct_sim_stats_t *stats = nfct_sim_stats();
+    CHECK(stats->rx_not_enabled == 0, "%u frames sent while the receiver was off", stats->rx_not_enabled);
+    printf("%u reader frames, %u answers, %d traces each\n", stats->frames, stats->answers, TRACE_REPEAT);
+    print_costs();
+
+    return test_result("test_tag_emulation");
+}
@@ -0,0 +1,135 @@
+/**
+ * Host test of the response frame queue (utils/tx_frame_queue.c) used for the USB CDC transmit:
+ * the cdc driver sends from the frame buffer and takes one transfer at a time.
+ * Checks the state machine, the send order and that no frame is rewritten while in flight,
+ * then prints how long a multi frame response takes with one frame and with the double buffer.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tx_frame_queue.h"
+#include "test_util.h"
+
+#define FRAME_SIZE          4106    // largest frame: 4096 bytes of data and the frame header
+#define RESPONSE_FRAMES     64
+#define BUILD_US            1500    // a handler reading 4 KiB from a card or from flash
+#define SEND_US             3300    // 4 KiB over full speed USB with the host polling
+
+static void test_state_machine(void) {
+    tx_frame_queue_t queue;
+    tx_frame_queue_init(&queue);
+    CHECK(tx_frame_queue_count(&queue, TX_FRAME_FREE) == TX_FRAME_QUEUE_DEPTH, "init: frames not free");
+    CHECK(tx_frame_queue_start(&queue) < 0, "start with nothing queued");
+
+    int a = tx_frame_queue_acquire(&queue);
+    int b = tx_frame_queue_acquire(&queue);
+    CHECK(a >= 0 && b >= 0 && a != b, "acquire: %d %d", a, b);
+    CHECK(tx_frame_queue_acquire(&queue) < 0, "acquire with all frames filling");
+
+    // committed out of acquire order, sent in commit order
+    tx_frame_queue_commit(&queue, b);
+    tx_frame_queue_commit(&queue, a);
+    CHECK(tx_frame_queue_start(&queue) == b, "first committed not sent first");
+    CHECK(tx_frame_queue_start(&queue) < 0, "second transfer started while busy");
+    CHECK(tx_frame_queue_acquire(&queue) < 0, "acquire while both in flight");
+    tx_frame_queue_done(&queue);
+    CHECK(tx_frame_queue_start(&queue) == a, "second frame not sent after done");
+    CHECK(tx_frame_queue_acquire(&queue) == b, "sent frame not reusable");
+
+    // port closed: pending frames dropped, the one being filled kept
+    tx_frame_queue_drop_pending(&queue);
+    CHECK(tx_frame_queue_count(&queue, TX_FRAME_FILLING) == 1, "drop_pending lost the filling frame");
+    CHECK(tx_frame_queue_count(&queue, TX_FRAME_FREE) == TX_FRAME_QUEUE_DEPTH - 1, "drop_pending kept frames");
+    tx_frame_queue_done(&queue);
+    CHECK(tx_frame_queue_count(&queue, TX_FRAME_FILLING) == 1, "done without transfer changed a frame");
+
+    // transports that copy the data give the frame back at once
+    tx_frame_queue_discard(&queue, b);
+    CHECK(tx_frame_queue_count(&queue, TX_FRAME_FREE) == TX_FRAME_QUEUE_DEPTH, "discard did not free");
+    tx_frame_queue_commit(&queue, b);
+    CHECK(tx_frame_queue_start(&queue) < 0, "commit of a free frame queued it");
+
+    // frames left by handlers
+    tx_frame_queue_acquire(&queue);
+    tx_frame_queue_acquire(&queue);
+    tx_frame_queue_discard_filling(&queue);
+    CHECK(tx_frame_queue_count(&queue, TX_FRAME_FREE) == TX_FRAME_QUEUE_DEPTH, "discard_filling left frames");
+}
+
+/**
+ * A handler answering RESPONSE_FRAMES frames (STATUS_MORE_DATA then the last one), with a time model:
+ * building a frame costs BUILD_US of cpu, the cdc sends a frame in SEND_US while the cpu goes on.
+ * With depth 1 this is the previous behavior, build then wait for TX done.
+ */
+static double simulate_response(int depth, int *back_pressure) {
+    static uint8_t frames[TX_FRAME_QUEUE_DEPTH][FRAME_SIZE];
+    tx_frame_queue_t queue;
+    tx_frame_queue_init(&queue);
+    for (int i = depth; i < TX_FRAME_QUEUE_DEPTH; i++) {
+        tx_frame_queue_acquire(&queue);  // held aside, never sent
+    }
+    double now = 0;
+    double transfer_end = 0;
+    int sent = 0;
+    int built = 0;
+    uint8_t sending_tag = 0;
+    *back_pressure = 0;
+
+    while (sent < RESPONSE_FRAMES) {
+        int index = built < RESPONSE_FRAMES ? tx_frame_queue_acquire(&queue) : -1;
+        if (index >= 0) {
+            now += BUILD_US;
+            memset(frames[index], (uint8_t)built, FRAME_SIZE);
+            tx_frame_queue_commit(&queue, index);
+            built++;
+        } else if (queue.sending < 0 && tx_frame_queue_count(&queue, TX_FRAME_QUEUED) == 0) {
+            CHECK(0, "no frame free and nothing in flight");
+            break;
+        } else {
+            // back-pressure: wait for TX done
+            if (built < RESPONSE_FRAMES) {
+                (*back_pressure)++;
+            }
+            if (queue.sending >= 0) {
+                if (transfer_end > now) {
+                    now = transfer_end;
+                }
+                // the frame must still hold what was handed to the cdc
+                for (int i = 0; i < FRAME_SIZE; i++) {
+                    if (frames[queue.sending][i] != sending_tag) {
+                        CHECK(0, "frame %d rewritten while in flight", sent);
+                        break;
+                    }
+                }
+                CHECK(sending_tag == (uint8_t)sent, "frame %d sent out of order", sent);
+                tx_frame_queue_done(&queue);
+                sent++;
+            }
+        }
+        // the cdc driver picks the next frame as soon as it is idle
+        if (queue.sending < 0) {
+            int start = tx_frame_queue_start(&queue);
+            if (start >= 0) {
+                sending_tag = frames[start][0];
+                transfer_end = (now > transfer_end ? now : transfer_end) + SEND_US;
+            }
+        }
+    }
+    return now;
+}
+
+int main(void) {
+    test_state_machine();
+
+    int back_pressure_single;
+    int back_pressure_double;
+    double single = simulate_response(1, &back_pressure_single);
+    double dual = simulate_response(TX_FRAME_QUEUE_DEPTH, &back_pressure_double);
+    CHECK(dual < single, "double buffer not faster");
+    printf("USB response of %d frames, build %d us, send %d us per frame:\n", RESPONSE_FRAMES, BUILD_US, SEND_US);
+    printf("  1 frame : %7.1f ms, %2d waits\n", single / 1000, back_pressure_single);
+    printf("  %d frames: %7.1f ms, %2d waits\n", TX_FRAME_QUEUE_DEPTH, dual / 1000, back_pressure_double);
+
+    return test_result("test_usb_tx_queue");
+}
@@ -0,0 +1,30 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * What the host tests share: CHECK() counts a failed condition and prints its message, the test goes on with the
+ * next one; main() returns test_result(), which prints the outcome and gives the exit status make looks at.
+ */
+static int m_failures = 0;
+
+#define CHECK(cond, ...) do {                   \
+    if (!(cond)) {                              \
+        printf("FAIL: " __VA_ARGS__);           \
+        printf("\n");                           \
+        m_failures++;                           \
+    }                                           \
+} while (0)
+
+static inline int test_result(const char *name) {
+    if (m_failures) {
+        printf("%s: %d check(s) failed\n", name, m_failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: OK\n", name);
+    return EXIT_SUCCESS;
+}
+
+#endif
@@ -46,6 +46,7 @@ uint32_t g_hf_spi_miso;
 uint32_t g_hf_spi_mosi;
 uint32_t g_hf_spi_sck;
 uint32_t g_hf_ant_sel;
+uint32_t g_hf_rc522_irq;
 uint32_t g_reader_power;
 #endif
 
@@ -140,6 +141,7 @@ void hw_connect_init(void) {
         HF_SPI_MOSI     = (NRF_GPIO_PIN_MAP(1, 7));
         HF_SPI_SCK      = (NRF_GPIO_PIN_MAP(1, 4));
         HF_ANT_SEL      = (NRF_GPIO_PIN_MAP(1, 10));
+        HF_RC522_IRQ    = HW_PIN_NOT_CONNECTED;     // not routed on hw_v1 (HW_HF_RC522_IRQ_ROUTED), the reader polls ComIrqReg
 
         READER_POWER    = (NRF_GPIO_PIN_MAP(1, 15));
     }
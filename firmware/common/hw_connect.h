@@ -74,6 +74,9 @@ extern nrf_saadc_input_t g_bat_sense;
 #define BAT_SENSE_PIN   g_bat_sense_pin
 #define BAT_SENSE       g_bat_sense
 
+// Pin of a signal the board does not route to the MCU
+#define HW_PIN_NOT_CONNECTED    0xFFFFFFFF
+
 #if defined(PROJECT_CHAMELEON_ULTRA)
 extern uint32_t g_lf_ant_driver;
 extern uint32_t g_lf_oa_out;
@@ -82,6 +85,7 @@ extern uint32_t g_hf_spi_miso;
 extern uint32_t g_hf_spi_mosi;
 extern uint32_t g_hf_spi_sck;
 extern uint32_t g_hf_ant_sel;
+extern uint32_t g_hf_rc522_irq;
 extern uint32_t g_reader_power;
 
 #define LF_ANT_DRIVER  g_lf_ant_driver
@@ -91,7 +95,13 @@ extern uint32_t g_reader_power;
 #define HF_SPI_MOSI    g_hf_spi_mosi
 #define HF_SPI_SCK     g_hf_spi_sck
 #define HF_ANT_SEL     g_hf_ant_sel
+#define HF_RC522_IRQ   g_hf_rc522_irq
 #define READER_POWER   g_reader_power
+
+// A board revision routing the IRQ pin of the RC522 sets it to build the reader with the GPIOTE wait, hw_v1 does not
+#ifndef HW_HF_RC522_IRQ_ROUTED
+#define HW_HF_RC522_IRQ_ROUTED  0
+#endif
 #endif
 
 
@@ -9,9 +9,6 @@ import colorama
 import chameleon_cli_unit
 import chameleon_utils
 import pathlib
-import prompt_toolkit
-from prompt_toolkit.formatted_text import ANSI
-from prompt_toolkit.history import FileHistory
 from chameleon_utils import CR, CG, CY, color_string
 
 
@@ -121,6 +118,8 @@ class ChameleonCLI:
 
         :return: current cmd prompt
         """
+        from prompt_toolkit.formatted_text import ANSI
+
         if self.device_com.isOpen():
             status = color_string((CG, 'USB'))
         else:
@@ -137,9 +136,14 @@ class ChameleonCLI:
         """
         print(color_string((CY, BANNER)))
 
-    def exec_cmd(self, cmd_str):
+    def exec_cmd(self, cmd_str) -> bool:
+        """
+            Run one command line.
+
+        :return: False if the command could not be parsed or failed
+        """
         if cmd_str == '':
-            return
+            return True
 
         # look for alternate exit
         if cmd_str in ["quit", "q", "e"]:
@@ -163,7 +167,7 @@ class ChameleonCLI:
                 else:
                     help_line = (f" - {cmd_title}".ljust(37)) + f"{child.help_text}"
                 print(help_line)
-            return
+            return True
 
         unit: chameleon_cli_unit.BaseCLIUnit = tree_node.cls()
         unit.device_com = self.device_com
@@ -175,18 +179,18 @@ class ChameleonCLI:
         try:
             args_parse_result = args.parse_args(arg_list)
             if args.help_requested:
-                return
+                return True
         except chameleon_utils.ArgsParserError as e:
             args.print_help()
             print(color_string((CY, str(e).strip())))
-            return
+            return False
         except chameleon_utils.ParserExitIntercept:
             # don't exit process.
-            return
+            return False
         try:
             # before process cmd, we need to do something...
             if not unit.before_exec(args_parse_result):
-                return
+                return False
 
             # start process cmd, delay error to call after_exec firstly
             error = None
@@ -200,8 +204,11 @@ class ChameleonCLI:
 
         except (chameleon_utils.UnexpectedResponseError, chameleon_utils.ArgsParserError) as e:
             print(color_string((CR, str(e))))
+            return False
         except Exception:
             print(f"CLI exception: {color_string((CR, traceback.format_exc()))}")
+            return False
+        return True
 
     def startCLI(self):
         """
@@ -209,6 +216,10 @@ class ChameleonCLI:
 
         :return:
         """
+        # prompt_toolkit sessions are slow to import and not needed by the script mode
+        import prompt_toolkit
+        from prompt_toolkit.history import FileHistory
+
         self.completer = chameleon_utils.CustomNestedCompleter.from_clitree(chameleon_cli_unit.root)
         self.session = prompt_toolkit.PromptSession(completer=self.completer,
                                                     history=FileHistory(str(pathlib.Path.home() /
@@ -233,15 +244,41 @@ class ChameleonCLI:
                     cmd_str = 'exit'
             self.exec_cmd(cmd_str)
 
+    def run_script(self, script) -> int:
+        """
+            Run the commands of a file, one per line, on the same connection and stop at the first failure.
+
+        :param script: opened command file
+        :return: process exit code
+        """
+        for line_number, cmd_str in enumerate(script, 1):
+            cmd_str = cmd_str.strip()
+            if not self.exec_cmd(cmd_str):
+                print(color_string((CR, f"Script stopped, line {line_number} failed: {cmd_str}")))
+                self.device_com.close()
+                return 1
+        self.device_com.close()
+        return 0
+
+
+def parse_main_args():
+    parser = argparse.ArgumentParser(description='Chameleon Ultra / Lite client')
+    parser.add_argument('--script', type=argparse.FileType('r', encoding='utf-8'), metavar='FILE',
+                        help="Run the commands of FILE ('-' for stdin) then exit, without prompt")
+    return parser.parse_args()
+
 
 if __name__ == '__main__':
     if sys.version_info < (3, 9):
         raise Exception("This script requires at least Python 3.9")
+    main_args = parse_main_args()
     colorama.init(autoreset=True)
     
     # Check for sufficient privileges on Linux
     if sys.platform == 'linux' and not check_privileges():
         escalate_privileges()
     
+    if main_args.script is not None:
+        sys.exit(ChameleonCLI().run_script(main_args.script))
     chameleon_cli_unit.check_tools()
     ChameleonCLI().startCLI()
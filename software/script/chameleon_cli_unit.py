@@ -1,4 +1,5 @@
 import binascii
+import functools
 import glob
 import math
 import os
@@ -25,9 +26,10 @@ from chameleon_utils import ArgumentParserNoExit, ArgsParserError, UnexpectedRes
     tqdm_if_exists, print_key_table
 from chameleon_utils import CLITree
 from chameleon_utils import CR, CG, CB, CC, CY, C0, color_string
-from chameleon_utils import print_mem_dump
+from chameleon_utils import print_mem_dump, ble_throughput_estimate
 from chameleon_enum import Command, Status, SlotNumber, TagSenseType, TagSpecificType
 from chameleon_enum import MifareClassicWriteMode, MifareClassicPrngType, MifareClassicDarksideStatus, MfcKeyType
+from chameleon_enum import MifareClassicDetectionPolicy
 from chameleon_enum import MifareUltralightWriteMode
 from chameleon_enum import AnimationMode, ButtonPressFunction, ButtonType, MfcValueBlockOperator
 from chameleon_enum import HIDFormat
@@ -243,7 +245,11 @@ def load_dic_file(import_dic, keys):
     return keys
 
 
-def check_tools():
+@functools.cache
+def get_missing_tools() -> tuple[str, ...]:
+    """
+    Tools not found in the bin directory, looked up once per process
+    """
     bin_dir = default_cwd
     missing_tools = []
 
@@ -253,7 +259,11 @@ def check_tools():
             continue
         else:
             missing_tools.append(tool)
+    return tuple(missing_tools)
 
+
+def check_tools():
+    missing_tools = get_missing_tools()
     if missing_tools:
         missing_tool_str = ", ".join(missing_tools)
         warn_str = f"Warning, {missing_tool_str} not found. Corresponding commands will not work as intended."
@@ -817,6 +827,7 @@ class HWConnect(BaseCLIUnit):
         parser = ArgumentParserNoExit()
         parser.description = 'Connect to chameleon by serial port'
         parser.add_argument('-p', '--port', type=str, required=False)
+        parser.add_argument('--no-compression', action='store_true', help="Receive the responses uncompressed")
         return parser
 
     def on_exec(self, args: argparse.Namespace):
@@ -855,6 +866,8 @@ class HWConnect(BaseCLIUnit):
                     return
             self.device_com.open(args.port)
             self.device_com.commands = self.cmd.get_device_capabilities()
+            if Command.SET_FRAME_COMPRESSION in self.device_com.commands and not args.no_compression:
+                self.cmd.set_frame_compression(True)
             major, minor = self.cmd.get_app_version()
             model = ['Ultra', 'Lite'][self.cmd.get_device_model()]
             print(f" {{ Chameleon {model} connected: v{major}.{minor} }}")
@@ -2524,14 +2537,20 @@ class HFMFFCHK(ReaderRequiredUnit):
         parser.set_defaults(maxSectors=16)
         return parser
 
-    def check_keys(self, mask: bytearray, keys: list[bytes], chunkSize=20):
+    def check_keys(self, mask: bytearray, keys: list[bytes], chunkSize=None):
         sectorKeys = dict()
+        if chunkSize is None:
+            chunkSize = self.cmd.mf1_check_keys_max()
+
+        def on_hit(sector, key_type, key):
+            print(f'   sector {color_string((CY, f"{sector:02d}"))} key {"A" if key_type == 0x60 else "B"}: '
+                  f'{color_string((CG, key.hex().upper()))}')
 
         for i in range(0, len(keys), chunkSize):
             # print("mask = {}".format(mask.hex(sep=' ', bytes_per_sep=1)))
             chunkKeys = keys[i:i+chunkSize]
             print(f' - progress of checking keys... {color_string((CY, i))} / {len(keys)} ({color_string((CY, f"{100 * i / len(keys):.1f}"))} %)')
-            resp = self.cmd.mf1_check_keys_of_sectors(mask, chunkKeys)
+            resp = self.cmd.mf1_check_keys_of_sectors(mask, chunkKeys, on_hit=on_hit)
             # print(resp)
 
             if resp["status"] != Status.HF_TAG_OK:
@@ -2692,20 +2711,17 @@ class HFMFView(MF1AuthArgsUnit):
                 keys.append((a, b))
             if len(keys) != args.maxSectors:
                 raise ArgsParserError(f"Invalid key file. Found {len(keys)}, expected {args.maxSectors}")
-            # iterate over blocks
-            for blk in range(0, args.maxSectors * 4):
-                resp = None
-                try:
-                    # first try with key B
-                    resp = self.cmd.mf1_read_one_block(blk, MfcKeyType.B, keys[blk//4][1])
-                except UnexpectedResponseError:
-                    # ignore read errors at this stage as we want to try key A
-                    pass
-                if not resp:
-                    # try with key A if B was unsuccessful
-                    # this will raise an exception if key A fails too
-                    resp = self.cmd.mf1_read_one_block(blk, MfcKeyType.A, keys[blk//4][0])
-                data.extend(resp)
+            # the device reads every block of every sector, with key A first then key B
+            blocks = self.cmd.mf1_read_sectors({sector: keys[sector] for sector in range(args.maxSectors)})
+            for blk in sorted(blocks.keys()):
+                status, block_data = blocks[blk]
+                if status != Status.HF_TAG_OK:
+                    try:
+                        status_string = str(Status(status))
+                    except ValueError:
+                        status_string = f"status {status:#04x}"
+                    print(color_string((CY, f"Block {blk} can not be read ({status_string})")))
+                data.extend(block_data)
         else:
             raise ArgsParserError("Missing args. Specify --dump-file (-d) or --key-file (-k)")
         print_mem_dump(data, 16)
@@ -2883,8 +2899,8 @@ class ItemGenerator:
         self.j = 1
         self.found = set()
         self.keys = set()
-        for known_key in uid_found_keys:
-            self.test_key(known_key)
+        if len(uid_found_keys) > 0:
+            self.test_keys(list(uid_found_keys))
 
     def __iter__(self):
         return self
@@ -2927,6 +2943,22 @@ class ItemGenerator:
                 self.keys.add(key)
                 self.found.add(item_key)
 
+    def test_keys(self, keys: list):
+        for item in self.rs:
+            item_key = self.key_from_item(item)
+            if item_key in self.found:
+                continue
+            found_keys = Crypto1.verify_keys(
+                int(item['uid'], 16),
+                int(item['nt'], 16),
+                int(item['nr'], 16),
+                int(item['ar'], 16),
+                keys,
+            )
+            if len(found_keys) > 0:
+                self.keys.update(found_keys)
+                self.found.add(item_key)
+
 @hf_mf.command('elog')
 class HFMFELog(DeviceRequiredUnit):
     detection_log_size = 18
@@ -2935,6 +2967,8 @@ class HFMFELog(DeviceRequiredUnit):
         parser = ArgumentParserNoExit()
         parser.description = 'MF1 Detection log count/decrypt'
         parser.add_argument('--decrypt', action='store_true', help="Decrypt key from MF1 log list")
+        parser.add_argument('--policy', type=str, choices=[p.name.lower() for p in MifareClassicDetectionPolicy],
+                            help="Once the log is full: stop logging or overwrite the oldest records")
         return parser
 
     def decrypt_by_list(self, rs: list, uid_found_keys: set = set()):
@@ -2958,24 +2992,20 @@ class HFMFELog(DeviceRequiredUnit):
         return gen.keys
 
     def on_exec(self, args: argparse.Namespace):
+        if args.policy is not None:
+            self.cmd.mf1_set_detection_policy(MifareClassicDetectionPolicy[args.policy.upper()])
         if not args.decrypt:
             count = self.cmd.mf1_get_detection_count()
-            print(f" - MF1 detection log count = {count}")
+            policy = self.cmd.mf1_get_detection_policy()
+            print(f" - MF1 detection log count = {count}/{policy['capacity']} ({policy['policy']})")
+            print(f" - Duplicates not stored = {policy['duplicates']}, records dropped = {policy['dropped']}")
             return
-        index = 0
         count = self.cmd.mf1_get_detection_count()
         if count == 0:
             print(" - No detection log to download")
             return
-        print(f" - MF1 detection log count = {count}, start download", end="")
-        result_list = []
-        while index < count:
-            tmp = self.cmd.mf1_get_detection_log(index)
-            recv_count = len(tmp)
-            index += recv_count
-            result_list.extend(tmp)
-            print("."*recv_count, end="")
-        print()
+        print(f" - MF1 detection log count = {count}, start download")
+        result_list = self.cmd.mf1_get_detection_log()
         print(f" - Download done ({len(result_list)} records), start parse and decrypt")
         # classify
         result_maps = {}
@@ -3048,19 +3078,9 @@ class HFMFELoad(SlotIndexArgsAndGoUnit, DeviceRequiredUnit):
         if len(buffer) / 16 > 256:
             raise Exception("Data block memory overflow")
 
-        index = 0
-        block = 0
-        max_blocks = (self.device_com.data_max_length - 1) // 16
-        while index + 16 < len(buffer):
-            # split a block from buffer
-            block_data = buffer[index: index + 16*max_blocks]
-            n_blocks = len(block_data) // 16
-            index += 16*n_blocks
-            # load to device
-            self.cmd.mf1_write_emu_block_data(block, block_data)
-            print('.'*n_blocks, end='')
-            block += n_blocks
-        print("\n - Load success")
+        # load to device, the whole dump is checked with CRC32 once written
+        self.cmd.emu_memory_bulk_write(0, bytes(buffer))
+        print(" - Load success")
 
 
 @hf_mf.command('esave')
@@ -3088,26 +3108,12 @@ class HFMFESave(SlotIndexArgsAndGoUnit, DeviceRequiredUnit):
         selected_slot = self.cmd.get_active_slot()
         slot_info = self.cmd.get_slot_info()
         tag_type = TagSpecificType(slot_info[selected_slot]['hf'])
-        if tag_type == TagSpecificType.MIFARE_Mini:
-            block_count = 20
-        elif tag_type == TagSpecificType.MIFARE_1024:
-            block_count = 64
-        elif tag_type == TagSpecificType.MIFARE_2048:
-            block_count = 128
-        elif tag_type == TagSpecificType.MIFARE_4096:
-            block_count = 256
-        else:
+        if tag_type not in [TagSpecificType.MIFARE_Mini, TagSpecificType.MIFARE_1024,
+                            TagSpecificType.MIFARE_2048, TagSpecificType.MIFARE_4096]:
             raise Exception("Card in current slot is not Mifare Classic/Plus in SL1 mode")
 
-        index = 0
-        data = bytearray(0)
-        max_blocks = self.device_com.data_max_length // 16
-        while block_count > 0:
-            chunk_count = min(block_count, max_blocks)
-            data.extend(self.cmd.mf1_read_emu_block_data(index, chunk_count))
-            index += chunk_count
-            block_count -= chunk_count
-            print('.'*chunk_count, end='')
+        # the whole memory of the slot, checked with CRC32
+        data = self.cmd.emu_memory_bulk_read()
 
         with open(file, 'wb') as fd:
             if content_type == 'hex':
@@ -3115,7 +3121,7 @@ class HFMFESave(SlotIndexArgsAndGoUnit, DeviceRequiredUnit):
                     fd.write(binascii.hexlify(data[i*16:(i+1)*16])+b'\n')
             else:
                 fd.write(data)
-        print("\n - Read success")
+        print(" - Read success")
 
 
 @hf_mf.command('eview')
@@ -3131,25 +3137,10 @@ class HFMFEView(SlotIndexArgsAndGoUnit, DeviceRequiredUnit):
         slot_info = self.cmd.get_slot_info()
         tag_type = TagSpecificType(slot_info[selected_slot]['hf'])
 
-        if tag_type == TagSpecificType.MIFARE_Mini:
-            block_count = 20
-        elif tag_type == TagSpecificType.MIFARE_1024:
-            block_count = 64
-        elif tag_type == TagSpecificType.MIFARE_2048:
-            block_count = 128
-        elif tag_type == TagSpecificType.MIFARE_4096:
-            block_count = 256
-        else:
+        if tag_type not in [TagSpecificType.MIFARE_Mini, TagSpecificType.MIFARE_1024,
+                            TagSpecificType.MIFARE_2048, TagSpecificType.MIFARE_4096]:
             raise Exception("Card in current slot is not Mifare Classic/Plus in SL1 mode")
-        index = 0
-        data = bytearray(0)
-        max_blocks = self.device_com.data_max_length // 16
-        while block_count > 0:
-            # read all the blocks
-            chunk_count = min(block_count, max_blocks)
-            data.extend(self.cmd.mf1_read_emu_block_data(index, chunk_count))
-            index += chunk_count
-            block_count -= chunk_count
+        data = self.cmd.emu_memory_bulk_read()
         print_mem_dump(data, 16)
 
 
@@ -3467,14 +3458,10 @@ class HFMFUEVIEW(DeviceRequiredUnit):
         return parser
 
     def on_exec(self, args: argparse.Namespace):
-        nr_pages = self.cmd.mfu_get_emu_pages_count()
-        page = 0
-        while page < nr_pages:
-            count = min(nr_pages - page, 16)
-            data = self.cmd.mfu_read_emu_page_data(page, count)
-            for i in range(0, len(data), 4):
-                print(f"#{page+(i >> 2):02x}: {data[i:i+4].hex()}")
-            page += count
+        # this will throw an exception on incorrect slot type
+        data = self.cmd.emu_memory_bulk_read()
+        for i in range(0, len(data), 4):
+            print(f"#{i >> 2:02x}: {data[i:i+4].hex()}")
 
 
 @hf_mfu.command('eload')
@@ -3526,19 +3513,7 @@ class HFMFUELOAD(DeviceRequiredUnit):
         elif len(data) < size:
             print(color_string((CY, f"Dump file is smaller than the current slot's memory ({len(data)} < {size}).")))
 
-        nr_pages = len(data) >> 2
-        page = 0
-        while page < nr_pages:
-            offset = page * 4
-            cur_count = min(16, nr_pages - page)
-
-            if offset >= len(data):
-                page_data = bytes.fromhex("00000000") * cur_count
-            else:
-                page_data = data[offset:offset + 4 * cur_count]
-
-            self.cmd.mfu_write_emu_page_data(page, page_data)
-            page += cur_count
+        self.cmd.emu_memory_bulk_write(0, data)
 
         print(" - Ok")
 
@@ -3603,18 +3578,12 @@ class HFMFUESAVE(DeviceRequiredUnit):
                 except:
                     pass  # slot does not have signature data
 
-            page = 0
-            while page < nr_pages:
-                cur_count = min(32, nr_pages - page)
-
-                data = self.cmd.mfu_read_emu_page_data(page, cur_count)
-                if save_as_eml:
-                    for i in range(0, len(data), 4):
-                        fd.write(data[i:i+4].hex() + "\n")
-                else:
-                    fd.write(data)
-
-                page += cur_count
+            data = self.cmd.emu_memory_bulk_read(0, nr_pages * 4)
+            if save_as_eml:
+                for i in range(0, len(data), 4):
+                    fd.write(data[i:i+4].hex() + "\n")
+            else:
+                fd.write(data)
 
         print(" - Ok")
 
@@ -4306,15 +4275,60 @@ class HWSlotList(DeviceRequiredUnit):
             name = "UTF8 Err"
             return {'baselen': len(name), 'metalen': len(CC+C0), 'name': color_string((CC, name))}
 
+    MF1_TAG_TYPES = [
+        TagSpecificType.MIFARE_Mini,
+        TagSpecificType.MIFARE_1024,
+        TagSpecificType.MIFARE_2048,
+        TagSpecificType.MIFARE_4096,
+    ]
+    LF_GET_EMU_ID = {
+        TagSpecificType.EM410X: Command.EM410X_GET_EMU_ID,
+        TagSpecificType.HIDProx: Command.HIDPROX_GET_EMU_ID,
+        TagSpecificType.Viking: Command.VIKING_GET_EMU_ID,
+    }
+
+    def slot_requests(self, args: argparse.Namespace, slot, current, slotinfo, enabled):
+        """
+            The commands list_slots runs for a slot, fetched in one batch then run in this order
+        """
+        fwslot = SlotNumber.to_fw(slot)
+        hf_tag_type = TagSpecificType(slotinfo[fwslot]['hf'])
+        lf_tag_type = TagSpecificType(slotinfo[fwslot]['lf'])
+        show_hf = (not args.short) and enabled[fwslot]['hf'] and hf_tag_type != TagSpecificType.UNDEFINED
+        show_lf = (not args.short) and enabled[fwslot]['lf'] and lf_tag_type != TagSpecificType.UNDEFINED
+        requests = []
+        if (show_hf or show_lf) and current != slot:
+            requests.append((Command.SET_ACTIVE_SLOT, struct.pack('!B', fwslot)))
+        if show_hf:
+            requests.append((Command.HF14A_GET_ANTI_COLL_DATA, None))
+            if hf_tag_type in self.MF1_TAG_TYPES:
+                requests.append((Command.MF1_GET_EMULATOR_CONFIG, None))
+        if show_lf and lf_tag_type in self.LF_GET_EMU_ID:
+            requests.append((self.LF_GET_EMU_ID[lf_tag_type], None))
+        return requests
+
     def on_exec(self, args: argparse.Namespace):
+        try:
+            self.list_slots(args)
+        finally:
+            self.device_com.clear_prefetched()
+
+    def list_slots(self, args: argparse.Namespace):
+        self.cmd.prefetch([
+            (Command.GET_SLOT_INFO, None),
+            (Command.GET_ACTIVE_SLOT, None),
+            (Command.GET_ENABLED_SLOTS, None),
+            (Command.GET_ALL_SLOT_NICKS, b''),
+        ])
         slotinfo = self.cmd.get_slot_info()
         selected = SlotNumber.from_fw(self.cmd.get_active_slot())
         current = selected
         enabled = self.cmd.get_enabled_slots()
+        all_nicks = self.cmd.get_all_slot_nicks()
+        self.device_com.clear_prefetched()
         maxnamelength = 0
 
         slotnames = []
-        all_nicks = self.cmd.get_all_slot_nicks()
         for slot_data in all_nicks:
             hfn = {'baselen': len(slot_data['hf']), 'metalen': len(CC+C0), 'name': color_string((CC, slot_data["hf"]))}
             lfn = {'baselen': len(slot_data['lf']), 'metalen': len(CC+C0), 'name': color_string((CC, slot_data["lf"]))}
@@ -4328,97 +4342,99 @@ class HWSlotList(DeviceRequiredUnit):
             hf_tag_type = TagSpecificType(slotinfo[fwslot]['hf'])
             lf_tag_type = TagSpecificType(slotinfo[fwslot]['lf'])
             print(f' - {f"Slot {slot}:":{4+maxnamelength+1}} {status}')
-
-            # HF
-            field_length = maxnamelength+slotnames[fwslot]["hf"]["metalen"]+1
-            status = f"({color_string((CR, 'disabled'))})" if not enabled[fwslot]["hf"] else ""
-            print(f'   HF: '
-                  f'{slotnames[fwslot]["hf"]["name"]:{field_length}}', end='')
-            print(status, end='')
-            if hf_tag_type != TagSpecificType.UNDEFINED:
-                color = CY if enabled[fwslot]['hf'] else C0
-                print(color_string((color, hf_tag_type)))
-            else:
-                print("undef")
-            if (not args.short) and enabled[fwslot]['hf'] and hf_tag_type != TagSpecificType.UNDEFINED:
-                if current != slot:
-                    self.cmd.set_active_slot(slot)
-                    current = slot
-                anti_coll_data = self.cmd.hf14a_get_anti_coll_data()
-                uid = anti_coll_data['uid']
-                atqa = anti_coll_data['atqa']
-                sak = anti_coll_data['sak']
-                ats = anti_coll_data['ats']
-                # print('    - ISO14443A emulator settings:')
-                atqa_hex_le = f"(0x{int.from_bytes(atqa, byteorder='little'):04x})"
-                print(f'      {"UID:":40}{color_string((CY, uid.hex().upper()))}')
-                print(f'      {"ATQA:":40}{color_string((CY, f"{atqa.hex().upper()} {atqa_hex_le}"))}')
-                print(f'      {"SAK:":40}{color_string((CY, sak.hex().upper()))}')
-                if len(ats) > 0:
-                    print(f'      {"ATS:":40}{color_string((CY, ats.hex().upper()))}')
-                if hf_tag_type in [
-                    TagSpecificType.MIFARE_Mini,
-                    TagSpecificType.MIFARE_1024,
-                    TagSpecificType.MIFARE_2048,
-                    TagSpecificType.MIFARE_4096,
-                ]:
-                    config = self.cmd.mf1_get_emulator_config()
-                    # print('    - Mifare Classic emulator settings:')
-                    enabled_str = color_string((CG, "enabled"))
-                    disabled_str = color_string((CR, "disabled"))
-                    print(
-                        f'      {"Gen1A magic mode:":40}'
-                        f'{enabled_str if config["gen1a_mode"] else disabled_str}')
-                    print(
-                        f'      {"Gen2 magic mode:":40}'
-                        f'{enabled_str if config["gen2_mode"] else disabled_str}')
-                    print(
-                        f'      {"Use anti-collision data from block 0:":40}'
-                        f'{enabled_str if config["block_anti_coll_mode"] else disabled_str}')
-                    try:
-                        print(f'      {"Write mode:":40}'
-                              f'{color_string((CY, MifareClassicWriteMode(config["write_mode"])))}')
-                    except ValueError:
-                        print(f'      {"Write mode:":40}{color_string((CR, "invalid value!"))}')
-                    print(
-                        f'      {"Log (mfkey32) mode:":40}'
-                        f'{enabled_str if config["detection"] else disabled_str}')
-
-            # LF
-            field_length = maxnamelength+slotnames[fwslot]["lf"]["metalen"]+1
-            status = f"({color_string((CR, 'disabled'))})" if not enabled[fwslot]["lf"] else ""
-            print(f'   LF: '
-                  f'{slotnames[fwslot]["lf"]["name"]:{field_length}}', end='')
-            print(status, end='')
-            if lf_tag_type != TagSpecificType.UNDEFINED:
-                color = CY if enabled[fwslot]['lf'] else C0
-                print(color_string((color, lf_tag_type)))
-            else:
-                print("undef")
-            if (not args.short) and enabled[fwslot]['lf'] and lf_tag_type != TagSpecificType.UNDEFINED:
-                if current != slot:
+            # the responses of a slot are used by it alone
+            requests = self.slot_requests(args, slot, current, slotinfo, enabled)
+            commands = [req_cmd for req_cmd, _ in requests]
+            try:
+                self.cmd.prefetch(requests)
+                if Command.SET_ACTIVE_SLOT in commands:
                     self.cmd.set_active_slot(slot)
                     current = slot
-                if lf_tag_type == TagSpecificType.EM410X:
-                    id = self.cmd.em410x_get_emu_id()
-                    print(f'      {"ID:":40}{color_string((CY, id.hex().upper()))}')
-                if lf_tag_type == TagSpecificType.HIDProx:
-                    (format, fc, cn1, cn2, il, oem) = self.cmd.hidprox_get_emu_id()
-                    cn = (cn1 << 32) + cn2
-                    print(f"      {'Format:':40}{color_string((CY, HIDFormat(format)))}")
-                    if fc > 0:
-                        print(f" FC: {color_string((CG, fc))}")
-                    if il > 0:
-                        print(f" IL: {color_string((CG, il))}")
-                    if oem > 0:
-                        print(f" OEM: {color_string((CG, oem))}")
-                    print(f" CN: {color_string((CG, cn))}")
-                if lf_tag_type == TagSpecificType.Viking:
-                    id = self.cmd.viking_get_emu_id()
-                    print(f"      {'ID:':40}{color_string((CY, id.hex().upper()))}")
+                self.print_slot_hf(slotnames[fwslot]['hf'], maxnamelength, enabled[fwslot]['hf'], hf_tag_type,
+                                   commands)
+                self.print_slot_lf(slotnames[fwslot]['lf'], maxnamelength, enabled[fwslot]['lf'], lf_tag_type,
+                                   commands)
+            finally:
+                self.device_com.clear_prefetched()
         if current != selected:
             self.cmd.set_active_slot(selected)
 
+    def print_slot_hf(self, slotname, maxnamelength, enabled, hf_tag_type, commands):
+        field_length = maxnamelength+slotname["metalen"]+1
+        status = f"({color_string((CR, 'disabled'))})" if not enabled else ""
+        print(f'   HF: '
+              f'{slotname["name"]:{field_length}}', end='')
+        print(status, end='')
+        if hf_tag_type != TagSpecificType.UNDEFINED:
+            color = CY if enabled else C0
+            print(color_string((color, hf_tag_type)))
+        else:
+            print("undef")
+        if Command.HF14A_GET_ANTI_COLL_DATA in commands:
+            anti_coll_data = self.cmd.hf14a_get_anti_coll_data()
+            uid = anti_coll_data['uid']
+            atqa = anti_coll_data['atqa']
+            sak = anti_coll_data['sak']
+            ats = anti_coll_data['ats']
+            # print('    - ISO14443A emulator settings:')
+            atqa_hex_le = f"(0x{int.from_bytes(atqa, byteorder='little'):04x})"
+            print(f'      {"UID:":40}{color_string((CY, uid.hex().upper()))}')
+            print(f'      {"ATQA:":40}{color_string((CY, f"{atqa.hex().upper()} {atqa_hex_le}"))}')
+            print(f'      {"SAK:":40}{color_string((CY, sak.hex().upper()))}')
+            if len(ats) > 0:
+                print(f'      {"ATS:":40}{color_string((CY, ats.hex().upper()))}')
+        if Command.MF1_GET_EMULATOR_CONFIG in commands:
+            config = self.cmd.mf1_get_emulator_config()
+            # print('    - Mifare Classic emulator settings:')
+            enabled_str = color_string((CG, "enabled"))
+            disabled_str = color_string((CR, "disabled"))
+            print(
+                f'      {"Gen1A magic mode:":40}'
+                f'{enabled_str if config["gen1a_mode"] else disabled_str}')
+            print(
+                f'      {"Gen2 magic mode:":40}'
+                f'{enabled_str if config["gen2_mode"] else disabled_str}')
+            print(
+                f'      {"Use anti-collision data from block 0:":40}'
+                f'{enabled_str if config["block_anti_coll_mode"] else disabled_str}')
+            try:
+                print(f'      {"Write mode:":40}'
+                      f'{color_string((CY, MifareClassicWriteMode(config["write_mode"])))}')
+            except ValueError:
+                print(f'      {"Write mode:":40}{color_string((CR, "invalid value!"))}')
+            print(
+                f'      {"Log (mfkey32) mode:":40}'
+                f'{enabled_str if config["detection"] else disabled_str}')
+
+    def print_slot_lf(self, slotname, maxnamelength, enabled, lf_tag_type, commands):
+        field_length = maxnamelength+slotname["metalen"]+1
+        status = f"({color_string((CR, 'disabled'))})" if not enabled else ""
+        print(f'   LF: '
+              f'{slotname["name"]:{field_length}}', end='')
+        print(status, end='')
+        if lf_tag_type != TagSpecificType.UNDEFINED:
+            color = CY if enabled else C0
+            print(color_string((color, lf_tag_type)))
+        else:
+            print("undef")
+        if Command.EM410X_GET_EMU_ID in commands:
+            id = self.cmd.em410x_get_emu_id()
+            print(f'      {"ID:":40}{color_string((CY, id.hex().upper()))}')
+        if Command.HIDPROX_GET_EMU_ID in commands:
+            (format, fc, cn1, cn2, il, oem) = self.cmd.hidprox_get_emu_id()
+            cn = (cn1 << 32) + cn2
+            print(f"      {'Format:':40}{color_string((CY, HIDFormat(format)))}")
+            if fc > 0:
+                print(f" FC: {color_string((CG, fc))}")
+            if il > 0:
+                print(f" IL: {color_string((CG, il))}")
+            if oem > 0:
+                print(f" OEM: {color_string((CG, oem))}")
+            print(f" CN: {color_string((CG, cn))}")
+        if Command.VIKING_GET_EMU_ID in commands:
+            id = self.cmd.viking_get_emu_id()
+            print(f"      {'ID:':40}{color_string((CY, id.hex().upper()))}")
+
 
 @hw_slot.command('change')
 class HWSlotSet(SlotIndexArgsUnit):
@@ -4783,6 +4799,57 @@ class HWBatteryInfo(DeviceRequiredUnit):
             print(color_string((CR, "[!] Low battery, please charge.")))
 
 
+@hw.command('blestatus')
+class HWBleLinkStatus(DeviceRequiredUnit):
+    PHY_NAMES = {1: '1M', 2: '2M', 4: 'Coded'}
+
+    def args_parser(self) -> ArgumentParserNoExit:
+        parser = ArgumentParserNoExit()
+        parser.description = 'Get the negotiated BLE link parameters and the expected throughput'
+        return parser
+
+    def on_exec(self, args: argparse.Namespace):
+        link = self.cmd.get_ble_link_status()
+        if not link['connected']:
+            print(" - BLE not connected")
+            return
+        print(" - BLE link:")
+        print(f"   profile       -> {'bulk transfer' if link['bulk_mode'] else 'default'}")
+        print(f"   PHY tx/rx     -> {self.PHY_NAMES.get(link['tx_phy'], link['tx_phy'])}"
+              f"/{self.PHY_NAMES.get(link['rx_phy'], link['rx_phy'])}")
+        print(f"   ATT MTU       -> {link['att_mtu']}")
+        print(f"   data length   -> {link['data_length']}")
+        print(f"   interval      -> {link['conn_interval_ms']} ms")
+        print(f"   tx queue      -> {link['tx_queue_depth']} bytes")
+        estimate = ble_throughput_estimate(link['att_mtu'], link['data_length'], link['conn_interval_ms'],
+                                           phy=link['tx_phy'] if link['tx_phy'] in (1, 2) else 1)
+        print(f"   estimated     -> {estimate['bytes_per_second'] / 1024:.1f} kB/s")
+
+
+@hw.command('storage')
+class HWStorageStatus(DeviceRequiredUnit):
+
+    def args_parser(self) -> ArgumentParserNoExit:
+        parser = ArgumentParserNoExit()
+        parser.description = 'Get the flash write queue depth and the flash usage'
+        return parser
+
+    def on_exec(self, args: argparse.Namespace):
+        storage = self.cmd.get_storage_status()
+        print(" - Flash write queue:")
+        print(f"   depth         -> {storage['queue_depth']} records, {storage['queue_bytes']}"
+              f"/{storage['queue_size']} bytes (most {storage['queue_depth_max']} records)")
+        print(f"   writes        -> {storage['writes']}, {storage['coalesced']} coalesced, "
+              f"{storage['stalls']} stalls, {storage['failures']} failed")
+        print(f"   GC            -> {storage['gc_idle']} idle, {storage['gc_full']} on a full flash")
+        print(" - Flash usage:")
+        used = storage['used_bytes'] - storage['freeable_bytes']
+        print(f"   used          -> {used}/{storage['flash_bytes']} bytes "
+              f"({used * 100 / storage['flash_bytes']:.1f}%), {storage['valid_records']} records")
+        print(f"   freeable      -> {storage['freeable_bytes']} bytes, {storage['dirty_records']} records")
+        print(f"   largest free  -> {storage['largest_free_bytes']} bytes")
+
+
 @hw_settings.command('btnpress')
 class HWButtonSettingsGet(DeviceRequiredUnit):
 
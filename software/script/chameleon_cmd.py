@@ -1,12 +1,13 @@
 import struct
 import ctypes
+import zlib
 from typing import Union
 
 import chameleon_com
-from chameleon_utils import expect_response, reconstruct_full_nt, parity_to_str
+from chameleon_utils import expect_response, reconstruct_full_nt, parity_to_str, UnexpectedResponseError
 from chameleon_enum import Command, SlotNumber, Status, TagSenseType, TagSpecificType
 from chameleon_enum import ButtonPressFunction, ButtonType, MifareClassicDarksideStatus
-from chameleon_enum import MfcKeyType, MfcValueBlockOperator
+from chameleon_enum import MfcKeyType, MfcValueBlockOperator, MifareClassicDetectionPolicy
 
 CURRENT_VERSION_SETTINGS = 5
 
@@ -303,14 +304,15 @@ class ChameleonCMD:
         return resp
 
     @expect_response([Status.HF_TAG_OK, Status.HF_TAG_NO])
-    def mf1_check_keys_of_sectors(self, mask: bytes, keys: list[bytes]):
+    def mf1_check_keys_of_sectors(self, mask: bytes, keys: list[bytes], on_hit=None):
         """
         Check keys of sectors.
+        :param on_hit: called with (sector, key_type, key) as soon as the device finds a key
         :return:
         """
         if len(mask) != 10:
             raise ValueError("len(mask) should be 10")
-        if len(keys) < 1 or len(keys) > 83:
+        if len(keys) < 1 or len(keys) > self.mf1_check_keys_max():
             raise ValueError("Invalid len(keys)")
         data = struct.pack(f'!10s{6*len(keys)}s', mask, b''.join(keys))
 
@@ -330,7 +332,15 @@ class ChameleonCMD:
         # read keyB from trailer block: 0.1s
         timeout = 1 + (bitsCnt + 1) * len(keys) * 0.1
 
-        resp = self.device.send_cmd_sync(Command.MF1_CHECK_KEYS_OF_SECTORS, data, timeout=timeout)
+        def on_more_data(hits: bytes):
+            # sector, key type and key of each hit, the final frame has all of them again
+            if callable(on_hit):
+                for sector, key_type, key in struct.iter_unpack('!BB6s', hits):
+                    on_hit(sector, key_type, key)
+
+        # the hits stay out of resp.data, which is the final frame alone
+        resp = self.device.send_cmd_sync(Command.MF1_CHECK_KEYS_OF_SECTORS, data, timeout=timeout,
+                                         on_more_data=on_more_data)
         resp.parsed = {'status': resp.status}
         if len(resp.data) == 490:
             found = ''.join([format(i, '08b') for i in resp.data[0:10]])
@@ -341,6 +351,12 @@ class ChameleonCMD:
             })
         return resp
 
+    def mf1_check_keys_max(self) -> int:
+        """
+        Number of keys one check keys of sectors request can carry, after the mask.
+        """
+        return (self.device.data_max_length - 10) // 6
+
     @expect_response([Status.HF_TAG_OK, Status.HF_TAG_NO, Status.MF_ERR_AUTH])
     def mf1_check_keys_on_block(self, block: int, key_type: int, keys: list[bytes]):
         if key_type not in [0x60, 0x61]:
@@ -358,6 +374,36 @@ class ChameleonCMD:
 
         return resp
 
+    @expect_response(Status.HF_TAG_OK)
+    def mf1_read_sectors(self, sector_keys: dict[int, tuple[Union[bytes, None], Union[bytes, None]]]):
+        """
+        Read all the blocks of several sectors, the device authenticates once per sector and key.
+
+        :param sector_keys: sector -> (key A, key B), None for an unknown key
+        :return: block -> (status, data), for every block of the requested sectors
+        """
+        mask = bytearray(10)
+        keys = bytearray()
+        blocks = []
+        for sector in sorted(sector_keys.keys()):
+            key_a, key_b = sector_keys[sector]
+            bits = (0b10 if key_a is not None else 0) | (0b01 if key_b is not None else 0)
+            if bits == 0:
+                continue
+            mask[sector // 4] |= bits << (6 - sector % 4 * 2)
+            keys.extend((key_a or bytes(6)) + (key_b or bytes(6)))
+            if sector < 32:
+                blocks.extend(range(sector * 4, sector * 4 + 4))
+            else:
+                blocks.extend(range(128 + (sector - 32) * 16, 128 + (sector - 31) * 16))
+        # base timeout: 1s, select + auth + read: 0.1s per block and key
+        timeout = 1 + len(blocks) * 2 * 0.1
+        resp = self.device.send_cmd_sync(Command.MF1_READ_SECTORS, bytes(mask + keys), timeout=timeout)
+        if resp.status == Status.HF_TAG_OK:
+            resp.parsed = {block: (resp.data[i * 17], resp.data[i * 17 + 1:i * 17 + 17])
+                           for i, block in enumerate(blocks)}
+        return resp
+
     @expect_response(Status.HF_TAG_OK)
     def mf1_static_nested_acquire(self, block_known, type_known, key_known, block_target, type_target):
         """
@@ -681,14 +727,14 @@ class ChameleonCMD:
         return resp
 
     @expect_response(Status.SUCCESS)
-    def mf1_get_detection_log(self, index: int):
+    def mf1_get_detection_log(self, index: Union[int, None] = None):
         """
         Get detection logs from the specified index position.
 
-        :param index: start index
+        :param index: start index, None for the whole log in one streamed response
         :return:
         """
-        data = struct.pack('!I', index)
+        data = struct.pack('!I', index) if index is not None else None
         resp = self.device.send_cmd_sync(Command.MF1_GET_DETECTION_LOG, data)
         if resp.status == Status.SUCCESS:
             # convert
@@ -709,6 +755,36 @@ class ChameleonCMD:
             resp.parsed = result_list
         return resp
 
+    @expect_response(Status.SUCCESS)
+    def mf1_set_detection_policy(self, policy: MifareClassicDetectionPolicy):
+        """
+        Set what the detection log does once full: keep its first records or overwrite the oldest.
+
+        :param policy: MifareClassicDetectionPolicy
+        :return:
+        """
+        data = struct.pack('!B', policy)
+        return self.device.send_cmd_sync(Command.MF1_SET_DETECTION_POLICY, data)
+
+    @expect_response(Status.SUCCESS)
+    def mf1_get_detection_policy(self):
+        """
+        Get the policy of the detection log, its capacity in records and the records it did not store:
+        duplicates of a record in the log, and the ones dropped while full.
+
+        :return:
+        """
+        resp = self.device.send_cmd_sync(Command.MF1_GET_DETECTION_POLICY)
+        if resp.status == Status.SUCCESS:
+            policy, capacity, duplicates, dropped = struct.unpack('!BIII', resp.data)
+            resp.parsed = {
+                'policy': MifareClassicDetectionPolicy(policy),
+                'capacity': capacity,
+                'duplicates': duplicates,
+                'dropped': dropped,
+            }
+        return resp
+
     @expect_response(Status.SUCCESS)
     def mf0_ntag_get_detection_enable(self):
         """
@@ -745,14 +821,14 @@ class ChameleonCMD:
         return resp
 
     @expect_response(Status.SUCCESS)
-    def mf0_ntag_get_detection_log(self, index: int):
+    def mf0_ntag_get_detection_log(self, index: Union[int, None] = None):
         """
         Get NTAG password detection logs from the specified index position.
 
-        :param index: start index
+        :param index: start index, None for the whole log in one streamed response
         :return:
         """
-        data = struct.pack('!I', index)
+        data = struct.pack('!I', index) if index is not None else None
         resp = self.device.send_cmd_sync(Command.MF0_NTAG_GET_DETECTION_LOG, data)
         if resp.status == Status.SUCCESS:
             # convert - each log entry is just a 4-byte password
@@ -823,6 +899,48 @@ class ChameleonCMD:
         resp = self.device.send_cmd_sync(Command.MF0_NTAG_WRITE_EMU_PAGE_DATA, data)
         return resp
 
+    @expect_response(Status.SUCCESS)
+    def emu_memory_bulk_read(self, offset: int = 0, length: int = 0):
+        """
+            Read the memory of the active MF1 / MF0 / NTAG slot in one request, length 0 means up to the end.
+            The device streams the range when larger than a frame, its CRC32 is checked on reception.
+        """
+        data = struct.pack('!HH', offset, length)
+        resp = self.device.send_cmd_sync(Command.EMU_MEMORY_BULK_READ, data)
+        if resp.status == Status.SUCCESS:
+            resp.parsed = resp.data
+        return resp
+
+    @expect_response(Status.SUCCESS)
+    def emu_memory_bulk_write_chunk(self, offset: int, data: bytes):
+        """
+            Write one frame of data to the memory of the active MF1 / MF0 / NTAG slot
+        """
+        data = struct.pack(f'!H{len(data)}s', offset, data)
+        return self.device.send_cmd_sync(Command.EMU_MEMORY_BULK_WRITE, data)
+
+    @expect_response(Status.SUCCESS)
+    def emu_memory_get_crc32(self, offset: int = 0, length: int = 0):
+        """
+            Get the CRC32 of a range of the active slot memory, length 0 means up to the end.
+        """
+        data = struct.pack('!HH', offset, length)
+        resp = self.device.send_cmd_sync(Command.EMU_MEMORY_GET_CRC32, data)
+        if resp.status == Status.SUCCESS:
+            resp.parsed, = struct.unpack('!I', resp.data)
+        return resp
+
+    def emu_memory_bulk_write(self, offset: int, data: bytes):
+        """
+            Write data to the memory of the active MF1 / MF0 / NTAG slot with max size frames,
+            then check the whole range once with CRC32.
+        """
+        chunk_size = self.device.data_max_length - struct.calcsize('!H')
+        for i in range(0, len(data), chunk_size):
+            self.emu_memory_bulk_write_chunk(offset + i, data[i:i + chunk_size])
+        if len(data) > 0 and self.emu_memory_get_crc32(offset, len(data)) != zlib.crc32(data):
+            raise UnexpectedResponseError("Emulator memory CRC32 mismatch")
+
     @expect_response(Status.SUCCESS)
     def mfu_read_emu_counter_data(self, index: int) -> tuple[int, bool]:
         """
@@ -935,6 +1053,48 @@ class ChameleonCMD:
         resp.parsed = slots
         return resp
 
+    @expect_response(Status.SUCCESS)
+    def batch(self, requests: list[tuple[int, Union[bytes, None]]]):
+        """
+            Run several commands with a single frame exchange.
+
+        :param requests: list of (cmd, data), data can be None
+        :return: list of chameleon_com.Response, in request order
+        """
+        data = b''.join(struct.pack(f'!HH{len(req_data or b"")}s', req_cmd, len(req_data or b''), req_data or b'')
+                        for req_cmd, req_data in requests)
+        resp = self.device.send_cmd_sync(Command.BATCH, data)
+        if resp.status == Status.SUCCESS:
+            results = []
+            chunks = []
+            offset = 0
+            while offset + struct.calcsize('!HHH') <= len(resp.data):
+                sub_cmd, sub_status, sub_length = struct.unpack_from('!HHH', resp.data, offset)
+                offset += struct.calcsize('!HHH')
+                sub_data = resp.data[offset:offset + sub_length]
+                offset += sub_length
+                if sub_status == Status.MORE_DATA:
+                    # partial response, joined to the next result of the same command
+                    chunks.append(sub_data)
+                    continue
+                results.append(chameleon_com.Response(cmd=sub_cmd, status=sub_status, data=b''.join(chunks) + sub_data))
+                chunks = []
+            resp.parsed = results
+        return resp
+
+    def prefetch(self, requests: list[tuple[int, Union[bytes, None]]]):
+        """
+            Run several commands in a batch and keep their responses,
+            the usual methods then return them without asking the device again.
+            Nothing is done when the device does not support batches.
+
+        :param requests: list of (cmd, data), data can be None, same as the methods send them
+        """
+        if len(requests) == 0 or Command.BATCH not in self.device.commands:
+            return
+        for (req_cmd, req_data), response in zip(requests, self.batch(requests)):
+            self.device.add_prefetched(req_cmd, req_data, response)
+
     @expect_response(Status.SUCCESS)
     def delete_slot_tag_nick(self, slot: SlotNumber, sense_type: TagSenseType):
         """
@@ -1083,6 +1243,70 @@ class ChameleonCMD:
             resp.parsed = struct.unpack('!HB', resp.data)
         return resp
 
+    @expect_response(Status.SUCCESS)
+    def get_ble_link_status(self):
+        """
+        Get the negotiated parameters of the BLE connection
+        """
+        resp = self.device.send_cmd_sync(Command.GET_BLE_LINK_STATUS)
+        if resp.status == Status.SUCCESS:
+            connected, bulk_mode, tx_phy, rx_phy, att_mtu, data_length, conn_interval, tx_queue_depth = \
+                struct.unpack('!4B4H', resp.data)
+            resp.parsed = {
+                'connected': bool(connected),
+                'bulk_mode': bool(bulk_mode),
+                'tx_phy': tx_phy,
+                'rx_phy': rx_phy,
+                'att_mtu': att_mtu,
+                'data_length': data_length,
+                'conn_interval_ms': conn_interval * 1.25,
+                'tx_queue_depth': tx_queue_depth,
+            }
+        return resp
+
+    @expect_response(Status.SUCCESS)
+    def get_storage_status(self):
+        """
+        Get the depth of the flash write queue and the usage of the flash storage
+        """
+        resp = self.device.send_cmd_sync(Command.GET_STORAGE_STATUS)
+        if resp.status == Status.SUCCESS:
+            (queue_depth, queue_bytes, queue_size, queue_depth_max, writes, coalesced, stalls, failures, gc_idle,
+             gc_full, pages, page_words, valid_records, dirty_records, words_used, freeable_words,
+             largest_contig) = struct.unpack('!4H6I7H', resp.data)
+            resp.parsed = {
+                'queue_depth': queue_depth,
+                'queue_bytes': queue_bytes,
+                'queue_size': queue_size,
+                'queue_depth_max': queue_depth_max,
+                'writes': writes,
+                'coalesced': coalesced,
+                'stalls': stalls,
+                'failures': failures,
+                'gc_idle': gc_idle,
+                'gc_full': gc_full,
+                'flash_bytes': pages * page_words * 4,
+                'used_bytes': words_used * 4,
+                'freeable_bytes': freeable_words * 4,
+                'largest_free_bytes': largest_contig * 4,
+                'valid_records': valid_records,
+                'dirty_records': dirty_records,
+            }
+        return resp
+
+    @expect_response(Status.SUCCESS)
+    def set_frame_compression(self, enabled: bool):
+        """
+        Let the device compress its responses (LZ4 block, flagged in the status), until the connection is closed
+
+        :return: True if the responses are compressed
+        """
+        data = struct.pack('!B', enabled)
+        resp = self.device.send_cmd_sync(Command.SET_FRAME_COMPRESSION, data)
+        if resp.status == Status.SUCCESS:
+            resp.parsed = bool(resp.data[0])
+        return resp
+
     @expect_response(Status.SUCCESS)
     def get_button_press_config(self, button: ButtonType):
         """
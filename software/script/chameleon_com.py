@@ -1,7 +1,9 @@
+import collections
 import queue
 import struct
 import threading
 import time
+import zlib
 import serial
 from typing import Union
 from chameleon_utils import CR, CG, CC, CY, color_string
@@ -32,6 +34,60 @@ class CMDInvalidException(Exception):
     """
 
 
+def lz4_block_decompress(data: bytes, max_length: int) -> bytes:
+    """
+        Decode a LZ4 block, the data of a frame sent with the compressed status flag.
+
+    :raise ValueError: malformed block or decoded data larger than max_length
+    """
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        token = data[pos]
+        pos += 1
+        literal_length = token >> 4
+        if literal_length == 15:
+            while True:
+                if pos >= len(data):
+                    raise ValueError("truncated literal length")
+                literal_length += data[pos]
+                pos += 1
+                if data[pos - 1] != 255:
+                    break
+        if pos + literal_length > len(data):
+            raise ValueError("truncated literals")
+        out += data[pos:pos + literal_length]
+        pos += literal_length
+        if pos == len(data):
+            break  # last sequence, literals only
+        if pos + 2 > len(data):
+            raise ValueError("truncated match offset")
+        offset = data[pos] | (data[pos + 1] << 8)
+        pos += 2
+        match_length = (token & 15) + 4
+        if token & 15 == 15:
+            while True:
+                if pos >= len(data):
+                    raise ValueError("truncated match length")
+                match_length += data[pos]
+                pos += 1
+                if data[pos - 1] != 255:
+                    break
+        if offset == 0 or offset > len(out):
+            raise ValueError(f"match offset {offset} out of the data")
+        if offset >= match_length:
+            out += out[-offset:len(out) - offset + match_length]
+        else:
+            # the match overlaps what it writes, repeat its period
+            period = out[-offset:]
+            out += (period * (match_length // offset + 1))[:match_length]
+        if len(out) > max_length:
+            raise ValueError("decoded data larger than a frame")
+    if len(out) > max_length:
+        raise ValueError("decoded data larger than a frame")
+    return bytes(out)
+
+
 class Response:
     """
         Chameleon Response Data
@@ -51,6 +107,8 @@ class ChameleonCom:
     """
     data_frame_sof = 0x11
     data_max_length = 4096
+    # status flag of the frames whose data is a LZ4 block, see ChameleonCMD.set_frame_compression()
+    status_compressed = 0x8000
     commands = []
 
     def __init__(self):
@@ -61,6 +119,8 @@ class ChameleonCom:
         self.send_data_queue = queue.Queue()
         self.wait_response_map = {}
         self.event_closing = threading.Event()
+        # responses already received in a batch, served by send_cmd_sync instead of asking the device again
+        self.prefetched = {}
 
     def isOpen(self) -> bool:
         """
@@ -204,6 +264,15 @@ class ChameleonCom:
                             # print(f"Buffer data = {data_buffer.hex()}")
                             data_response = bytes(data_buffer[struct.calcsize('!BBHHHB'):
                                                               struct.calcsize(f'!BBHHHB{data_length}s')])
+                            if data_status & self.status_compressed:
+                                data_status &= ~self.status_compressed
+                                try:
+                                    data_response = lz4_block_decompress(data_response, self.data_max_length)
+                                except ValueError as e:
+                                    print(f"Data frame decompression error: {e}")
+                                    data_position = 0
+                                    data_buffer.clear()
+                                    continue
                             if DEBUG:
                                 try:
                                     command = Command(data_cmd)
@@ -220,7 +289,29 @@ class ChameleonCom:
                                     status_string = f"{data_status:30x}"
                                     response = data_response.hex() if data_response is not None else ""
                                     print(f"<={color_string((CC, command_string.ljust(40)), (CR, status_string), (CY, response))}")
-                            if data_cmd in self.wait_response_map:
+                            if data_cmd in self.wait_response_map and \
+                                    data_status in (Status.STREAM_BEGIN, Status.STREAM_DATA):
+                                stream_result = self.stream_receive(self.wait_response_map[data_cmd],
+                                                                    data_status, data_response)
+                                if stream_result is not None:
+                                    # stream complete, answered like a single frame response
+                                    data_status, data_response = stream_result
+                            if data_cmd in self.wait_response_map and \
+                                    data_status in (Status.MORE_DATA, Status.STREAM_BEGIN, Status.STREAM_DATA):
+                                # partial response, keep the task alive until the final frame arrives
+                                task = self.wait_response_map[data_cmd]
+                                if data_status == Status.MORE_DATA:
+                                    # given to the hook of the task, or joined to the final frame without one
+                                    if 'on_more_data' in task:
+                                        task['on_more_data'](data_response)
+                                    else:
+                                        task.setdefault('chunks', []).append(data_response)
+                                task_timeout = task['end_time'] - task['start_time']
+                                task['start_time'] = time.time()
+                                task['end_time'] = task['start_time'] + task_timeout
+                            elif data_cmd in self.wait_response_map:
+                                if 'chunks' in self.wait_response_map[data_cmd]:
+                                    data_response = b''.join(self.wait_response_map[data_cmd]['chunks']) + data_response
                                 # call processor
                                 if 'callback' in self.wait_response_map[data_cmd]:
                                     fn_call = self.wait_response_map[data_cmd]['callback']
@@ -242,6 +333,34 @@ class ChameleonCom:
                         continue
                 data_position += 1
 
+    @staticmethod
+    def stream_receive(task, status, data):
+        """
+            Reassemble a streamed response in its wait task.
+
+        :return: (status, data) of the command once the whole stream is received and checked, None before
+        """
+        if status == Status.STREAM_BEGIN:
+            stream_id, length, crc, final_status = struct.unpack('!BIIH', data)
+            task['stream'] = {'id': stream_id, 'length': length, 'crc': crc, 'status': final_status,
+                              'data': bytearray()}
+        else:
+            stream_id, offset = struct.unpack_from('!BI', data)
+            stream = task.get('stream')
+            if stream is None or stream_id != stream['id'] or offset != len(stream['data']):
+                print(f"Stream frame lost or out of order (offset {offset}).")
+                task.pop('stream', None)
+                return Status.STREAM_CRC_ERR, b''
+            stream['data'] += data[struct.calcsize('!BI'):]
+        stream = task['stream']
+        if len(stream['data']) < stream['length']:
+            return None
+        del task['stream']
+        if len(stream['data']) != stream['length'] or zlib.crc32(stream['data']) != stream['crc']:
+            print("Stream crc32 error.")
+            return Status.STREAM_CRC_ERR, b''
+        return stream['status'], bytes(stream['data'])
+
     def thread_data_transfer(self):
         """
             Sub thread to transfer data to chameleon device.
@@ -262,6 +381,8 @@ class ChameleonCom:
                 self.wait_response_map[task_cmd] = {'callback': task['callback']}  # The callback for this task
             else:
                 self.wait_response_map[task_cmd] = {'response': None}
+            if 'on_more_data' in task and callable(task['on_more_data']):
+                self.wait_response_map[task_cmd]['on_more_data'] = task['on_more_data']
             # set start time
             start_time = time.time()
             self.wait_response_map[task_cmd]['start_time'] = start_time
@@ -317,7 +438,7 @@ class ChameleonCom:
         return bytes(frame)
 
     def send_cmd_auto(self, cmd: int, data: Union[bytes, None] = None, status: int = 0, callback=None, timeout: int = 3,
-                      close: bool = False):
+                      close: bool = False, on_more_data=None):
         """
             Send cmd to device
 
@@ -327,6 +448,7 @@ class ChameleonCom:
         :param callback: call on response
         :param timeout: wait response timeout
         :param close: close connection after executing
+        :param on_more_data: call on each partial response, which is then left out of the final one
         :return:
         """
         self.check_open()
@@ -347,10 +469,12 @@ class ChameleonCom:
         task = {'cmd': cmd, 'frame': data_frame, 'timeout': timeout, 'close': close}
         if callable(callback):
             task['callback'] = callback
+        if callable(on_more_data):
+            task['on_more_data'] = on_more_data
         self.send_data_queue.put(task)
 
     def send_cmd_sync(self, cmd: int, data: Union[bytes, None] = None, status: int = 0,
-                      timeout: int = 3) -> Response:
+                      timeout: int = 3, on_more_data=None) -> Response:
         """
             Send cmd to device, and block receive data.
 
@@ -358,15 +482,22 @@ class ChameleonCom:
         :param data: bytes data (optional)
         :param status: status (optional)
         :param timeout: wait response timeout
+        :param on_more_data: call on each partial response, which is then left out of the final one
         :return: response data
         """
+        prefetched = self.prefetched.get((cmd, bytes(data or b'')))
+        if prefetched:
+            data_response = prefetched.popleft()
+            if data_response.status == Status.INVALID_CMD:
+                raise CMDInvalidException(f"Device unsupported cmd: {cmd}")
+            return data_response
         if len(self.commands):
             # check if chameleon can understand this command
             if cmd not in self.commands:
                 raise CMDInvalidException(f"This device doesn't declare that it can support this command: {cmd}.\n"
                                           f"Make sure firmware is up to date and matches client")
         # first to send cmd, no callback mode(sync)
-        self.send_cmd_auto(cmd, data, status, None, timeout)
+        self.send_cmd_auto(cmd, data, status, None, timeout, on_more_data=on_more_data)
         # wait cmd start process
         while cmd not in self.wait_response_map:
             time.sleep(0.01)
@@ -382,6 +513,22 @@ class ChameleonCom:
             raise CMDInvalidException(f"Device unsupported cmd: {cmd}")
         return data_response
 
+    def add_prefetched(self, cmd: int, data: Union[bytes, None], response: Response) -> None:
+        """
+            Keep a response received in a batch, the next send_cmd_sync of the same cmd and data returns it.
+
+        :param cmd: cmd of the request
+        :param data: data of the request
+        :param response: response to return
+        """
+        self.prefetched.setdefault((cmd, bytes(data or b'')), collections.deque()).append(response)
+
+    def clear_prefetched(self) -> None:
+        """
+            Forget the prefetched responses which were not used.
+        """
+        self.prefetched.clear()
+
 
 if __name__ == '__main__':
     try:
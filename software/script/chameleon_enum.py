@@ -14,6 +14,10 @@ class Command(enum.IntEnum):
     SET_SLOT_TAG_NICK = 1007
     GET_SLOT_TAG_NICK = 1008
     GET_ALL_SLOT_NICKS = 1038
+    BATCH = 1039
+    GET_BLE_LINK_STATUS = 1040
+    SET_FRAME_COMPRESSION = 1041
+    GET_STORAGE_STATUS = 1042
 
     SLOT_DATA_CONFIG_SAVE = 1009
 
@@ -73,6 +77,7 @@ class Command(enum.IntEnum):
     MF1_HARDNESTED_ACQUIRE = 2013
     MF1_ENC_NESTED_ACQUIRE = 2014
     MF1_CHECK_KEYS_ON_BLOCK = 2015
+    MF1_READ_SECTORS = 2016
 
     EM410X_SCAN = 3000
     EM410X_WRITE_TO_T55XX = 3001
@@ -123,6 +128,11 @@ class Command(enum.IntEnum):
     MF0_NTAG_GET_DETECTION_ENABLE = 4036
     # FIXME: not implemented
     MF0_NTAG_GET_EMULATOR_CONFIG = 4037
+    EMU_MEMORY_BULK_READ = 4038
+    EMU_MEMORY_BULK_WRITE = 4039
+    EMU_MEMORY_GET_CRC32 = 4040
+    MF1_SET_DETECTION_POLICY = 4041
+    MF1_GET_DETECTION_POLICY = 4042
 
     EM410X_SET_EMU_ID = 5000
     EM410X_GET_EMU_ID = 5001
@@ -160,6 +170,13 @@ class Status(enum.IntEnum):
     FLASH_WRITE_FAIL = 0x70
     FLASH_READ_FAIL = 0x71
     INVALID_SLOT_TYPE = 0x72
+    # Partial response, more frames of the same command will follow
+    MORE_DATA = 0x73
+    # Streamed response: header (stream id, total length, crc32, final status), then data frames with offsets
+    STREAM_BEGIN = 0x74
+    STREAM_DATA = 0x75
+    # Set by the client when a streamed response is incomplete or fails its crc32 check
+    STREAM_CRC_ERR = 0x76
 
     def __str__(self):
         if self == Status.HF_TAG_OK:
@@ -200,6 +217,14 @@ class Status(enum.IntEnum):
             return "Flash read failed"
         elif self == Status.INVALID_SLOT_TYPE:
             return "Invalid card type in slot"
+        elif self == Status.MORE_DATA:
+            return "Partial response, more data follows"
+        elif self == Status.STREAM_BEGIN:
+            return "Streamed response, data follows"
+        elif self == Status.STREAM_DATA:
+            return "Part of a streamed response"
+        elif self == Status.STREAM_CRC_ERR:
+            return "Streamed response lost or corrupted"
         return "Invalid status"
 
 
@@ -419,6 +444,21 @@ class MifareClassicWriteMode(enum.IntEnum):
         return "None"
 
 
+@enum.unique
+class MifareClassicDetectionPolicy(enum.IntEnum):
+    # Keep the first records once the log is full
+    STOP = 0
+    # Overwrite the oldest record once the log is full
+    OVERWRITE = 1
+
+    def __str__(self):
+        if self == MifareClassicDetectionPolicy.STOP:
+            return "Stop when full"
+        elif self == MifareClassicDetectionPolicy.OVERWRITE:
+            return "Overwrite oldest"
+        return "None"
+
+
 @enum.unique
 class MifareUltralightWriteMode(enum.IntEnum):
     # Normal write
@@ -197,6 +197,64 @@ def parity_to_str(nt_par_err):
     )
 
 
+# BLE link layer timings, in microseconds, for the 1M and 2M PHY (BLE_GAP_PHY_1MBPS / BLE_GAP_PHY_2MBPS)
+BLE_PHY_US_PER_BYTE = {1: 8, 2: 4}
+BLE_PHY_PREAMBLE = {1: 1, 2: 2}
+BLE_T_IFS_US = 150
+# access address, LL header, CRC
+BLE_PDU_OVERHEAD = 4 + 2 + 3
+BLE_MIC_LEN = 4
+# ATT notification opcode and handle, L2CAP header
+BLE_ATT_NOTIFY_OVERHEAD = 3
+BLE_L2CAP_HEADER = 4
+
+
+def ble_notification_chunks(frame_length, att_mtu):
+    """
+        Sizes of the notifications the NUS queue splits a frame into
+    """
+    chunk_max = att_mtu - BLE_ATT_NOTIFY_OVERHEAD
+    return [min(chunk_max, frame_length - offset) for offset in range(0, frame_length, chunk_max)]
+
+
+def ble_pdu_airtime_us(payload_length, phy, encrypted=False):
+    length = BLE_PHY_PREAMBLE[phy] + BLE_PDU_OVERHEAD + payload_length
+    if encrypted and payload_length:
+        length += BLE_MIC_LEN
+    return length * BLE_PHY_US_PER_BYTE[phy]
+
+
+def ble_throughput_estimate(att_mtu, data_length, conn_interval_ms, phy=1, event_length_ms=None, encrypted=False):
+    """
+        Estimate the notification throughput of a link, peripheral to central.
+
+        Every notification is split in LL fragments of data_length bytes at most,
+        each one is acknowledged by an empty packet of the central.
+        Without connection event extension the event stops after event_length_ms,
+        with it (the default) packets go on up to the next connection event.
+
+    :return: dict with fragments per notification, notifications per event and bytes per second
+    """
+    l2cap_length = att_mtu + BLE_L2CAP_HEADER
+    fragments = [min(data_length, l2cap_length - offset) for offset in range(0, l2cap_length, data_length)]
+    exchange_us = 2 * BLE_T_IFS_US + ble_pdu_airtime_us(0, phy, encrypted)
+    fragment_us = [ble_pdu_airtime_us(length, phy, encrypted) + exchange_us for length in fragments]
+    event_us = (event_length_ms if event_length_ms is not None else conn_interval_ms) * 1000
+    # fragments go on in the next event, the last one of an event must fit entirely
+    sent_us = 0
+    sent_fragments = 0
+    while sent_us + fragment_us[sent_fragments % len(fragments)] <= event_us:
+        sent_us += fragment_us[sent_fragments % len(fragments)]
+        sent_fragments += 1
+    notifications_per_event = sent_fragments / len(fragments)
+    payload = att_mtu - BLE_ATT_NOTIFY_OVERHEAD
+    return {
+        'fragments': len(fragments),
+        'notifications_per_event': notifications_per_event,
+        'bytes_per_second': notifications_per_event * payload * 1000 / conn_interval_ms,
+    }
+
+
 def execute_tool(tool_name, args):
     if sys.platform == "win32":
         tool_executable = f"{tool_name}.exe"
@@ -285,16 +343,24 @@ class CLITree:
     def __init__(self, name: str = "", help_text: Union[str, None] = None, fullname: Union[str, None] = None,
                  children: Union[list["CLITree"], None] = None, cls=None, root=False) -> None:
         self.name = name
-        self.help_text = help_text
+        self._help_text = help_text
         self.fullname = fullname if fullname else name
         self.children = children if children else list()
         self.cls = cls
         self.root = root
-        if self.help_text is None and not root:
+        if self._help_text is None and not root:
             assert self.cls is not None
+
+    @property
+    def help_text(self) -> Union[str, None]:
+        """
+        Hint displayed for the command, the parser of a command is only built on first access
+        """
+        if self._help_text is None and self.cls is not None:
             parser = self.cls().args_parser()
             assert parser is not None
-            self.help_text = parser.description
+            self._help_text = parser.description
+        return self._help_text
 
     def subgroup(self, name, help_text=None):
         """
@@ -347,17 +413,25 @@ class CustomNestedCompleter(NestedCompleter):
         meta_dict = {}
 
         for child_node in node.children:
-            if child_node.cls:
-                # CLITree is a standalone command with arguments
-                options[child_node.name] = ArgparseCompleter(
-                    child_node.cls().args_parser())
-            else:
-                # CLITree is a command group
-                options[child_node.name] = cls.from_clitree(child_node)
+            # sub completers are created when first needed, see get_sub_completer()
+            options[child_node.name] = child_node
+            if not child_node.cls:
                 meta_dict[child_node.name] = child_node.help_text
 
         return cls(options, meta_dict=meta_dict)
 
+    def get_sub_completer(self, name):
+        completer = self.options.get(name)
+        if isinstance(completer, CLITree):
+            if completer.cls:
+                # CLITree is a standalone command with arguments
+                completer = ArgparseCompleter(completer.cls().args_parser())
+            else:
+                # CLITree is a command group
+                completer = CustomNestedCompleter.from_clitree(completer)
+            self.options[name] = completer
+        return completer
+
     def get_completions(self, document, complete_event):
         # Split document.
         text = document.text_before_cursor.lstrip()
@@ -366,7 +440,7 @@ class CustomNestedCompleter(NestedCompleter):
         # If there is a space, check for the first term, and use a sub_completer.
         if " " in text:
             first_term = text.split()[0]
-            completer = self.options.get(first_term)
+            completer = self.get_sub_completer(first_term)
 
             # If we have a sub completer, use this for the completions.
             if completer is not None:
@@ -1,4 +1,7 @@
+import ctypes
 import re
+import sys
+from pathlib import Path
 
 LFSR48_FILTER_A = 0x9E98
 LFSR48_FILTER_B = 0xB48E
@@ -37,6 +40,45 @@ def swap_endian_u16(u16):
 def swap_endian_u32(u32):
     return swap_endian_u16(u32 & 0xFFFF) << 16 | swap_endian_u16((u32 >> 16) & 0xFFFF)
 
+
+def _load_native():
+    """
+        Load the native crypto1 library built by software/src (crypto1_native),
+        return None to fall back to the python implementation.
+    """
+    if getattr(sys, 'frozen', False):
+        bin_dirs = [Path(getattr(sys, '_MEIPASS')) / "bin"]
+    else:
+        bin_dirs = [Path(__file__).parent / "bin", Path.cwd() / "bin"]
+    for bin_dir in bin_dirs:
+        for lib_path in bin_dir.glob("crypto1_native*"):
+            if lib_path.suffix not in ('.so', '.dll', '.dylib'):
+                continue
+            try:
+                lib = ctypes.CDLL(str(lib_path))
+            except OSError:
+                continue
+            lib.crypto1_native_lfsr48_u8.argtypes = [ctypes.POINTER(ctypes.c_uint64), ctypes.c_uint8, ctypes.c_int]
+            lib.crypto1_native_lfsr48_u8.restype = ctypes.c_uint8
+            lib.crypto1_native_lfsr48_u32.argtypes = [ctypes.POINTER(ctypes.c_uint64), ctypes.c_uint32, ctypes.c_int]
+            lib.crypto1_native_lfsr48_u32.restype = ctypes.c_uint32
+            lib.crypto1_native_prng_successor.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+            lib.crypto1_native_prng_successor.restype = ctypes.c_uint32
+            lib.crypto1_native_verify_keys.argtypes = [ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32,
+                                                       ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint64),
+                                                       ctypes.c_size_t, ctypes.POINTER(ctypes.c_uint8)]
+            lib.crypto1_native_verify_keys.restype = ctypes.c_size_t
+            return lib
+    return None
+
+
+_native = _load_native()
+
+
+def is_native_available() -> bool:
+    return _native is not None
+
+
 """
 ref: https://web.archive.org/web/20081010065744/http://sar.informatik.hu-berlin.de/research/publications/SAR-PR-2008-21/SAR-PR-2008-21_.pdf
 """
@@ -77,6 +119,11 @@ class Crypto1:
         return out_bit
     
     def lfsr48_u8(self, u8_in: int = 0, is_encrypted: bool = False) -> int:
+        if _native is not None:
+            state = ctypes.c_uint64(self.lfsr48)
+            out_u8 = _native.crypto1_native_lfsr48_u8(ctypes.byref(state), u8_in & 0xFF, int(is_encrypted))
+            self.lfsr48 = state.value
+            return out_u8
         out_u8 = 0
         for i in range(8):
             tmp = self.lfsr48_bit(u8_in >> i, is_encrypted) << i
@@ -84,6 +131,11 @@ class Crypto1:
         return out_u8
     
     def lfsr48_u32(self, u32_in: int = 0, is_encrypted: bool = False) -> int:
+        if _native is not None:
+            state = ctypes.c_uint64(self.lfsr48)
+            out_u32 = _native.crypto1_native_lfsr48_u32(ctypes.byref(state), u32_in & 0xFFFFFFFF, int(is_encrypted))
+            self.lfsr48 = state.value
+            return out_u32
         out_u32 = 0
         for i in range(3, -1, -1):
             bit_offset = i << 3
@@ -92,6 +144,8 @@ class Crypto1:
     
     @staticmethod
     def prng_next(lfsr32: int, n: int = 1) -> int:
+        if _native is not None:
+            return _native.crypto1_native_prng_successor(lfsr32 & 0xFFFFFFFF, n)
         lfsr32 = swap_endian_u32(lfsr32)
         for i in range(n):
             lfsr32 = even_parity_u8(0x2D & (lfsr32 >> 16)) << 31 | (lfsr32 >> 1)
@@ -99,6 +153,8 @@ class Crypto1:
     
     @staticmethod
     def mfkey32_is_reader_has_key(uid: int, nt: int, nrEnc: int, arEnc: int, key: str) -> bool:
+        if _native is not None:
+            return len(Crypto1.verify_keys(uid, nt, nrEnc, arEnc, [key])) > 0
         state = Crypto1()
         state.key = key
         state.lfsr48_u32(uid ^ nt, False) # ks0
@@ -107,4 +163,33 @@ class Crypto1:
         ar = arEnc ^ ks2
         result = ar == Crypto1.prng_next(nt, 64)
         # print(f'uid: {hex(uid)}, nt: {hex(nt)}, nrEnc: {hex(nrEnc)}, arEnc: {hex(arEnc)}, key: {key}, result = {result}')
-        return result
\ No newline at end of file
+        return result
+
+    @staticmethod
+    def verify_keys(uid: int, nt: int, nrEnc: int, arEnc: int, keys: list[str]) -> list[str]:
+        """
+            Check many candidate keys against one reader authentication (mfkey32 record).
+
+        :return: keys which decrypt arEnc to the expected reader answer
+        """
+        if _native is None:
+            return [key for key in keys if Crypto1.mfkey32_is_reader_has_key(uid, nt, nrEnc, arEnc, key)]
+        for key in keys:
+            if not re.match(r"^[a-fA-F0-9]{12}$", key):
+                raise ValueError(f"Invalid hex format key: {key}")
+        keys_len = len(keys)
+        keys_arr = (ctypes.c_uint64 * keys_len)(*[int(key, 16) for key in keys])
+        results = (ctypes.c_uint8 * keys_len)()
+        found = _native.crypto1_native_verify_keys(uid & 0xFFFFFFFF, nt & 0xFFFFFFFF, nrEnc & 0xFFFFFFFF,
+                                                   arEnc & 0xFFFFFFFF, keys_arr, keys_len, results)
+        if found == 0:
+            return []
+        return [key for key, result in zip(keys, results) if result]
+
+
+def prng_successor(lfsr32: int, n: int = 1) -> int:
+    return Crypto1.prng_next(lfsr32, n)
+
+
+def verify_keys(uid: int, nt: int, nrEnc: int, arEnc: int, keys: list[str]) -> list[str]:
+    return Crypto1.verify_keys(uid, nt, nrEnc, arEnc, keys)
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+import contextlib
+import io
+import os
+import re
+import struct
+import sys
+import unittest
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_cli_unit
+import chameleon_com
+import chameleon_cmd
+from chameleon_enum import Command, Status, TagSpecificType
+
+
+class FakeChameleonCom(chameleon_com.ChameleonCom):
+    """
+        Answer the frames without a device, records the commands sent
+    """
+
+    def __init__(self, responses):
+        super().__init__()
+        self.responses = responses
+        self.sent = []
+        self.commands = [Command.BATCH, Command.GET_ACTIVE_SLOT, Command.GET_SLOT_TAG_NICK]
+
+    def check_open(self):
+        pass
+
+    def send_cmd_auto(self, cmd, data=None, status=0, callback=None, timeout=3, close=False, on_more_data=None):
+        self.sent.append((cmd, data))
+        resp_status, resp_data = self.responses[cmd]
+        self.wait_response_map[cmd] = {'response': chameleon_com.Response(cmd, resp_status, resp_data)}
+
+
+def result(cmd, status, data=b''):
+    return struct.pack('!HHH', cmd, status, len(data)) + data
+
+
+class FakeSlotsCom(FakeChameleonCom):
+    """
+        Answer the slot commands from the slots given, a batch runs its requests one after the other as the device does
+    """
+
+    def __init__(self, slots, active):
+        super().__init__({})
+        self.slots = slots
+        self.active = active
+        self.commands = [Command.BATCH, Command.GET_SLOT_INFO, Command.GET_ACTIVE_SLOT, Command.SET_ACTIVE_SLOT,
+                         Command.GET_ENABLED_SLOTS, Command.GET_ALL_SLOT_NICKS, Command.HF14A_GET_ANTI_COLL_DATA,
+                         Command.MF1_GET_EMULATOR_CONFIG, Command.EM410X_GET_EMU_ID]
+
+    def run(self, cmd, data):
+        slot = self.slots[self.active]
+        if cmd == Command.GET_SLOT_INFO:
+            return Status.SUCCESS, b''.join(struct.pack('!HH', s['hf'], s['lf']) for s in self.slots)
+        if cmd == Command.GET_ACTIVE_SLOT:
+            return Status.SUCCESS, bytes([self.active])
+        if cmd == Command.SET_ACTIVE_SLOT:
+            self.active = data[0]
+            return Status.SUCCESS, b''
+        if cmd == Command.GET_ENABLED_SLOTS:
+            return Status.SUCCESS, b'\x01\x01' * len(self.slots)
+        if cmd == Command.GET_ALL_SLOT_NICKS:
+            return Status.SUCCESS, b'\x00\x00' * len(self.slots)
+        if cmd == Command.HF14A_GET_ANTI_COLL_DATA:
+            return Status.SUCCESS, bytes([len(slot['uid'])]) + slot['uid'] + b'\x04\x00\x08\x00'
+        if cmd == Command.MF1_GET_EMULATOR_CONFIG:
+            return Status.SUCCESS, b'\x00\x00\x00\x01\x00'
+        if cmd == Command.EM410X_GET_EMU_ID:
+            return Status.SUCCESS, slot['id']
+        return Status.INVALID_CMD, b''
+
+    def send_cmd_auto(self, cmd, data=None, status=0, callback=None, timeout=3, close=False, on_more_data=None):
+        self.sent.append((cmd, data))
+        if cmd == Command.BATCH:
+            resp_data = b''
+            offset = 0
+            while offset < len(data):
+                sub_cmd, sub_length = struct.unpack_from('!HH', data, offset)
+                sub_data = data[offset + 4:offset + 4 + sub_length]
+                offset += 4 + sub_length
+                resp_data += result(sub_cmd, *self.run(sub_cmd, sub_data))
+            resp_status = Status.SUCCESS
+        else:
+            resp_status, resp_data = self.run(cmd, data)
+        self.wait_response_map[cmd] = {'response': chameleon_com.Response(cmd, resp_status, resp_data)}
+
+
+class TestBatch(unittest.TestCase):
+
+    def test_batch_request_and_results(self):
+        device = FakeChameleonCom({Command.BATCH: (Status.SUCCESS,
+                                                   result(Command.GET_ACTIVE_SLOT, Status.SUCCESS, b'\x02') +
+                                                   result(Command.GET_SLOT_TAG_NICK, Status.MORE_DATA, b'ab') +
+                                                   result(Command.GET_SLOT_TAG_NICK, Status.SUCCESS, b'cd') +
+                                                   result(Command.GET_APP_VERSION, Status.INVALID_CMD))})
+        cmd = chameleon_cmd.ChameleonCMD(device)
+        results = cmd.batch([(Command.GET_ACTIVE_SLOT, None),
+                             (Command.GET_SLOT_TAG_NICK, b'\x01\x02'),
+                             (Command.GET_APP_VERSION, None)])
+        self.assertEqual(device.sent, [(Command.BATCH, struct.pack('!HH', Command.GET_ACTIVE_SLOT, 0) +
+                                        struct.pack('!HH2s', Command.GET_SLOT_TAG_NICK, 2, b'\x01\x02') +
+                                        struct.pack('!HH', Command.GET_APP_VERSION, 0))])
+        self.assertEqual([(r.cmd, r.status, r.data) for r in results],
+                         [(Command.GET_ACTIVE_SLOT, Status.SUCCESS, b'\x02'),
+                          (Command.GET_SLOT_TAG_NICK, Status.SUCCESS, b'abcd'),
+                          (Command.GET_APP_VERSION, Status.INVALID_CMD, b'')])
+
+    def test_prefetch_served_once(self):
+        device = FakeChameleonCom({
+            Command.BATCH: (Status.SUCCESS, result(Command.GET_ACTIVE_SLOT, Status.SUCCESS, b'\x05')),
+            Command.GET_ACTIVE_SLOT: (Status.SUCCESS, b'\x01'),
+        })
+        cmd = chameleon_cmd.ChameleonCMD(device)
+        cmd.prefetch([(Command.GET_ACTIVE_SLOT, None)])
+        self.assertEqual(cmd.get_active_slot(), 5)
+        self.assertEqual(cmd.get_active_slot(), 1)
+        self.assertEqual([sent_cmd for sent_cmd, _ in device.sent], [Command.BATCH, Command.GET_ACTIVE_SLOT])
+
+    def test_prefetch_without_batch_support(self):
+        device = FakeChameleonCom({Command.GET_ACTIVE_SLOT: (Status.SUCCESS, b'\x01')})
+        device.commands = [Command.GET_ACTIVE_SLOT]
+        cmd = chameleon_cmd.ChameleonCMD(device)
+        cmd.prefetch([(Command.GET_ACTIVE_SLOT, None)])
+        self.assertEqual(cmd.get_active_slot(), 1)
+        self.assertEqual(device.sent, [(Command.GET_ACTIVE_SLOT, None)])
+
+
+class TestSlotList(unittest.TestCase):
+
+    def list_slots(self, device, short=False):
+        unit = chameleon_cli_unit.HWSlotList()
+        unit.device_com = device
+        out = io.StringIO()
+        with contextlib.redirect_stdout(out):
+            unit.on_exec(unit.args_parser().parse_args(['--short'] if short else []))
+        return re.sub(r'\x1b\[[0-9;]*m', '', out.getvalue())
+
+    def test_each_slot_prefetched_alone(self):
+        undefined = {'hf': TagSpecificType.UNDEFINED, 'lf': TagSpecificType.UNDEFINED}
+        slots = [dict(undefined) for _ in range(8)]
+        slots[0] = {'hf': TagSpecificType.MIFARE_1024, 'lf': TagSpecificType.EM410X,
+                    'uid': bytes.fromhex('11111111'), 'id': bytes.fromhex('0102030405')}
+        slots[1] = {'hf': TagSpecificType.MIFARE_1024, 'lf': TagSpecificType.UNDEFINED,
+                    'uid': bytes.fromhex('22222222')}
+        slots[3] = {'hf': TagSpecificType.NTAG_215, 'lf': TagSpecificType.EM410X,
+                    'uid': bytes.fromhex('04333333333333'), 'id': bytes.fromhex('0A0B0C0D0E')}
+        device = FakeSlotsCom(slots, active=1)
+        out = self.list_slots(device)
+        uids = [line.split()[-1] for line in out.splitlines() if 'UID:' in line]
+        ids = [line.split()[-1] for line in out.splitlines() if 'ID:' in line and 'UID:' not in line]
+        self.assertEqual(uids, ['11111111', '22222222', '04333333333333'])
+        self.assertEqual(ids, ['0102030405', '0A0B0C0D0E'])
+        # one batch for the slot list and one per slot shown, the other commands served from them
+        self.assertEqual([cmd for cmd, _ in device.sent], [Command.BATCH] * 4 + [Command.SET_ACTIVE_SLOT])
+        self.assertEqual(device.active, 1)
+        self.assertEqual(device.prefetched, {})
+
+    def test_short_list_asks_no_slot(self):
+        slots = [{'hf': TagSpecificType.MIFARE_1024, 'lf': TagSpecificType.EM410X,
+                  'uid': b'\x01\x02\x03\x04', 'id': b'\x01\x02\x03\x04\x05'} for _ in range(8)]
+        device = FakeSlotsCom(slots, active=0)
+        self.list_slots(device, short=True)
+        self.assertEqual([cmd for cmd, _ in device.sent], [Command.BATCH])
+        self.assertEqual(device.active, 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+import os
+import struct
+import sys
+import unittest
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_cmd
+import chameleon_com
+from chameleon_enum import Command, Status
+from chameleon_utils import ble_notification_chunks, ble_throughput_estimate
+
+# largest frame: 4096 bytes of data and the frame header
+FRAME_SIZE = 4106
+
+
+class FakeChameleonCom(chameleon_com.ChameleonCom):
+
+    def __init__(self, response):
+        super().__init__()
+        self.response = response
+
+    def check_open(self):
+        pass
+
+    def send_cmd_auto(self, cmd, data=None, status=0, callback=None, timeout=3, close=False, on_more_data=None):
+        self.wait_response_map[cmd] = {'response': chameleon_com.Response(cmd, Status.SUCCESS, self.response)}
+
+
+class TestBleThroughput(unittest.TestCase):
+
+    def test_notification_chunks(self):
+        for mtu in (23, 185, 247):
+            chunks = ble_notification_chunks(FRAME_SIZE, mtu)
+            self.assertEqual(sum(chunks), FRAME_SIZE)
+            self.assertTrue(all(chunk == mtu - 3 for chunk in chunks[:-1]))
+            self.assertTrue(0 < chunks[-1] <= mtu - 3)
+        self.assertEqual(len(ble_notification_chunks(FRAME_SIZE, 247)), 17)
+
+    def test_fragments_per_notification(self):
+        self.assertEqual(ble_throughput_estimate(23, 27, 7.5)['fragments'], 1)
+        self.assertEqual(ble_throughput_estimate(247, 251, 7.5)['fragments'], 1)
+        self.assertEqual(ble_throughput_estimate(247, 27, 7.5)['fragments'], 10)
+
+    def test_bulk_profile_is_faster(self):
+        default = ble_throughput_estimate(23, 27, 75, phy=1, event_length_ms=7.5)
+        dle = ble_throughput_estimate(247, 251, 15, phy=1)
+        bulk = ble_throughput_estimate(247, 251, 15, phy=2)
+        self.assertLess(default['bytes_per_second'], dle['bytes_per_second'])
+        self.assertLess(dle['bytes_per_second'], bulk['bytes_per_second'])
+        # 2M PHY can't go over its raw bit rate
+        self.assertLess(bulk['bytes_per_second'], 2e6 / 8)
+        print("\nBLE throughput estimate, one frame of %d bytes:" % FRAME_SIZE)
+        for name, estimate in (('default', default), ('1M + DLE', dle), ('2M + DLE', bulk)):
+            print(f"  {name:9}: {estimate['bytes_per_second'] / 1024:6.1f} kB/s, "
+                  f"{FRAME_SIZE / estimate['bytes_per_second'] * 1000:6.0f} ms per frame")
+
+    def test_link_status_parsing(self):
+        device = FakeChameleonCom(struct.pack('!4B4H', 1, 1, 2, 2, 247, 251, 12, 300))
+        link = chameleon_cmd.ChameleonCMD(device).get_ble_link_status()
+        self.assertEqual(link, {'connected': True, 'bulk_mode': True, 'tx_phy': 2, 'rx_phy': 2, 'att_mtu': 247,
+                                'data_length': 251, 'conn_interval_ms': 15.0, 'tx_queue_depth': 300})
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+import os
+import struct
+import sys
+import time
+import unittest
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_com
+import chameleon_cmd
+from chameleon_enum import Command, Status
+
+KEY_A = bytes.fromhex('FFFFFFFFFFFF')
+KEY_B = bytes.fromhex('4D3A99C351DD')
+
+
+class LoopbackSerial:
+    """
+        Serial port replaying the bytes of the device, closed once they are all read
+    """
+
+    def __init__(self, data):
+        self.data = bytearray(data)
+        self.is_open = True
+
+    def read(self):
+        if not self.data:
+            self.is_open = False
+            return b''
+        byte = bytes(self.data[:1])
+        del self.data[:1]
+        return byte
+
+
+class LoopbackChameleonCom(chameleon_com.ChameleonCom):
+    """
+        Answers each command with the next list of frames, through the receive thread
+    """
+
+    def __init__(self, answers):
+        super().__init__()
+        self.answers = answers
+        self.sent = []
+
+    def check_open(self):
+        pass
+
+    def send_cmd_auto(self, cmd, data=None, status=0, callback=None, timeout=3, close=False, on_more_data=None):
+        self.sent.append((cmd, data))
+        self.wait_response_map[cmd] = {'response': None, 'start_time': time.time(), 'end_time': time.time() + timeout}
+        if on_more_data is not None:
+            self.wait_response_map[cmd]['on_more_data'] = on_more_data
+        frames = [self.make_data_frame_bytes(cmd, frame_data, frame_status)
+                  for frame_status, frame_data in self.answers.pop(0)]
+        self.serial_instance = LoopbackSerial(b''.join(frames))
+        self.thread_data_receive()
+
+
+def hit(sector, key_type, key):
+    return struct.pack('!BB6s', sector, key_type, key)
+
+
+def check_keys_out(sector_keys):
+    found = bytearray(10)
+    keys = bytearray(480)
+    for (sector, key_type), key in sector_keys.items():
+        found[sector // 4] |= (0b10 >> key_type) << (6 - sector % 4 * 2)
+        keys[(sector * 2 + key_type) * 6:(sector * 2 + key_type + 1) * 6] = key
+    return bytes(found + keys)
+
+
+class TestCheckKeys(unittest.TestCase):
+
+    def test_hits_streamed_before_the_result(self):
+        device = LoopbackChameleonCom([[
+            (Status.MORE_DATA, hit(0, 0x60, KEY_A) + hit(0, 0x61, KEY_A)),
+            (Status.MORE_DATA, hit(1, 0x60, KEY_B)),
+            (Status.HF_TAG_OK, check_keys_out({(0, 0): KEY_A, (0, 1): KEY_A, (1, 0): KEY_B})),
+        ]])
+        cmd = chameleon_cmd.ChameleonCMD(device)
+        hits = []
+        resp = cmd.mf1_check_keys_of_sectors(bytes(10), [KEY_A, KEY_B], on_hit=lambda *h: hits.append(h))
+        self.assertEqual(hits, [(0, 0x60, KEY_A), (0, 0x61, KEY_A), (1, 0x60, KEY_B)])
+        self.assertEqual(resp['status'], Status.HF_TAG_OK)
+        self.assertEqual(resp['sectorKeys'], {0: KEY_A, 1: KEY_A, 2: KEY_B})
+
+    def test_hits_left_out_of_the_result(self):
+        out = check_keys_out({(0, 0): KEY_A})
+        device = LoopbackChameleonCom([[
+            (Status.MORE_DATA, hit(0, 0x60, KEY_A)),
+            (Status.HF_TAG_OK, out),
+        ]])
+        hits = []
+        resp = device.send_cmd_sync(Command.MF1_CHECK_KEYS_OF_SECTORS, bytes(16), on_more_data=hits.append)
+        self.assertEqual(hits, [hit(0, 0x60, KEY_A)])
+        self.assertEqual(resp.data, out)
+
+    def test_result_without_hits(self):
+        device = LoopbackChameleonCom([[(Status.HF_TAG_OK, check_keys_out({}))]])
+        cmd = chameleon_cmd.ChameleonCMD(device)
+        resp = cmd.mf1_check_keys_of_sectors(bytes(10), [KEY_A])
+        self.assertEqual(resp['sectorKeys'], {})
+
+    def test_keys_of_a_full_frame(self):
+        device = LoopbackChameleonCom([[(Status.HF_TAG_OK, check_keys_out({}))]])
+        cmd = chameleon_cmd.ChameleonCMD(device)
+        keys = [i.to_bytes(6, 'big') for i in range(cmd.mf1_check_keys_max())]
+        cmd.mf1_check_keys_of_sectors(bytes(10), keys)
+        self.assertEqual(len(device.sent[0][1]), device.data_max_length)
+        with self.assertRaises(ValueError):
+            cmd.mf1_check_keys_of_sectors(bytes(10), keys + [KEY_A])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+import os
+import subprocess
+import sys
+import unittest
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_cli_unit
+import chameleon_utils
+
+# cold start of the client up to the first command of a script, run in a new interpreter
+STARTUP_BENCHMARK = """
+import io
+import time
+start = time.perf_counter()
+import chameleon_cli_main
+exit_code = chameleon_cli_main.ChameleonCLI().run_script(io.StringIO('rem startup benchmark\\n'))
+print(f'{time.perf_counter() - start:.3f}')
+exit(exit_code)
+"""
+
+
+def command_nodes(node):
+    for child in node.children:
+        if child.cls:
+            yield child
+        else:
+            yield from command_nodes(child)
+
+
+class TestCLIStartup(unittest.TestCase):
+
+    def test_parsers_built_on_demand(self):
+        # help texts and completers come from the parsers, nothing is built while registering the commands
+        nodes = list(command_nodes(chameleon_cli_unit.root))
+        self.assertTrue(all(node._help_text is None for node in nodes))
+        completer = chameleon_utils.CustomNestedCompleter.from_clitree(chameleon_cli_unit.root)
+        self.assertTrue(all(isinstance(option, chameleon_utils.CLITree) for option in completer.options.values()))
+
+        hw_completer = completer.get_sub_completer('hw')
+        self.assertIsInstance(hw_completer, chameleon_utils.CustomNestedCompleter)
+        self.assertIs(completer.get_sub_completer('hw'), hw_completer)
+        self.assertIsInstance(hw_completer.get_sub_completer('connect'), chameleon_utils.ArgparseCompleter)
+        self.assertEqual(nodes[0].help_text, nodes[0].cls().args_parser().description)
+
+    def test_script_startup_time(self):
+        result = subprocess.run([sys.executable, '-c', STARTUP_BENCHMARK], cwd=config_path,
+                                capture_output=True, text=True, timeout=60)
+        self.assertEqual(result.returncode, 0, result.stdout + result.stderr)
+        print(f"\nCLI startup to first script command: {result.stdout.splitlines()[-1]} s")
+
+
+if __name__ == '__main__':
+    unittest.main()
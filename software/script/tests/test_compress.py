@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+import os
+import sys
+import time
+import unittest
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_com
+from chameleon_enum import Command, Status
+
+
+def length_bytes(length):
+    """
+        Extra length bytes of a token field of 15
+    """
+    length -= 15
+    return bytes([255] * (length // 255) + [length % 255])
+
+
+def run_block(value, length):
+    """
+        LZ4 block of length times the byte value: one literal, a match on itself, the last 5 literals
+    """
+    match_length = length - 1 - 5
+    return (bytes([0x1F, value, 0x01, 0x00]) + length_bytes(match_length - 4) +
+            bytes([0x50]) + bytes([value] * 5))
+
+
+class LoopbackSerial:
+    """
+        Serial port replaying the bytes of the device, closed once they are all read
+    """
+
+    def __init__(self, data):
+        self.data = bytearray(data)
+        self.is_open = True
+
+    def read(self):
+        if not self.data:
+            self.is_open = False
+            return b''
+        byte = bytes(self.data[:1])
+        del self.data[:1]
+        return byte
+
+
+def receive(frame, cmd):
+    com = chameleon_com.ChameleonCom()
+    com.serial_instance = LoopbackSerial(frame)
+    com.wait_response_map[cmd] = {'response': None, 'start_time': time.time(), 'end_time': time.time() + 3}
+    com.thread_data_receive()
+    return com.wait_response_map[cmd]['response']
+
+
+class TestCompress(unittest.TestCase):
+
+    def test_literals(self):
+        self.assertEqual(chameleon_com.lz4_block_decompress(b'\x50hello', 4096), b'hello')
+        long = bytes(range(256)) + bytes(44)
+        self.assertEqual(chameleon_com.lz4_block_decompress(b'\xF0' + length_bytes(300) + long, 4096), long)
+        self.assertEqual(chameleon_com.lz4_block_decompress(b'', 4096), b'')
+
+    def test_matches(self):
+        # offset 1 and 3 overlap the bytes they copy
+        self.assertEqual(chameleon_com.lz4_block_decompress(bytes([0x1F]) + b'a\x01\x00\x05\x00', 4096), b'a' * 25)
+        self.assertEqual(chameleon_com.lz4_block_decompress(bytes([0x32]) + b'abc\x03\x00\x10!', 4096),
+                         b'abcabcabc!')
+        self.assertEqual(chameleon_com.lz4_block_decompress(bytes([0x40]) + b'abcd\x04\x00\x00', 4096), b'abcdabcd')
+        self.assertEqual(chameleon_com.lz4_block_decompress(run_block(0xFF, 4096), 4096), b'\xFF' * 4096)
+
+    def test_malformed(self):
+        for block in (bytes([0x10]) + b'a\x02\x00',      # offset before the data
+                      bytes([0x10]) + b'a\x00\x00',      # offset 0
+                      bytes([0x10]) + b'a\x01',          # truncated offset
+                      b'\x50abc',                        # truncated literals
+                      bytes([0xF0])):                    # truncated length
+            with self.assertRaises(ValueError):
+                chameleon_com.lz4_block_decompress(block, 4096)
+        with self.assertRaises(ValueError):
+            chameleon_com.lz4_block_decompress(run_block(0, 4097), 4096)
+
+    def test_compressed_frame(self):
+        com = chameleon_com.ChameleonCom()
+        frame = com.make_data_frame_bytes(Command.MF1_READ_EMU_BLOCK_DATA, run_block(0, 4096),
+                                          Status.SUCCESS | com.status_compressed)
+        response = receive(frame, Command.MF1_READ_EMU_BLOCK_DATA)
+        self.assertEqual(response.status, Status.SUCCESS)
+        self.assertEqual(response.data, bytes(4096))
+
+    def test_malformed_frame_dropped(self):
+        com = chameleon_com.ChameleonCom()
+        frame = com.make_data_frame_bytes(Command.MF1_READ_EMU_BLOCK_DATA, run_block(0, 5000),
+                                          Status.SUCCESS | com.status_compressed)
+        self.assertIsNone(receive(frame, Command.MF1_READ_EMU_BLOCK_DATA))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -2,6 +2,7 @@
 import os
 import sys
 import unittest
+import crypto1
 from crypto1 import Crypto1
 
 CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
@@ -80,5 +81,28 @@ class TestCrypto1(unittest.TestCase):
             key = 'FFFFFFFFFFFF'
         ))
 
+    def test_verify_keys(self):
+        keys = ['FFFFFFFFFFFF', 'a0a1a2a3a4a5', 'A9AC67832330', '000000000000']
+        self.assertEqual(Crypto1.verify_keys(0x65535D33, 0x2C198BE4, 0xFEDAC6D2, 0xCF0A3C7E, keys),
+                         ['A9AC67832330'])
+        self.assertEqual(Crypto1.verify_keys(0x65535D33, 0x2C198BE4, 0xFEDAC6D2, 0xCF0A3C7E, []), [])
+
+    @unittest.skipUnless(crypto1.is_native_available(), "crypto1_native library not built")
+    def test_native_matches_python(self):
+        native = crypto1._native
+        results = []
+        for _native in (native, None):
+            crypto1._native = _native
+            try:
+                state = Crypto1()
+                state.key = '974C262B9278'
+                ks = [state.lfsr48_u32(0x65535D33 ^ 0xBE2B7B5D, False), state.lfsr48_u32(0xB1E1B891, True),
+                      state.lfsr48_u8(0x5A, False), state.lfsr48_u8(0xA5, True)]
+                results.append((ks, state.key, Crypto1.prng_next(0xBE2B7B5D, 96)))
+            finally:
+                crypto1._native = native
+        self.assertEqual(results[0], results[1])
+
+
 if __name__ == '__main__':
     unittest.main()
\ No newline at end of file
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+import os
+import struct
+import sys
+import time
+import unittest
+import zlib
+
+CURRENT_DIR = os.path.split(os.path.abspath(__file__))[0]
+config_path = CURRENT_DIR.rsplit(os.sep, 1)[0]
+sys.path.append(config_path)
+
+import chameleon_com
+from chameleon_enum import Command, Status
+
+# same as DATA_FRAME_STREAM_CHUNK_MAX in dataframe.h
+STREAM_CHUNK_MAX = 4096 - struct.calcsize('!BI')
+
+
+class LoopbackSerial:
+    """
+        Serial port replaying the bytes of the device, closed once they are all read
+    """
+
+    def __init__(self, data):
+        self.data = bytearray(data)
+        self.is_open = True
+
+    def read(self):
+        if not self.data:
+            self.is_open = False
+            return b''
+        byte = bytes(self.data[:1])
+        del self.data[:1]
+        return byte
+
+
+def stream_frames(com, cmd, status, data, stream_id=1):
+    """
+        Frames of a streamed response, as data_frame_stream() makes them
+    """
+    frames = [com.make_data_frame_bytes(cmd, struct.pack('!BIIH', stream_id, len(data), zlib.crc32(data), status),
+                                        Status.STREAM_BEGIN)]
+    for offset in range(0, len(data), STREAM_CHUNK_MAX):
+        chunk = struct.pack('!BI', stream_id, offset) + data[offset:offset + STREAM_CHUNK_MAX]
+        frames.append(com.make_data_frame_bytes(cmd, chunk, Status.STREAM_DATA))
+    return frames
+
+
+def receive(frames, cmd):
+    com = chameleon_com.ChameleonCom()
+    com.serial_instance = LoopbackSerial(b''.join(frames))
+    com.wait_response_map[cmd] = {'response': None, 'start_time': time.time(), 'end_time': time.time() + 3}
+    com.thread_data_receive()
+    return com.wait_response_map[cmd]['response']
+
+
+class TestStream(unittest.TestCase):
+
+    def setUp(self):
+        self.com = chameleon_com.ChameleonCom()
+        # a full detection log, 1000 records
+        self.data = bytes((i * 31 + (i >> 9)) & 0xFF for i in range(18000))
+
+    def test_stream_reassembled(self):
+        for length in (0, 1, STREAM_CHUNK_MAX, STREAM_CHUNK_MAX + 1, len(self.data)):
+            data = self.data[:length]
+            response = receive(stream_frames(self.com, Command.MF1_GET_DETECTION_LOG, Status.SUCCESS, data),
+                               Command.MF1_GET_DETECTION_LOG)
+            self.assertIsNotNone(response, length)
+            self.assertEqual(response.status, Status.SUCCESS)
+            self.assertEqual(response.data, data)
+
+    def test_lost_frame(self):
+        frames = stream_frames(self.com, Command.MF1_GET_DETECTION_LOG, Status.SUCCESS, self.data)
+        del frames[2]
+        response = receive(frames, Command.MF1_GET_DETECTION_LOG)
+        self.assertEqual(response.status, Status.STREAM_CRC_ERR)
+
+    def test_corrupted_stream(self):
+        frames = stream_frames(self.com, Command.MF1_GET_DETECTION_LOG, Status.SUCCESS, self.data)
+        # valid frame, wrong content: only the stream crc32 can tell
+        frames[1] = self.com.make_data_frame_bytes(Command.MF1_GET_DETECTION_LOG,
+                                                   struct.pack('!BI', 1, 0) + bytes(STREAM_CHUNK_MAX),
+                                                   Status.STREAM_DATA)
+        response = receive(frames, Command.MF1_GET_DETECTION_LOG)
+        self.assertEqual(response.status, Status.STREAM_CRC_ERR)
+
+    def test_final_status(self):
+        response = receive(stream_frames(self.com, Command.MF1_READ_SECTORS, Status.HF_TAG_OK, self.data),
+                           Command.MF1_READ_SECTORS)
+        self.assertEqual(response.status, Status.HF_TAG_OK)
+        self.assertEqual(response.data, self.data)
+
+
+if __name__ == '__main__':
+    unittest.main()
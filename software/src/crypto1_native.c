@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// Native Crypto1 helpers for the python client (script/crypto1.py).
+//
+// Loaded through ctypes, the python side falls back to its pure python
+// implementation when this library is not available.
+//
+// The python Crypto1 class stores its state as a 48 bit integer in which the
+// key bytes are in reverse order (lfsr48), so every call converts the state
+// from and to the crapto1 odd/even representation.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+#include "crapto1.h"
+
+#if defined(_WIN32)
+#define CRYPTO1_NATIVE_EXPORT __declspec(dllexport)
+#else
+#define CRYPTO1_NATIVE_EXPORT __attribute__((visibility("default")))
+#endif
+
+static uint64_t swap_endian_u48(uint64_t x) {
+    uint64_t ret = 0;
+    for (int i = 0; i < 6; i++) {
+        ret = (ret << 8) | (x & 0xFF);
+        x >>= 8;
+    }
+    return ret;
+}
+
+static void lfsr48_to_state(uint64_t lfsr48, struct Crypto1State *s) {
+    crypto1_init(s, swap_endian_u48(lfsr48));
+}
+
+static uint64_t state_to_lfsr48(struct Crypto1State *s) {
+    uint64_t key;
+    crypto1_get_lfsr(s, &key);
+    return swap_endian_u48(key);
+}
+
+CRYPTO1_NATIVE_EXPORT uint8_t crypto1_native_lfsr48_u8(uint64_t *lfsr48, uint8_t in, int is_encrypted) {
+    struct Crypto1State s;
+    lfsr48_to_state(*lfsr48, &s);
+    uint8_t ret = crypto1_byte(&s, in, is_encrypted);
+    *lfsr48 = state_to_lfsr48(&s);
+    return ret;
+}
+
+CRYPTO1_NATIVE_EXPORT uint32_t crypto1_native_lfsr48_u32(uint64_t *lfsr48, uint32_t in, int is_encrypted) {
+    struct Crypto1State s;
+    lfsr48_to_state(*lfsr48, &s);
+    uint32_t ret = crypto1_word(&s, in, is_encrypted);
+    *lfsr48 = state_to_lfsr48(&s);
+    return ret;
+}
+
+CRYPTO1_NATIVE_EXPORT uint32_t crypto1_native_prng_successor(uint32_t x, uint32_t n) {
+    return prng_successor(x, n);
+}
+
+/**
+ * Check a list of candidate keys against one reader authentication (mfkey32 record).
+ * The expected reader answer only depends on nt, so it is computed once for all keys.
+ *
+ * @param keys      48 bit keys, most significant byte first (same as the hex string)
+ * @param results   one byte per key, set to 1 when the key decrypts ar_enc correctly
+ * @return          number of matching keys
+ */
+CRYPTO1_NATIVE_EXPORT size_t crypto1_native_verify_keys(uint32_t uid, uint32_t nt, uint32_t nr_enc, uint32_t ar_enc,
+                                                        const uint64_t *keys, size_t keys_len, uint8_t *results) {
+    struct Crypto1State s;
+    uint32_t ar = prng_successor(nt, 64);
+    size_t found = 0;
+    for (size_t i = 0; i < keys_len; i++) {
+        crypto1_init(&s, keys[i]);
+        crypto1_word(&s, uid ^ nt, 0);
+        crypto1_word(&s, nr_enc, 1);
+        results[i] = (ar_enc ^ crypto1_word(&s, 0, 0)) == ar;
+        found += results[i];
+    }
+    return found;
+}